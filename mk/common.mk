@@ -16,9 +16,9 @@ INSTALL  ?= install
 STRIP    ?= strip
 OBJCPY   ?= objcopy
 RPCGEN   ?= rpcgen
-BMAKE    ?= MAKEFLAGS= bmake
 DOCKER   ?= docker
 PATCH    ?= patch
+STRACE   ?= strace
 
 UID      := $(shell id -u)
 GID      := $(shell id -g)
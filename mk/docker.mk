@@ -19,7 +19,6 @@ GOLANG_VERSION ?= $(shell ./hack/golang-version.sh)
 # Global definitions. These are defined here to allow the docker targets to be
 # invoked directly without the root makefile.
 WITH_NVCGO   ?= yes
-WITH_LIBELF  ?= no
 WITH_TIRPC   ?= no
 WITH_SECCOMP ?= yes
 
@@ -92,7 +91,6 @@ docker-aarch64: $(AARCH64_TARGETS)
 # ppc64le targets
 PPC64LE_TARGETS := $(patsubst %, %-ppc64le, $(PPC64LE_TARGETS))
 $(PPC64LE_TARGETS): ARCH := ppc64le
-$(PPC64LE_TARGETS): WITH_LIBELF := yes
 $(PPC64LE_TARGETS): %: --%
 docker-ppc64le: $(PPC64LE_TARGETS)
 
@@ -134,12 +132,10 @@ docker-amd64-verify: $(patsubst %, %-verify, $(AMD64_TARGETS)) \
 
 # private ubuntu target with overrides
 --ubuntu22.04%: WITH_TIRPC = yes
---ubuntu22.04%: WITH_LIBELF = yes
 
 # private centos target with overrides
 --centos%: OS := centos
 --centos%: WITH_TIRPC = yes
---centos%: WITH_LIBELF = yes
 --centos8%: BASEIMAGE = quay.io/centos/centos:stream8
 
 # private opensuse-leap target with overrides
@@ -170,7 +166,6 @@ docker-build-%: $(ARTIFACTS_DIR)
 	    --build-arg OS_ARCH="$(ARCH)" \
 	    --build-arg GOLANG_VERSION="$(GOLANG_VERSION)" \
 	    --build-arg WITH_NVCGO="$(WITH_NVCGO)" \
-	    --build-arg WITH_LIBELF="$(WITH_LIBELF)" \
 	    --build-arg WITH_TIRPC="$(WITH_TIRPC)" \
 	    --build-arg WITH_SECCOMP="$(WITH_SECCOMP)" \
 	    --build-arg CFLAGS="$(CFLAGS)" \
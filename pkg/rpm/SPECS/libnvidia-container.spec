@@ -1,7 +1,5 @@
 Name: libnvidia-container
 License:        BSD-3-Clause AND Apache-2.0 AND GPL-3.0-or-later AND LGPL-3.0-or-later AND MIT AND GPL-2.0-only
-# elftoolchain is licensed under BSD-3-Clause
-#  https://github.com/elftoolchain/elftoolchain#copyright-and-license
 # libnvidia-container is licensed under apache-2.0
 #  https://github.com/NVIDIA/libnvidia-container/blob/main/LICENSE
 # libnvidia-container includes the GPLv3 license
@@ -0,0 +1,5 @@
+#define BUILD_DATE     "2026-10-16T22:16+00:00"
+#define BUILD_COMPILER "x86_64-linux-gnu-gcc-12 " __VERSION__
+#define BUILD_FLAGS    "-D_GNU_SOURCE -D_FORTIFY_SOURCE=2 -DNDEBUG -std=gnu11 -O2 -g -fdata-sections -ffunction-sections -fplan9-extensions -fstack-protector -fno-strict-aliasing -fvisibility=hidden -Wall -Wextra -Wcast-align -Wpointer-arith -Wmissing-prototypes -Wnonnull -Wwrite-strings -Wlogical-op -Wformat=2 -Wmissing-format-attribute -Winit-self -Wshadow -Wstrict-prototypes -Wunreachable-code -Wconversion -Wsign-conversion -Wno-unknown-warning-option -Wno-format-extra-args -Wno-gnu-alignof-expression -Wl,-zrelro -Wl,-znow -Wl,-zdefs -Wl,--gc-sections"
+#define BUILD_REVISION "749c7dedc85deed540113b2ca835db8f1ebd9a0a"
+#define BUILD_PLATFORM "x86_64"
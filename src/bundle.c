@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/file.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <libgen.h>
+#undef basename /* Use the GNU version of basename. */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef SYS_openat2
+# include <linux/openat2.h>
+#endif /* SYS_openat2 */
+
+#include "bundle.h"
+#include "utils.h"
+#include "xfuncs.h"
+
+/*
+ * A driver bundle is a directory populated once per driver version and set of container capabilities with the
+ * matching driver binaries and libraries (hard linked from the driver root when possible, copied otherwise).
+ * Containers get the whole bundle with a single bind mount instead of one bind mount per file, and only see the
+ * files their capabilities would have had mounted.
+ *
+ * Bundles of other driver versions are removed once the current one is staged, but only when no one uses them:
+ * the directory of a driver version is locked shared while its bundles are staged and mounted, and exclusively
+ * while it is removed, which also requires that no process has one of its bundles mounted at NV_BUNDLE_DIR.
+ */
+
+static int bundle_dir(struct error *, const char *);
+static int bundle_lock(struct error *, const char *);
+static int copy_file(struct error *, const char *, const char *, const struct stat *);
+static int stage_file(struct error *, const char *, const char *);
+static int stage_files(struct error *, const char *, const char *, const char *, char * const [], size_t, int32_t);
+static int remove_entry(const char *, const struct stat *, int, struct FTW *);
+static bool bundle_in_use(const char *);
+static void remove_stale_bundles(const char *);
+
+/*
+ * bundle_dir creates the directory path if needed and checks that no one else but us can write to it,
+ * since containers end up executing whatever it holds.
+ */
+static int
+bundle_dir(struct error *err, const char *path)
+{
+        struct stat s;
+
+        if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+                error_set(err, "mkdir failed: %s", path);
+                return (-1);
+        }
+        if (xlstat(err, path, &s) < 0)
+                return (-1);
+        if (!S_ISDIR(s.st_mode) || s.st_uid != geteuid() || (s.st_mode & (S_IWGRP|S_IWOTH))) {
+                error_setx(err, "insecure bundle directory: %s", path);
+                return (-1);
+        }
+        return (0);
+}
+
+/*
+ * bundle_lock creates and locks the directory of a driver version for sharing, and returns the locked descriptor.
+ * The directory might get removed while we wait for the lock, in which case we start over.
+ */
+static int
+bundle_lock(struct error *err, const char *path)
+{
+        struct stat s, d;
+        int fd;
+
+        for (;;) {
+                if (bundle_dir(err, path) < 0)
+                        return (-1);
+                if ((fd = xopen(err, path, O_RDONLY|O_DIRECTORY|O_CLOEXEC)) < 0)
+                        return (-1);
+                if (flock(fd, LOCK_SH) < 0 || fstat(fd, &s) < 0) {
+                        error_set(err, "lock failed: %s", path);
+                        xclose(fd);
+                        return (-1);
+                }
+                if (stat(path, &d) == 0 && d.st_dev == s.st_dev && d.st_ino == s.st_ino)
+                        return (fd);
+                xclose(fd);
+        }
+}
+
+static int
+copy_file(struct error *err, const char *src, const char *dst, const struct stat *s)
+{
+        int sfd, dfd;
+        off_t off = 0;
+        ssize_t n;
+        int rv = -1;
+
+        if ((sfd = xopen(err, src, O_RDONLY|O_CLOEXEC)) < 0)
+                return (-1);
+        if ((dfd = open(dst, O_WRONLY|O_CREAT|O_EXCL|O_CLOEXEC, s->st_mode & 0755)) < 0) {
+                error_set(err, "open failed: %s", dst);
+                xclose(sfd);
+                return (-1);
+        }
+        while (off < s->st_size) {
+                if ((n = sendfile(dfd, sfd, &off, (size_t)(s->st_size - off))) < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        error_set(err, "copy failed: %s", src);
+                        goto fail;
+                }
+                if (n == 0) {
+                        error_setx(err, "copy failed: %s: unexpected end of file", src);
+                        goto fail;
+                }
+        }
+        if (futimens(dfd, (struct timespec[2]){s->st_atim, s->st_mtim}) < 0) {
+                error_set(err, "copy failed: %s", dst);
+                goto fail;
+        }
+        rv = 0;
+
+ fail:
+        xclose(sfd);
+        if (close(dfd) < 0 && rv == 0) {
+                error_set(err, "copy failed: %s", dst);
+                rv = -1;
+        }
+        if (rv < 0)
+                unlink(dst);
+        return (rv);
+}
+
+static int
+stage_file(struct error *err, const char *src, const char *dst)
+{
+        char tmp[PATH_MAX];
+        struct stat s, d;
+        int n;
+
+        if (xstat(err, src, &s) < 0)
+                return (-1);
+        if (!S_ISREG(s.st_mode)) {
+                error_setx(err, "unexpected source file mode %o for %s", s.st_mode, src);
+                return (-1);
+        }
+
+        /* Files already staged are either hard links to the source or copies with the same size and mtime. */
+        if (lstat(dst, &d) == 0 && S_ISREG(d.st_mode)) {
+                if (d.st_dev == s.st_dev && d.st_ino == s.st_ino)
+                        return (0);
+                if (d.st_size == s.st_size && d.st_mtim.tv_sec == s.st_mtim.tv_sec && d.st_mtim.tv_nsec == s.st_mtim.tv_nsec)
+                        return (0);
+        }
+
+        if ((n = snprintf(tmp, sizeof(tmp), "%s.%ld", dst, (long)getpid())) < 0 || (size_t)n >= sizeof(tmp)) {
+                error_setx(err, "path error: %s", dst);
+                return (-1);
+        }
+        unlink(tmp);
+        log_infof("staging %s at %s", src, dst);
+        if (link(src, tmp) < 0) {
+                if (errno != EXDEV && errno != EPERM) {
+                        error_set(err, "link failed: %s", src);
+                        return (-1);
+                }
+                if (copy_file(err, src, tmp, &s) < 0)
+                        return (-1);
+        }
+        if (rename(tmp, dst) < 0) {
+                error_set(err, "rename failed: %s", tmp);
+                unlink(tmp);
+                return (-1);
+        }
+        return (0);
+}
+
+static int
+stage_files(struct error *err, const char *root, const char *bundle, const char *subdir, char * const paths[], size_t size, int32_t flags)
+{
+        char src[PATH_MAX];
+        char dst[PATH_MAX];
+        char *src_end, *dst_end;
+
+        if (path_new(err, src, root) < 0)
+                return (-1);
+        if (path_join(err, dst, bundle, subdir) < 0)
+                return (-1);
+        if (file_create(err, dst, NULL, geteuid(), getegid(), MODE_DIR(0755)) < 0)
+                return (-1);
+        src_end = src + strlen(src);
+        dst_end = dst + strlen(dst);
+
+        for (size_t i = 0; i < size; ++i) {
+                if (!match_binary_flags(basename(paths[i]), flags) && !match_library_flags(basename(paths[i]), flags))
+                        continue;
+                if (path_append(err, src, paths[i]) < 0)
+                        return (-1);
+                if (path_append(err, dst, basename(paths[i])) < 0)
+                        return (-1);
+                if (stage_file(err, src, dst) < 0)
+                        return (-1);
+                *src_end = '\0';
+                *dst_end = '\0';
+        }
+        return (0);
+}
+
+int
+bundle_path(struct error *err, const struct nvc_driver_info *info, int32_t flags, char *path)
+{
+        char caps[16];
+
+        if (strchr(info->nvrm_version, '/') != NULL || str_equal(info->nvrm_version, "..")) {
+                error_setx(err, "invalid driver version: %s", info->nvrm_version);
+                return (-1);
+        }
+        if (xsnprintf(err, caps, sizeof(caps), "%x", (unsigned int)(flags & NV_BUNDLE_FLAGS)) < 0)
+                return (-1);
+        if (path_join(err, path, NV_BUNDLE_HOST_DIR, info->nvrm_version) < 0)
+                return (-1);
+        return (path_append(err, path, caps));
+}
+
+static int
+remove_entry(const char *path, maybe_unused const struct stat *s, int flag, maybe_unused struct FTW *ftw)
+{
+        if (flag == FTW_DP)
+                return (rmdir(path));
+        if (flag == FTW_F || flag == FTW_SL || flag == FTW_SLN)
+                return (unlink(path));
+        return (-1);
+}
+
+/*
+ * bundle_in_use checks whether any process has one of the bundles of path mounted at NV_BUNDLE_DIR.
+ * Processes which can't be inspected count as users, and so does everyone if openat2 isn't available.
+ */
+static bool
+bundle_in_use(maybe_unused const char *path)
+{
+#ifdef SYS_openat2
+        struct open_how how = {
+                .flags = O_PATH|O_DIRECTORY|O_CLOEXEC,
+                .resolve = RESOLVE_IN_ROOT|RESOLVE_NO_MAGICLINKS,
+        };
+        struct stat bundles[16];
+        size_t nbundles = 0;
+        char proc[32];
+        struct stat s;
+        DIR *d;
+        struct dirent *e;
+        int root, fd;
+        bool rv = true;
+
+        if ((d = opendir(path)) == NULL)
+                return (true);
+        while ((e = readdir(d)) != NULL) {
+                if (e->d_type != DT_DIR || str_equal(e->d_name, ".") || str_equal(e->d_name, ".."))
+                        continue;
+                if (nbundles == nitems(bundles) || fstatat(dirfd(d), e->d_name, &bundles[nbundles++], AT_SYMLINK_NOFOLLOW) < 0) {
+                        closedir(d);
+                        return (true);
+                }
+        }
+        closedir(d);
+
+        if ((d = opendir("/proc")) == NULL)
+                return (true);
+        while ((e = readdir(d)) != NULL) {
+                if (strspn(e->d_name, "0123456789") != strlen(e->d_name))
+                        continue;
+                snprintf(proc, sizeof(proc), "/proc/%s/root", e->d_name);
+                if ((root = open(proc, O_PATH|O_DIRECTORY|O_CLOEXEC)) < 0) {
+                        if (errno == ENOENT || errno == ESRCH)
+                                continue;
+                        goto done;
+                }
+                fd = (int)syscall(SYS_openat2, root, NV_BUNDLE_DIR, &how, sizeof(how));
+                close(root);
+                if (fd < 0) {
+                        if (errno == ENOENT || errno == ENOTDIR || errno == ESRCH)
+                                continue;
+                        goto done;
+                }
+                if (fstat(fd, &s) < 0) {
+                        close(fd);
+                        goto done;
+                }
+                close(fd);
+                for (size_t i = 0; i < nbundles; ++i) {
+                        if (s.st_dev == bundles[i].st_dev && s.st_ino == bundles[i].st_ino)
+                                goto done;
+                }
+        }
+        rv = false;
+
+ done:
+        closedir(d);
+        return (rv);
+#else
+        return (true);
+#endif /* SYS_openat2 */
+}
+
+static void
+remove_stale_bundles(const char *current)
+{
+        char path[PATH_MAX];
+        DIR *d;
+        struct dirent *e;
+        int fd;
+
+        if ((d = opendir(NV_BUNDLE_HOST_DIR)) == NULL)
+                return;
+        while ((e = readdir(d)) != NULL) {
+                if (e->d_type != DT_DIR || str_equal(e->d_name, ".") || str_equal(e->d_name, ".."))
+                        continue;
+                if (str_equal(e->d_name, current))
+                        continue;
+                if (path_join(NULL, path, NV_BUNDLE_HOST_DIR, e->d_name) < 0)
+                        continue;
+                /* Bundles being staged or mounted hold the lock, mounted ones are looked for in every process. */
+                if ((fd = open(path, O_RDONLY|O_DIRECTORY|O_CLOEXEC)) < 0)
+                        continue;
+                if (flock(fd, LOCK_EX|LOCK_NB) < 0 || bundle_in_use(path)) {
+                        log_infof("keeping stale driver bundle %s still in use", path);
+                        close(fd);
+                        continue;
+                }
+                log_infof("removing stale driver bundle %s", path);
+                if (nftw(path, remove_entry, 16, FTW_DEPTH|FTW_PHYS|FTW_MOUNT) < 0)
+                        log_warnf("failed to remove stale driver bundle %s: %s", path, strerror(errno));
+                close(fd);
+        }
+        closedir(d);
+}
+
+/*
+ * bundle_stage stages the bundle of the driver files matching flags at path, and returns a descriptor holding
+ * the bundle in use until closed (i.e. once the bundle is mounted).
+ */
+int
+bundle_stage(struct error *err, const char *root, const struct nvc_driver_info *info, int32_t flags, char *path)
+{
+        char dir[PATH_MAX];
+        int lock;
+
+        if (bundle_path(err, info, flags, path) < 0)
+                return (-1);
+        if (path_join(err, dir, NV_BUNDLE_HOST_DIR, info->nvrm_version) < 0)
+                return (-1);
+        if (bundle_dir(err, NV_BUNDLE_STATE_DIR) < 0 || bundle_dir(err, NV_BUNDLE_HOST_DIR) < 0)
+                return (-1);
+        if ((lock = bundle_lock(err, dir)) < 0)
+                return (-1);
+        if (bundle_dir(err, path) < 0)
+                goto fail;
+        if (stage_files(err, root, path, NV_BUNDLE_BINS_SUBDIR, info->bins, info->nbins, flags) < 0)
+                goto fail;
+        if (stage_files(err, root, path, NV_BUNDLE_LIBS_SUBDIR, info->libs, info->nlibs, flags) < 0)
+                goto fail;
+        if ((flags & OPT_COMPAT32) &&
+            stage_files(err, root, path, NV_BUNDLE_LIBS32_SUBDIR, info->libs32, info->nlibs32, flags) < 0)
+                goto fail;
+        remove_stale_bundles(info->nvrm_version);
+        return (lock);
+
+ fail:
+        xclose(lock);
+        return (-1);
+}
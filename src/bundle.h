@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HEADER_BUNDLE_H
+#define HEADER_BUNDLE_H
+
+#include <paths.h>
+
+#include "error.h"
+#include "nvc_internal.h"
+#include "options.h"
+
+/* Host directory holding the driver bundles of each driver version, one per set of bundle flags. */
+#define NV_BUNDLE_STATE_DIR     "/var/lib/nvidia-container"
+#define NV_BUNDLE_HOST_DIR      NV_BUNDLE_STATE_DIR "/bundles"
+/* Container directory where the driver bundle gets mounted. */
+#define NV_BUNDLE_DIR           _PATH_VARRUN "nvidia-container-driver"
+
+#define NV_BUNDLE_BINS_SUBDIR   "bin"
+#define NV_BUNDLE_LIBS_SUBDIR   "lib"
+#define NV_BUNDLE_LIBS32_SUBDIR "lib32"
+
+/* Container flags selecting the files of a bundle. */
+#define NV_BUNDLE_FLAGS (OPT_UTILITY_BINS|OPT_COMPUTE_BINS|OPT_UTILITY_LIBS|OPT_COMPUTE_LIBS|OPT_NGX_LIBS| \
+                         OPT_VIDEO_LIBS|OPT_GRAPHICS_LIBS|OPT_COMPAT32)
+
+int bundle_path(struct error *, const struct nvc_driver_info *, int32_t, char *);
+int bundle_stage(struct error *, const char *, const struct nvc_driver_info *, int32_t, char *);
+
+#endif /* HEADER_BUNDLE_H */
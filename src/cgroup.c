@@ -23,13 +23,14 @@
 #include "cgroup.h"
 #include "options.h"
 #include "nvcgo.h"
+#include "trace.h"
 #include "rpc.h"
 
 int
-get_device_cgroup_version(struct error *err, const struct nvc_container *cnt)
+get_device_cgroup_version(struct error *err, const struct nvc_context *ctx, const struct nvc_container *cnt)
 {
         struct nvcgo_get_device_cgroup_version_res res = {0};
-        struct nvcgo *nvcgo = nvcgo_get_context();
+        struct nvcgo *nvcgo = ctx->nvcgo;
         int rv = -1;
 
         const char* proc_root = (cnt->flags & OPT_STANDALONE) ? cnt->cfg.rootfs : "/";
@@ -83,11 +84,12 @@ nvcgo_get_device_cgroup_version_1_svc(ptr_t ctxptr, char *proc_root, pid_t pid,
 }
 
 char *
-find_device_cgroup_path(struct error *err, const struct nvc_container *cnt)
+find_device_cgroup_path(struct error *err, const struct nvc_context *ctx, const struct nvc_container *cnt)
 {
         struct nvcgo_find_device_cgroup_path_res res = {0};
-        struct nvcgo *nvcgo = nvcgo_get_context();
+        struct nvcgo *nvcgo = ctx->nvcgo;
         char *cgroup_path = NULL;
+        trace_func();
 
         pid_t pid = (cnt->flags & OPT_STANDALONE) ? cnt->cfg.pid : getppid();
         const char* proc_root = (cnt->flags & OPT_STANDALONE) ? cnt->cfg.rootfs : "/";
@@ -163,47 +165,68 @@ nvcgo_find_device_cgroup_path_1_svc(ptr_t ctxptr, int dev_cg_version, char *proc
 }
 
 int
-setup_device_cgroup(struct error *err, const struct nvc_container *cnt, dev_t id)
+setup_device_cgroup(struct error *err, const struct nvc_context *ctx, const struct nvc_container *cnt, const dev_t ids[], size_t size)
 {
         struct nvcgo_setup_device_cgroup_res res = {0};
-        struct nvcgo *nvcgo = nvcgo_get_context();
+        struct nvcgo *nvcgo = ctx->nvcgo;
+        nvcgo_device_ids devs = {0};
+        bool_t use_map = (cnt->flags & OPT_CGROUP_DEVICE_MAP) ? true : false;
         int rv = -1;
+        trace_func();
 
-        if (call_rpc(err, &nvcgo->rpc, &res, nvcgo_setup_device_cgroup_1, cnt->dev_cg_version, cnt->dev_cg, id) < 0)
+        if (size == 0)
+                return (0);
+
+        if ((devs.nvcgo_device_ids_val = xcalloc(err, size, sizeof(*devs.nvcgo_device_ids_val))) == NULL)
+                return (-1);
+        devs.nvcgo_device_ids_len = (u_int)size;
+        for (size_t i = 0; i < size; ++i) {
+                log_infof("whitelisting device node %u:%u", major(ids[i]), minor(ids[i]));
+                devs.nvcgo_device_ids_val[i] = ids[i];
+        }
+        if (call_rpc(err, &nvcgo->rpc, &res, nvcgo_setup_device_cgroup_1, cnt->dev_cg_version, cnt->dev_cg, devs, use_map) < 0)
                 goto fail;
         rv = 0;
 
  fail:
-        xdr_free((xdrproc_t)xdr_nvcgo_find_device_cgroup_path_res, (caddr_t)&res);
+        free(devs.nvcgo_device_ids_val);
+        xdr_free((xdrproc_t)xdr_nvcgo_setup_device_cgroup_res, (caddr_t)&res);
         return (rv);
 }
 
 bool_t
-nvcgo_setup_device_cgroup_1_svc(ptr_t ctxptr, int dev_cg_version, char *dev_cg, dev_t id, nvcgo_setup_device_cgroup_res *res, maybe_unused struct svc_req *req)
+nvcgo_setup_device_cgroup_1_svc(ptr_t ctxptr, int dev_cg_version, char *dev_cg, nvcgo_device_ids ids, bool_t use_map, nvcgo_setup_device_cgroup_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
         struct nvcgo *nvcgo = (struct nvcgo *)ctxptr;
+        struct device_rule *rules = NULL;
+        GoSlice rules_slice = {0};
         char *rerr = NULL;
         int rv = -1;
 
-        struct device_rule rules[] = {
-                {
+        memset(res, 0, sizeof(*res));
+
+        // Build a single set of rules out of all the devices requested so
+        // that the whole set is applied with one 'AddDeviceRules()' call
+        // (i.e. a single eBPF program generation per cgroup for v2).
+        if ((rules = xcalloc(err, ids.nvcgo_device_ids_len, sizeof(*rules))) == NULL)
+                goto fail;
+        for (u_int i = 0; i < ids.nvcgo_device_ids_len; ++i) {
+                rules[i] = (struct device_rule){
                         .allow  = true,
                         .type   = "c",
                         .access = "rw",
-                        .major  = major(id),
-                        .minor  = minor(id),
-                },
-        };
+                        .major  = major(ids.nvcgo_device_ids_val[i]),
+                        .minor  = minor(ids.nvcgo_device_ids_val[i]),
+                };
+        }
 
-        GoSlice rules_slice = {
-                .data = &rules,
-                .len = sizeof(rules)/sizeof(rules[0]),
-                .cap = sizeof(rules)/sizeof(rules[0]),
+        rules_slice = (GoSlice){
+                .data = rules,
+                .len = ids.nvcgo_device_ids_len,
+                .cap = ids.nvcgo_device_ids_len,
         };
 
-        memset(res, 0, sizeof(*res));
-
         // Explicitly set CAP_EFFECTIVE to NVC_MOUNT across the 'AddDeviceRules()' call.
         // This is only done because we happen to know these are the effective
         // capabilities set by the nvidia-container-cli (i.e. the only known
@@ -214,7 +237,7 @@ nvcgo_setup_device_cgroup_1_svc(ptr_t ctxptr, int dev_cg_version, char *dev_cg,
         if (perm_set_capabilities(err, CAP_EFFECTIVE, ecaps[NVC_MOUNT], ecaps_size(NVC_MOUNT)) < 0)
                 goto fail;
 
-        if ((rv = nvcgo->api.AddDeviceRules(dev_cg_version, dev_cg, rules_slice, &rerr)) < 0) {
+        if ((rv = nvcgo->api.AddDeviceRules(dev_cg_version, dev_cg, rules_slice, use_map, &rerr)) < 0) {
                 error_setx(err, "failed to add device rules: %s", rerr);
                 goto fail;
         }
@@ -223,6 +246,7 @@ nvcgo_setup_device_cgroup_1_svc(ptr_t ctxptr, int dev_cg_version, char *dev_cg,
 
 fail:
         free(rerr);
+        free(rules);
         if (perm_set_capabilities(err, CAP_EFFECTIVE, NULL, 0) < 0)
                 rv = -1;
         if (rv < 0)
@@ -22,8 +22,8 @@
 #include "error.h"
 #include "nvc_internal.h"
 
-int  get_device_cgroup_version(struct error *, const struct nvc_container *);
-char *find_device_cgroup_path(struct error *, const struct nvc_container *);
-int  setup_device_cgroup(struct error *, const struct nvc_container *, dev_t);
+int  get_device_cgroup_version(struct error *, const struct nvc_context *, const struct nvc_container *);
+char *find_device_cgroup_path(struct error *, const struct nvc_context *, const struct nvc_container *);
+int  setup_device_cgroup(struct error *, const struct nvc_context *, const struct nvc_container *, const dev_t [], size_t);
 
 #endif /* HEADER_CGROUP_H */
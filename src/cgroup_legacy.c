@@ -21,6 +21,7 @@
 #include "cgroup.h"
 #include "error.h"
 #include "options.h"
+#include "trace.h"
 
 typedef char *(*parse_fn)(char *, char *, const char *);
 
@@ -29,15 +30,16 @@ static char *cgroup_root(char *, char *, const char *);
 static char *parse_proc_file(struct error *, const char *, parse_fn, char *, const char *);
 
 int
-get_device_cgroup_version(struct error *err, const struct nvc_container *cnt)
+get_device_cgroup_version(struct error *err, const struct nvc_context *ctx, const struct nvc_container *cnt)
 {
         (void)err;
+        (void)ctx;
         (void)cnt;
         return 1;
 }
 
 char *
-find_device_cgroup_path(struct error *err, const struct nvc_container *cnt)
+find_device_cgroup_path(struct error *err, maybe_unused const struct nvc_context *ctx, const struct nvc_container *cnt)
 {
         pid_t pid;
         const char *prefix;
@@ -46,6 +48,7 @@ find_device_cgroup_path(struct error *err, const struct nvc_container *cnt)
         char *mount = NULL;
         char *root = NULL;
         char *cgroup = NULL;
+        trace_func();
 
         pid = (cnt->flags & OPT_STANDALONE) ? cnt->cfg.pid : getppid();
         prefix = (cnt->flags & OPT_STANDALONE) ? cnt->cfg.rootfs : "";
@@ -68,22 +71,31 @@ find_device_cgroup_path(struct error *err, const struct nvc_container *cnt)
 }
 
 int
-setup_device_cgroup(struct error *err, const struct nvc_container *cnt, dev_t id)
+setup_device_cgroup(struct error *err, maybe_unused const struct nvc_context *ctx, const struct nvc_container *cnt, const dev_t ids[], size_t size)
 {
         char path[PATH_MAX];
         FILE *fs;
         int rv = -1;
+        trace_func();
 
+        if (size == 0)
+                return (0);
         if (path_join(err, path, cnt->dev_cg, "devices.allow") < 0)
                 return (-1);
         if ((fs = xfopen(err, path, "a")) == NULL)
                 return (-1);
 
-        log_infof("whitelisting device node %u:%u", major(id), minor(id));
-        /* XXX fprintf doesn't seem to catch the write errors, flush the stream explicitly instead. */
-        if (fprintf(fs, "c %u:%u rw", major(id), minor(id)) < 0 || fflush(fs) == EOF || ferror(fs)) {
-                error_set(err, "write error: %s", path);
-                goto fail;
+        /*
+         * The kernel parses a single rule per write, so flush after every entry
+         * but keep the file open across the whole set.
+         */
+        for (size_t i = 0; i < size; ++i) {
+                log_infof("whitelisting device node %u:%u", major(ids[i]), minor(ids[i]));
+                /* XXX fprintf doesn't seem to catch the write errors, flush the stream explicitly instead. */
+                if (fprintf(fs, "c %u:%u rw", major(ids[i]), minor(ids[i])) < 0 || fflush(fs) == EOF || ferror(fs)) {
+                        error_set(err, "write error: %s", path);
+                        goto fail;
+                }
         }
         rv = 0;
 
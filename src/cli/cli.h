@@ -43,6 +43,8 @@ struct context {
         size_t nreqs;
         char *ldconfig;
         char *container_flags;
+        bool batch;
+        bool dry_run;
 
         /* list */
         bool compat32;
@@ -56,6 +58,9 @@ struct context {
         char *mig_monitor;
         char *imex_channels;
         char *driver_opts;
+
+        /* daemon */
+        char *socket;
 };
 
 bool matches_pci_format(const char *gpu, char *buf, size_t bufsize);
@@ -102,9 +107,11 @@ int select_mig_monitor_devices(
 extern const struct argp info_usage;
 extern const struct argp list_usage;
 extern const struct argp configure_usage;
+extern const struct argp daemon_usage;
 
 int info_command(const struct context *);
 int list_command(const struct context *);
 int configure_command(const struct context *);
+int daemon_command(const struct context *);
 
 #endif /* HEADER_CLI_H */
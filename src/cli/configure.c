@@ -3,6 +3,7 @@
  */
 
 #include <err.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "cli.h"
@@ -14,6 +15,12 @@ static int check_cuda_version(const struct dsl_data *, enum dsl_comparator, cons
 static int check_driver_version(const struct dsl_data *, enum dsl_comparator, const char *);
 static int check_device_arch(const struct dsl_data *, enum dsl_comparator, const char *);
 static int check_device_brand(const struct dsl_data *, enum dsl_comparator, const char *);
+static int configure_container(const struct context *, struct nvc_context *, const struct nvc_config *,
+    const struct nvc_driver_info *, const struct nvc_device_info *);
+static int print_mount_plan(struct nvc_context *, const struct nvc_container *, const struct nvc_driver_info *, const struct devices *);
+static int configure_batch(const struct context *, struct nvc_context *, const struct nvc_config *);
+static int dry_run_init_flags(struct error *, const char *, char **);
+static int parse_record(struct error *, const struct context *, char *, struct context *);
 
 const struct argp configure_usage = {
         (const struct argp_option[]){
@@ -39,6 +46,13 @@ const struct argp configure_usage = {
                 {"no-gsp-firmware", 0x88, NULL, 0, "Don't include GSP Firmware", -1},
                 {"no-cntlibs", 0x89, NULL, 0, "[Deprecated] Equivalent to --cuda-compat-mode=disabled", -1},
                 {"cuda-compat-mode", 0x90, "MODE", 0, "The mode to use to support CUDA Forward Compatibility. One of [ mount (default) | ldconfig | disabled]", -1},
+                {"cgroup-device-map", 0x91, NULL, 0, "Use an eBPF map to grant devices under cgroupv2", -1},
+                {"driver-bundle", 0x92, NULL, 0, "Mount the driver files from a per-version bundle with a single bind mount", -1},
+                {"ldcache-store", 0x93, NULL, 0, "Reuse the ldcache computed for identical containers from a node-local store", -1},
+                {"batch", 0x94, NULL, 0, "Configure the containers listed on the standard input", -1},
+                {"dry-run", 0x95, NULL, 0, "Print the driver and GPU device mounts as JSON without changing anything "
+                    "(MIG, IMEX and ldcache setup are not included, kernel modules are not loaded)", -1},
+                {"mknod-devices", 0x96, NULL, 0, "Create the device nodes in the container instead of bind mounting them when permitted", -1},
                 {0},
         },
         configure_parser,
@@ -46,7 +60,10 @@ const struct argp configure_usage = {
         "Configure a container with GPU support by exposing device drivers to it.\n\n"
         "This command enters the namespace of the container process referred by PID (or the current parent process if none specified) "
         "and performs the necessary steps to ensure that the given capabilities are available inside the container.\n"
-        "It is assumed that the container has been created but not yet started, and the host filesystem is accessible (i.e. chroot/pivot_root hasn't been called).",
+        "It is assumed that the container has been created but not yet started, and the host filesystem is accessible (i.e. chroot/pivot_root hasn't been called).\n\n"
+        "With --batch, ROOTFS is omitted and the containers are read from the standard input, one per line as \"PID ROOTFS DEVICES [FLAG...]\", "
+        "where DEVICES is a list of device UUID(s) or index(es) (or - for none) and FLAG(s) are additional container flags (e.g. compute utility). "
+        "The driver is initialized once for all of them and a status line is printed for each container as it is configured.",
         NULL,
         NULL,
         NULL,
@@ -180,8 +197,42 @@ configure_parser(int key, char *arg, struct argp_state *state)
                 if (str_join(&err, &ctx->container_flags, arg, "=") < 0)
                         goto fatal;
                 break;
+        case 0x91:
+                if (libnvc.version()->major == 0)
+                        break;
+                if (str_join(&err, &ctx->container_flags, "cgroup-device-map", " ") < 0)
+                        goto fatal;
+                break;
+        case 0x92:
+                if (libnvc.version()->major == 0)
+                        break;
+                if (str_join(&err, &ctx->container_flags, "driver-bundle", " ") < 0)
+                        goto fatal;
+                break;
+        case 0x93:
+                if (libnvc.version()->major == 0)
+                        break;
+                if (str_join(&err, &ctx->container_flags, "ldcache-store", " ") < 0)
+                        goto fatal;
+                break;
+        case 0x94:
+                ctx->batch = true;
+                break;
+        case 0x95:
+                if (libnvc.version()->major == 0) {
+                        error_setx(&err, "dry-run is not supported by this library version");
+                        goto fatal;
+                }
+                ctx->dry_run = true;
+                break;
+        case 0x96:
+                if (libnvc.version()->major == 0)
+                        break;
+                if (str_join(&err, &ctx->container_flags, "mknod-devices", " ") < 0)
+                        goto fatal;
+                break;
         case ARGP_KEY_ARG:
-                if (state->arg_num > 0)
+                if (state->arg_num > 0 || ctx->batch)
                         argp_usage(state);
                 if (arg[0] != '/' || str_equal(arg, "/")) {
                         error_setx(&err, "invalid rootfs directory");
@@ -190,6 +241,14 @@ configure_parser(int key, char *arg, struct argp_state *state)
                 ctx->rootfs = arg;
                 break;
         case ARGP_KEY_SUCCESS:
+                /* The container PID and rootfs come from the records in batch mode (see parse_record). */
+                if (ctx->batch) {
+                        if (ctx->pid > 0 || ctx->rootfs != NULL || ctx->devices != NULL) {
+                                error_setx(&err, "pid, rootfs and devices can't be given with batch");
+                                goto fatal;
+                        }
+                        break;
+                }
                 if (ctx->pid > 0) {
                         if (str_join(&err, &ctx->container_flags, "supervised", " ") < 0)
                                 goto fatal;
@@ -198,9 +257,14 @@ configure_parser(int key, char *arg, struct argp_state *state)
                         if (str_join(&err, &ctx->container_flags, "standalone", " ") < 0)
                                 goto fatal;
                 }
+                /* Apply all the device cgroup rules at once after the mounts are done. */
+                if (libnvc.version()->major != 0) {
+                        if (str_join(&err, &ctx->container_flags, "defer-cgroups", " ") < 0)
+                                goto fatal;
+                }
                 break;
         case ARGP_KEY_END:
-                if (state->arg_num < 1)
+                if (state->arg_num < 1 && !ctx->batch)
                         argp_usage(state);
                 break;
         default:
@@ -257,11 +321,10 @@ check_device_brand(const struct dsl_data *data, enum dsl_comparator cmp, const c
         return (dsl_compare_string(data->dev->brand, cmp, brand));
 }
 
-int
-configure_command(const struct context *ctx)
+static int
+configure_container(const struct context *ctx, struct nvc_context *nvc, const struct nvc_config *nvc_cfg,
+    const struct nvc_driver_info *shared_drv, const struct nvc_device_info *shared_dev)
 {
-        struct nvc_context *nvc = NULL;
-        struct nvc_config *nvc_cfg = NULL;
         struct nvc_driver_info *drv = NULL;
         struct nvc_device_info *dev = NULL;
         struct nvc_container *cnt = NULL;
@@ -271,91 +334,71 @@ configure_command(const struct context *ctx)
         struct devices mig_config_devices = {0};
         struct devices mig_monitor_devices = {0};
         struct error err = {0};
-        int rv = EXIT_FAILURE;
-
-        if (perm_set_capabilities(&err, CAP_PERMITTED, pcaps, nitems(pcaps)) < 0 ||
-            perm_set_capabilities(&err, CAP_INHERITABLE, NULL, 0) < 0 ||
-            perm_set_bounds(&err, bcaps, nitems(bcaps)) < 0) {
-                warnx("permission error: %s", err.msg);
-                return (rv);
-        }
+        int rv = -1;
 
-        /* Initialize the library and container contexts. */
-        int c = ctx->load_kmods ? NVC_INIT_KMODS : NVC_INIT;
-        if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[c], ecaps_size(c)) < 0) {
+        if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[NVC_CONTAINER], ecaps_size(NVC_CONTAINER)) < 0) {
                 warnx("permission error: %s", err.msg);
                 goto fail;
         }
-        if ((nvc = libnvc.context_new()) == NULL ||
-            (nvc_cfg = libnvc.config_new()) == NULL ||
-            (cnt_cfg = libnvc.container_config_new(ctx->pid, ctx->rootfs)) == NULL) {
+        if ((cnt_cfg = libnvc.container_config_new(ctx->pid, ctx->rootfs)) == NULL) {
                 warn("memory allocation failed");
                 goto fail;
         }
-        nvc->no_pivot = ctx->no_pivot;
-        nvc_cfg->uid = ctx->uid;
-        nvc_cfg->gid = ctx->gid;
-        nvc_cfg->root = ctx->root;
-        nvc_cfg->ldcache = ctx->ldcache;
-        if (parse_imex_info(&err, ctx->imex_channels, &nvc_cfg->imex) < 0) {
-                warnx("error parsing IMEX info: %s", err.msg);
-                goto fail;
-        }
-        if (libnvc.init(nvc, nvc_cfg, ctx->init_flags) < 0) {
-                warnx("initialization error: %s", libnvc.error(nvc));
-                goto fail;
-        }
-        if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[NVC_CONTAINER], ecaps_size(NVC_CONTAINER)) < 0) {
-                warnx("permission error: %s", err.msg);
-                goto fail;
-        }
         cnt_cfg->ldconfig = ctx->ldconfig;
         if ((cnt = libnvc.container_new(nvc, cnt_cfg, ctx->container_flags)) == NULL) {
                 warnx("container error: %s", libnvc.error(nvc));
                 goto fail;
         }
 
-        /* Query the driver and device information. */
-        if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[NVC_INFO], ecaps_size(NVC_INFO)) < 0) {
-                warnx("permission error: %s", err.msg);
-                goto fail;
-        }
-        if ((drv = libnvc.driver_info_new(nvc, ctx->driver_opts)) == NULL ||
-            (dev = libnvc.device_info_new(nvc, NULL)) == NULL) {
-                warnx("detection error: %s", libnvc.error(nvc));
-                goto fail;
+        /* Query the driver and device information, unless it is shared between containers. */
+        if (shared_drv == NULL || shared_dev == NULL) {
+                if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[NVC_INFO], ecaps_size(NVC_INFO)) < 0) {
+                        warnx("permission error: %s", err.msg);
+                        goto fail;
+                }
+                /* Only look up the driver components requested by the container when the library supports it. */
+                if (libnvc.version()->major == 0)
+                        drv = libnvc.driver_info_new(nvc, ctx->driver_opts);
+                else
+                        drv = libnvc.driver_info_new_for(nvc, cnt, ctx->driver_opts);
+                if (drv == NULL || (dev = libnvc.device_info_new(nvc, NULL)) == NULL) {
+                        warnx("detection error: %s", libnvc.error(nvc));
+                        goto fail;
+                }
+                shared_drv = drv;
+                shared_dev = dev;
         }
 
         /*
          * We now have the driver version and can update the list of compat
          * libraries discovered above accordingly.
          */
-        if (update_compat_libraries(nvc, cnt, drv) < 0) {
+        if (update_compat_libraries(nvc, cnt, shared_drv) < 0) {
                 warn("updating compat library settings failed: %s", libnvc.error(nvc));
                 goto fail;
         }
 
         /* Allocate space for selecting GPU devices and MIG devices */
-        if (new_devices(&err, dev, &devices) < 0) {
+        if (new_devices(&err, shared_dev, &devices) < 0) {
                 warn("memory allocation failed: %s", err.msg);
                 goto fail;
         }
 
         /* Allocate space for selecting which devices are available for MIG config */
-        if (new_devices(&err, dev, &mig_config_devices) < 0) {
+        if (new_devices(&err, shared_dev, &mig_config_devices) < 0) {
                 warn("memory allocation failed: %s", err.msg);
                 goto fail;
         }
 
         /* Allocate space for selecting which devices are available for MIG monitor */
-        if (new_devices(&err, dev, &mig_monitor_devices) < 0) {
+        if (new_devices(&err, shared_dev, &mig_monitor_devices) < 0) {
                 warn("memory allocation failed: %s", err.msg);
                 goto fail;
         }
 
         /* Select the visible GPU devices. */
-        if (dev->ngpus > 0) {
-                if (select_devices(&err, ctx->devices, dev, &devices) < 0) {
+        if (shared_dev->ngpus > 0) {
+                if (select_devices(&err, ctx->devices, shared_dev, &devices) < 0) {
                         warnx("device error: %s", err.msg);
                         goto fail;
                 }
@@ -378,7 +421,7 @@ configure_command(const struct context *ctx)
          * Try evaluating per visible device first, and globally otherwise.
          */
         for (size_t i = 0; i < devices.ngpus; ++i) {
-                struct dsl_data data = {drv, devices.gpus[i]};
+                struct dsl_data data = {shared_drv, devices.gpus[i]};
                 for (size_t j = 0; j < ctx->nreqs; ++j) {
                         if (dsl_evaluate(&err, ctx->reqs[j], &data, rules, nitems(rules)) < 0) {
                                 warnx("requirement error: %s", err.msg);
@@ -388,7 +431,7 @@ configure_command(const struct context *ctx)
                 eval_reqs = false;
         }
         for (size_t i = 0; i < devices.nmigs; ++i) {
-                struct dsl_data data = {drv, devices.migs[i]->parent};
+                struct dsl_data data = {shared_drv, devices.migs[i]->parent};
                 for (size_t j = 0; j < ctx->nreqs; ++j) {
                         if (dsl_evaluate(&err, ctx->reqs[j], &data, rules, nitems(rules)) < 0) {
                                 warnx("requirement error: %s", err.msg);
@@ -398,7 +441,7 @@ configure_command(const struct context *ctx)
                 eval_reqs = false;
         }
         if (eval_reqs) {
-                struct dsl_data data = {drv, NULL};
+                struct dsl_data data = {shared_drv, NULL};
                 for (size_t j = 0; j < ctx->nreqs; ++j) {
                         if (dsl_evaluate(&err, ctx->reqs[j], &data, rules, nitems(rules)) < 0) {
                                 warnx("requirement error: %s", err.msg);
@@ -407,12 +450,17 @@ configure_command(const struct context *ctx)
                 }
         }
 
+        if (ctx->dry_run) {
+                rv = print_mount_plan(nvc, cnt, shared_drv, &devices);
+                goto fail;
+        }
+
         /* Mount the driver, visible devices, mig-configs, mig-monitors, and imex-channels. */
         if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[NVC_MOUNT], ecaps_size(NVC_MOUNT)) < 0) {
                 warnx("permission error: %s", err.msg);
                 goto fail;
         }
-        if (libnvc.driver_mount(nvc, cnt, drv) < 0) {
+        if (libnvc.driver_mount(nvc, cnt, shared_drv) < 0) {
                 warnx("mount error: %s", libnvc.error(nvc));
                 goto fail;
         }
@@ -460,6 +508,10 @@ configure_command(const struct context *ctx)
                         goto fail;
                 }
         }
+        if (libnvc.device_cgroup_commit != NULL && libnvc.device_cgroup_commit(nvc, cnt) < 0) {
+                warnx("cgroup error: %s", libnvc.error(nvc));
+                goto fail;
+        }
 
         /* Update the container ldcache. */
         if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[NVC_LDCACHE], ecaps_size(NVC_LDCACHE)) < 0) {
@@ -471,6 +523,267 @@ configure_command(const struct context *ctx)
                 goto fail;
         }
 
+        rv = 0;
+
+ fail:
+        free_devices(&devices);
+        free_devices(&mig_config_devices);
+        free_devices(&mig_monitor_devices);
+        libnvc.container_free(cnt);
+        libnvc.device_info_free(dev);
+        libnvc.driver_info_free(drv);
+        libnvc.container_config_free(cnt_cfg);
+        error_reset(&err);
+        return (rv);
+}
+
+/*
+ * Print the mounts that would be performed for the driver and the visible devices, the MIG and IMEX channel
+ * mounts as well as the ldcache update are not part of the output.
+ */
+static int
+print_mount_plan(struct nvc_context *nvc, const struct nvc_container *cnt, const struct nvc_driver_info *drv, const struct devices *devices)
+{
+        char *drv_plan = NULL;
+        char **dev_plans;
+        int rv = -1;
+
+        if ((dev_plans = calloc(devices->ngpus + 1, sizeof(*dev_plans))) == NULL) {
+                warn("memory allocation failed");
+                return (-1);
+        }
+        if (libnvc.driver_mount_plan(nvc, cnt, drv, &drv_plan) < 0) {
+                warnx("mount error: %s", libnvc.error(nvc));
+                goto fail;
+        }
+        for (size_t i = 0; i < devices->ngpus; ++i) {
+                if (libnvc.device_mount_plan(nvc, cnt, devices->gpus[i], &dev_plans[i]) < 0) {
+                        warnx("mount error: %s", libnvc.error(nvc));
+                        goto fail;
+                }
+        }
+
+        printf("{\"driver\": %s,\n \"devices\": [", drv_plan);
+        for (size_t i = 0; i < devices->ngpus; ++i)
+                printf("%s%s", (i > 0) ? ",\n " : "", dev_plans[i]);
+        printf("]}\n");
+        rv = 0;
+
+ fail:
+        for (size_t i = 0; i < devices->ngpus; ++i)
+                free(dev_plans[i]);
+        free(dev_plans);
+        free(drv_plan);
+        return (rv);
+}
+
+/*
+ * Parse a batch record "PID ROOTFS DEVICES [FLAG...]" into a copy of the command context.
+ * The strings of the copy are either pointing into the record or allocated, see configure_batch for their release.
+ */
+static int
+parse_record(struct error *err, const struct context *ctx, char *line, struct context *rec)
+{
+        char *fields[3] = {NULL};
+        char *tok;
+        size_t n = 0;
+
+        *rec = *ctx;
+        rec->container_flags = NULL;
+        rec->mig_config = NULL;
+        rec->mig_monitor = NULL;
+
+        while (n < nitems(fields) && (tok = strsep(&line, " \t")) != NULL) {
+                if (*tok != '\0')
+                        fields[n++] = tok;
+        }
+        if (n < nitems(fields)) {
+                error_setx(err, "invalid record: expected PID ROOTFS DEVICES");
+                return (-1);
+        }
+        if (str_to_pid(err, fields[0], &rec->pid) < 0)
+                return (-1);
+        if (fields[1][0] != '/' || str_equal(fields[1], "/")) {
+                error_setx(err, "invalid rootfs directory");
+                return (-1);
+        }
+        rec->rootfs = fields[1];
+        rec->devices = str_equal(fields[2], "-") ? NULL : fields[2];
+
+        if (ctx->container_flags != NULL && str_join(err, &rec->container_flags, ctx->container_flags, " ") < 0)
+                return (-1);
+        while ((tok = strsep(&line, " \t")) != NULL) {
+                if (*tok != '\0' && str_join(err, &rec->container_flags, tok, " ") < 0)
+                        return (-1);
+        }
+        if (str_join(err, &rec->container_flags, "supervised", " ") < 0)
+                return (-1);
+        /* Apply all the device cgroup rules at once after the mounts are done. */
+        if (libnvc.version()->major != 0) {
+                if (str_join(err, &rec->container_flags, "defer-cgroups", " ") < 0)
+                        return (-1);
+        }
+
+        /* The MIG device lists are consumed while selecting devices, each container gets its own copy. */
+        if (ctx->mig_config != NULL && (rec->mig_config = xstrdup(err, ctx->mig_config)) == NULL)
+                return (-1);
+        if (ctx->mig_monitor != NULL && (rec->mig_monitor = xstrdup(err, ctx->mig_monitor)) == NULL)
+                return (-1);
+        return (0);
+}
+
+static int
+configure_batch(const struct context *ctx, struct nvc_context *nvc, const struct nvc_config *nvc_cfg)
+{
+        struct nvc_driver_info *drv = NULL;
+        struct nvc_device_info *dev = NULL;
+        struct context rec;
+        struct error err = {0};
+        char *line = NULL;
+        size_t size = 0;
+        ssize_t len;
+        int rv = -1;
+
+        /*
+         * The driver and device information is looked up once and shared by all the containers,
+         * the driver components mounted into each of them are still selected by their own flags.
+         */
+        if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[NVC_INFO], ecaps_size(NVC_INFO)) < 0) {
+                warnx("permission error: %s", err.msg);
+                goto fail;
+        }
+        if ((drv = libnvc.driver_info_new(nvc, ctx->driver_opts)) == NULL ||
+            (dev = libnvc.device_info_new(nvc, NULL)) == NULL) {
+                warnx("detection error: %s", libnvc.error(nvc));
+                goto fail;
+        }
+
+        rv = 0;
+        while ((len = getline(&line, &size, stdin)) >= 0) {
+                if (len > 0 && line[len - 1] == '\n')
+                        line[len - 1] = '\0';
+                if (str_empty(line) || *line == '#')
+                        continue;
+
+                if (parse_record(&err, ctx, line, &rec) < 0) {
+                        warnx("input error: %s", err.msg);
+                        printf("- failed\n");
+                        rv = -1;
+                } else if (configure_container(&rec, nvc, nvc_cfg, drv, dev) < 0) {
+                        printf("%jd failed\n", (intmax_t)rec.pid);
+                        rv = -1;
+                } else {
+                        printf("%jd ok\n", (intmax_t)rec.pid);
+                }
+                fflush(stdout);
+
+                free(rec.container_flags);
+                free(rec.mig_config);
+                free(rec.mig_monitor);
+                rec.container_flags = rec.mig_config = rec.mig_monitor = NULL;
+                error_reset(&err);
+        }
+        if (ferror(stdin)) {
+                warn("read error");
+                rv = -1;
+        }
+
+ fail:
+        free(line);
+        libnvc.device_info_free(dev);
+        libnvc.driver_info_free(drv);
+        error_reset(&err);
+        return (rv);
+}
+
+/*
+ * A dry run must leave the host untouched, the library is therefore initialized without loading the kernel modules
+ * (which also creates their device nodes and the IMEX channels).
+ */
+static int
+dry_run_init_flags(struct error *err, const char *flags, char **dry_flags)
+{
+        char *copy, *ptr, *tok;
+        int rv = -1;
+
+        *dry_flags = NULL;
+        if (flags == NULL)
+                return (0);
+        if ((copy = ptr = xstrdup(err, flags)) == NULL)
+                return (-1);
+        while ((tok = strsep(&ptr, " ")) != NULL) {
+                if (*tok == '\0' || str_equal(tok, "load-kmods"))
+                        continue;
+                if (str_join(err, dry_flags, tok, " ") < 0)
+                        goto fail;
+        }
+        rv = 0;
+
+ fail:
+        free(copy);
+        return (rv);
+}
+
+int
+configure_command(const struct context *ctx)
+{
+        struct nvc_context *nvc = NULL;
+        struct nvc_config *nvc_cfg = NULL;
+        struct error err = {0};
+        char *dry_flags = NULL;
+        bool load_kmods = ctx->load_kmods;
+        int rv = EXIT_FAILURE;
+
+        if (perm_set_capabilities(&err, CAP_PERMITTED, pcaps, nitems(pcaps)) < 0 ||
+            perm_set_capabilities(&err, CAP_INHERITABLE, NULL, 0) < 0 ||
+            perm_set_bounds(&err, bcaps, nitems(bcaps)) < 0) {
+                warnx("permission error: %s", err.msg);
+                return (rv);
+        }
+
+        /* Initialize the library context. */
+        if (ctx->dry_run) {
+                if (dry_run_init_flags(&err, ctx->init_flags, &dry_flags) < 0) {
+                        warnx("%s", err.msg);
+                        goto fail;
+                }
+                if (load_kmods)
+                        warnx("kernel modules are not loaded in dry-run mode");
+                load_kmods = false;
+        }
+        int c = load_kmods ? NVC_INIT_KMODS : NVC_INIT;
+        if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[c], ecaps_size(c)) < 0) {
+                warnx("permission error: %s", err.msg);
+                goto fail;
+        }
+        if ((nvc = libnvc.context_new()) == NULL ||
+            (nvc_cfg = libnvc.config_new()) == NULL) {
+                warn("memory allocation failed");
+                goto fail;
+        }
+        nvc->no_pivot = ctx->no_pivot;
+        nvc_cfg->uid = ctx->uid;
+        nvc_cfg->gid = ctx->gid;
+        nvc_cfg->root = ctx->root;
+        nvc_cfg->ldcache = ctx->ldcache;
+        if (parse_imex_info(&err, ctx->imex_channels, &nvc_cfg->imex) < 0) {
+                warnx("error parsing IMEX info: %s", err.msg);
+                goto fail;
+        }
+        if (libnvc.init(nvc, nvc_cfg, ctx->dry_run ? dry_flags : ctx->init_flags) < 0) {
+                warnx("initialization error: %s", libnvc.error(nvc));
+                goto fail;
+        }
+
+        /* Configure the container(s). */
+        if (ctx->batch) {
+                if (configure_batch(ctx, nvc, nvc_cfg) < 0)
+                        goto fail;
+        } else {
+                if (configure_container(ctx, nvc, nvc_cfg, NULL, NULL) < 0)
+                        goto fail;
+        }
+
         if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[NVC_SHUTDOWN], ecaps_size(NVC_SHUTDOWN)) < 0) {
                 warnx("permission error: %s", err.msg);
                 goto fail;
@@ -478,15 +791,12 @@ configure_command(const struct context *ctx)
         rv = EXIT_SUCCESS;
 
  fail:
-        free(nvc_cfg->imex.chans);
-        free_devices(&devices);
+        if (nvc_cfg != NULL)
+                free(nvc_cfg->imex.chans);
         libnvc.shutdown(nvc);
-        libnvc.container_free(cnt);
-        libnvc.device_info_free(dev);
-        libnvc.driver_info_free(drv);
-        libnvc.container_config_free(cnt_cfg);
         libnvc.config_free(nvc_cfg);
         libnvc.context_free(nvc);
+        free(dry_flags);
         error_reset(&err);
         return (rv);
 }
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <err.h>
+#include <stdlib.h>
+
+#include "cli.h"
+
+static error_t daemon_parser(int, char *, struct argp_state *);
+
+const struct argp daemon_usage = {
+        (const struct argp_option[]){
+                {NULL, 0, NULL, 0, "Options:", -1},
+                {"socket", 's', "PATH", 0, "Path to the unix socket to listen on", -1},
+                {0},
+        },
+        daemon_parser,
+        NULL,
+        "Serve the driver information over a unix socket.\n\n"
+        "This command keeps the driver initialized and shares it with the other invocations using the same driver root and user, "
+        "which connect to the socket automatically when it exists (see NVC_DRIVER_SOCKET).",
+        NULL,
+        NULL,
+        NULL,
+};
+
+static error_t
+daemon_parser(int key, char *arg, struct argp_state *state)
+{
+        struct context *ctx = state->input;
+
+        switch (key) {
+        case 's':
+                ctx->socket = arg;
+                break;
+        default:
+                return (ARGP_ERR_UNKNOWN);
+        }
+        return (0);
+}
+
+int
+daemon_command(const struct context *ctx)
+{
+        struct nvc_context *nvc = NULL;
+        struct nvc_config *nvc_cfg = NULL;
+        struct error err = {0};
+        int rv = EXIT_FAILURE;
+
+        if (libnvc.driver_serve == NULL) {
+                warnx("daemon mode is not supported by this library version");
+                return (rv);
+        }
+        if (perm_set_capabilities(&err, CAP_PERMITTED, pcaps, nitems(pcaps)) < 0 ||
+            perm_set_capabilities(&err, CAP_INHERITABLE, NULL, 0) < 0 ||
+            perm_set_bounds(&err, bcaps, nitems(bcaps)) < 0) {
+                warnx("permission error: %s", err.msg);
+                return (rv);
+        }
+        if (perm_set_capabilities(&err, CAP_EFFECTIVE, ecaps[NVC_INIT], ecaps_size(NVC_INIT)) < 0) {
+                warnx("permission error: %s", err.msg);
+                goto fail;
+        }
+
+        if ((nvc = libnvc.context_new()) == NULL ||
+            (nvc_cfg = libnvc.config_new()) == NULL) {
+                warn("memory allocation failed");
+                goto fail;
+        }
+        nvc_cfg->uid = ctx->uid;
+        nvc_cfg->gid = ctx->gid;
+        nvc_cfg->root = ctx->root;
+        nvc_cfg->ldcache = ctx->ldcache;
+        if (libnvc.driver_serve(nvc, nvc_cfg, ctx->socket) < 0) {
+                warnx("daemon error: %s", libnvc.error(nvc));
+                goto fail;
+        }
+        rv = EXIT_SUCCESS;
+
+ fail:
+        libnvc.config_free(nvc_cfg);
+        libnvc.context_free(nvc);
+        error_reset(&err);
+        return (rv);
+}
@@ -19,7 +19,7 @@ enum dsl_comparator {
 };
 
 struct dsl_data {
-        struct nvc_driver_info *drv;
+        const struct nvc_driver_info *drv;
         const struct nvc_device *dev;
 };
 
@@ -162,6 +162,11 @@ load_libnvc_v1(void)
         load_libnvc_func(mig_monitor_global_caps_mount);
         load_libnvc_func(device_mig_caps_mount);
         load_libnvc_func(imex_channel_mount);
+        load_libnvc_func(device_cgroup_commit);
+        load_libnvc_func(driver_serve);
+        load_libnvc_func(driver_info_new_for);
+        load_libnvc_func(driver_mount_plan);
+        load_libnvc_func(device_mount_plan);
 
         return (0);
 }
@@ -51,6 +51,11 @@ struct libnvc {
         libnvc_entry(mig_monitor_global_caps_mount);
         libnvc_entry(device_mig_caps_mount);
         libnvc_entry(imex_channel_mount);
+        libnvc_entry(device_cgroup_commit);
+        libnvc_entry(driver_serve);
+        libnvc_entry(driver_info_new_for);
+        libnvc_entry(driver_mount_plan);
+        libnvc_entry(device_mount_plan);
 };
 
 int load_libnvc(void);
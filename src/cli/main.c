@@ -33,10 +33,12 @@ static struct argp usage = {
                 {"root", 'r', "PATH", 0, "Path to the driver root directory", -1},
                 {"ldcache", 'l', "FILE", 0, "Path to the system's DSO cache", -1},
                 {"no-create-imex-channels", 0x80, NULL, 0, "Don't automatically create IMEX channel device nodes", -1},
+                {"coalesce-discovery", 0x81, NULL, 0, "Share the driver discovery with concurrent invocations", -1},
                 {NULL, 0, NULL, 0, "Commands:", 0},
                 {"info", 0, NULL, OPTION_DOC|OPTION_NO_USAGE, "Report information about the driver and devices", 0},
                 {"list", 0, NULL, OPTION_DOC|OPTION_NO_USAGE, "List driver components", 0},
                 {"configure", 0, NULL, OPTION_DOC|OPTION_NO_USAGE, "Configure a container with GPU support", 0},
+                {"daemon", 0, NULL, OPTION_DOC|OPTION_NO_USAGE, "Serve the driver information over a unix socket", 0},
                 {0},
         },
         parser,
@@ -51,6 +53,7 @@ static const struct command commands[] = {
         {"info", &info_usage, &info_command},
         {"list", &list_usage, &list_command},
         {"configure", &configure_usage, &configure_command},
+        {"daemon", &daemon_usage, &daemon_command},
 };
 
 static void
@@ -117,6 +120,10 @@ parser(int key, char *arg, struct argp_state *state)
                 if (str_join(&err, &ctx->init_flags, "no-create-imex-channels", " ") < 0)
                         goto fatal;
                 break;
+        case 0x81:
+                if (str_join(&err, &ctx->init_flags, "coalesce-discovery", " ") < 0)
+                        goto fatal;
+                break;
         case ARGP_KEY_ARGS:
                 state->argv += state->next;
                 state->argc -= state->next;
@@ -2,9 +2,21 @@
  * Copyright (c) 2017-2018, NVIDIA CORPORATION. All rights reserved.
  */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "nvml.h"
 
@@ -12,25 +24,45 @@
 
 #include "driver.h"
 #include "error.h"
+#include "info_cache.h"
+#include "trace.h"
 #include "utils.h"
 #include "rpc.h"
 #include "xfuncs.h"
 
-#define MAX_DEVICES     64
-#define MAX_MIG_DEVICES  8
+#define MAX_DEVICES       64
+#define MAX_MIG_DEVICES    8
+#define MAX_QUERY_THREADS  8
+
+#define SNAPSHOT_MAGIC        "nvc-driver-snapshot 1"
+#define SNAPSHOT_FILE         NVC_CACHE_DIR "/driver.snapshot"
+#define SNAPSHOT_LOCK         NVC_CACHE_DIR "/driver.lock"
+#define SNAPSHOT_MAX_SIZE     (1 << 20)
+#define SNAPSHOT_TTL          30  /* seconds */
 
 void driver_program_1(struct svc_req *, register SVCXPRT *);
 
+/* Outcome of snapshot_load, a miss is not an error. */
+enum {
+        SNAPSHOT_ERROR = -1,
+        SNAPSHOT_MISS  = 0,
+        SNAPSHOT_HIT   = 1,
+};
+
 struct mig_device {
         nvmlDevice_t nvml;
 };
 
-static struct driver_device {
+struct driver_device {
         nvmlDevice_t nvml;
         struct mig_device mig[MAX_MIG_DEVICES];
-} device_handles[MAX_DEVICES];
+};
 
-static struct driver {
+/*
+ * The client side of a driver context (the RPC client and the snapshot) lives in the library process,
+ * the service side (NVML and the device handles) in the service process forked from it (see driver_service).
+ */
+struct driver {
         struct rpc rpc;
         bool initialized;
         char root[PATH_MAX];
@@ -38,7 +70,26 @@ static struct driver {
         uid_t uid;
         gid_t gid;
         void *nvml_dl;
-} global_driver_context;
+        bool shared;
+        struct device_info_cache {
+                bool enabled;
+                char *key;
+                char *data;
+                u_int size;
+        } cache;
+        struct {
+                bool loaded;
+                driver_snapshot data;
+        } snapshot;
+        struct driver_device devices[MAX_DEVICES];
+};
+
+/*
+ * A service process serves a single driver context: either the one it was forked from, which the first request it
+ * receives (i.e. driver_init) binds it to, or the one it shares over a socket (see driver_serve).
+ * Context pointers sent by the clients of a shared service refer to their own address space and are ignored.
+ */
+static struct driver *service;
 
 #define call_nvml(err, ctx, sym, ...) __extension__ ({                                                 \
         union {void *ptr; __typeof__(&sym) fn;} u_;                                                    \
@@ -53,9 +104,39 @@ static struct driver {
 })
 
 static struct driver *
-driver_get_context(void)
+driver_service(ptr_t ctxptr)
 {
-        return &global_driver_context;
+        if (service == NULL)
+                service = (struct driver *)ctxptr;
+        return (service);
+}
+
+/*
+ * Devices are referred to by the clients with tokens rather than with the addresses of their handles in the service
+ * process: the low half of a token is the index of the GPU plus one, the high half the index of the MIG device plus one
+ * (0 for the GPU itself), so that 0 is never a valid device. Tokens are validated against the handles resolved so far.
+ */
+#define DEVICE_TOKEN(gpu, mig) ((ptr_t)(((uint64_t)(mig) << 32) | ((uint64_t)(gpu) + 1)))
+#define DEVICE_TOKEN_GPU(tok)  ((uint64_t)(tok) % ((uint64_t)1 << 32) - 1)
+#define DEVICE_TOKEN_MIG(tok)  ((uint64_t)(tok) >> 32)
+
+static nvmlDevice_t *
+device_handle(struct error *err, struct driver *ctx, ptr_t dev)
+{
+        uint64_t gpu = DEVICE_TOKEN_GPU(dev);
+        uint64_t mig = DEVICE_TOKEN_MIG(dev);
+        nvmlDevice_t *handle;
+
+        if (gpu >= MAX_DEVICES || mig > MAX_MIG_DEVICES)
+                goto fail;
+        handle = (mig == 0) ? &ctx->devices[gpu].nvml : &ctx->devices[gpu].mig[mig - 1].nvml;
+        if (*handle == NULL)
+                goto fail;
+        return (handle);
+
+ fail:
+        error_setx(err, "invalid device handle");
+        return (NULL);
 }
 
 int
@@ -65,14 +146,383 @@ driver_program_1_freeresult(maybe_unused SVCXPRT *svc, xdrproc_t xdr_result, cad
         return (1);
 }
 
-int
-driver_init(struct error *err, struct dxcore_context *dxcore, const char *root, uid_t uid, gid_t gid)
+/*
+ * set_nvml_override replaces the NVML library with the one given by NVC_NVML_LIBRARY (resolved within the driver root).
+ * This is meant for development, e.g. to run the discovery path against a stub library on machines without GPUs.
+ */
+static int
+set_nvml_override(struct error *err, struct driver *ctx)
 {
+        const char *path;
+
+        if ((path = secure_getenv("NVC_NVML_LIBRARY")) == NULL || str_empty(path))
+                return (0);
+        if (path_new(err, ctx->nvml_path, path) < 0)
+                return (-1);
+        log_warnf("using NVML library override %s", ctx->nvml_path);
+        return (0);
+}
+
+/*
+ * driver_connected checks that a driver service is available for the RPCs not answered by a driver snapshot.
+ */
+static int
+driver_connected(struct error *err, struct driver *ctx)
+{
+        if (!ctx->rpc.initialized) {
+                error_setx(err, "driver rpc service is not running");
+                return (-1);
+        }
+        return (0);
+}
+
+/*
+ * driver_attach connects to a shared driver service (see driver_serve) if one is listening on the
+ * driver socket. Any failure is logged and the caller falls back to spawning a private service.
+ */
+static int
+driver_attach(struct driver *ctx, struct rpc_prog *prog)
+{
+        struct error err = {0};
+        struct driver_attach_res res = {0};
+        const char *path;
         int ret;
-        struct rpc_prog rpc_prog = {0};;
-        struct driver *ctx = driver_get_context();
+
+        if ((path = secure_getenv("NVC_DRIVER_SOCKET")) == NULL)
+                path = NV_DRIVER_SOCKET;
+        if (str_empty(path) || access(path, F_OK) < 0)
+                return (-1);
+
+        if (rpc_connect(&err, &ctx->rpc, prog, path) < 0)
+                goto fail;
+        ret = call_rpc(&err, &ctx->rpc, &res, driver_attach_1, ctx->root, ctx->nvml_path, ctx->uid, ctx->gid);
+        xdr_free((xdrproc_t)xdr_driver_attach_res, (caddr_t)&res);
+        if (ret < 0)
+                goto fail;
+
+        log_infof("using shared driver rpc service at %s", path);
+        return (0);
+
+ fail:
+        log_warnf("could not use shared driver rpc service at %s: %s", path, err.msg);
+        rpc_shutdown(NULL, &ctx->rpc, false);
+        error_reset(&err);
+        return (-1);
+}
+
+static int
+driver_start(struct error *err, struct driver *ctx, struct rpc_prog *prog, bool attach)
+{
         struct driver_init_res res = {0};
         struct error rpcerr = {0};
+        int ret;
+
+        if (attach && driver_attach(ctx, prog) == 0)
+                return (0);
+
+        if (rpc_init(err, &ctx->rpc, prog) < 0)
+                goto fail;
+
+        ret = call_rpc(err, &ctx->rpc, &res, driver_init_1);
+        xdr_free((xdrproc_t)xdr_driver_init_res, (caddr_t)&res);
+        if (ret < 0)
+                goto fail;
+        return (0);
+
+ fail:
+        rpc_shutdown(&rpcerr, &ctx->rpc, true);
+        return (-1);
+}
+
+/*
+ * snapshot_key captures what a published snapshot depends on: the boot, the instance of the kernel module (its sysfs
+ * directory is recreated on every load), the driver version, the MIG instances and the configuration of the service.
+ */
+static int
+snapshot_key(struct error *err, struct driver *ctx, char **key)
+{
+        char boot_id[64];
+        char *version = NULL;
+        struct stat s;
+        glob_t gl = {0};
+        int rv = -1;
+
+        *key = NULL;
+        if (file_read_line(err, "/proc/sys/kernel/random/boot_id", boot_id, sizeof(boot_id)) < 0)
+                return (-1);
+        if (xstat(err, "/sys/module/nvidia", &s) < 0)
+                return (-1);
+        if (file_read_text(err, NV_PROC_DRIVER "/version", &version) < 0)
+                return (-1);
+        if (xasprintf(err, key,
+            SNAPSHOT_MAGIC "\n"
+            "boot %s"
+            "module %ju %jd.%09ld\n"
+            "root %s\n"
+            "nvml %s\n"
+            "user %"PRIu32":%"PRIu32"\n"
+            "%s",
+            boot_id, (uintmax_t)s.st_ino, (intmax_t)s.st_ctim.tv_sec, s.st_ctim.tv_nsec,
+            ctx->root, ctx->nvml_path, (uint32_t)ctx->uid, (uint32_t)ctx->gid, version ? version : "") < 0)
+                goto fail;
+        if (xglob(err, NV_PROC_DRIVER_CAPS "/gpu*/mig/gi*/ci*", 0, NULL, &gl) < 0)
+                goto fail;
+        for (size_t i = 0; i < gl.gl_pathc; ++i) {
+                if (str_join(err, key, gl.gl_pathv[i], "\n") < 0)
+                        goto fail;
+        }
+        rv = 0;
+
+ fail:
+        globfree(&gl);
+        free(version);
+        if (rv < 0) {
+                free(*key);
+                *key = NULL;
+        }
+        return (rv);
+}
+
+/*
+ * Open file description locks are used so that two contexts of the same process exclude each other as well.
+ * The driver service forked while the lock is held shares the description, hence the explicit snapshot_unlock.
+ */
+static int
+snapshot_lock(struct error *err)
+{
+        struct flock lock = {.l_type = F_WRLCK, .l_whence = SEEK_SET};
+        int fd;
+
+        if (info_cache_dir(err) < 0)
+                return (-1);
+        if ((fd = open(SNAPSHOT_LOCK, O_RDWR|O_CREAT|O_NOFOLLOW|O_CLOEXEC, 0600)) < 0) {
+                error_set(err, "open failed: %s", SNAPSHOT_LOCK);
+                return (-1);
+        }
+        while (fcntl(fd, F_OFD_SETLKW, &lock) < 0) {
+                if (errno != EINTR) {
+                        error_set(err, "lock failed: %s", SNAPSHOT_LOCK);
+                        close(fd);
+                        return (-1);
+                }
+        }
+        return (fd);
+}
+
+static void
+snapshot_unlock(int fd)
+{
+        struct flock lock = {.l_type = F_UNLCK, .l_whence = SEEK_SET};
+
+        if (fd < 0)
+                return;
+        fcntl(fd, F_OFD_SETLK, &lock);
+        close(fd);
+}
+
+static int
+snapshot_load(struct error *err, struct driver *ctx, const char *key)
+{
+        driver_snapshot snap = {0};
+        struct timespec now;
+        struct stat s;
+        void *addr = MAP_FAILED;
+        XDR xdr;
+        bool_t ok;
+        int fd;
+        int rv = SNAPSHOT_ERROR;
+
+        if ((fd = open(SNAPSHOT_FILE, O_RDONLY|O_NOFOLLOW|O_CLOEXEC)) < 0) {
+                if (errno == ENOENT)
+                        return (SNAPSHOT_MISS);
+                error_set(err, "open failed: %s", SNAPSHOT_FILE);
+                return (SNAPSHOT_ERROR);
+        }
+        if (fstat(fd, &s) < 0) {
+                error_set(err, "stat failed: %s", SNAPSHOT_FILE);
+                goto fail;
+        }
+        if (!S_ISREG(s.st_mode) || s.st_uid != geteuid() || (s.st_mode & (S_IWGRP|S_IWOTH))) {
+                error_setx(err, "insecure snapshot file: %s", SNAPSHOT_FILE);
+                goto fail;
+        }
+        if (s.st_size <= 0 || s.st_size > SNAPSHOT_MAX_SIZE) {
+                rv = SNAPSHOT_MISS;
+                goto fail;
+        }
+        if ((addr = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+                error_set(err, "mmap failed: %s", SNAPSHOT_FILE);
+                goto fail;
+        }
+        xdrmem_create(&xdr, addr, (u_int)s.st_size, XDR_DECODE);
+        ok = xdr_driver_snapshot(&xdr, &snap);
+        xdr_destroy(&xdr);
+        clock_gettime(CLOCK_BOOTTIME, &now);
+
+        if (!ok || !str_equal(snap.key, key) ||
+            snap.timestamp > (uint64_t)now.tv_sec || (uint64_t)now.tv_sec - snap.timestamp >= SNAPSHOT_TTL) {
+                log_info("driver snapshot is stale");
+                rv = SNAPSHOT_MISS;
+                goto fail;
+        }
+        ctx->snapshot.data = snap;
+        ctx->snapshot.loaded = true;
+        memset(&snap, 0, sizeof(snap));
+        rv = SNAPSHOT_HIT;
+
+ fail:
+        xdr_free((xdrproc_t)xdr_driver_snapshot, (caddr_t)&snap);
+        if (addr != MAP_FAILED)
+                munmap(addr, (size_t)s.st_size);
+        close(fd);
+        return (rv);
+}
+
+static int
+snapshot_query(struct error *err, struct driver *ctx, const char *key)
+{
+        struct driver_get_rm_version_res rm = {0};
+        struct driver_get_cuda_version_res cuda = {0};
+        struct driver_get_device_info_res devs = {0};
+        driver_snapshot *snap = &ctx->snapshot.data;
+        struct timespec now;
+        int rv = -1;
+
+        if (call_rpc(err, &ctx->rpc, &rm, driver_get_rm_version_1) < 0)
+                goto fail;
+        if (call_rpc(err, &ctx->rpc, &cuda, driver_get_cuda_version_1) < 0)
+                goto fail;
+        if (call_rpc(err, &ctx->rpc, &devs, driver_get_device_info_1, true) < 0)
+                goto fail;
+        if ((snap->key = xstrdup(err, key)) == NULL)
+                goto fail;
+        clock_gettime(CLOCK_BOOTTIME, &now);
+
+        // Take over the results of the RPC calls.
+        snap->timestamp = (uint64_t)now.tv_sec;
+        snap->rm_version = rm.driver_get_rm_version_res_u.vers;
+        rm.driver_get_rm_version_res_u.vers = NULL;
+        snap->cuda_version = cuda.driver_get_cuda_version_res_u.vers;
+        snap->devices.devices_len = devs.driver_get_device_info_res_u.devices.devices_len;
+        snap->devices.devices_val = devs.driver_get_device_info_res_u.devices.devices_val;
+        devs.driver_get_device_info_res_u.devices.devices_len = 0;
+        devs.driver_get_device_info_res_u.devices.devices_val = NULL;
+        ctx->snapshot.loaded = true;
+        rv = 0;
+
+ fail:
+        if (rv < 0)
+                xdr_free((xdrproc_t)xdr_driver_snapshot, (caddr_t)snap);
+        xdr_free((xdrproc_t)xdr_driver_get_rm_version_res, (caddr_t)&rm);
+        xdr_free((xdrproc_t)xdr_driver_get_cuda_version_res, (caddr_t)&cuda);
+        xdr_free((xdrproc_t)xdr_driver_get_device_info_res, (caddr_t)&devs);
+        return (rv);
+}
+
+static int
+snapshot_store(struct error *err, struct driver *ctx)
+{
+        char tmp[] = SNAPSHOT_FILE ".XXXXXX";
+        FILE *fs = NULL;
+        XDR xdr;
+        bool_t ok;
+        int fd;
+        int rv = -1;
+
+        if ((fd = mkstemp(tmp)) < 0) {
+                error_set(err, "open failed: %s", tmp);
+                return (-1);
+        }
+        if ((fs = fdopen(fd, "w")) == NULL) {
+                error_set(err, "open failed: %s", tmp);
+                close(fd);
+                goto fail;
+        }
+        xdrstdio_create(&xdr, fs, XDR_ENCODE);
+        ok = xdr_driver_snapshot(&xdr, &ctx->snapshot.data);
+        xdr_destroy(&xdr);
+        if (!ok) {
+                error_setx(err, "write failed: %s", tmp);
+                goto fail;
+        }
+        if (fclose(fs) != 0) {
+                fs = NULL;
+                error_set(err, "write failed: %s", tmp);
+                goto fail;
+        }
+        fs = NULL;
+        if (rename(tmp, SNAPSHOT_FILE) < 0) {
+                error_set(err, "rename failed: %s", tmp);
+                goto fail;
+        }
+        rv = 0;
+
+ fail:
+        if (fs != NULL)
+                fclose(fs);
+        if (rv < 0)
+                unlink(tmp);
+        return (rv);
+}
+
+/*
+ * driver_coalesce shares a single driver discovery between concurrent library contexts. The first context to take
+ * the snapshot lock starts a driver service and publishes what it queried, the others wait for the lock and reuse the
+ * published snapshot without starting a service. Any failure of the snapshot itself falls back to a private service.
+ */
+static int
+driver_coalesce(struct error *err, struct driver *ctx, struct rpc_prog *prog)
+{
+        struct error snaperr = {0};
+        char *key = NULL;
+        int fd = -1;
+        int rv;
+
+        if (snapshot_key(&snaperr, ctx, &key) < 0)
+                goto fallback;
+        if ((rv = snapshot_load(&snaperr, ctx, key)) == SNAPSHOT_MISS) {
+                if ((fd = snapshot_lock(&snaperr)) < 0)
+                        goto fallback;
+                /* Another context might have published a snapshot while we were waiting for the lock. */
+                rv = snapshot_load(&snaperr, ctx, key);
+        }
+        if (rv == SNAPSHOT_ERROR)
+                goto fallback;
+        if (rv == SNAPSHOT_HIT) {
+                log_infof("using driver snapshot from %s", SNAPSHOT_FILE);
+                rv = 0;
+                goto done;
+        }
+
+        if ((rv = driver_start(err, ctx, prog, true)) < 0)
+                goto done;
+        if (snapshot_query(&snaperr, ctx, key) < 0 || snapshot_store(&snaperr, ctx) < 0) {
+                log_warnf("could not publish driver snapshot: %s", snaperr.msg);
+                error_reset(&snaperr);
+        }
+        goto done;
+
+ fallback:
+        log_warnf("could not use driver snapshot: %s", snaperr.msg);
+        error_reset(&snaperr);
+        rv = driver_start(err, ctx, prog, true);
+ done:
+        snapshot_unlock(fd);
+        free(key);
+        return (rv);
+}
+
+int
+driver_init(struct error *err, struct driver **drv, struct dxcore_context *dxcore, const char *root, uid_t uid, gid_t gid, bool coalesce)
+{
+        struct rpc_prog rpc_prog = {0};
+        struct driver *ctx;
+        int ret;
+        trace_func();
+
+        *drv = NULL;
+        if ((ctx = xcalloc(err, 1, sizeof(*ctx))) == NULL)
+                return (-1);
 
         rpc_prog = (struct rpc_prog){
                 .name = "driver",
@@ -82,7 +532,7 @@ driver_init(struct error *err, struct dxcore_context *dxcore, const char *root,
         };
 
         *ctx = (struct driver){
-                .rpc = {0},
+                .rpc = {false, {-1, -1}, -1, NULL, NULL, {0}},
                 .root = {0},
                 .nvml_path = SONAME_LIBNVML,
                 .uid = uid,
@@ -95,29 +545,31 @@ driver_init(struct error *err, struct dxcore_context *dxcore, const char *root,
                 memset(ctx->nvml_path, 0, strlen(ctx->nvml_path));
                 if (path_join(err, ctx->nvml_path, dxcore->adapterList[0].pDriverStorePath, SONAME_LIBNVML) < 0)
                         goto fail;
-        }
-
-        if (rpc_init(err, &ctx->rpc, &rpc_prog) < 0)
+        } else if (set_nvml_override(err, ctx) < 0) {
                 goto fail;
+        }
 
-        ret = call_rpc(err, &ctx->rpc, &res, driver_init_1);
-        xdr_free((xdrproc_t)xdr_driver_init_res, (caddr_t)&res);
+        if (coalesce && !dxcore->initialized)
+                ret = driver_coalesce(err, ctx, &rpc_prog);
+        else
+                ret = driver_start(err, ctx, &rpc_prog, !dxcore->initialized);
         if (ret < 0)
                 goto fail;
 
         ctx->initialized = true;
+        *drv = ctx;
         return (0);
 
  fail:
-        rpc_shutdown(&rpcerr, &ctx->rpc, true);
+        free(ctx);
         return (-1);
 }
 
 bool_t
-driver_init_1_svc(ptr_t ctxptr, driver_init_res *res, maybe_unused struct svc_req *req)
+driver_init_1_svc(maybe_unused ptr_t ctxptr, driver_init_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
+        struct driver *ctx = driver_service(ctxptr);
 
         memset(res, 0, sizeof(*res));
 
@@ -173,32 +625,44 @@ driver_init_1_svc(ptr_t ctxptr, driver_init_res *res, maybe_unused struct svc_re
 }
 
 int
-driver_shutdown(struct error *err)
+driver_shutdown(struct error *err, struct driver **drv)
 {
         int ret;
-        struct driver *ctx = driver_get_context();
+        struct driver *ctx = *drv;
         struct driver_shutdown_res res = {0};
 
-        if (ctx->initialized == false)
+        if (ctx == NULL)
                 return (0);
 
-        ret = call_rpc(err, &ctx->rpc, &res, driver_shutdown_1);
-        xdr_free((xdrproc_t)xdr_driver_shutdown_res, (caddr_t)&res);
+        /* A shared service (i.e. one we did not spawn) is left running. */
+        if (ctx->rpc.pid > 0) {
+                ret = call_rpc(err, &ctx->rpc, &res, driver_shutdown_1);
+                xdr_free((xdrproc_t)xdr_driver_shutdown_res, (caddr_t)&res);
+        } else {
+                ret = 0;
+        }
         if (rpc_shutdown(err, &ctx->rpc, (ret < 0)) < 0)
                 return (-1);
 
-        ctx->initialized = false;
+        xdr_free((xdrproc_t)xdr_driver_snapshot, (caddr_t)&ctx->snapshot.data);
+        free(ctx);
+        *drv = NULL;
         return (0);
 }
 
 bool_t
-driver_shutdown_1_svc(ptr_t ctxptr, driver_shutdown_res *res, maybe_unused struct svc_req *req)
+driver_shutdown_1_svc(maybe_unused ptr_t ctxptr, driver_shutdown_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
+        struct driver *ctx = driver_service(ctxptr);
         int rv = -1;
 
         memset(res, 0, sizeof(*res));
+        if (ctx->shared) {
+                error_setx(err, "shared driver rpc service cannot be shut down remotely");
+                error_to_xdr(err, res);
+                return (true);
+        }
         if ((rv = call_nvml(err, ctx, nvmlShutdown)) < 0)
                 goto fail;
         svc_exit();
@@ -210,14 +674,161 @@ driver_shutdown_1_svc(ptr_t ctxptr, driver_shutdown_res *res, maybe_unused struc
         return (true);
 }
 
+/*
+ * The socket of a shared service can't be removed by the service itself, which chroots into the driver root and
+ * drops its privileges. Instead, a helper process is forked beforehand with the credentials and root it was created
+ * with. It waits for the service to close its end of a pipe, which also happens if the service gets killed, and then
+ * removes the socket unless it was replaced in the meantime.
+ */
+static const int serve_signals[] = {SIGHUP, SIGINT, SIGTERM};
+
+static int
+spawn_socket_reaper(struct error *err, const struct rpc *rpc, const char *path, pid_t *pid)
+{
+        struct stat s, cur;
+        int fd[2];
+        char c;
+
+        if (lstat(path, &s) < 0) {
+                error_set(err, "stat failed: %s", path);
+                return (-1);
+        }
+        if (pipe2(fd, O_CLOEXEC) < 0) {
+                error_set(err, "pipe creation failed");
+                return (-1);
+        }
+        if ((*pid = fork()) < 0) {
+                error_set(err, "process creation failed");
+                xclose(fd[0]);
+                xclose(fd[1]);
+                return (-1);
+        }
+        if (*pid == 0) {
+                /* Signals sent to the process group are meant for the service, outlive it to clean up after it. */
+                for (size_t i = 0; i < nitems(serve_signals); ++i)
+                        signal(serve_signals[i], SIG_IGN);
+                xclose(rpc->svc->xp_sock);
+                xclose(fd[1]);
+                while (read(fd[0], &c, 1) < 0 && errno == EINTR)
+                        ;
+                if (lstat(path, &cur) == 0 && cur.st_dev == s.st_dev && cur.st_ino == s.st_ino)
+                        unlink(path);
+                _exit(EXIT_SUCCESS);
+        }
+        xclose(fd[0]);
+        return (fd[1]);
+}
+
+/*
+ * driver_serve runs the driver service in the current process and shares it with other library contexts
+ * over the unix socket at path. NVML stays initialized for the lifetime of the service, and the device tree
+ * is cached until the driver version, the MIG modes or the MIG instances change.
+ */
+int
+driver_serve(struct error *err, const char *root, uid_t uid, gid_t gid, const char *path)
+{
+        struct rpc_prog rpc_prog = {0};
+        struct driver *ctx;
+        struct driver_init_res res = {0};
+        pid_t reaper = -1;
+        int reaper_fd = -1;
+        int rv = -1;
+
+        rpc_prog = (struct rpc_prog){
+                .name = "driver",
+                .id = DRIVER_PROGRAM,
+                .version = DRIVER_VERSION,
+                .dispatch = driver_program_1,
+        };
+
+        if ((ctx = xcalloc(err, 1, sizeof(*ctx))) == NULL)
+                return (-1);
+        *ctx = (struct driver){
+                .rpc = {0},
+                .root = {0},
+                .nvml_path = SONAME_LIBNVML,
+                .uid = uid,
+                .gid = gid,
+                .nvml_dl = NULL,
+                .shared = true,
+        };
+        strcpy(ctx->root, root);
+        service = ctx;
+
+        if (set_nvml_override(err, ctx) < 0)
+                goto fail;
+        if (rpc_listen(err, &ctx->rpc, &rpc_prog, path) < 0)
+                goto fail;
+        if ((reaper_fd = spawn_socket_reaper(err, &ctx->rpc, path, &reaper)) < 0)
+                goto fail;
+
+        driver_init_1_svc(0, &res, NULL);
+        error_from_xdr(err, &res);
+        xdr_free((xdrproc_t)xdr_driver_init_res, (caddr_t)&res);
+        if (err->code != 0)
+                goto fail;
+        ctx->initialized = true;
+
+        /* MIG reconfigurations can only be detected if the driver procfs is visible from the driver root. */
+        if ((ctx->cache.enabled = (access(NV_PROC_DRIVER_CAPS, F_OK) == 0)) == false)
+                log_warnf("%s is not accessible, device information will not be cached", NV_PROC_DRIVER_CAPS);
+
+        svc_run();
+        log_info("terminating shared driver rpc service");
+        rv = 0;
+
+        call_nvml(NULL, ctx, nvmlShutdown);
+        xdlclose(NULL, ctx->nvml_dl);
+
+ fail:
+        if (ctx->rpc.svc != NULL) {
+                svc_destroy(ctx->rpc.svc);
+                if (reaper_fd < 0)
+                        unlink(path);
+        }
+        if (reaper_fd >= 0) {
+                xclose(reaper_fd);
+                waitpid(reaper, NULL, 0);
+        }
+        free(ctx->cache.key);
+        free(ctx->cache.data);
+        free(ctx);
+        service = NULL;
+        return (rv);
+}
+
+bool_t
+driver_attach_1_svc(maybe_unused ptr_t ctxptr, char *root, char *nvml_path, u_int uid, u_int gid, driver_attach_res *res, maybe_unused struct svc_req *req)
+{
+        struct error *err = (struct error[]){0};
+        struct driver *ctx = driver_service(ctxptr);
+
+        memset(res, 0, sizeof(*res));
+        if (!ctx->shared || !ctx->initialized) {
+                error_setx(err, "driver rpc service is not shared");
+                goto fail;
+        }
+        if (!str_equal(root, ctx->root) || !str_equal(nvml_path, ctx->nvml_path) || uid != ctx->uid || gid != ctx->gid) {
+                error_setx(err, "driver rpc service configuration mismatch (root %s, nvml %s, user %"PRIu32":%"PRIu32")",
+                    ctx->root, ctx->nvml_path, (uint32_t)ctx->uid, (uint32_t)ctx->gid);
+                goto fail;
+        }
+        return (true);
+
+ fail:
+        error_to_xdr(err, res);
+        return (true);
+}
+
 int
-driver_get_rm_version(struct error *err, char **version)
+driver_get_rm_version(struct error *err, struct driver *ctx, char **version)
 {
-        struct driver *ctx = driver_get_context();
         struct driver_get_rm_version_res res = {0};
         int rv = -1;
 
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_rm_version_1) < 0)
+        if (ctx->snapshot.loaded)
+                return ((*version = xstrdup(err, ctx->snapshot.data.rm_version)) == NULL ? -1 : 0);
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_rm_version_1) < 0)
                 goto fail;
         if ((*version = xstrdup(err, res.driver_get_rm_version_res_u.vers)) == NULL)
                 goto fail;
@@ -229,10 +840,10 @@ driver_get_rm_version(struct error *err, char **version)
 }
 
 bool_t
-driver_get_rm_version_1_svc(ptr_t ctxptr, driver_get_rm_version_res *res, maybe_unused struct svc_req *req)
+driver_get_rm_version_1_svc(maybe_unused ptr_t ctxptr, driver_get_rm_version_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
+        struct driver *ctx = driver_service(ctxptr);
         char buf[NVML_SYSTEM_DRIVER_VERSION_BUFFER_SIZE];
 
         memset(res, 0, sizeof(*res));
@@ -248,13 +859,16 @@ driver_get_rm_version_1_svc(ptr_t ctxptr, driver_get_rm_version_res *res, maybe_
 }
 
 int
-driver_get_cuda_version(struct error *err, char **version)
+driver_get_cuda_version(struct error *err, struct driver *ctx, char **version)
 {
-        struct driver *ctx = driver_get_context();
         struct driver_get_cuda_version_res res = {0};
         int rv = -1;
 
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_cuda_version_1) < 0)
+        if (ctx->snapshot.loaded) {
+                return (xasprintf(err, version, "%u.%u", ctx->snapshot.data.cuda_version.major,
+                    ctx->snapshot.data.cuda_version.minor) < 0 ? -1 : 0);
+        }
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_cuda_version_1) < 0)
                 goto fail;
         if (xasprintf(err, version, "%u.%u", res.driver_get_cuda_version_res_u.vers.major,
             res.driver_get_cuda_version_res_u.vers.minor) < 0)
@@ -267,10 +881,10 @@ driver_get_cuda_version(struct error *err, char **version)
 }
 
 bool_t
-driver_get_cuda_version_1_svc(ptr_t ctxptr, driver_get_cuda_version_res *res, maybe_unused struct svc_req *req)
+driver_get_cuda_version_1_svc(maybe_unused ptr_t ctxptr, driver_get_cuda_version_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
+        struct driver *ctx = driver_service(ctxptr);
         int version;
 
         memset(res, 0, sizeof(*res));
@@ -287,13 +901,12 @@ driver_get_cuda_version_1_svc(ptr_t ctxptr, driver_get_cuda_version_res *res, ma
 }
 
 int
-driver_get_device_count(struct error *err, unsigned int *count)
+driver_get_device_count(struct error *err, struct driver *ctx, unsigned int *count)
 {
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_count_res res = {0};
         int rv = -1;
 
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_count_1) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_count_1) < 0)
                 goto fail;
         *count = res.driver_get_device_count_res_u.count;
         rv = 0;
@@ -304,10 +917,10 @@ driver_get_device_count(struct error *err, unsigned int *count)
 }
 
 bool_t
-driver_get_device_count_1_svc(ptr_t ctxptr, driver_get_device_count_res *res, maybe_unused struct svc_req *req)
+driver_get_device_count_1_svc(maybe_unused ptr_t ctxptr, driver_get_device_count_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
+        struct driver *ctx = driver_service(ctxptr);
         unsigned int count;
 
         memset(res, 0, sizeof(*res));
@@ -322,13 +935,12 @@ driver_get_device_count_1_svc(ptr_t ctxptr, driver_get_device_count_res *res, ma
 }
 
 int
-driver_get_device(struct error *err, unsigned int idx, struct driver_device **dev)
+driver_get_device(struct error *err, struct driver *ctx, unsigned int idx, struct driver_device **dev)
 {
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_res res = {0};
         int rv = -1;
 
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_1, idx) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_1, idx) < 0)
                 goto fail;
         *dev = (struct driver_device *)res.driver_get_device_res_u.dev;
         rv = 0;
@@ -339,20 +951,20 @@ driver_get_device(struct error *err, unsigned int idx, struct driver_device **de
 }
 
 bool_t
-driver_get_device_1_svc(ptr_t ctxptr, u_int idx, driver_get_device_res *res, maybe_unused struct svc_req *req)
+driver_get_device_1_svc(maybe_unused ptr_t ctxptr, u_int idx, driver_get_device_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
+        struct driver *ctx = driver_service(ctxptr);
 
         memset(res, 0, sizeof(*res));
         if (idx >= MAX_DEVICES) {
                 error_setx(err, "too many devices");
                 goto fail;
         }
-        if (call_nvml(err, ctx, nvmlDeviceGetHandleByIndex_v2, (unsigned)idx, &device_handles[idx].nvml) < 0)
+        if (call_nvml(err, ctx, nvmlDeviceGetHandleByIndex_v2, (unsigned)idx, &ctx->devices[idx].nvml) < 0)
                 goto fail;
 
-        res->driver_get_device_res_u.dev = (ptr_t)&device_handles[idx];
+        res->driver_get_device_res_u.dev = DEVICE_TOKEN(idx, 0);
         return (true);
 
  fail:
@@ -361,13 +973,12 @@ driver_get_device_1_svc(ptr_t ctxptr, u_int idx, driver_get_device_res *res, may
 }
 
 int
-driver_get_device_minor(struct error *err, struct driver_device *dev, unsigned int *minor)
+driver_get_device_minor(struct error *err, struct driver *ctx, struct driver_device *dev, unsigned int *minor)
 {
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_minor_res res = {0};
         int rv = -1;
 
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_minor_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_minor_1, (ptr_t)dev) < 0)
                 goto fail;
         *minor = res.driver_get_device_minor_res_u.minor;
         rv = 0;
@@ -378,15 +989,17 @@ driver_get_device_minor(struct error *err, struct driver_device *dev, unsigned i
 }
 
 bool_t
-driver_get_device_minor_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_minor_res *res, maybe_unused struct svc_req *req)
+driver_get_device_minor_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_minor_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
         unsigned int minor;
 
         memset(res, 0, sizeof(*res));
-        if (call_nvml(err, ctx, nvmlDeviceGetMinorNumber, handle->nvml, &minor) < 0)
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+        if (call_nvml(err, ctx, nvmlDeviceGetMinorNumber, *handle, &minor) < 0)
                 goto fail;
         res->driver_get_device_minor_res_u.minor = minor;
         return (true);
@@ -397,13 +1010,12 @@ driver_get_device_minor_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_minor_r
 }
 
 int
-driver_get_device_busid(struct error *err, struct driver_device *dev, char **busid)
+driver_get_device_busid(struct error *err, struct driver *ctx, struct driver_device *dev, char **busid)
 {
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_busid_res res = {0};
         int rv = -1;
 
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_busid_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_busid_1, (ptr_t)dev) < 0)
                 goto fail;
         if ((*busid = xstrdup(err, res.driver_get_device_busid_res_u.busid)) == NULL)
                 goto fail;
@@ -415,15 +1027,17 @@ driver_get_device_busid(struct error *err, struct driver_device *dev, char **bus
 }
 
 bool_t
-driver_get_device_busid_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_busid_res *res, maybe_unused struct svc_req *req)
+driver_get_device_busid_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_busid_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
         nvmlPciInfo_t pci;
 
         memset(res, 0, sizeof(*res));
-        if (call_nvml(err, ctx, nvmlDeviceGetPciInfo, handle->nvml, &pci) < 0)
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+        if (call_nvml(err, ctx, nvmlDeviceGetPciInfo, *handle, &pci) < 0)
                 goto fail;
 
         if (xasprintf(err, &res->driver_get_device_busid_res_u.busid, "%08x:%02x:%02x.0", pci.domain, pci.bus, pci.device) < 0)
@@ -436,13 +1050,12 @@ driver_get_device_busid_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_busid_r
 }
 
 int
-driver_get_device_uuid(struct error *err, struct driver_device *dev, char **uuid)
+driver_get_device_uuid(struct error *err, struct driver *ctx, struct driver_device *dev, char **uuid)
 {
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_uuid_res res = {0};
         int rv = -1;
 
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_uuid_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_uuid_1, (ptr_t)dev) < 0)
                 goto fail;
         if ((*uuid = xstrdup(err, res.driver_get_device_uuid_res_u.uuid)) == NULL)
                 goto fail;
@@ -454,15 +1067,17 @@ driver_get_device_uuid(struct error *err, struct driver_device *dev, char **uuid
 }
 
 bool_t
-driver_get_device_uuid_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_uuid_res *res, maybe_unused struct svc_req *req)
+driver_get_device_uuid_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_uuid_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
         char buf[NVML_DEVICE_UUID_V2_BUFFER_SIZE];
 
         memset(res, 0, sizeof(*res));
-        if (call_nvml(err, ctx, nvmlDeviceGetUUID, handle->nvml, buf, sizeof(buf)) < 0)
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+        if (call_nvml(err, ctx, nvmlDeviceGetUUID, *handle, buf, sizeof(buf)) < 0)
                 goto fail;
         if ((res->driver_get_device_uuid_res_u.uuid = xstrdup(err, buf)) == NULL)
                 goto fail;
@@ -474,13 +1089,12 @@ driver_get_device_uuid_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_uuid_res
 }
 
 int
-driver_get_device_model(struct error *err, struct driver_device *dev, char **model)
+driver_get_device_model(struct error *err, struct driver *ctx, struct driver_device *dev, char **model)
 {
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_model_res res = {0};
         int rv = -1;
 
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_model_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_model_1, (ptr_t)dev) < 0)
                 goto fail;
         if ((*model = xstrdup(err, res.driver_get_device_model_res_u.model)) == NULL)
                 goto fail;
@@ -492,15 +1106,17 @@ driver_get_device_model(struct error *err, struct driver_device *dev, char **mod
 }
 
 bool_t
-driver_get_device_model_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_model_res *res, maybe_unused struct svc_req *req)
+driver_get_device_model_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_model_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
         char buf[NVML_DEVICE_NAME_BUFFER_SIZE];
 
         memset(res, 0, sizeof(*res));
-        if (call_nvml(err, ctx, nvmlDeviceGetName, handle->nvml, buf, sizeof(buf)) < 0)
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+        if (call_nvml(err, ctx, nvmlDeviceGetName, *handle, buf, sizeof(buf)) < 0)
                 goto fail;
         if ((res->driver_get_device_model_res_u.model = xstrdup(err, buf)) == NULL)
                 goto fail;
@@ -511,93 +1127,81 @@ driver_get_device_model_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_model_r
         return (true);
 }
 
-int
-driver_get_device_brand(struct error *err, struct driver_device *dev, char **brand)
+static const char *
+device_brand_name(nvmlBrandType_t brand)
 {
-        struct driver *ctx = driver_get_context();
-        struct driver_get_device_brand_res res = {0};
-        int rv = -1;
-
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_brand_1, (ptr_t)dev) < 0)
-                goto fail;
-        if ((*brand = xstrdup(err, res.driver_get_device_brand_res_u.brand)) == NULL)
-                goto fail;
-        rv = 0;
-
- fail:
-        xdr_free((xdrproc_t)xdr_driver_get_device_brand_res, (caddr_t)&res);
-        return (rv);
-}
-
-bool_t
-driver_get_device_brand_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_brand_res *res, maybe_unused struct svc_req *req)
-{
-        struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
-        nvmlBrandType_t brand;
-        const char *buf;
-
-        memset(res, 0, sizeof(*res));
-        if (call_nvml(err, ctx, nvmlDeviceGetBrand, handle->nvml, &brand) < 0)
-                goto fail;
         switch (brand) {
         case NVML_BRAND_QUADRO:
-                buf = "Quadro";
-                break;
+                return ("Quadro");
         case NVML_BRAND_TESLA:
-                buf = "Tesla";
-                break;
+                return ("Tesla");
         case NVML_BRAND_NVS:
-                buf = "NVS";
-                break;
+                return ("NVS");
         case NVML_BRAND_GRID:
-                buf = "GRID";
-                break;
+                return ("GRID");
         case NVML_BRAND_GEFORCE:
-                buf = "GeForce";
-                break;
+                return ("GeForce");
         case NVML_BRAND_TITAN:
-                buf = "TITAN";
-                break;
+                return ("TITAN");
         case NVML_BRAND_NVIDIA_VAPPS:
-                buf = "VApps";
-                break;
+                return ("VApps");
         case NVML_BRAND_NVIDIA_VPC:
-                buf = "VPC";
-                break;
+                return ("VPC");
         case NVML_BRAND_NVIDIA_VCS:
-                buf = "VCS";
-                break;
+                return ("VCS");
         case NVML_BRAND_NVIDIA_VWS:
-                buf = "VWS";
-                break;
+                return ("VWS");
         case NVML_BRAND_NVIDIA_CLOUD_GAMING:
-                buf = "CloudGaming";
-                break;
+                return ("CloudGaming");
         // Deprecated in favor of NVML_BRAND_NVIDIA_CLOUD_GAMING
         //case NVML_BRAND_NVIDIA_VGAMING:
-        //        buf = "VGaming";
-        //        break;
+        //        return ("VGaming");
         case NVML_BRAND_QUADRO_RTX:
-                buf = "QuadroRTX";
-                break;
+                return ("QuadroRTX");
         case NVML_BRAND_NVIDIA_RTX:
-                buf = "NvidiaRTX";
-                break;
+                return ("NvidiaRTX");
         case NVML_BRAND_NVIDIA:
-                buf = "Nvidia";
-                break;
+                return ("Nvidia");
         case NVML_BRAND_GEFORCE_RTX:
-                buf = "GeForceRTX";
-                break;
+                return ("GeForceRTX");
         case NVML_BRAND_TITAN_RTX:
-                buf = "TitanRTX";
-                break;
+                return ("TitanRTX");
         default:
-                buf = "Unknown";
+                return ("Unknown");
         }
-        if ((res->driver_get_device_brand_res_u.brand = xstrdup(err, buf)) == NULL)
+}
+
+int
+driver_get_device_brand(struct error *err, struct driver *ctx, struct driver_device *dev, char **brand)
+{
+        struct driver_get_device_brand_res res = {0};
+        int rv = -1;
+
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_brand_1, (ptr_t)dev) < 0)
+                goto fail;
+        if ((*brand = xstrdup(err, res.driver_get_device_brand_res_u.brand)) == NULL)
+                goto fail;
+        rv = 0;
+
+ fail:
+        xdr_free((xdrproc_t)xdr_driver_get_device_brand_res, (caddr_t)&res);
+        return (rv);
+}
+
+bool_t
+driver_get_device_brand_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_brand_res *res, maybe_unused struct svc_req *req)
+{
+        struct error *err = (struct error[]){0};
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
+        nvmlBrandType_t brand;
+
+        memset(res, 0, sizeof(*res));
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+        if (call_nvml(err, ctx, nvmlDeviceGetBrand, *handle, &brand) < 0)
+                goto fail;
+        if ((res->driver_get_device_brand_res_u.brand = xstrdup(err, device_brand_name(brand))) == NULL)
                 goto fail;
         return (true);
 
@@ -607,13 +1211,12 @@ driver_get_device_brand_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_brand_r
 }
 
 int
-driver_get_device_arch(struct error *err, struct driver_device *dev, char **arch)
+driver_get_device_arch(struct error *err, struct driver *ctx, struct driver_device *dev, char **arch)
 {
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_arch_res res = {0};
         int rv = -1;
 
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_arch_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_arch_1, (ptr_t)dev) < 0)
                 goto fail;
         if (xasprintf(err, arch, "%u.%u", res.driver_get_device_arch_res_u.arch.major,
             res.driver_get_device_arch_res_u.arch.minor) < 0)
@@ -626,15 +1229,17 @@ driver_get_device_arch(struct error *err, struct driver_device *dev, char **arch
 }
 
 bool_t
-driver_get_device_arch_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_arch_res *res, maybe_unused struct svc_req *req)
+driver_get_device_arch_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_arch_res *res, maybe_unused struct svc_req *req)
 {
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
         int major, minor;
 
         memset(res, 0, sizeof(*res));
-        if (call_nvml(err, ctx, nvmlDeviceGetCudaComputeCapability, handle->nvml, &major, &minor) < 0)
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+        if (call_nvml(err, ctx, nvmlDeviceGetCudaComputeCapability, *handle, &major, &minor) < 0)
                 goto fail;
 
         res->driver_get_device_arch_res_u.arch.major = (unsigned int)major;
@@ -647,10 +1252,9 @@ driver_get_device_arch_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_arch_res
 }
 
 int
-driver_get_device_mig_enabled(struct error *err, struct driver_device *dev, bool *enabled)
+driver_get_device_mig_enabled(struct error *err, struct driver *ctx, struct driver_device *dev, bool *enabled)
 {
         // Initialize local variables.
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_mig_mode_res res = {0};
         unsigned int current;
         int rv = -1;
@@ -659,7 +1263,7 @@ driver_get_device_mig_enabled(struct error *err, struct driver_device *dev, bool
         *enabled = false;
 
         // Make an RPC call to determine if MIG mode is enabled or not.
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_mig_mode_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_mig_mode_1, (ptr_t)dev) < 0)
                 goto fail;
 
         switch(res.driver_get_device_mig_mode_res_u.mode.error) {
@@ -691,10 +1295,9 @@ driver_get_device_mig_enabled(struct error *err, struct driver_device *dev, bool
 }
 
 int
-driver_get_device_mig_capable(struct error *err, struct driver_device *dev, bool *supported)
+driver_get_device_mig_capable(struct error *err, struct driver *ctx, struct driver_device *dev, bool *supported)
 {
         // Initialize local variables.
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_mig_mode_res res = {0};
         int rv = -1;
 
@@ -702,7 +1305,7 @@ driver_get_device_mig_capable(struct error *err, struct driver_device *dev, bool
         *supported= false;
 
         // Make an RPC call to determine if MIG mode is enabled or not.
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_mig_mode_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_mig_mode_1, (ptr_t)dev) < 0)
                 goto fail;
 
         switch(res.driver_get_device_mig_mode_res_u.mode.error) {
@@ -727,32 +1330,40 @@ driver_get_device_mig_capable(struct error *err, struct driver_device *dev, bool
 }
 
 bool_t
-driver_get_device_mig_mode_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_mig_mode_res *res, maybe_unused struct svc_req *req)
+driver_get_device_mig_mode_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_mig_mode_res *res, maybe_unused struct svc_req *req)
 {
         // Initialize local variables.
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
         unsigned int current, pending;
 
         // Clear out 'res' which will hold the result of this RPC call.
         memset(res, 0, sizeof(*res));
 
+        // Resolve the device handle from the token sent by the client.
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+
         // Call into NVML to get the MIG mode. We don't directly catch the
         // error here and return a failure. Instead, we capture the error and
         // pass it as part of the return value for the caller to interpret.
-        if(call_nvml(err, ctx, nvmlDeviceGetMigMode, handle->nvml, &current, &pending) < 0)
+        if(call_nvml(err, ctx, nvmlDeviceGetMigMode, *handle, &current, &pending) < 0)
                 res->driver_get_device_mig_mode_res_u.mode.error = err->code;
         res->driver_get_device_mig_mode_res_u.mode.current = current;
         res->driver_get_device_mig_mode_res_u.mode.pending = pending;
         return (true);
+
+ fail:
+        // Populate the error in the result of the RPC call and return.
+        error_to_xdr(err, res);
+        return (true);
 }
 
 int
-driver_get_device_max_mig_device_count(struct error *err, struct driver_device *dev, unsigned int *count)
+driver_get_device_max_mig_device_count(struct error *err, struct driver *ctx, struct driver_device *dev, unsigned int *count)
 {
         // Initialize local variables.
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_max_mig_device_count_res res = {0};
         int rv = -1;
 
@@ -760,7 +1371,7 @@ driver_get_device_max_mig_device_count(struct error *err, struct driver_device *
         *count = 0;
 
         // Make an RPC call to get the max count of MIG devices for this device.
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_max_mig_device_count_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_max_mig_device_count_1, (ptr_t)dev) < 0)
                 goto fail;
 
         // Extract max MIG device count from the result of the RPC call and
@@ -777,21 +1388,25 @@ driver_get_device_max_mig_device_count(struct error *err, struct driver_device *
 }
 
 bool_t
-driver_get_device_max_mig_device_count_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_max_mig_device_count_res *res, maybe_unused struct svc_req *req)
+driver_get_device_max_mig_device_count_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_max_mig_device_count_res *res, maybe_unused struct svc_req *req)
 {
         // Initialize local variables.
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
 
         // Clear out 'res' which will hold the result of this RPC call.
         memset(res, 0, sizeof(*res));
 
+        // Resolve the device handle from the token sent by the client.
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+
         // Grab a shorter reference to fields embedded in 'res' for the max MIG count.
         unsigned int *count = (unsigned int *)&res->driver_get_device_max_mig_device_count_res_u.count;
 
         // Call into NVML to get the max MIG count and assign it to '*count'.
-        if (call_nvml(err, ctx, nvmlDeviceGetMaxMigDeviceCount, handle->nvml, count) < 0)
+        if (call_nvml(err, ctx, nvmlDeviceGetMaxMigDeviceCount, *handle, count) < 0)
                 goto fail;
 
         return (true);
@@ -803,10 +1418,9 @@ driver_get_device_max_mig_device_count_1_svc(ptr_t ctxptr, ptr_t dev, driver_get
 }
 
 int
-driver_get_device_mig_device(struct error *err, struct driver_device *dev, unsigned int idx, struct driver_device **mig_dev)
+driver_get_device_mig_device(struct error *err, struct driver *ctx, struct driver_device *dev, unsigned int idx, struct driver_device **mig_dev)
 {
         // Initialize local variables.
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_mig_device_res res = {0};
         int rv = -1;
 
@@ -814,7 +1428,7 @@ driver_get_device_mig_device(struct error *err, struct driver_device *dev, unsig
         *mig_dev = NULL;
 
         // Make an RPC call to get the MIG device t index 'idx' for this device.
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_mig_device_1, (ptr_t)dev, idx) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_mig_device_1, (ptr_t)dev, idx) < 0)
                 goto fail;
 
         // Extract the MIG device from the result of the RPC call and populate
@@ -830,16 +1444,25 @@ driver_get_device_mig_device(struct error *err, struct driver_device *dev, unsig
 }
 
 bool_t
-driver_get_device_mig_device_1_svc(ptr_t ctxptr, ptr_t dev, u_int idx, driver_get_device_mig_device_res *res, maybe_unused struct svc_req *req)
+driver_get_device_mig_device_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, u_int idx, driver_get_device_mig_device_res *res, maybe_unused struct svc_req *req)
 {
         // Initialize local variables.
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
 
         // Clear out 'res' which will hold the result of this RPC call.
         memset(res, 0, sizeof(*res));
 
+        // Resolve the device handle from the token sent by the client, MIG
+        // devices can only be looked up from their parent GPU.
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+        if (DEVICE_TOKEN_MIG(dev) != 0) {
+                error_setx(err, "invalid device handle");
+                goto fail;
+        }
+
         // Sanity check that we don't exceed MAX_MIG_DEVICES.
         if (idx >= MAX_MIG_DEVICES) {
                 error_setx(err, "too many MIG devices");
@@ -848,10 +1471,10 @@ driver_get_device_mig_device_1_svc(ptr_t ctxptr, ptr_t dev, u_int idx, driver_ge
 
         // Grab a shorter reference to mig field embedded in the device handle
         // for the MIG device.
-        nvmlDevice_t *mig_dev = &handle->mig[idx].nvml;
+        nvmlDevice_t *mig_dev = &ctx->devices[DEVICE_TOKEN_GPU(dev)].mig[idx].nvml;
 
         // Call into NVML to get the max MIG count and assign it to '*count'.
-        if (call_nvml(err, ctx, nvmlDeviceGetMigDeviceHandleByIndex, handle->nvml, idx, mig_dev) < 0) {
+        if (call_nvml(err, ctx, nvmlDeviceGetMigDeviceHandleByIndex, *handle, idx, mig_dev) < 0) {
                 // If a device isn't found, then it's not an error, we just set
                 // the result to NULL in our return value.
                 switch (err->code) {
@@ -863,8 +1486,8 @@ driver_get_device_mig_device_1_svc(ptr_t ctxptr, ptr_t dev, u_int idx, driver_ge
                 goto fail;
         }
 
-        // Assign the field embedded in the 'res' to point to the MIG device.
-        res->driver_get_device_mig_device_res_u.dev = (ptr_t)&handle->mig[idx];
+        // Assign the token of the MIG device to the field embedded in the 'res'.
+        res->driver_get_device_mig_device_res_u.dev = DEVICE_TOKEN(DEVICE_TOKEN_GPU(dev), idx + 1);
 
         return (true);
 
@@ -875,10 +1498,9 @@ driver_get_device_mig_device_1_svc(ptr_t ctxptr, ptr_t dev, u_int idx, driver_ge
 }
 
 int
-driver_get_device_gpu_instance_id(struct error *err, struct driver_device *dev, unsigned int *id)
+driver_get_device_gpu_instance_id(struct error *err, struct driver *ctx, struct driver_device *dev, unsigned int *id)
 {
         // Initialize local variables.
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_gpu_instance_id_res res = {0};
         int rv = -1;
 
@@ -886,7 +1508,7 @@ driver_get_device_gpu_instance_id(struct error *err, struct driver_device *dev,
         *id = 0;
 
         // Make an RPC call to grab the instance ID of the GPU Instance.
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_gpu_instance_id_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_gpu_instance_id_1, (ptr_t)dev) < 0)
                 goto fail;
 
         // Extract the id from the result of the RPC call and populate the 'id'
@@ -903,21 +1525,25 @@ driver_get_device_gpu_instance_id(struct error *err, struct driver_device *dev,
 }
 
 bool_t
-driver_get_device_gpu_instance_id_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_gpu_instance_id_res *res, maybe_unused struct svc_req *req)
+driver_get_device_gpu_instance_id_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_gpu_instance_id_res *res, maybe_unused struct svc_req *req)
 {
         // Initialize local variables.
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
 
         // Clear out 'res' which will hold the result of this RPC call.
         memset(res, 0, sizeof(*res));
 
+        // Resolve the device handle from the token sent by the client.
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+
         // Grab a shorter reference to fields embedded in 'res' for the id.
         unsigned int *id = (unsigned int *)&res->driver_get_device_gpu_instance_id_res_u.id;
 
         // Call into NVML to get the GPU Instance Info.
-        if (call_nvml(err, ctx, nvmlDeviceGetGpuInstanceId, handle->nvml, id) < 0)
+        if (call_nvml(err, ctx, nvmlDeviceGetGpuInstanceId, *handle, id) < 0)
                 goto fail;
 
         return (true);
@@ -929,10 +1555,9 @@ driver_get_device_gpu_instance_id_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_devi
 }
 
 int
-driver_get_device_compute_instance_id(struct error *err, struct driver_device *dev, unsigned int *id)
+driver_get_device_compute_instance_id(struct error *err, struct driver *ctx, struct driver_device *dev, unsigned int *id)
 {
         // Initialize local variables.
-        struct driver *ctx = driver_get_context();
         struct driver_get_device_compute_instance_id_res res = {0};
         int rv = -1;
 
@@ -940,7 +1565,7 @@ driver_get_device_compute_instance_id(struct error *err, struct driver_device *d
         *id = 0;
 
         // Make an RPC call to grab the instance ID of the Compute Instance.
-        if (call_rpc(err, &ctx->rpc, &res, driver_get_device_compute_instance_id_1, (ptr_t)dev) < 0)
+        if (driver_connected(err, ctx) < 0 || call_rpc(err, &ctx->rpc, &res, driver_get_device_compute_instance_id_1, (ptr_t)dev) < 0)
                 goto fail;
 
         // Extract the id from the result of the RPC call and populate the 'id'
@@ -957,21 +1582,25 @@ driver_get_device_compute_instance_id(struct error *err, struct driver_device *d
 }
 
 bool_t
-driver_get_device_compute_instance_id_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_device_compute_instance_id_res *res, maybe_unused struct svc_req *req)
+driver_get_device_compute_instance_id_1_svc(maybe_unused ptr_t ctxptr, ptr_t dev, driver_get_device_compute_instance_id_res *res, maybe_unused struct svc_req *req)
 {
         // Initialize local variables.
         struct error *err = (struct error[]){0};
-        struct driver *ctx = (struct driver *)ctxptr;
-        struct driver_device *handle = (struct driver_device *)dev;
+        struct driver *ctx = driver_service(ctxptr);
+        nvmlDevice_t *handle;
 
         // Clear out 'res' which will hold the result of this RPC call.
         memset(res, 0, sizeof(*res));
 
+        // Resolve the device handle from the token sent by the client.
+        if ((handle = device_handle(err, ctx, dev)) == NULL)
+                goto fail;
+
         // Grab a shorter reference to fields embedded in 'res' for the id.
         unsigned int *id = (unsigned int *)&res->driver_get_device_compute_instance_id_res_u.id;
 
         // Call into NVML to get the Compute Instance Info.
-        if (call_nvml(err, ctx, nvmlDeviceGetComputeInstanceId, handle->nvml, id) < 0)
+        if (call_nvml(err, ctx, nvmlDeviceGetComputeInstanceId, *handle, id) < 0)
                 goto fail;
 
         return (true);
@@ -980,3 +1609,520 @@ driver_get_device_compute_instance_id_1_svc(ptr_t ctxptr, ptr_t dev, driver_get_
         error_to_xdr(err, res);
         return (true);
 }
+
+static int
+copy_device_attrs(struct error *err, const driver_device_attrs *attrs, size_t n, struct driver_device_info **infos)
+{
+        struct driver_device_info *info;
+        const driver_mig_device_attrs *mig_attrs;
+
+        if ((info = xcalloc(err, n, sizeof(*info))) == NULL)
+                return (-1);
+
+        for (size_t i = 0; i < n; ++i) {
+                if ((info[i].model = xstrdup(err, attrs[i].model)) == NULL)
+                        goto fail;
+                if ((info[i].uuid = xstrdup(err, attrs[i].uuid)) == NULL)
+                        goto fail;
+                if ((info[i].busid = xstrdup(err, attrs[i].busid)) == NULL)
+                        goto fail;
+                if ((info[i].brand = xstrdup(err, attrs[i].brand)) == NULL)
+                        goto fail;
+                if (xasprintf(err, &info[i].arch, "%u.%u", attrs[i].arch.major, attrs[i].arch.minor) < 0)
+                        goto fail;
+                if ((info[i].mig_devices = xcalloc(err, attrs[i].mig_devices.mig_devices_len, sizeof(*info[i].mig_devices))) == NULL)
+                        goto fail;
+                info[i].nmig_devices = attrs[i].mig_devices.mig_devices_len;
+                for (size_t j = 0; j < info[i].nmig_devices; ++j) {
+                        mig_attrs = &attrs[i].mig_devices.mig_devices_val[j];
+                        if ((info[i].mig_devices[j].uuid = xstrdup(err, mig_attrs->uuid)) == NULL)
+                                goto fail;
+                        info[i].mig_devices[j].gi = mig_attrs->gi;
+                        info[i].mig_devices[j].ci = mig_attrs->ci;
+                }
+                info[i].minor = attrs[i].minor;
+                info[i].mig_capable = attrs[i].mig_capable;
+                info[i].mig_enabled = attrs[i].mig_enabled;
+        }
+        *infos = info;
+        return (0);
+
+ fail:
+        driver_device_info_free(info, n);
+        return (-1);
+}
+
+static int
+query_mig_device_info(struct error *err, struct driver *ctx, struct driver_device *dev, struct driver_device_info *info)
+{
+        struct driver_mig_device_info *mig_info;
+        struct driver_device *mig_dev;
+        unsigned int count;
+
+        if (driver_get_device_max_mig_device_count(err, ctx, dev, &count) < 0)
+                return (-1);
+        if ((info->mig_devices = xcalloc(err, count, sizeof(*info->mig_devices))) == NULL)
+                return (-1);
+
+        for (unsigned int i = 0; i < count; ++i) {
+                mig_info = &info->mig_devices[i];
+
+                // If no MIG device exists at this index, then we are done.
+                if (driver_get_device_mig_device(err, ctx, dev, i, &mig_dev) < 0)
+                        return (-1);
+                if (mig_dev == NULL)
+                        break;
+                if (driver_get_device_gpu_instance_id(err, ctx, mig_dev, &mig_info->gi) < 0)
+                        return (-1);
+                if (driver_get_device_compute_instance_id(err, ctx, mig_dev, &mig_info->ci) < 0)
+                        return (-1);
+                if (driver_get_device_uuid(err, ctx, mig_dev, &mig_info->uuid) < 0)
+                        return (-1);
+                info->nmig_devices++;
+        }
+        return (0);
+}
+
+static int
+query_device_info(struct error *err, struct driver *ctx, unsigned int idx, bool native, struct driver_device_info *info)
+{
+        struct driver_device *dev;
+
+        if (driver_get_device(err, ctx, idx, &dev) < 0)
+                return (-1);
+        if (driver_get_device_model(err, ctx, dev, &info->model) < 0)
+                return (-1);
+        if (driver_get_device_uuid(err, ctx, dev, &info->uuid) < 0)
+                return (-1);
+        if (driver_get_device_busid(err, ctx, dev, &info->busid) < 0)
+                return (-1);
+        if (driver_get_device_arch(err, ctx, dev, &info->arch) < 0)
+                return (-1);
+        if (driver_get_device_brand(err, ctx, dev, &info->brand) < 0)
+                return (-1);
+
+        // Device nodes and MIG are only relevant outside of WSL.
+        if (!native)
+                return (0);
+
+        if (driver_get_device_minor(err, ctx, dev, &info->minor) < 0)
+                return (-1);
+        if (driver_get_device_mig_capable(err, ctx, dev, &info->mig_capable) < 0)
+                return (-1);
+        if (driver_get_device_mig_enabled(err, ctx, dev, &info->mig_enabled) < 0)
+                return (-1);
+        if (info->mig_enabled)
+                return (query_mig_device_info(err, ctx, dev, info));
+        return (0);
+}
+
+/*
+ * query_devices_info walks the device tree one attribute at a time, for services which don't implement the
+ * DRIVER_GET_DEVICE_INFO procedure.
+ */
+static int
+query_devices_info(struct error *err, struct driver *ctx, bool native, struct driver_device_info **infos, size_t *count)
+{
+        struct driver_device_info *info;
+        unsigned int n;
+
+        if (driver_get_device_count(err, ctx, &n) < 0)
+                return (-1);
+        if ((info = xcalloc(err, n, sizeof(*info))) == NULL)
+                return (-1);
+        for (unsigned int i = 0; i < n; ++i) {
+                if (query_device_info(err, ctx, i, native, &info[i]) < 0) {
+                        driver_device_info_free(info, n);
+                        return (-1);
+                }
+        }
+        *infos = info;
+        *count = n;
+        return (0);
+}
+
+int
+driver_get_device_info(struct error *err, struct driver *ctx, bool native, struct driver_device_info **infos, size_t *count)
+{
+        // Initialize local variables.
+        struct driver_get_device_info_res res = {0};
+        enum clnt_stat stat;
+        size_t n = 0;
+        int rv = -1;
+
+        // Initialize return values.
+        *infos = NULL;
+        *count = 0;
+
+        // A driver snapshot holds the native device tree already.
+        if (native && ctx->snapshot.loaded) {
+                n = ctx->snapshot.data.devices.devices_len;
+                if (copy_device_attrs(err, ctx->snapshot.data.devices.devices_val, n, infos) < 0)
+                        return (-1);
+                *count = n;
+                return (0);
+        }
+
+        // Make a single RPC call to gather the attributes of all the devices
+        // (and their MIG devices) at once, falling back to one call per
+        // attribute if the service doesn't implement it.
+        if (driver_connected(err, ctx) < 0)
+                goto fail;
+        if (call_rpc_stat(err, &ctx->rpc, &stat, &res, driver_get_device_info_1, native) < 0) {
+                if (stat != RPC_PROCUNAVAIL)
+                        goto fail;
+                error_reset(err);
+                rv = query_devices_info(err, ctx, native, infos, count);
+                goto fail;
+        }
+
+        n = res.driver_get_device_info_res_u.devices.devices_len;
+        if (copy_device_attrs(err, res.driver_get_device_info_res_u.devices.devices_val, n, infos) < 0)
+                goto fail;
+        *count = n;
+
+        // Set 'rv' to 0 to indicate success.
+        rv = 0;
+
+ fail:
+        // Free the results of the RPC call and return.
+        xdr_free((xdrproc_t)xdr_driver_get_device_info_res, (caddr_t)&res);
+        return (rv);
+}
+
+void
+driver_device_info_free(struct driver_device_info *infos, size_t count)
+{
+        if (infos == NULL)
+                return;
+        for (size_t i = 0; i < count; ++i) {
+                free(infos[i].model);
+                free(infos[i].uuid);
+                free(infos[i].busid);
+                free(infos[i].arch);
+                free(infos[i].brand);
+                for (size_t j = 0; infos[i].mig_devices != NULL && j < infos[i].nmig_devices; ++j)
+                        free(infos[i].mig_devices[j].uuid);
+                free(infos[i].mig_devices);
+        }
+        free(infos);
+}
+
+static int
+get_mig_device_attrs(struct error *err, struct driver *ctx, struct driver_device *handle, driver_device_attrs *attrs)
+{
+        driver_mig_device_attrs *mig_attrs;
+        nvmlDevice_t *mig_dev;
+        char buf[NVML_DEVICE_UUID_V2_BUFFER_SIZE];
+        unsigned int count;
+
+        if (call_nvml(err, ctx, nvmlDeviceGetMaxMigDeviceCount, handle->nvml, &count) < 0)
+                return (-1);
+        if ((attrs->mig_devices.mig_devices_val = xcalloc(err, count, sizeof(*mig_attrs))) == NULL)
+                return (-1);
+
+        for (unsigned int i = 0; i < count; ++i) {
+                if (i >= MAX_MIG_DEVICES) {
+                        error_setx(err, "too many MIG devices");
+                        return (-1);
+                }
+                mig_dev = &handle->mig[i].nvml;
+                mig_attrs = &attrs->mig_devices.mig_devices_val[i];
+
+                // If no MIG device exists at this index, then we are done.
+                if (call_nvml(err, ctx, nvmlDeviceGetMigDeviceHandleByIndex, handle->nvml, i, mig_dev) < 0) {
+                        if (err->code != NVML_ERROR_NOT_FOUND)
+                                return (-1);
+                        error_reset(err);
+                        break;
+                }
+                if (call_nvml(err, ctx, nvmlDeviceGetGpuInstanceId, *mig_dev, &mig_attrs->gi) < 0)
+                        return (-1);
+                if (call_nvml(err, ctx, nvmlDeviceGetComputeInstanceId, *mig_dev, &mig_attrs->ci) < 0)
+                        return (-1);
+                if (call_nvml(err, ctx, nvmlDeviceGetUUID, *mig_dev, buf, sizeof(buf)) < 0)
+                        return (-1);
+                if ((mig_attrs->uuid = xstrdup(err, buf)) == NULL)
+                        return (-1);
+                attrs->mig_devices.mig_devices_len++;
+        }
+        return (0);
+}
+
+static int
+get_device_attrs(struct error *err, struct driver *ctx, unsigned int idx, bool native, driver_device_attrs *attrs)
+{
+        struct driver_device *handle = &ctx->devices[idx];
+        char buf[MAX(NVML_DEVICE_UUID_V2_BUFFER_SIZE, NVML_DEVICE_NAME_BUFFER_SIZE)];
+        nvmlPciInfo_t pci;
+        nvmlBrandType_t brand;
+        unsigned int current, pending;
+        int major, minor;
+
+        if (call_nvml(err, ctx, nvmlDeviceGetHandleByIndex_v2, idx, &handle->nvml) < 0)
+                return (-1);
+        if (call_nvml(err, ctx, nvmlDeviceGetName, handle->nvml, buf, sizeof(buf)) < 0)
+                return (-1);
+        if ((attrs->model = xstrdup(err, buf)) == NULL)
+                return (-1);
+        if (call_nvml(err, ctx, nvmlDeviceGetUUID, handle->nvml, buf, sizeof(buf)) < 0)
+                return (-1);
+        if ((attrs->uuid = xstrdup(err, buf)) == NULL)
+                return (-1);
+        if (call_nvml(err, ctx, nvmlDeviceGetPciInfo, handle->nvml, &pci) < 0)
+                return (-1);
+        if (xasprintf(err, &attrs->busid, "%08x:%02x:%02x.0", pci.domain, pci.bus, pci.device) < 0)
+                return (-1);
+        if (call_nvml(err, ctx, nvmlDeviceGetCudaComputeCapability, handle->nvml, &major, &minor) < 0)
+                return (-1);
+        attrs->arch.major = (unsigned int)major;
+        attrs->arch.minor = (unsigned int)minor;
+        if (call_nvml(err, ctx, nvmlDeviceGetBrand, handle->nvml, &brand) < 0)
+                return (-1);
+        if ((attrs->brand = xstrdup(err, device_brand_name(brand))) == NULL)
+                return (-1);
+
+        // Device nodes and MIG are only relevant outside of WSL.
+        if (!native)
+                return (0);
+
+        if (call_nvml(err, ctx, nvmlDeviceGetMinorNumber, handle->nvml, &attrs->minor) < 0)
+                return (-1);
+
+        // An older NVML or a device without MIG support is not an error.
+        if (call_nvml(err, ctx, nvmlDeviceGetMigMode, handle->nvml, &current, &pending) < 0) {
+                if (err->code != NVML_ERROR_FUNCTION_NOT_FOUND && err->code != NVML_ERROR_NOT_SUPPORTED)
+                        return (-1);
+                error_reset(err);
+                return (0);
+        }
+        attrs->mig_capable = true;
+        attrs->mig_enabled = (current == NVML_DEVICE_MIG_ENABLE);
+        if (attrs->mig_enabled)
+                return (get_mig_device_attrs(err, ctx, handle, attrs));
+        return (0);
+}
+
+struct device_result {
+        int rv;
+        struct error err;
+};
+
+struct device_query {
+        struct driver *ctx;
+        bool native;
+        unsigned int count;
+        unsigned int next;
+        driver_device_attrs *attrs;
+        struct device_result *results;
+};
+
+static void *
+device_query_worker(void *arg)
+{
+        struct device_query *query = arg;
+        unsigned int i;
+
+        // Grab the next device not yet claimed by any worker until none are left.
+        while ((i = __atomic_fetch_add(&query->next, 1, __ATOMIC_RELAXED)) < query->count) {
+                query->results[i].rv = get_device_attrs(&query->results[i].err, query->ctx, i,
+                    query->native, &query->attrs[i]);
+        }
+        return (NULL);
+}
+
+static unsigned int
+device_query_threads(unsigned int count)
+{
+        const char *str;
+        char *ptr;
+        uintmax_t n;
+
+        // The concurrency can be capped (e.g. set to 1 to query devices serially).
+        if ((str = secure_getenv("NVC_DEVICE_QUERY_THREADS")) == NULL || *str == '\0')
+                return (MIN(MAX_QUERY_THREADS, count));
+        errno = 0;
+        n = strtoumax(str, &ptr, 10);
+        if (!isdigit((unsigned char)*str) || *ptr != '\0' || n == 0 || errno != 0) {
+                log_warnf("ignoring invalid NVC_DEVICE_QUERY_THREADS value %s", str);
+                n = MAX_QUERY_THREADS;
+        }
+        return ((unsigned int)MIN(n, count));
+}
+
+static int
+query_devices(struct error *err, struct driver *ctx, bool native, driver_device_attrs *attrs, unsigned int count)
+{
+        struct device_query query = {ctx, native, count, 0, attrs, NULL};
+        pthread_t threads[MAX_DEVICES];
+        unsigned int nthreads, nstarted = 0;
+        int rv = -1;
+
+        if ((query.results = xcalloc(err, count, sizeof(*query.results))) == NULL)
+                return (-1);
+
+        // Fan the devices out across a small pool of threads, the calling thread being one of them.
+        // If a thread can't be created, we just carry on with fewer of them.
+        nthreads = device_query_threads(count);
+        for (; nstarted + 1 < nthreads; ++nstarted) {
+                if (pthread_create(&threads[nstarted], NULL, device_query_worker, &query) != 0)
+                        break;
+        }
+        device_query_worker(&query);
+        for (unsigned int i = 0; i < nstarted; ++i)
+                pthread_join(threads[i], NULL);
+
+        // Results land at their device index, report the first failure in that same order.
+        for (unsigned int i = 0; i < count; ++i) {
+                if (query.results[i].rv < 0) {
+                        error_reset(err);
+                        *err = query.results[i].err;
+                        query.results[i].err = (struct error){0};
+                        goto fail;
+                }
+        }
+        rv = 0;
+
+ fail:
+        for (unsigned int i = 0; i < count; ++i)
+                error_reset(&query.results[i].err);
+        free(query.results);
+        return (rv);
+}
+
+/*
+ * device_info_fingerprint captures what the device tree of a shared service depends on: the driver version,
+ * the device count, the MIG mode of each device and the MIG instances exposed through the driver capabilities.
+ */
+static int
+device_info_fingerprint(struct error *err, struct driver *ctx, bool native, char **key)
+{
+        char version[NVML_SYSTEM_DRIVER_VERSION_BUFFER_SIZE];
+        nvmlDevice_t dev;
+        unsigned int count, current, pending;
+        glob_t gl = {0};
+        int rv = -1;
+
+        *key = NULL;
+        if (call_nvml(err, ctx, nvmlSystemGetDriverVersion, version, sizeof(version)) < 0)
+                return (-1);
+        if (call_nvml(err, ctx, nvmlDeviceGetCount_v2, &count) < 0)
+                return (-1);
+        if (xasprintf(err, key, "%s %d %u", version, native, count) < 0)
+                return (-1);
+        for (unsigned int i = 0; i < count; ++i) {
+                current = pending = 0;
+                if (call_nvml(NULL, ctx, nvmlDeviceGetHandleByIndex_v2, i, &dev) == 0)
+                        call_nvml(NULL, ctx, nvmlDeviceGetMigMode, dev, &current, &pending);
+                if (str_join(err, key, (current == NVML_DEVICE_MIG_ENABLE) ? "1" : "0", " ") < 0)
+                        goto fail;
+        }
+        if (xglob(err, NV_PROC_DRIVER_CAPS "/gpu*/mig/gi*/ci*", 0, NULL, &gl) < 0)
+                goto fail;
+        for (size_t i = 0; i < gl.gl_pathc; ++i) {
+                if (str_join(err, key, gl.gl_pathv[i], " ") < 0)
+                        goto fail;
+        }
+        rv = 0;
+
+ fail:
+        globfree(&gl);
+        if (rv < 0) {
+                free(*key);
+                *key = NULL;
+        }
+        return (rv);
+}
+
+static bool
+device_info_cache_load(struct driver *ctx, const char *key, driver_get_device_info_res *res)
+{
+        XDR xdr;
+        bool_t ok;
+
+        if (ctx->cache.key == NULL || !str_equal(ctx->cache.key, key))
+                return (false);
+        xdrmem_create(&xdr, ctx->cache.data, ctx->cache.size, XDR_DECODE);
+        if (!(ok = xdr_driver_get_device_info_res(&xdr, res)))
+                xdr_free((xdrproc_t)xdr_driver_get_device_info_res, (caddr_t)res);
+        xdr_destroy(&xdr);
+        return (ok);
+}
+
+static void
+device_info_cache_store(struct driver *ctx, char *key, driver_get_device_info_res *res)
+{
+        XDR xdr;
+        u_int size;
+        char *data;
+
+        size = (u_int)xdr_sizeof((xdrproc_t)xdr_driver_get_device_info_res, res);
+        if ((data = malloc(size)) == NULL) {
+                free(key);
+                return;
+        }
+        xdrmem_create(&xdr, data, size, XDR_ENCODE);
+        if (!xdr_driver_get_device_info_res(&xdr, res)) {
+                free(data);
+                free(key);
+                data = key = NULL;
+                size = 0;
+        }
+        xdr_destroy(&xdr);
+
+        free(ctx->cache.key);
+        free(ctx->cache.data);
+        ctx->cache.key = key;
+        ctx->cache.data = data;
+        ctx->cache.size = size;
+}
+
+bool_t
+driver_get_device_info_1_svc(maybe_unused ptr_t ctxptr, bool_t native, driver_get_device_info_res *res, maybe_unused struct svc_req *req)
+{
+        // Initialize local variables.
+        struct error *err = (struct error[]){0};
+        struct driver *ctx = driver_service(ctxptr);
+        driver_device_attrs *attrs;
+        unsigned int count;
+        char *key = NULL;
+
+        // Clear out 'res' which will hold the result of this RPC call.
+        memset(res, 0, sizeof(*res));
+
+        // A shared service reuses the last device tree as long as its fingerprint is unchanged.
+        if (ctx->cache.enabled) {
+                if (device_info_fingerprint(err, ctx, native, &key) < 0)
+                        goto fail;
+                if (device_info_cache_load(ctx, key, res)) {
+                        free(key);
+                        return (true);
+                }
+        }
+
+        if (call_nvml(err, ctx, nvmlDeviceGetCount_v2, &count) < 0)
+                goto fail;
+        if (count > MAX_DEVICES) {
+                error_setx(err, "too many devices");
+                goto fail;
+        }
+        if ((attrs = xcalloc(err, count, sizeof(*attrs))) == NULL)
+                goto fail;
+        res->driver_get_device_info_res_u.devices.devices_val = attrs;
+        res->driver_get_device_info_res_u.devices.devices_len = count;
+
+        // Walk the whole device tree here so that it is returned in a single message.
+        if (query_devices(err, ctx, native, attrs, count) < 0)
+                goto fail;
+        if (key != NULL)
+                device_info_cache_store(ctx, key, res);
+        return (true);
+
+ fail:
+        // Release whatever was gathered so far and populate the error instead.
+        free(key);
+        xdr_free((xdrproc_t)xdr_driver_get_device_info_res, (caddr_t)res);
+        memset(res, 0, sizeof(*res));
+        error_to_xdr(err, res);
+        return (true);
+}
@@ -12,25 +12,48 @@
 #include "error.h"
 #include "dxcore.h"
 
+struct driver;
 struct driver_device;
 
-int driver_init(struct error *, struct dxcore_context *, const char *, uid_t, gid_t);
-int driver_shutdown(struct error *);
-int driver_get_rm_version(struct error*, char **);
-int driver_get_cuda_version(struct error*, char **);
-int driver_get_device_count(struct error*, unsigned int *);
-int driver_get_device(struct error*, unsigned int, struct driver_device **);
-int driver_get_device_minor(struct error*, struct driver_device *, unsigned int *);
-int driver_get_device_busid(struct error*, struct driver_device *, char **);
-int driver_get_device_uuid(struct error*, struct driver_device *, char **);
-int driver_get_device_arch(struct error*, struct driver_device *, char **);
-int driver_get_device_model(struct error*, struct driver_device *, char **);
-int driver_get_device_brand(struct error*, struct driver_device *, char **);
-int driver_get_device_mig_capable(struct error*, struct driver_device *, bool *);
-int driver_get_device_mig_enabled(struct error*, struct driver_device *, bool *);
-int driver_get_device_max_mig_device_count(struct error*, struct driver_device *, unsigned int *);
-int driver_get_device_mig_device(struct error*, struct driver_device *, unsigned int, struct driver_device **);
-int driver_get_device_gpu_instance_id(struct error*, struct driver_device *, unsigned int *);
-int driver_get_device_compute_instance_id(struct error*, struct driver_device *, unsigned int *);
+struct driver_mig_device_info {
+        char *uuid;
+        unsigned int gi;
+        unsigned int ci;
+};
+
+struct driver_device_info {
+        char *model;
+        char *uuid;
+        char *busid;
+        char *arch;
+        char *brand;
+        unsigned int minor;
+        bool mig_capable;
+        bool mig_enabled;
+        struct driver_mig_device_info *mig_devices;
+        size_t nmig_devices;
+};
+
+int driver_init(struct error *, struct driver **, struct dxcore_context *, const char *, uid_t, gid_t, bool);
+int driver_shutdown(struct error *, struct driver **);
+int driver_serve(struct error *, const char *, uid_t, gid_t, const char *);
+int driver_get_rm_version(struct error*, struct driver *, char **);
+int driver_get_cuda_version(struct error*, struct driver *, char **);
+int driver_get_device_count(struct error*, struct driver *, unsigned int *);
+int driver_get_device(struct error*, struct driver *, unsigned int, struct driver_device **);
+int driver_get_device_minor(struct error*, struct driver *, struct driver_device *, unsigned int *);
+int driver_get_device_busid(struct error*, struct driver *, struct driver_device *, char **);
+int driver_get_device_uuid(struct error*, struct driver *, struct driver_device *, char **);
+int driver_get_device_arch(struct error*, struct driver *, struct driver_device *, char **);
+int driver_get_device_model(struct error*, struct driver *, struct driver_device *, char **);
+int driver_get_device_brand(struct error*, struct driver *, struct driver_device *, char **);
+int driver_get_device_mig_capable(struct error*, struct driver *, struct driver_device *, bool *);
+int driver_get_device_mig_enabled(struct error*, struct driver *, struct driver_device *, bool *);
+int driver_get_device_max_mig_device_count(struct error*, struct driver *, struct driver_device *, unsigned int *);
+int driver_get_device_mig_device(struct error*, struct driver *, struct driver_device *, unsigned int, struct driver_device **);
+int driver_get_device_gpu_instance_id(struct error*, struct driver *, struct driver_device *, unsigned int *);
+int driver_get_device_compute_instance_id(struct error*, struct driver *, struct driver_device *, unsigned int *);
+int driver_get_device_info(struct error*, struct driver *, bool, struct driver_device_info **, size_t *);
+void driver_device_info_free(struct driver_device_info *, size_t);
 
 #endif /* HEADER_DRIVER_H */
@@ -1,167 +1,455 @@
 /*
  * Copyright (c) 2017-2018, NVIDIA CORPORATION. All rights reserved.
- *
- * This file is part of libnvidia-container.
- * If this file is being compiled and dynamically linked against libelf from the
- * elfutils package (usually characterized by the definition of the macro `WITH_LIBELF'),
- * the following license notice covers the use of said library along with the terms from
- * the COPYING and COPYING.LESSER files:
- *
- *  elfutils is free software: you can redistribute it and/or modify
- *  it under the terms of the GNU Lesser General Public License as published by
- *  the Free Software Foundation, either version 3 of the License, or
- *  (at your option) any later version.
- *
- *  elfutils is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- *  GNU Lesser General Public License for more details.
- *
- *  You should have received copies of the GNU General Public License and
- *  the GNU Lesser General Public License along with this program.  If
- *  not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <elf.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-#include <gelf.h>
-
 #include "elftool.h"
 #include "error.h"
 #include "utils.h"
 #include "xfuncs.h"
 
-/* Extracted from <elf.h> since elftoolchain headers conflict. */
-#ifndef WITH_LIBELF
-# define ELF_NOTE_GNU      "GNU"
-# define ELF_NOTE_ABI      1
-# define ELF_NOTE_OS_LINUX 0
-#endif /* WITH_LIBELF */
+/*
+ * Only the program headers are parsed: DT_NEEDED and DT_SONAME entries are read from PT_DYNAMIC and the ABI tag from PT_NOTE.
+ * This avoids building the section descriptors of the (large) driver libraries.
+ * The results are memoized per inode for the lifetime of the process since the same files are inspected for every
+ * duplicate ldcache entry and every container.
+ */
+
+#define MAX_CACHED_ENTRIES 256
+
+struct elftool_entry {
+        dev_t dev;
+        ino_t ino;
+        off_t size;
+        struct timespec mtime;
+        bool is64;
+        uint16_t machine;
+        uint32_t flags;
+        bool has_dynamic;
+        bool has_abi;
+        uint32_t abi[4];
+        char *needed;
+        size_t needed_size;
+        char *soname;
+        struct elftool_entry *next;
+};
+
+struct elf_image {
+        const unsigned char *data;
+        size_t size;
+        bool is64;
+        uint16_t machine;
+        uint32_t flags;
+        uint64_t phoff;
+        uint16_t phentsize;
+        uint16_t phnum;
+};
+
+struct segment {
+        uint32_t type;
+        uint64_t offset;
+        uint64_t vaddr;
+        uint64_t filesz;
+        uint64_t align;
+};
 
-static int lookup_section(struct elftool *, GElf_Shdr *, Elf_Scn **, Elf64_Word, const char *);
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct elftool_entry *cache_head;
+static size_t cache_size;
+
+static bool in_bounds(const struct elf_image *, uint64_t, uint64_t);
+static int  read_header(struct elf_image *, const void *, size_t);
+static bool read_segment(const struct elf_image *, uint16_t, struct segment *);
+static bool read_dyn(const struct elf_image *, uint64_t, int64_t *, uint64_t *);
+static bool vaddr_to_offset(const struct elf_image *, uint64_t, uint64_t *);
+static int  parse_dynamic(struct elftool *, const struct elf_image *, const struct segment *, struct elftool_entry *);
+static void parse_notes(const struct elf_image *, const struct segment *, struct elftool_entry *);
+static int  parse_image(struct elftool *, const struct elf_image *, struct elftool_entry *);
+static struct elftool_entry *cache_lookup(const struct stat *);
+static bool cache_insert(struct elftool_entry *);
 
 void
 elftool_init(struct elftool *ctx, struct error *err)
 {
-        *ctx = (struct elftool){err, -1, NULL, NULL};
-        elf_version(EV_CURRENT);
+        *ctx = (struct elftool){err, NULL, false, NULL};
 }
 
-int
-elftool_open(struct elftool *ctx, const char *path)
+static bool
+in_bounds(const struct elf_image *img, uint64_t off, uint64_t len)
+{
+        return (off <= img->size && len <= img->size - off);
+}
+
+static int
+read_header(struct elf_image *img, const void *data, size_t size)
 {
-        if ((ctx->fd = xopen(ctx->err, path, O_RDONLY)) < 0)
+        const unsigned char *ident = data;
+
+        *img = (struct elf_image){data, size, false, 0, 0, 0, 0, 0};
+        if (size < EI_NIDENT || memcmp(ident, ELFMAG, SELFMAG))
                 return (-1);
-        if ((ctx->elf = elf_begin(ctx->fd, ELF_C_READ, NULL)) == NULL) {
-                error_setx(ctx->err, "elf file read error: %s", path);
-                xclose(ctx->fd);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        if (ident[EI_DATA] != ELFDATA2LSB)
+                return (-1);
+#else
+        if (ident[EI_DATA] != ELFDATA2MSB)
+                return (-1);
+#endif
+        if (ident[EI_CLASS] == ELFCLASS64) {
+                Elf64_Ehdr ehdr;
+
+                if (size < sizeof(ehdr))
+                        return (-1);
+                memcpy(&ehdr, data, sizeof(ehdr));
+                img->is64 = true;
+                img->machine = ehdr.e_machine;
+                img->flags = ehdr.e_flags;
+                img->phoff = ehdr.e_phoff;
+                img->phentsize = ehdr.e_phentsize;
+                img->phnum = ehdr.e_phnum;
+                if (img->phentsize < sizeof(Elf64_Phdr))
+                        return (-1);
+        } else if (ident[EI_CLASS] == ELFCLASS32) {
+                Elf32_Ehdr ehdr;
+
+                if (size < sizeof(ehdr))
+                        return (-1);
+                memcpy(&ehdr, data, sizeof(ehdr));
+                img->machine = ehdr.e_machine;
+                img->flags = ehdr.e_flags;
+                img->phoff = ehdr.e_phoff;
+                img->phentsize = ehdr.e_phentsize;
+                img->phnum = ehdr.e_phnum;
+                if (img->phentsize < sizeof(Elf32_Phdr))
+                        return (-1);
+        } else {
                 return (-1);
         }
-        ctx->path = path;
+        if (!in_bounds(img, img->phoff, (uint64_t)img->phentsize * img->phnum))
+                return (-1);
         return (0);
 }
 
-void
-elftool_close(struct elftool *ctx)
+static bool
+read_segment(const struct elf_image *img, uint16_t i, struct segment *seg)
 {
-        elf_end(ctx->elf);
-        xclose(ctx->fd);
+        const unsigned char *ptr = img->data + img->phoff + (uint64_t)i * img->phentsize;
 
-        ctx->elf = NULL;
-        ctx->fd = -1;
-        ctx->path = NULL;
+        if (img->is64) {
+                Elf64_Phdr phdr;
+
+                memcpy(&phdr, ptr, sizeof(phdr));
+                *seg = (struct segment){phdr.p_type, phdr.p_offset, phdr.p_vaddr, phdr.p_filesz, phdr.p_align};
+        } else {
+                Elf32_Phdr phdr;
+
+                memcpy(&phdr, ptr, sizeof(phdr));
+                *seg = (struct segment){phdr.p_type, phdr.p_offset, phdr.p_vaddr, phdr.p_filesz, phdr.p_align};
+        }
+        return (in_bounds(img, seg->offset, seg->filesz));
+}
+
+static bool
+read_dyn(const struct elf_image *img, uint64_t off, int64_t *tag, uint64_t *val)
+{
+        if (img->is64) {
+                Elf64_Dyn dyn;
+
+                if (!in_bounds(img, off, sizeof(dyn)))
+                        return (false);
+                memcpy(&dyn, img->data + off, sizeof(dyn));
+                *tag = dyn.d_tag;
+                *val = dyn.d_un.d_val;
+        } else {
+                Elf32_Dyn dyn;
+
+                if (!in_bounds(img, off, sizeof(dyn)))
+                        return (false);
+                memcpy(&dyn, img->data + off, sizeof(dyn));
+                *tag = dyn.d_tag;
+                *val = dyn.d_un.d_val;
+        }
+        return (true);
+}
+
+static bool
+vaddr_to_offset(const struct elf_image *img, uint64_t vaddr, uint64_t *off)
+{
+        struct segment seg;
+
+        for (uint16_t i = 0; i < img->phnum; ++i) {
+                if (!read_segment(img, i, &seg) || seg.type != PT_LOAD)
+                        continue;
+                if (vaddr >= seg.vaddr && vaddr - seg.vaddr < seg.filesz) {
+                        *off = vaddr - seg.vaddr + seg.offset;
+                        return (true);
+                }
+        }
+        return (false);
 }
 
 static int
-lookup_section(struct elftool *ctx, GElf_Shdr *shdr, Elf_Scn **scn, Elf64_Word type, const char *name)
+parse_dynamic(struct elftool *ctx, const struct elf_image *img, const struct segment *seg, struct elftool_entry *entry)
 {
-        size_t shstrndx;
-        char *shname;
+        size_t dynsz = img->is64 ? sizeof(Elf64_Dyn) : sizeof(Elf32_Dyn);
+        uint64_t strtab = 0, strsz = 0, stroff;
+        uint64_t soname = UINT64_MAX;
+        int64_t tag;
+        uint64_t val;
+        const char *str;
+        size_t len, size = 0;
+        char *ptr;
 
-        if (elf_getshdrstrndx(ctx->elf, &shstrndx) < 0)
+        /* First pass to locate the string table and compute the size of the dependency list. */
+        for (uint64_t off = 0; off + dynsz <= seg->filesz; off += dynsz) {
+                if (!read_dyn(img, seg->offset + off, &tag, &val) || tag == DT_NULL)
+                        break;
+                if (tag == DT_STRTAB)
+                        strtab = val;
+                else if (tag == DT_STRSZ)
+                        strsz = val;
+                else if (tag == DT_SONAME)
+                        soname = val;
+        }
+        if (strtab == 0 || !vaddr_to_offset(img, strtab, &stroff) || !in_bounds(img, stroff, strsz))
                 goto fail;
 
-        *scn = NULL;
-        while ((*scn = elf_nextscn(ctx->elf, *scn)) != NULL) {
-                   if (gelf_getshdr(*scn, shdr) == NULL)
-                           goto fail;
-                   if ((shname = elf_strptr(ctx->elf, shstrndx, shdr->sh_name)) == NULL)
-                           goto fail;
-                   if (shdr->sh_type == type && name == NULL)
-                           return (0);
-                   else if (shdr->sh_type == type && str_equal(shname, name))
-                           return (0);
-        }
-        error_setx(ctx->err, "elf section 0x%x missing: %s", type, ctx->path);
-        return (-1);
+        if (soname != UINT64_MAX) {
+                if (soname >= strsz)
+                        goto fail;
+                str = (const char *)img->data + stroff + soname;
+                if ((len = strnlen(str, (size_t)(strsz - soname))) == strsz - soname)
+                        goto fail;
+                if ((entry->soname = xcalloc(ctx->err, len + 1, sizeof(*entry->soname))) == NULL)
+                        return (-1);
+                memcpy(entry->soname, str, len);
+        }
+
+        for (int pass = 0; pass < 2; ++pass) {
+                if (pass == 1 && size > 0) {
+                        if ((entry->needed = xcalloc(ctx->err, size, sizeof(*entry->needed))) == NULL)
+                                return (-1);
+                        entry->needed_size = size;
+                }
+                ptr = entry->needed;
+                for (uint64_t off = 0; off + dynsz <= seg->filesz; off += dynsz) {
+                        if (!read_dyn(img, seg->offset + off, &tag, &val) || tag == DT_NULL)
+                                break;
+                        if (tag != DT_NEEDED)
+                                continue;
+                        if (val >= strsz)
+                                goto fail;
+                        str = (const char *)img->data + stroff + val;
+                        if ((len = strnlen(str, (size_t)(strsz - val))) == strsz - val)
+                                goto fail;
+                        if (pass == 0) {
+                                size += len + 1;
+                        } else if (ptr != NULL) {
+                                memcpy(ptr, str, len + 1);
+                                ptr += len + 1;
+                        }
+                }
+        }
+        entry->has_dynamic = true;
+        return (0);
 
  fail:
-        error_set_elf(ctx->err, "elf section read error: %s", ctx->path);
+        error_setx(ctx->err, "elf data read error: %s", ctx->path);
         return (-1);
 }
 
+static void
+parse_notes(const struct elf_image *img, const struct segment *seg, struct elftool_entry *entry)
+{
+        uint64_t align = (seg->align == 8) ? 8 : 4;
+        uint64_t off = seg->offset;
+        uint64_t end = seg->offset + seg->filesz;
+        uint64_t name, desc;
+        Elf32_Nhdr nhdr;
+
+        while (!entry->has_abi && off + sizeof(nhdr) <= end) {
+                memcpy(&nhdr, img->data + off, sizeof(nhdr));
+                name = off + sizeof(nhdr);
+                desc = name + ((nhdr.n_namesz + align - 1) & ~(align - 1));
+                if (desc > end || nhdr.n_descsz > end - desc)
+                        break;
+                if (nhdr.n_type == ELF_NOTE_ABI && nhdr.n_namesz == sizeof(ELF_NOTE_GNU) &&
+                    nhdr.n_descsz >= sizeof(entry->abi) && !memcmp(img->data + name, ELF_NOTE_GNU, nhdr.n_namesz)) {
+                        memcpy(entry->abi, img->data + desc, sizeof(entry->abi));
+                        entry->has_abi = true;
+                }
+                off = desc + ((nhdr.n_descsz + align - 1) & ~(align - 1));
+        }
+}
+
+static int
+parse_image(struct elftool *ctx, const struct elf_image *img, struct elftool_entry *entry)
+{
+        struct segment seg;
+
+        for (uint16_t i = 0; i < img->phnum; ++i) {
+                if (!read_segment(img, i, &seg)) {
+                        error_setx(ctx->err, "elf file read error: %s", ctx->path);
+                        return (-1);
+                }
+                if (seg.type == PT_DYNAMIC && !entry->has_dynamic) {
+                        if (parse_dynamic(ctx, img, &seg, entry) < 0)
+                                return (-1);
+                } else if (seg.type == PT_NOTE) {
+                        parse_notes(img, &seg, entry);
+                }
+        }
+        return (0);
+}
+
+static struct elftool_entry *
+cache_lookup(const struct stat *s)
+{
+        struct elftool_entry *entry;
+
+        for (entry = cache_head; entry != NULL; entry = entry->next) {
+                if (entry->dev == s->st_dev && entry->ino == s->st_ino && entry->size == s->st_size &&
+                    entry->mtime.tv_sec == s->st_mtim.tv_sec && entry->mtime.tv_nsec == s->st_mtim.tv_nsec)
+                        return (entry);
+        }
+        return (NULL);
+}
+
+static bool
+cache_insert(struct elftool_entry *entry)
+{
+        if (cache_size >= MAX_CACHED_ENTRIES)
+                return (false);
+        entry->next = cache_head;
+        cache_head = entry;
+        ++cache_size;
+        return (true);
+}
+
 int
-elftool_has_dependency(struct elftool *ctx, const char *lib)
+elftool_open(struct elftool *ctx, const char *path)
 {
-        GElf_Shdr shdr;
-        Elf_Scn *scn;
-        Elf_Data *data;
-        GElf_Dyn dyn;
-        char *dep;
+        struct elftool_entry *entry = NULL;
+        struct elf_image img;
+        struct stat s;
+        void *addr = MAP_FAILED;
+        int fd;
+        int rv = -1;
 
-        if (lookup_section(ctx, &shdr, &scn, SHT_DYNAMIC, NULL) < 0)
+        ctx->path = path;
+        if ((fd = xopen(ctx->err, path, O_RDONLY|O_CLOEXEC)) < 0)
                 return (-1);
-        if ((data = elf_getdata(scn, NULL)) == NULL)
+        if (fstat(fd, &s) < 0) {
+                error_set(ctx->err, "stat failed: %s", path);
                 goto fail;
+        }
 
-        for (size_t i = 0; i < data->d_size / shdr.sh_entsize; ++i) {
-                if (gelf_getdyn(data, (int)i, &dyn) == NULL)
-                        goto fail;
-                if (dyn.d_tag == DT_NEEDED) {
-                        if ((dep = elf_strptr(ctx->elf, shdr.sh_link, dyn.d_un.d_ptr)) == NULL)
-                                goto fail;
-                        if (str_has_prefix(dep, lib))
-                                return (true);
-                }
+        assert_func(pthread_mutex_lock(&cache_mutex));
+        ctx->entry = cache_lookup(&s);
+        assert_func(pthread_mutex_unlock(&cache_mutex));
+        if (ctx->entry != NULL) {
+                rv = 0;
+                goto fail;
         }
-        return (false);
+
+        if (!S_ISREG(s.st_mode) || s.st_size <= 0) {
+                error_setx(ctx->err, "elf file read error: %s", path);
+                goto fail;
+        }
+        if ((addr = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+                error_set(ctx->err, "file mapping failed: %s", path);
+                goto fail;
+        }
+        if (read_header(&img, addr, (size_t)s.st_size) < 0) {
+                error_setx(ctx->err, "elf file read error: %s", path);
+                goto fail;
+        }
+        if ((entry = xcalloc(ctx->err, 1, sizeof(*entry))) == NULL)
+                goto fail;
+        *entry = (struct elftool_entry){.dev = s.st_dev, .ino = s.st_ino, .size = s.st_size, .mtime = s.st_mtim,
+            .is64 = img.is64, .machine = img.machine, .flags = img.flags};
+        if (parse_image(ctx, &img, entry) < 0)
+                goto fail;
+
+        assert_func(pthread_mutex_lock(&cache_mutex));
+        ctx->entry = entry;
+        ctx->owned = cache_lookup(&s) != NULL || !cache_insert(entry);
+        assert_func(pthread_mutex_unlock(&cache_mutex));
+        entry = NULL;
+        rv = 0;
 
  fail:
-        error_set_elf(ctx->err, "elf data read error: %s", ctx->path);
-        return (-1);
+        if (entry != NULL) {
+                free(entry->needed);
+                free(entry->soname);
+                free(entry);
+        }
+        if (addr != MAP_FAILED)
+                munmap(addr, (size_t)s.st_size);
+        xclose(fd);
+        if (rv < 0)
+                ctx->path = NULL;
+        return (rv);
+}
+
+void
+elftool_close(struct elftool *ctx)
+{
+        if (ctx->owned && ctx->entry != NULL) {
+                free(ctx->entry->needed);
+                free(ctx->entry->soname);
+                free(ctx->entry);
+        }
+        ctx->entry = NULL;
+        ctx->owned = false;
+        ctx->path = NULL;
 }
 
 int
-elftool_has_abi(struct elftool *ctx, uint32_t abi[3])
+elftool_has_dependency(struct elftool *ctx, const char *lib)
 {
-        GElf_Shdr shdr;
-        Elf_Scn *scn;
-        Elf_Data *data;
-        Elf64_Nhdr nhdr;
-        char *ptr;
-        uint32_t desc[4];
+        const char *dep;
 
-        if (lookup_section(ctx, &shdr, &scn, SHT_NOTE, ".note.ABI-tag") < 0)
-                return (-1);
-        if ((data = elf_getdata(scn, NULL)) == NULL) {
-                error_set_elf(ctx->err, "elf data read error: %s", ctx->path);
+        if (!ctx->entry->has_dynamic) {
+                error_setx(ctx->err, "elf section 0x%x missing: %s", SHT_DYNAMIC, ctx->path);
                 return (-1);
         }
+        for (dep = ctx->entry->needed; dep != NULL && dep < ctx->entry->needed + ctx->entry->needed_size; dep += strlen(dep) + 1) {
+                if (str_has_prefix(dep, lib))
+                        return (true);
+        }
+        return (false);
+}
 
-        if (data->d_size <= sizeof(nhdr))
-                return (0);
-        memcpy(&nhdr, data->d_buf, sizeof(nhdr));
-        ptr = (char *)data->d_buf + sizeof(nhdr);
+int
+elftool_has_abi(struct elftool *ctx, uint32_t abi[3])
+{
+        if (!ctx->entry->has_abi) {
+                error_setx(ctx->err, "elf section 0x%x missing: %s", SHT_NOTE, ctx->path);
+                return (-1);
+        }
+        return (ctx->entry->abi[0] == ELF_NOTE_OS_LINUX && !memcmp(&ctx->entry->abi[1], abi, 3 * sizeof(uint32_t)));
+}
 
-        if (data->d_size < sizeof(nhdr) + nhdr.n_namesz + nhdr.n_descsz)
-                return (0);
-        if (nhdr.n_type != ELF_NOTE_ABI || nhdr.n_namesz != sizeof(ELF_NOTE_GNU) || nhdr.n_descsz < sizeof(desc))
-                return (0);
-        if (memcmp(ptr, ELF_NOTE_GNU, nhdr.n_namesz))
-                return (0);
-        memcpy(&desc, ptr + nhdr.n_namesz, sizeof(desc));
+const char *
+elftool_soname(struct elftool *ctx)
+{
+        return (ctx->entry->soname);
+}
 
-        return (desc[0] == ELF_NOTE_OS_LINUX && !memcmp(&desc[1], abi, 3 * sizeof(uint32_t)));
+void
+elftool_machine(struct elftool *ctx, uint16_t *machine, bool *is64, uint32_t *flags)
+{
+        *machine = ctx->entry->machine;
+        *is64 = ctx->entry->is64;
+        *flags = ctx->entry->flags;
 }
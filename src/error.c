@@ -7,39 +7,24 @@
 #include <dlfcn.h>
 #include <errno.h>
 
-#include <libelf.h>
-
 #include "nvml.h"
 
 #include "error.h"
 
-int
-error_set_elf(struct error *err, const char *fmt, ...)
-{
-        int errcode;
-        va_list ap;
-        int rv;
-
-        errcode = elf_errno();
-        va_start(ap, fmt);
-        rv = error_vset(err, errcode, elf_errmsg(errcode), fmt, ap);
-        va_end(ap);
-        return (rv);
-}
-
 int
 error_set_nvml(struct error *err, void *handle, int errcode, const char *fmt, ...)
 {
-        static union {void *ptr; char *(*fn)(nvmlReturn_t);} errfn;
+        union {void *ptr; char *(*fn)(nvmlReturn_t);} errfn;
         const char *errmsg = "unknown error";
         va_list ap;
         int rv;
 
-        if (errfn.ptr == NULL) {
-                dlerror();
-                errfn.ptr = dlsym(handle, "nvmlErrorString");
-        }
-        if (errfn.ptr != NULL || dlerror() == NULL)
+        /*
+         * Not cached, errors can be raised concurrently by the device query threads, and the handle
+         * belongs to the context in error (contexts of the same process may load different libraries).
+         */
+        dlerror();
+        if ((errfn.ptr = dlsym(handle, "nvmlErrorString")) != NULL && dlerror() == NULL)
                 errmsg = (*errfn.fn)((nvmlReturn_t)errcode);
 
         va_start(ap, fmt);
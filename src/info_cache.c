@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "info_cache.h"
+#include "options.h"
+#include "utils.h"
+#include "xfuncs.h"
+
+#define CACHE_MAGIC       "nvc-driver-info 2"
+#define CACHE_MAX_SIZE    (1 << 20)
+#define CACHE_MAX_ENTRIES 4096
+
+/*
+ * The cache file is a plain text file made of a key header followed by one counted section per path list:
+ *
+ *   nvc-driver-info 2
+ *   ldcache <dev> <ino> <size> <mtime>.<nsec>
+ *   ...
+ *   dir /usr/bin <mtime>.<nsec>
+ *   ...
+ *   libs <count>
+ *   /usr/lib/x86_64-linux-gnu/libcuda.so.XXX.YY
+ *   ...
+ *
+ * The header captures everything the path lookup depends on (the ldcache file identity, the driver version, the root,
+ * the driver options, the PATH used for binaries and the modification time of every directory searched outside of the
+ * ldcache), so a mismatch on any byte of it invalidates the cache. In particular a binary or a firmware file added after
+ * the cache was written updates the mtime of its directory and forces a new lookup.
+ * Each set of driver components looked up gets its own cache file, named after the container options selecting it.
+ */
+
+static int dir_stamp(struct error *, char **, const char *, const char *);
+static int cache_key(struct error *, char **, const struct nvc_driver_info *, const char *, const char *, int32_t);
+static int cache_path(struct error *, char *, int32_t);
+static int cache_read(struct error *, const char *, char **);
+static int parse_section(struct error *, char **, const char *, char ***, size_t *);
+static int paths_exist(struct error *, const char *, char * const [], size_t);
+static int write_section(FILE *, const char *, char * const [], size_t);
+
+/*
+ * dir_stamp appends the modification time of the directory dir (within root) to the cache key.
+ * A directory that can't be found is recorded as such, so that creating it later invalidates the cache.
+ */
+static int
+dir_stamp(struct error *err, char **key, const char *root, const char *dir)
+{
+        char path[PATH_MAX];
+        struct stat s;
+        char *tmp;
+        int rv;
+
+        if (path_resolve_full(NULL, path, root, dir) < 0 || stat(path, &s) < 0 || !S_ISDIR(s.st_mode))
+                rv = xasprintf(err, &tmp, "%sdir %s -\n", *key, dir);
+        else
+                rv = xasprintf(err, &tmp, "%sdir %s %jd.%09ld\n", *key, dir, (intmax_t)s.st_mtim.tv_sec, s.st_mtim.tv_nsec);
+        if (rv < 0)
+                return (-1);
+        free(*key);
+        *key = tmp;
+        return (0);
+}
+
+static int
+cache_key(struct error *err, char **key, const struct nvc_driver_info *info, const char *root, const char *ldcache, int32_t flags)
+{
+        char path[PATH_MAX];
+        struct stat s;
+        const char *env;
+        char *dirs = NULL, *ptr;
+        const char *dir;
+        char *firmware = NULL;
+        int rv = -1;
+
+        *key = NULL;
+        if ((env = secure_getenv("PATH")) == NULL)
+                env = "";
+        if (strchr(root, '\n') != NULL || strchr(ldcache, '\n') != NULL || strchr(env, '\n') != NULL) {
+                error_setx(err, "unsupported character in cache key");
+                return (-1);
+        }
+        if (path_resolve_full(err, path, root, ldcache) < 0)
+                return (-1);
+        if (xstat(err, path, &s) < 0)
+                return (-1);
+
+        if (xasprintf(err, key,
+            CACHE_MAGIC "\n"
+            "ldcache %ju %ju %jd %jd.%09ld\n"
+            "version %s\n"
+            "flags %"PRIx32"\n"
+            "root %s\n"
+            "ldcache-path %s\n"
+            "path %s\n",
+            (uintmax_t)s.st_dev, (uintmax_t)s.st_ino, (intmax_t)s.st_size,
+            (intmax_t)s.st_mtim.tv_sec, s.st_mtim.tv_nsec,
+            info->nvrm_version, (uint32_t)(flags & ~OPT_NO_CACHE), root, ldcache, env) < 0)
+                return (-1);
+
+        // Binaries are searched in every directory of the PATH (see find_binary_paths), firmwares in a single one.
+        if ((dirs = ptr = xstrdup(err, env)) == NULL)
+                goto fail;
+        while ((dir = strsep(&ptr, ":")) != NULL) {
+                if (dir_stamp(err, key, root, (*dir == '\0') ? "." : dir) < 0)
+                        goto fail;
+        }
+        if (xasprintf(err, &firmware, NV_FIRMWARE_PATH, info->nvrm_version) < 0)
+                goto fail;
+        if (dir_stamp(err, key, root, firmware) < 0)
+                goto fail;
+        rv = 0;
+
+ fail:
+        if (rv < 0) {
+                free(*key);
+                *key = NULL;
+        }
+        free(firmware);
+        free(dirs);
+        return (rv);
+}
+
+static int
+cache_path(struct error *err, char *path, int32_t components)
+{
+        return (xsnprintf(err, path, PATH_MAX, NVC_CACHE_FILE, (uint32_t)components));
+}
+
+int
+info_cache_dir(struct error *err)
+{
+        struct stat s;
+
+        if (mkdir(NVC_CACHE_DIR, 0700) < 0 && errno != EEXIST) {
+                error_set(err, "mkdir failed: %s", NVC_CACHE_DIR);
+                return (-1);
+        }
+        if (xlstat(err, NVC_CACHE_DIR, &s) < 0)
+                return (-1);
+        if (!S_ISDIR(s.st_mode) || s.st_uid != geteuid() || (s.st_mode & (S_IWGRP|S_IWOTH))) {
+                error_setx(err, "insecure cache directory: %s", NVC_CACHE_DIR);
+                return (-1);
+        }
+        return (0);
+}
+
+static int
+cache_read(struct error *err, const char *path, char **txt)
+{
+        struct stat s;
+        ssize_t n;
+        size_t len = 0;
+        int fd;
+        int rv = INFO_CACHE_ERROR;
+
+        *txt = NULL;
+        if ((fd = open(path, O_RDONLY|O_NOFOLLOW|O_CLOEXEC)) < 0) {
+                if (errno == ENOENT)
+                        return (INFO_CACHE_MISS);
+                error_set(err, "open failed: %s", path);
+                return (INFO_CACHE_ERROR);
+        }
+        if (fstat(fd, &s) < 0) {
+                error_set(err, "stat failed: %s", path);
+                goto fail;
+        }
+        if (!S_ISREG(s.st_mode) || s.st_uid != geteuid() || (s.st_mode & (S_IWGRP|S_IWOTH))) {
+                error_setx(err, "insecure cache file: %s", path);
+                goto fail;
+        }
+        if (s.st_size <= 0 || s.st_size > CACHE_MAX_SIZE) {
+                rv = INFO_CACHE_MISS;
+                goto fail;
+        }
+        if ((*txt = xcalloc(err, (size_t)s.st_size + 1, sizeof(**txt))) == NULL)
+                goto fail;
+        while (len < (size_t)s.st_size) {
+                if ((n = read(fd, *txt + len, (size_t)s.st_size - len)) < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        error_set(err, "read failed: %s", path);
+                        goto fail;
+                }
+                if (n == 0)
+                        break;
+                len += (size_t)n;
+        }
+        (*txt)[len] = '\0';
+        rv = INFO_CACHE_HIT;
+
+ fail:
+        if (rv != INFO_CACHE_HIT) {
+                free(*txt);
+                *txt = NULL;
+        }
+        close(fd);
+        return (rv);
+}
+
+static int
+parse_section(struct error *err, char **ptr, const char *name, char ***arr, size_t *size)
+{
+        char *line, *end;
+        unsigned long long n;
+
+        *arr = NULL;
+        *size = 0;
+
+        if ((line = strsep(ptr, "\n")) == NULL || !str_has_prefix(line, name))
+                return (INFO_CACHE_MISS);
+        line += strlen(name);
+        if (*line++ != ' ')
+                return (INFO_CACHE_MISS);
+        errno = 0;
+        n = strtoull(line, &end, 10);
+        if (errno != 0 || end == line || *end != '\0' || n > CACHE_MAX_ENTRIES)
+                return (INFO_CACHE_MISS);
+        if (n == 0)
+                return (INFO_CACHE_HIT);
+
+        if ((*arr = array_new(err, (size_t)n)) == NULL)
+                return (INFO_CACHE_ERROR);
+        *size = (size_t)n;
+        for (size_t i = 0; i < *size; ++i) {
+                if ((line = strsep(ptr, "\n")) == NULL || *line != '/')
+                        return (INFO_CACHE_MISS);
+                if (((*arr)[i] = xstrdup(err, line)) == NULL)
+                        return (INFO_CACHE_ERROR);
+        }
+        return (INFO_CACHE_HIT);
+}
+
+static int
+paths_exist(struct error *err, const char *root, char * const paths[], size_t size)
+{
+        int fd;
+        int rv = INFO_CACHE_HIT;
+
+        if (size == 0)
+                return (INFO_CACHE_HIT);
+        if ((fd = xopen(err, root, O_PATH|O_DIRECTORY)) < 0)
+                return (INFO_CACHE_ERROR);
+        for (size_t i = 0; i < size; ++i) {
+                if (faccessat(fd, paths[i] + 1, F_OK, AT_SYMLINK_NOFOLLOW) < 0) {
+                        log_infof("cached path %s is stale", paths[i]);
+                        rv = INFO_CACHE_MISS;
+                        break;
+                }
+        }
+        close(fd);
+        return (rv);
+}
+
+int
+info_cache_load(struct error *err, struct nvc_driver_info *info, const char *root, const char *ldcache, int32_t flags, int32_t components)
+{
+        char path[PATH_MAX];
+        char *key = NULL;
+        char *txt = NULL;
+        char *ptr;
+        int rv = INFO_CACHE_ERROR;
+
+        if (cache_key(err, &key, info, root, ldcache, flags) < 0)
+                goto fail;
+        if (cache_path(err, path, components) < 0)
+                goto fail;
+        if ((rv = cache_read(err, path, &txt)) != INFO_CACHE_HIT)
+                goto fail;
+        if (!str_has_prefix(txt, key)) {
+                log_info("driver cache key mismatch");
+                rv = INFO_CACHE_MISS;
+                goto fail;
+        }
+
+        ptr = txt + strlen(key);
+        if ((rv = parse_section(err, &ptr, "bins", &info->bins, &info->nbins)) != INFO_CACHE_HIT)
+                goto fail;
+        if ((rv = parse_section(err, &ptr, "libs", &info->libs, &info->nlibs)) != INFO_CACHE_HIT)
+                goto fail;
+        if ((rv = parse_section(err, &ptr, "libs32", &info->libs32, &info->nlibs32)) != INFO_CACHE_HIT)
+                goto fail;
+        if ((rv = parse_section(err, &ptr, "firmwares", &info->firmwares, &info->nfirmwares)) != INFO_CACHE_HIT)
+                goto fail;
+
+        if ((rv = paths_exist(err, root, info->bins, info->nbins)) != INFO_CACHE_HIT)
+                goto fail;
+        if ((rv = paths_exist(err, root, info->libs, info->nlibs)) != INFO_CACHE_HIT)
+                goto fail;
+        if ((rv = paths_exist(err, root, info->libs32, info->nlibs32)) != INFO_CACHE_HIT)
+                goto fail;
+        if ((rv = paths_exist(err, root, info->firmwares, info->nfirmwares)) != INFO_CACHE_HIT)
+                goto fail;
+
+        log_infof("using cached driver paths from %s", path);
+
+ fail:
+        if (rv != INFO_CACHE_HIT) {
+                array_free(info->bins, info->nbins);
+                array_free(info->libs, info->nlibs);
+                array_free(info->libs32, info->nlibs32);
+                array_free(info->firmwares, info->nfirmwares);
+                info->bins = info->libs = info->libs32 = info->firmwares = NULL;
+                info->nbins = info->nlibs = info->nlibs32 = info->nfirmwares = 0;
+        }
+        free(txt);
+        free(key);
+        return (rv);
+}
+
+static int
+write_section(FILE *fs, const char *name, char * const paths[], size_t size)
+{
+        if (fprintf(fs, "%s %zu\n", name, size) < 0)
+                return (-1);
+        for (size_t i = 0; i < size; ++i) {
+                if (fprintf(fs, "%s\n", paths[i]) < 0)
+                        return (-1);
+        }
+        return (0);
+}
+
+int
+info_cache_store(struct error *err, const struct nvc_driver_info *info, const char *root, const char *ldcache, int32_t flags, int32_t components)
+{
+        char path[PATH_MAX];
+        char tmp[PATH_MAX];
+        char *key = NULL;
+        FILE *fs = NULL;
+        int fd;
+        int rv = -1;
+
+        char * const *sections[] = {info->bins, info->libs, info->libs32, info->firmwares};
+        size_t sizes[] = {info->nbins, info->nlibs, info->nlibs32, info->nfirmwares};
+
+        for (size_t i = 0; i < nitems(sections); ++i) {
+                for (size_t j = 0; j < sizes[i]; ++j) {
+                        if (strchr(sections[i][j], '\n') != NULL) {
+                                error_setx(err, "unsupported character in path: %s", sections[i][j]);
+                                return (-1);
+                        }
+                }
+        }
+        if (cache_path(err, path, components) < 0)
+                return (-1);
+        if (xsnprintf(err, tmp, sizeof(tmp), "%s.XXXXXX", path) < 0)
+                return (-1);
+        if (cache_key(err, &key, info, root, ldcache, flags) < 0)
+                return (-1);
+
+        if (info_cache_dir(err) < 0)
+                goto fail;
+
+        if ((fd = mkstemp(tmp)) < 0) {
+                error_set(err, "open failed: %s", tmp);
+                goto fail;
+        }
+        if ((fs = fdopen(fd, "w")) == NULL) {
+                error_set(err, "open failed: %s", tmp);
+                close(fd);
+                goto fail;
+        }
+        if (fputs(key, fs) < 0 ||
+            write_section(fs, "bins", info->bins, info->nbins) < 0 ||
+            write_section(fs, "libs", info->libs, info->nlibs) < 0 ||
+            write_section(fs, "libs32", info->libs32, info->nlibs32) < 0 ||
+            write_section(fs, "firmwares", info->firmwares, info->nfirmwares) < 0) {
+                error_set(err, "write failed: %s", tmp);
+                goto fail;
+        }
+        if (fclose(fs) != 0) {
+                fs = NULL;
+                error_set(err, "write failed: %s", tmp);
+                goto fail;
+        }
+        fs = NULL;
+        if (rename(tmp, path) < 0) {
+                error_set(err, "rename failed: %s", tmp);
+                goto fail;
+        }
+        rv = 0;
+
+ fail:
+        if (fs != NULL)
+                fclose(fs);
+        if (rv < 0)
+                unlink(tmp);
+        free(key);
+        return (rv);
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HEADER_INFO_CACHE_H
+#define HEADER_INFO_CACHE_H
+
+#include <inttypes.h>
+#include <paths.h>
+#include <stdint.h>
+
+#include "error.h"
+#include "nvc_internal.h"
+
+#define NVC_CACHE_DIR  _PATH_VARRUN "nvidia-container"
+#define NVC_CACHE_FILE NVC_CACHE_DIR "/driver-info-%08"PRIx32".cache"
+
+/* Outcome of info_cache_load, a miss (i.e. no cache or a stale one) is not an error. */
+enum {
+        INFO_CACHE_ERROR = -1,
+        INFO_CACHE_MISS  = 0,
+        INFO_CACHE_HIT   = 1,
+};
+
+int info_cache_dir(struct error *);
+int info_cache_load(struct error *, struct nvc_driver_info *, const char *, const char *, int32_t, int32_t);
+int info_cache_store(struct error *, const struct nvc_driver_info *, const char *, const char *, int32_t, int32_t);
+
+#endif /* HEADER_INFO_CACHE_H */
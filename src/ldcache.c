@@ -3,7 +3,11 @@
  */
 
 #include <sys/mman.h>
+#include <sys/stat.h>
 
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdalign.h>
 #include <string.h>
@@ -23,6 +27,8 @@
 #define MAGIC_LIBC6_LEN   (sizeof(MAGIC_LIBC6) - 1)
 #define MAGIC_VERSION_LEN (sizeof(MAGIC_VERSION) - 1)
 
+#define HWCAP_EXTENSION   (1ull << 62) /* DL_CACHE_HWCAP_EXTENSION */
+
 struct entry_libc5 {
         int32_t flags;
         uint32_t key;
@@ -52,10 +58,26 @@ struct header_libc6 {
         struct entry_libc6 libs[];
 };
 
+struct merged_entry {
+        struct entry_libc6 entry;
+        const char *key;
+        const char *value;
+        size_t pos;
+};
+
+static int build_index(struct ldcache *);
+static int compare_entries(const void *, const void *, void *);
+static int compare_indices(const void *, const void *);
+static size_t lower_bound(const struct ldcache *, const char *);
+static const char *entry_key(const struct ldcache *, uint32_t);
+static const char *entry_string(const struct ldcache *, uint32_t);
+static int compare_merged(const void *, const void *);
+static bool is_replaced(const struct entry_libc6 *, const char *, const struct ldcache_entry [], size_t);
+
 void
 ldcache_init(struct ldcache *ctx, struct error *err, const char *path)
 {
-        *ctx = (struct ldcache){err, path, NULL, NULL, 0};
+        *ctx = (struct ldcache){err, path, NULL, NULL, 0, NULL, 0};
 }
 
 int
@@ -85,7 +107,13 @@ ldcache_open(struct ldcache *ctx)
         if (strncmp(h6->magic, MAGIC_LIBC6, MAGIC_LIBC6_LEN) ||
             strncmp(h6->version, MAGIC_VERSION, MAGIC_VERSION_LEN))
                 goto fail;
+        if ((size_t)((char *)ctx->addr + ctx->size - (char *)ctx->ptr) - sizeof(*h6) < (size_t)h6->nlibs * sizeof(*h6->libs))
+                goto fail;
 
+        if (build_index(ctx) < 0) {
+                file_unmap(NULL, ctx->path, ctx->addr, ctx->size);
+                return (-1);
+        }
         return (0);
 
  fail:
@@ -94,54 +122,392 @@ ldcache_open(struct ldcache *ctx)
         return (-1);
 }
 
+static const char *
+entry_key(const struct ldcache *ctx, uint32_t i)
+{
+        const struct header_libc6 *h = ctx->ptr;
+
+        return ((const char *)ctx->ptr + h->libs[i].key);
+}
+
+static int
+compare_entries(const void *a, const void *b, void *arg)
+{
+        const struct ldcache *ctx = arg;
+        uint32_t i = *(const uint32_t *)a;
+        uint32_t j = *(const uint32_t *)b;
+        int rv;
+
+        if ((rv = strcmp(entry_key(ctx, i), entry_key(ctx, j))) != 0)
+                return (rv);
+        return ((i > j) - (i < j));
+}
+
+static int
+compare_indices(const void *a, const void *b)
+{
+        uint32_t i = *(const uint32_t *)a;
+        uint32_t j = *(const uint32_t *)b;
+
+        return ((i > j) - (i < j));
+}
+
+/*
+ * Build an index of the ELF entries sorted by key so that all the entries sharing a given prefix
+ * end up contiguous and can be found with a binary search instead of a scan of the whole table.
+ */
+static int
+build_index(struct ldcache *ctx)
+{
+        struct header_libc6 *h;
+        size_t limit;
+
+        h = (struct header_libc6 *)ctx->ptr;
+        limit = (size_t)((char *)ctx->addr + ctx->size - (char *)ctx->ptr);
+
+        if ((ctx->index = xcalloc(ctx->err, h->nlibs ? h->nlibs : 1, sizeof(*ctx->index))) == NULL)
+                return (-1);
+        ctx->nindex = 0;
+        for (uint32_t i = 0; i < h->nlibs; ++i) {
+                if (!(h->libs[i].flags & LD_ELF))
+                        continue;
+                if (h->libs[i].key >= limit || h->libs[i].value >= limit ||
+                    memchr((char *)ctx->ptr + h->libs[i].key, '\0', limit - h->libs[i].key) == NULL ||
+                    memchr((char *)ctx->ptr + h->libs[i].value, '\0', limit - h->libs[i].value) == NULL) {
+                        error_setx(ctx->err, "unsupported file format: %s", ctx->path);
+                        free(ctx->index);
+                        ctx->index = NULL;
+                        return (-1);
+                }
+                ctx->index[ctx->nindex++] = i;
+        }
+        qsort_r(ctx->index, ctx->nindex, sizeof(*ctx->index), compare_entries, ctx);
+        return (0);
+}
+
+static size_t
+lower_bound(const struct ldcache *ctx, const char *prefix)
+{
+        size_t lo = 0;
+        size_t hi = ctx->nindex;
+        size_t mid;
+
+        while (lo < hi) {
+                mid = lo + (hi - lo) / 2;
+                if (strcmp(entry_key(ctx, ctx->index[mid]), prefix) < 0)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        return (lo);
+}
+
 int
 ldcache_close(struct ldcache *ctx)
 {
         if (file_unmap(ctx->err, ctx->path, ctx->addr, ctx->size) < 0)
                 return (-1);
 
+        free(ctx->index);
+        ctx->index = NULL;
+        ctx->nindex = 0;
         ctx->addr = NULL;
         ctx->ptr = NULL;
         ctx->size = 0;
         return (0);
 }
 
+/*
+ * Resolve every library prefix for all the given architectures at once.
+ * paths[a] receives the results for archs[a], each array being indexed like libs.
+ * If an entry matches several prefixes, only the first of them in libs is considered.
+ */
 int
-ldcache_resolve(struct ldcache *ctx, uint32_t arch, const char *root, const char * const libs[],
-    char *paths[], size_t size, ldcache_select_fn select, void *select_ctx)
+ldcache_resolve(struct ldcache *ctx, const uint32_t archs[], char **paths[], size_t narchs, const char *root,
+    const char * const libs[], size_t size, ldcache_select_fn select, void *select_ctx)
 {
         char path[PATH_MAX];
         struct header_libc6 *h;
+        uint32_t *matches;
+        size_t nmatches, a;
+        bool shadowed;
         int override;
+        int rv = -1;
 
         h = (struct header_libc6 *)ctx->ptr;
-        memset(paths, 0, size * sizeof(*paths));
+        for (a = 0; a < narchs; ++a)
+                memset(paths[a], 0, size * sizeof(*paths[a]));
 
-        for (uint32_t i = 0; i < h->nlibs; ++i) {
-                int32_t flags = h->libs[i].flags;
-                char *key = (char *)ctx->ptr + h->libs[i].key;
-                char *value = (char *)ctx->ptr + h->libs[i].value;
+        if ((matches = xcalloc(ctx->err, ctx->nindex ? ctx->nindex : 1, sizeof(*matches))) == NULL)
+                return (-1);
 
-                if (!(flags & LD_ELF) || (flags & LD_ARCH_MASK) != arch)
-                        continue;
+        for (size_t j = 0; j < size; ++j) {
+                nmatches = 0;
+                for (size_t k = lower_bound(ctx, libs[j]); k < ctx->nindex; ++k) {
+                        const char *key = entry_key(ctx, ctx->index[k]);
 
-                for (size_t j = 0; j < size; ++j) {
                         if (!str_has_prefix(key, libs[j]))
+                                break;
+                        shadowed = false;
+                        for (size_t l = 0; l < j && !shadowed; ++l)
+                                shadowed = str_has_prefix(key, libs[l]);
+                        if (!shadowed)
+                                matches[nmatches++] = ctx->index[k];
+                }
+                /* Preserve the cache ordering since the selection callback can depend on it. */
+                qsort(matches, nmatches, sizeof(*matches), compare_indices);
+
+                for (size_t k = 0; k < nmatches; ++k) {
+                        int32_t flags = h->libs[matches[k]].flags;
+                        char *value = (char *)ctx->ptr + h->libs[matches[k]].value;
+
+                        for (a = 0; a < narchs; ++a) {
+                                if ((flags & LD_ARCH_MASK) == (int32_t)archs[a])
+                                        break;
+                        }
+                        if (a == narchs)
                                 continue;
+
                         if (path_resolve(ctx->err, path, root, value) < 0)
-                                return (-1);
-                        if (paths[j] != NULL && str_equal(paths[j], path))
+                                goto fail;
+                        if (paths[a][j] != NULL && str_equal(paths[a][j], path))
                                 continue;
-                        if ((override = select(ctx->err, select_ctx, root, paths[j], path)) < 0)
-                                return (-1);
+                        if ((override = select(ctx->err, select_ctx, root, paths[a][j], path)) < 0)
+                                goto fail;
                         if (override) {
-                                free(paths[j]);
-                                paths[j] = xstrdup(ctx->err, path);
-                                if (paths[j] == NULL)
-                                        return (-1);
+                                free(paths[a][j]);
+                                paths[a][j] = xstrdup(ctx->err, path);
+                                if (paths[a][j] == NULL)
+                                        goto fail;
                         }
-                        break;
                 }
         }
+        rv = 0;
+
+ fail:
+        free(matches);
+        return (rv);
+}
+
+/*
+ * Compare library names the way the dynamic loader does (see _dl_cache_libcmp in glibc),
+ * sequences of digits are compared numerically so that libfoo.so.10 sorts after libfoo.so.9.
+ */
+int
+ldcache_libcmp(const char *p1, const char *p2)
+{
+        unsigned long v1, v2;
+
+        while (*p1 != '\0') {
+                if (*p1 >= '0' && *p1 <= '9') {
+                        if (*p2 < '0' || *p2 > '9')
+                                return (1);
+                        for (v1 = 0; *p1 >= '0' && *p1 <= '9'; ++p1)
+                                v1 = v1 * 10 + (unsigned long)(*p1 - '0');
+                        for (v2 = 0; *p2 >= '0' && *p2 <= '9'; ++p2)
+                                v2 = v2 * 10 + (unsigned long)(*p2 - '0');
+                        if (v1 != v2)
+                                return ((v1 > v2) - (v1 < v2));
+                } else if (*p2 >= '0' && *p2 <= '9') {
+                        return (-1);
+                } else if (*p1 != *p2) {
+                        return (*p1 - *p2);
+                } else {
+                        ++p1;
+                        ++p2;
+                }
+        }
+        return (*p1 - *p2);
+}
+
+/*
+ * Map the ELF identification of a library to the cache flags ldconfig would give it.
+ * Returns LD_UNKNOWN for the architectures we don't know how to describe.
+ */
+int32_t
+ldcache_elf_flags(uint16_t machine, bool is64, uint32_t flags)
+{
+        switch (machine) {
+        case EM_386:
+                return (is64 ? LD_UNKNOWN : LD_ELF_LIBC6|LD_I386_LIB32);
+        case EM_X86_64:
+                return (LD_ELF_LIBC6|(is64 ? LD_X8664_LIB64 : LD_X8664_LIBX32));
+        case EM_AARCH64:
+                return (is64 ? LD_ELF_LIBC6|LD_AARCH64_LIB64 : LD_UNKNOWN);
+        case EM_PPC64:
+                return (is64 ? LD_ELF_LIBC6|LD_POWERPC_LIB64 : LD_UNKNOWN);
+        case EM_ARM:
+                if (is64)
+                        return (LD_UNKNOWN);
+                return (LD_ELF_LIBC6|((flags & EF_ARM_ABI_FLOAT_HARD) ? LD_ARM_LIBHF : LD_ARM_LIBSF));
+        }
+        return (LD_UNKNOWN);
+}
+
+static const char *
+entry_string(const struct ldcache *ctx, uint32_t off)
+{
+        size_t limit = (size_t)((char *)ctx->addr + ctx->size - (char *)ctx->ptr);
+
+        if (off >= limit || memchr((char *)ctx->ptr + off, '\0', limit - off) == NULL)
+                return (NULL);
+        return ((const char *)ctx->ptr + off);
+}
+
+static int
+compare_merged(const void *a, const void *b)
+{
+        const struct merged_entry *e1 = a;
+        const struct merged_entry *e2 = b;
+        int rv;
+
+        /*
+         * Same ordering as ldconfig since the dynamic loader binary searches the table: names in decreasing order,
+         * then flags, hwcap and osversion in decreasing order. Ties keep their original position.
+         */
+        if ((rv = ldcache_libcmp(e2->key, e1->key)) != 0)
+                return (rv);
+        if (e1->entry.flags != e2->entry.flags)
+                return ((e1->entry.flags < e2->entry.flags) ? 1 : -1);
+        if (e1->entry.hwcap != e2->entry.hwcap)
+                return ((e1->entry.hwcap < e2->entry.hwcap) ? 1 : -1);
+        if (e1->entry.osversion != e2->entry.osversion)
+                return ((e1->entry.osversion < e2->entry.osversion) ? 1 : -1);
+        return ((e1->pos > e2->pos) - (e1->pos < e2->pos));
+}
+
+static bool
+is_replaced(const struct entry_libc6 *e, const char *key, const struct ldcache_entry entries[], size_t size)
+{
+        for (size_t i = 0; i < size; ++i) {
+                if (e->flags == entries[i].flags && str_equal(key, entries[i].key))
+                        return (true);
+        }
+        return (false);
+}
+
+/*
+ * Atomically replace the cache at path with the given data.
+ */
+int
+ldcache_install(struct error *err, const char *path, const void *data, size_t size)
+{
+        char tmp[PATH_MAX];
+        const char *ptr = data;
+        ssize_t n;
+        int fd;
+
+        if (xsnprintf(err, tmp, sizeof(tmp), "%s~", path) < 0)
+                return (-1);
+        if ((fd = open(tmp, O_WRONLY|O_CREAT|O_TRUNC|O_NOFOLLOW|O_CLOEXEC, 0644)) < 0) {
+                error_set(err, "open failed: %s", tmp);
+                return (-1);
+        }
+        while (size > 0) {
+                if ((n = write(fd, ptr, size)) < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        error_set(err, "write failed: %s", tmp);
+                        goto fail;
+                }
+                ptr += n;
+                size -= (size_t)n;
+        }
+        if (fdatasync(fd) < 0) {
+                error_set(err, "write failed: %s", tmp);
+                goto fail;
+        }
+        if (close(fd) < 0) {
+                fd = -1;
+                error_set(err, "write failed: %s", tmp);
+                goto fail;
+        }
+        fd = -1;
+        if (chmod(tmp, 0644) < 0 || rename(tmp, path) < 0) {
+                error_set(err, "rename failed: %s", tmp);
+                goto fail;
+        }
         return (0);
+
+ fail:
+        if (fd >= 0)
+                close(fd);
+        unlink(tmp);
+        return (-1);
+}
+
+/*
+ * Rewrite the cache with the given entries merged in, replacing any existing entry with the same name and flags.
+ * The new file only contains the glibc 2.2 format (without the libc5 compatibility header) and drops the cache
+ * extensions, which is what ldconfig -c new would produce minus the generator tag. Caches relying on the
+ * glibc-hwcaps extension are not supported and left untouched.
+ */
+int
+ldcache_merge(struct ldcache *ctx, const struct ldcache_entry entries[], size_t size)
+{
+        struct header_libc6 *h, *out;
+        struct merged_entry *tab;
+        const char *key, *value;
+        size_t n = 0;
+        size_t len = 0;
+        size_t off;
+        char *buf = NULL;
+        char *str;
+        int rv = -1;
+
+        h = (struct header_libc6 *)ctx->ptr;
+        if ((tab = xcalloc(ctx->err, (size_t)h->nlibs + size + 1, sizeof(*tab))) == NULL)
+                return (-1);
+
+        for (uint32_t i = 0; i < h->nlibs; ++i) {
+                if (h->libs[i].hwcap & HWCAP_EXTENSION) {
+                        error_setx(ctx->err, "unsupported cache extension: %s", ctx->path);
+                        goto fail;
+                }
+                if ((key = entry_string(ctx, h->libs[i].key)) == NULL || (value = entry_string(ctx, h->libs[i].value)) == NULL) {
+                        error_setx(ctx->err, "unsupported file format: %s", ctx->path);
+                        goto fail;
+                }
+                if (is_replaced(&h->libs[i], key, entries, size))
+                        continue;
+                tab[n++] = (struct merged_entry){h->libs[i], key, value, i};
+        }
+        for (size_t i = 0; i < size; ++i)
+                tab[n++] = (struct merged_entry){{entries[i].flags, 0, 0, 0, 0}, entries[i].key, entries[i].value, h->nlibs + i};
+        qsort(tab, n, sizeof(*tab), compare_merged);
+
+        off = sizeof(*out) + n * sizeof(*out->libs);
+        for (size_t i = 0; i < n; ++i)
+                len += strlen(tab[i].key) + strlen(tab[i].value) + 2;
+        if (off + len > UINT32_MAX) {
+                error_setx(ctx->err, "cache too large: %s", ctx->path);
+                goto fail;
+        }
+        if ((buf = xcalloc(ctx->err, off + len, sizeof(*buf))) == NULL)
+                goto fail;
+
+        /* String offsets are relative to the beginning of the header in the glibc 2.2 format. */
+        out = (struct header_libc6 *)buf;
+        memcpy(out->magic, MAGIC_LIBC6, MAGIC_LIBC6_LEN);
+        memcpy(out->version, MAGIC_VERSION, MAGIC_VERSION_LEN);
+        out->nlibs = (uint32_t)n;
+        out->table_size = (uint32_t)len;
+        out->unused[0] = h->unused[0]; /* endianness flags */
+        str = buf + off;
+        for (size_t i = 0; i < n; ++i) {
+                out->libs[i] = tab[i].entry;
+                out->libs[i].key = (uint32_t)(str - buf);
+                str = stpcpy(str, tab[i].key) + 1;
+                out->libs[i].value = (uint32_t)(str - buf);
+                str = stpcpy(str, tab[i].value) + 1;
+        }
+
+        if (ldcache_install(ctx->err, ctx->path, buf, off + len) < 0)
+                goto fail;
+        rv = 0;
+
+ fail:
+        free(buf);
+        free(tab);
+        return (rv);
 }
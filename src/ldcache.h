@@ -5,6 +5,7 @@
 #ifndef HEADER_LDCACHE_H
 #define HEADER_LDCACHE_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -16,6 +17,8 @@ struct ldcache {
         void *addr;
         void *ptr;
         size_t size;
+        uint32_t *index;
+        size_t nindex;
 };
 
 enum {
@@ -44,12 +47,22 @@ enum {
         LD_MIPS64_LIBN64_NAN2008   = 0x0e00,
 };
 
+struct ldcache_entry {
+        int32_t flags;
+        const char *key;
+        const char *value;
+};
+
 typedef int (*ldcache_select_fn)(struct error *, void *, const char *, const char *, const char *);
 
 void ldcache_init(struct ldcache *, struct error *, const char *);
 int  ldcache_open(struct ldcache *);
 int  ldcache_close(struct ldcache *);
-int  ldcache_resolve(struct ldcache *, uint32_t, const char *, const char * const [],
-    char *[], size_t, ldcache_select_fn, void *);
+int  ldcache_resolve(struct ldcache *, const uint32_t [], char **[], size_t, const char *,
+    const char * const [], size_t, ldcache_select_fn, void *);
+int  ldcache_merge(struct ldcache *, const struct ldcache_entry [], size_t);
+int  ldcache_install(struct error *, const char *, const void *, size_t);
+int  ldcache_libcmp(const char *, const char *);
+int32_t ldcache_elf_flags(uint16_t, bool, uint32_t);
 
 #endif /* HEADER_LDCACHE_H */
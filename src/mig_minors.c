@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvc_internal.h"
+
+#include "mig_minors.h"
+#include "utils.h"
+
+static int parse_index(const char **, const char *, unsigned int *);
+static int parse_entry(const char *, struct mig_minor *);
+static int add_entry(struct error *, struct mig_minors *, size_t *, const struct mig_minor *);
+static int compare_entries(const void *, const void *);
+
+static int
+parse_index(const char **str, const char *prefix, unsigned int *val)
+{
+        unsigned long n;
+        char *end;
+
+        if (!str_has_prefix(*str, prefix))
+                return (-1);
+        *str += strlen(prefix);
+        if (!isdigit((unsigned char)**str))
+                return (-1);
+        errno = 0;
+        n = strtoul(*str, &end, 10);
+        if (errno != 0 || n >= MIG_MINOR_NONE)
+                return (-1);
+        *val = (unsigned int)n;
+        *str = end;
+        return (0);
+}
+
+/*
+ * parse_entry parses one line of the file in a single pass, the format of which is discussed in:
+ *     https://docs.nvidia.com/datacenter/tesla/mig-user-guide/index.html#unique_1576522674
+ */
+static int
+parse_entry(const char *line, struct mig_minor *m)
+{
+        *m = (struct mig_minor){MIG_MINOR_NONE, MIG_MINOR_NONE, MIG_MINOR_NONE, MIG_CAP_CONFIG, 0};
+
+        if (str_has_prefix(line, "config ")) {
+                line += strlen("config");
+        } else if (str_has_prefix(line, "monitor ")) {
+                m->cap = MIG_CAP_MONITOR;
+                line += strlen("monitor");
+        } else {
+                if (parse_index(&line, "gpu", &m->gpu) < 0 || parse_index(&line, "/gi", &m->gi) < 0)
+                        return (-1);
+                m->cap = MIG_CAP_GI_ACCESS;
+                if (str_has_prefix(line, "/ci")) {
+                        if (parse_index(&line, "/ci", &m->ci) < 0)
+                                return (-1);
+                        m->cap = MIG_CAP_CI_ACCESS;
+                }
+                if (!str_has_prefix(line, "/" NV_MIG_ACCESS_FILE " "))
+                        return (-1);
+                line += strlen("/" NV_MIG_ACCESS_FILE);
+        }
+        if (parse_index(&line, " ", &m->minor) < 0)
+                return (-1);
+        return (str_empty(line) ? 0 : -1);
+}
+
+static int
+add_entry(struct error *err, struct mig_minors *minors, size_t *size, const struct mig_minor *m)
+{
+        struct mig_minor *entries;
+        size_t n;
+
+        if (minors->nentries == *size) {
+                n = (*size > 0) ? *size * 2 : 256;
+                if ((entries = xreallocarray(err, minors->entries, n, sizeof(*entries))) == NULL)
+                        return (-1);
+                minors->entries = entries;
+                *size = n;
+        }
+        minors->entries[minors->nentries++] = *m;
+        return (0);
+}
+
+static int
+compare_entries(const void *p1, const void *p2)
+{
+        const struct mig_minor *m1 = p1, *m2 = p2;
+
+        if (m1->gpu != m2->gpu)
+                return ((m1->gpu < m2->gpu) ? -1 : 1);
+        if (m1->gi != m2->gi)
+                return ((m1->gi < m2->gi) ? -1 : 1);
+        if (m1->ci != m2->ci)
+                return ((m1->ci < m2->ci) ? -1 : 1);
+        if (m1->cap != m2->cap)
+                return ((m1->cap < m2->cap) ? -1 : 1);
+        return (0);
+}
+
+/*
+ * mig_minors_load parses NV_CAPS_MIG_MINORS_PATH into the table, unless it was already loaded.
+ * The table is left empty if the file doesn't exist (i.e. the system isn't MIG capable), lines that aren't
+ * understood (e.g. capabilities added by a newer driver) are skipped.
+ */
+int
+mig_minors_load(struct error *err, struct mig_minors *minors)
+{
+        struct mig_minor m;
+        FILE *fs;
+        char *line = NULL;
+        size_t len = 0;
+        size_t size = 0;
+        size_t skipped = 0;
+        int rv = -1;
+
+        if (minors->loaded)
+                return (0);
+        if ((fs = fopen(NV_CAPS_MIG_MINORS_PATH, "r")) == NULL) {
+                if (errno == ENOENT) {
+                        minors->loaded = true;
+                        minors->missing = true;
+                        return (0);
+                }
+                error_set(err, "open failed: %s", NV_CAPS_MIG_MINORS_PATH);
+                return (-1);
+        }
+        while (getline(&line, &len, fs) >= 0) {
+                line[strcspn(line, "\n")] = '\0';
+                if (parse_entry(line, &m) < 0) {
+                        ++skipped;
+                        continue;
+                }
+                if (add_entry(err, minors, &size, &m) < 0)
+                        goto fail;
+        }
+        if (ferror(fs)) {
+                error_setx(err, "file read error: %s", NV_CAPS_MIG_MINORS_PATH);
+                goto fail;
+        }
+        if (skipped > 0)
+                log_warnf("skipped %zu unexpected lines in %s", skipped, NV_CAPS_MIG_MINORS_PATH);
+        if (minors->nentries > 0)
+                qsort(minors->entries, minors->nentries, sizeof(*minors->entries), compare_entries);
+        minors->loaded = true;
+        rv = 0;
+
+ fail:
+        if (rv < 0)
+                mig_minors_free(minors);
+        free(line);
+        fclose(fs);
+        return (rv);
+}
+
+void
+mig_minors_free(struct mig_minors *minors)
+{
+        free(minors->entries);
+        *minors = (struct mig_minors){false, false, NULL, 0};
+}
+
+const struct mig_minor *
+mig_minors_find(const struct mig_minors *minors, enum mig_cap cap, unsigned int gpu, unsigned int gi, unsigned int ci)
+{
+        const struct mig_minor key = {gpu, gi, ci, cap, 0};
+
+        if (minors->nentries == 0)
+                return (NULL);
+        return (bsearch(&key, minors->entries, minors->nentries, sizeof(*minors->entries), compare_entries));
+}
+
+/*
+ * mig_minors_for_gpu returns the number of capabilities of the given GPU minor, starting at *entries.
+ */
+size_t
+mig_minors_for_gpu(const struct mig_minors *minors, unsigned int gpu, const struct mig_minor **entries)
+{
+        size_t lo = 0, hi = minors->nentries;
+        size_t end;
+
+        while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (minors->entries[mid].gpu < gpu)
+                        lo = mid + 1;
+                else
+                        hi = mid;
+        }
+        for (end = lo; end < minors->nentries && minors->entries[end].gpu == gpu; ++end);
+
+        *entries = minors->entries + lo;
+        return (end - lo);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HEADER_MIG_MINORS_H
+#define HEADER_MIG_MINORS_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "error.h"
+
+/* Index of a GPU, GPU instance or compute instance that doesn't apply to a capability. */
+#define MIG_MINOR_NONE UINT_MAX
+
+enum mig_cap {
+        MIG_CAP_CI_ACCESS,
+        MIG_CAP_GI_ACCESS,
+        MIG_CAP_CONFIG,
+        MIG_CAP_MONITOR,
+};
+
+struct mig_minor {
+        unsigned int gpu;
+        unsigned int gi;
+        unsigned int ci;
+        enum mig_cap cap;
+        unsigned int minor;
+};
+
+/*
+ * Device minors of the MIG capabilities as listed by the driver in NV_CAPS_MIG_MINORS_PATH.
+ * Entries are sorted by GPU, GPU instance and compute instance, the global capabilities come last.
+ * A missing file (i.e. the system isn't MIG capable) is loaded as an empty table with missing set.
+ */
+struct mig_minors {
+        bool loaded;
+        bool missing;
+        struct mig_minor *entries;
+        size_t nentries;
+};
+
+int mig_minors_load(struct error *, struct mig_minors *);
+void mig_minors_free(struct mig_minors *);
+const struct mig_minor *mig_minors_find(const struct mig_minors *, enum mig_cap, unsigned int, unsigned int, unsigned int);
+size_t mig_minors_for_gpu(const struct mig_minors *, unsigned int, const struct mig_minor **);
+
+#endif /* HEADER_MIG_MINORS_H */
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/mount.h>
+#include <sys/sysmacros.h>
+#include <sys/types.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mount_plan.h"
+#include "utils.h"
+#include "xfuncs.h"
+
+static void write_string(FILE *, const char *);
+static void write_action(FILE *, const struct plan_action *);
+
+static const char * const plan_ops[] = {
+        [PLAN_MKDIR] = "mkdir",
+        [PLAN_BIND] = "bind",
+        [PLAN_MKNOD] = "mknod",
+        [PLAN_TMPFS] = "tmpfs",
+        [PLAN_COPY] = "copy",
+        [PLAN_SYMLINK] = "symlink",
+        [PLAN_PROFILE] = "profile",
+        [PLAN_CGROUP] = "cgroup",
+};
+
+static const struct {
+        unsigned long flag;
+        const char *name;
+} mount_flags[] = {
+        {MS_RDONLY, "ro"},
+        {MS_NOSUID, "nosuid"},
+        {MS_NODEV, "nodev"},
+        {MS_NOEXEC, "noexec"},
+};
+
+/*
+ * plan_add appends an action to the plan and returns it for the caller to fill in the attributes of the operation.
+ */
+struct plan_action *
+plan_add(struct error *err, struct mount_plan *plan, enum plan_op op, const char *src, const char *dst)
+{
+        struct plan_action *actions, *a;
+        size_t size;
+
+        if (plan->nactions == plan->size) {
+                size = (plan->size > 0) ? plan->size * 2 : 64;
+                if ((actions = xreallocarray(err, plan->actions, size, sizeof(*actions))) == NULL)
+                        return (NULL);
+                plan->actions = actions;
+                plan->size = size;
+        }
+        a = &plan->actions[plan->nactions];
+        *a = (struct plan_action){.op = op};
+        if (src != NULL && (a->src = xstrdup(err, src)) == NULL)
+                return (NULL);
+        if (dst != NULL && (a->dst = xstrdup(err, dst)) == NULL) {
+                free(a->src);
+                return (NULL);
+        }
+        ++plan->nactions;
+        return (a);
+}
+
+void
+plan_free(struct mount_plan *plan)
+{
+        for (size_t i = 0; i < plan->nactions; ++i) {
+                free(plan->actions[i].src);
+                free(plan->actions[i].dst);
+        }
+        free(plan->actions);
+        *plan = (struct mount_plan){NULL, 0, 0};
+}
+
+static void
+write_string(FILE *fs, const char *str)
+{
+        fputc('"', fs);
+        for (const unsigned char *p = (const unsigned char *)str; *p != '\0'; ++p) {
+                if (*p == '"' || *p == '\\')
+                        fprintf(fs, "\\%c", *p);
+                else if (*p < 0x20)
+                        fprintf(fs, "\\u%04x", *p);
+                else
+                        fputc(*p, fs);
+        }
+        fputc('"', fs);
+}
+
+static void
+write_action(FILE *fs, const struct plan_action *a)
+{
+        const char *sep = "";
+
+        fprintf(fs, "{\"op\": \"%s\"", plan_ops[a->op]);
+        if (a->src != NULL) {
+                fputs(", \"src\": ", fs);
+                write_string(fs, a->src);
+        }
+        if (a->dst != NULL) {
+                fputs(", \"dst\": ", fs);
+                write_string(fs, a->dst);
+        }
+        switch (a->op) {
+        case PLAN_MKDIR:
+                fprintf(fs, ", \"mode\": \"%04o\"", (unsigned int)(a->mode & 07777));
+                break;
+        case PLAN_BIND:
+        case PLAN_MKNOD:
+        case PLAN_TMPFS:
+                fputs(", \"flags\": [", fs);
+                for (size_t i = 0; i < nitems(mount_flags); ++i) {
+                        if (a->flags & mount_flags[i].flag) {
+                                fprintf(fs, "%s\"%s\"", sep, mount_flags[i].name);
+                                sep = ", ";
+                        }
+                }
+                fputc(']', fs);
+                break;
+        default:
+                break;
+        }
+        if (a->dev != 0 || a->op == PLAN_CGROUP || a->op == PLAN_PROFILE)
+                fprintf(fs, ", \"device\": \"%u:%u\"", major(a->dev), minor(a->dev));
+        if (a->opts & PLAN_OPT_OPTIONAL)
+                fputs(", \"optional\": true", fs);
+        if (a->opts & PLAN_OPT_REPLACE)
+                fputs(", \"replace\": true", fs);
+        fputc('}', fs);
+}
+
+int
+plan_to_json(struct error *err, const struct mount_plan *plan, char **json)
+{
+        FILE *fs;
+        size_t len;
+        int rv = 0;
+
+        *json = NULL;
+        if ((fs = open_memstream(json, &len)) == NULL) {
+                error_set(err, "memory allocation failed");
+                return (-1);
+        }
+        fputc('[', fs);
+        for (size_t i = 0; i < plan->nactions; ++i) {
+                fputs((i > 0) ? ",\n " : "", fs);
+                write_action(fs, &plan->actions[i]);
+        }
+        fputc(']', fs);
+        if (ferror(fs))
+                rv = -1;
+        if (fclose(fs) != 0)
+                rv = -1;
+        if (rv < 0) {
+                error_setx(err, "memory allocation failed");
+                free(*json);
+                *json = NULL;
+        }
+        return (rv);
+}
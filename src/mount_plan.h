@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HEADER_MOUNT_PLAN_H
+#define HEADER_MOUNT_PLAN_H
+
+#include <sys/types.h>
+
+#include <stddef.h>
+
+#include "error.h"
+
+enum plan_op {
+        PLAN_MKDIR,   /* Create the directory dst with mode. */
+        PLAN_BIND,    /* Bind mount the host path src at dst with the mount flags. */
+        PLAN_MKNOD,   /* Create the device node dev at dst like the host node src, or bind mount it if not permitted. */
+        PLAN_TMPFS,   /* Mount a tmpfs at dst with the mount flags. */
+        PLAN_COPY,    /* Copy the content of the host file src to dst. */
+        PLAN_SYMLINK, /* Create the symlink dst pointing to src. */
+        PLAN_PROFILE, /* Make the device dev visible in the application profile. */
+        PLAN_CGROUP,  /* Allow the device dev in the device cgroup. */
+};
+
+#define PLAN_OPT_OPTIONAL (1 << 0) /* Skip the action if src doesn't exist. */
+#define PLAN_OPT_REGULAR  (1 << 1) /* Fail if src is a directory or a symlink. */
+#define PLAN_OPT_PARAMS   (1 << 2) /* Prevent NVRM from adjusting the device nodes (driver params). */
+#define PLAN_OPT_REPLACE  (1 << 3) /* Atomically replace a symlink at dst, shadow any other entry. */
+
+/*
+ * Destination paths are relative to the container rootfs and are only resolved when the plan gets executed,
+ * a plan is therefore not tied to a given container but only to the driver information and container flags.
+ */
+struct plan_action {
+        enum plan_op op;
+        char *src;
+        char *dst;
+        unsigned long flags;
+        mode_t mode;
+        dev_t dev;
+        int opts;
+};
+
+struct mount_plan {
+        struct plan_action *actions;
+        size_t nactions;
+        size_t size;
+};
+
+struct plan_action *plan_add(struct error *, struct mount_plan *, enum plan_op, const char *, const char *);
+void plan_free(struct mount_plan *);
+int plan_to_json(struct error *, const struct mount_plan *, char **);
+
+#endif /* HEADER_MOUNT_PLAN_H */
@@ -4,15 +4,19 @@
 
 #include <gnu/lib-names.h>
 
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <dirent.h>
 #include <elf.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <libgen.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <pci-enum.h>
@@ -29,10 +33,14 @@
 #include "nvcgo.h"
 #endif
 #include "options.h"
+#include "trace.h"
 #include "utils.h"
 #include "xfuncs.h"
 
 static int init_within_userns(struct error *);
+static int mig_nvcaps_mknod(struct error *, const struct mig_minors *, const char *, enum mig_cap, unsigned int, unsigned int, unsigned int);
+static int mig_nvcaps_walk(struct error *, const struct mig_minors *, char *, unsigned int, unsigned int, unsigned int);
+static int mig_nvcaps_mknodes(struct error *, int);
 static int load_kernel_modules(struct error *, const char *, const struct nvc_imex_info *, int32_t);
 static int copy_config(struct error *, struct nvc_context *, const struct nvc_config *);
 
@@ -147,84 +155,120 @@ init_within_userns(struct error *err)
 }
 
 static int
-mig_nvcaps_mknodes(struct error *err, int num_gpus) {
-        FILE *fp;
-        char line[PATH_MAX];
-        char path[PATH_MAX];
-        int gpu = -1, gi = -1, ci = -1, mig_minor = -1;
-        int rv = -1;
+mig_nvcaps_mknod(struct error *err, const struct mig_minors *minors, const char *path,
+    enum mig_cap cap, unsigned int gpu, unsigned int gi, unsigned int ci)
+{
+        const struct mig_minor *m;
+        int minor;
 
-        // If the NV_CAPS_MIG_MINORS_PATH does not exist, then we are not on a
-        // MIG capable machine, so there is nothing to do.
-        if (!file_exists(NULL, NV_CAPS_MIG_MINORS_PATH))
+        // Only the capabilities listed in NV_CAPS_MIG_MINORS_PATH get a device node.
+        if ((m = mig_minors_find(minors, cap, gpu, gi, ci)) == NULL)
                 return (0);
 
-        // Open NV_CAPS_MIG_MINORS_PATH for walking.
-        // The format of this file is discussed in:
-        //     https://docs.nvidia.com/datacenter/tesla/mig-user-guide/index.html#unique_1576522674
-        if ((fp = fopen(NV_CAPS_MIG_MINORS_PATH, "r")) == NULL) {
-                error_setx(err, "unable to open: %s", NV_CAPS_MIG_MINORS_PATH);
+        // Call into nvidia-modprobe code to perform the mknod() on
+        // /dev/nvidia-caps/nvidia-cap<mig_minor> from the canonical
+        // /proc path.
+        log_infof("running mknod for " NV_CAPS_DEVICE_PATH " from %s", m->minor, path);
+        if (nvidia_cap_mknod(path, &minor) == 0) {
+                error_setx(err, "error running mknod for nvcap: %s", path);
                 return (-1);
         }
+        return (0);
+}
+
+// mig_nvcaps_walk creates the device nodes of the capabilities found under path, which is either
+// the global MIG directory (gpu == MIG_MINOR_NONE), a GPU MIG directory, or a GPU/compute instance
+// directory of that GPU (gi/ci != MIG_MINOR_NONE).
+static int
+mig_nvcaps_walk(struct error *err, const struct mig_minors *minors, char *path,
+    unsigned int gpu, unsigned int gi, unsigned int ci)
+{
+        DIR *d;
+        struct dirent *ent;
+        size_t len = strlen(path);
+        unsigned int idx;
+        int rv = -1;
 
-        // Walk through each line of NV_CAPS_MIG_MINORS_PATH
-        memset(line, 0, PATH_MAX);
-        memset(path, 0, PATH_MAX);
-        while (fgets(line, PATH_MAX - 1, fp)) {
-                // Look for a ci access entry and construct a path into /proc from it
-                if (sscanf(line, "gpu%d/gi%d/ci%d/access %d", &gpu, &gi, &ci, &mig_minor) == 4) {
-                        if (gpu >= num_gpus)
-                                continue;
-                        if (sprintf(path, NV_COMP_INST_CAPS_PATH "/" NV_MIG_ACCESS_FILE, gpu, gi, ci) < 0) {
-                                error_setx(err, "error constructing path for ci access file");
+        if ((d = opendir(path)) == NULL) {
+                if (errno == ENOENT)
+                        return (0);
+                error_set(err, "open failed: %s", path);
+                return (-1);
+        }
+        for (;;) {
+                errno = 0;
+                if ((ent = readdir(d)) == NULL) {
+                        if (errno != 0) {
+                                error_set(err, "read failed: %s", path);
                                 goto fail;
                         }
-                // Look for a gi access entry and construct a path into /proc from it
-                } else if (sscanf(line, "gpu%d/gi%d/access %d", &gpu, &gi, &mig_minor) == 3) {
-                        if (gpu >= num_gpus)
-                                continue;
-                        if (sprintf(path, NV_GPU_INST_CAPS_PATH "/" NV_MIG_ACCESS_FILE, gpu, gi) < 0) {
-                                error_setx(err, "error constructing path for gi access file");
-                                goto fail;
+                        break;
+                }
+                if (path_append(err, path, ent->d_name) < 0)
+                        goto fail;
+
+                if (gpu == MIG_MINOR_NONE) {
+                        if (str_equal(ent->d_name, NV_MIG_CONFIG_FILE)) {
+                                if (mig_nvcaps_mknod(err, minors, path, MIG_CAP_CONFIG, gpu, gi, ci) < 0)
+                                        goto fail;
+                        } else if (str_equal(ent->d_name, NV_MIG_MONITOR_FILE)) {
+                                if (mig_nvcaps_mknod(err, minors, path, MIG_CAP_MONITOR, gpu, gi, ci) < 0)
+                                        goto fail;
                         }
-                // Look for a mig config entry and construct a path into /proc from it
-                } else if (sscanf(line, "config %d", &mig_minor) == 1) {
-                        if (sprintf(path, NV_MIG_CAPS_PATH "/" NV_MIG_CONFIG_FILE) < 0) {
-                                error_setx(err, "error constructing path for mig config file");
-                                goto fail;
+                } else if (gi == MIG_MINOR_NONE) {
+                        if (sscanf(ent->d_name, "gi%u", &idx) == 1) {
+                                if (mig_nvcaps_walk(err, minors, path, gpu, idx, ci) < 0)
+                                        goto fail;
                         }
-                // Look for a mig monitor entry and construct a path into /proc from it
-                } else if (sscanf(line, "monitor %d", &mig_minor) == 1) {
-                        if (sprintf(path, NV_MIG_CAPS_PATH "/" NV_MIG_MONITOR_FILE) < 0) {
-                                error_setx(err, "error constructing path for mig monitor file");
+                } else if (str_equal(ent->d_name, NV_MIG_ACCESS_FILE)) {
+                        if (mig_nvcaps_mknod(err, minors, path, (ci == MIG_MINOR_NONE) ? MIG_CAP_GI_ACCESS : MIG_CAP_CI_ACCESS, gpu, gi, ci) < 0)
+                                goto fail;
+                } else if (ci == MIG_MINOR_NONE && sscanf(ent->d_name, "ci%u", &idx) == 1) {
+                        if (mig_nvcaps_walk(err, minors, path, gpu, gi, idx) < 0)
                                 goto fail;
-                        }
-                // We encountered an unexpected pattern, so error out
-                } else {
-                        error_setx(err, "unexpected line in mig-monitors file: %s", line);
-                        goto fail;
                 }
+                path[len] = '\0';
+        }
+        rv = 0;
+
+ fail:
+        path[len] = '\0';
+        closedir(d);
+        return (rv);
+}
+
+static int
+mig_nvcaps_mknodes(struct error *err, int num_gpus) {
+        struct mig_minors minors = {0};
+        char path[PATH_MAX];
+        int rv = -1;
 
-                // This file contains entries for all possible MIG nvcaps on up
-                // to 32 GPUs. If the newly constructed path does not exist,
-                // then just move on because there are many entries in this
-                // file that will not be present on the machine.
-                if (!file_exists(NULL, path))
-                        continue;
-
-                // Call into nvidia-modprobe code to perform the mknod() on
-                // /dev/nvidia-caps/nvidia-cap<mig_minor> from the canonical
-                // /proc path we constructed.
-                log_infof("running mknod for " NV_CAPS_DEVICE_PATH " from %s", mig_minor, path);
-                if (nvidia_cap_mknod(path, &mig_minor) == 0) {
-                        error_setx(err, "error running mknod for nvcap: %s", path);
+        // Parse NV_CAPS_MIG_MINORS_PATH once. It contains entries for all possible
+        // MIG nvcaps on up to 32 GPUs, most of which will not be present on the
+        // machine, so walk the capabilities that exist in /proc instead.
+        // If it does not exist, then we are not on a MIG capable machine, so
+        // there is nothing to do.
+        if (mig_minors_load(err, &minors) < 0)
+                return (-1);
+        if (minors.nentries == 0)
+                goto done;
+
+        if (path_new(err, path, NV_MIG_CAPS_PATH) < 0)
+                goto fail;
+        if (mig_nvcaps_walk(err, &minors, path, MIG_MINOR_NONE, MIG_MINOR_NONE, MIG_MINOR_NONE) < 0)
+                goto fail;
+        for (int gpu = 0; gpu < num_gpus; ++gpu) {
+                if (xsnprintf(err, path, sizeof(path), NV_GPU_MIG_CAPS_PATH, gpu) < 0)
+                        goto fail;
+                if (mig_nvcaps_walk(err, &minors, path, (unsigned int)gpu, MIG_MINOR_NONE, MIG_MINOR_NONE) < 0)
                         goto fail;
-                }
         }
+
+ done:
         rv = 0;
 
-fail:
-        fclose(fp);
+ fail:
+        mig_minors_free(&minors);
         return (rv);
 }
 
@@ -242,6 +286,7 @@ load_kernel_modules(struct error *err, const char *root, const struct nvc_imex_i
                 0xff00,        /* class mask (any subclass) */
                 0,             /* match count */
         };
+        trace_func();
 
         /*
          * Prevent loading the kernel modules if we are inside a user namespace because we could potentially adjust the host
@@ -393,10 +438,14 @@ nvc_init(struct nvc_context *ctx, const struct nvc_config *cfg, const char *opts
                 return (-1);
 
         log_open(secure_getenv("NVC_DEBUG_FILE"));
+        trace_open(secure_getenv("NVC_TRACE_FILE"));
         log_infof("initializing library context (version=%s, build=%s)", NVC_VERSION, BUILD_REVISION);
+        trace_func();
 
         memset(&ctx->cfg, 0, sizeof(ctx->cfg));
+        memset(&ctx->ldconfig, 0, sizeof(ctx->ldconfig));
         ctx->mnt_ns = -1;
+        ctx->ldconfig.fd = -1;
 
         if (copy_config(&ctx->err, ctx, cfg) < 0)
                 goto fail;
@@ -427,11 +476,11 @@ nvc_init(struct nvc_context *ctx, const struct nvc_config *cfg, const char *opts
                         goto fail;
         }
 
-        if (driver_init(&ctx->err, &ctx->dxcore, ctx->cfg.root, ctx->cfg.uid, ctx->cfg.gid) < 0)
+        if (driver_init(&ctx->err, &ctx->driver, &ctx->dxcore, ctx->cfg.root, ctx->cfg.uid, ctx->cfg.gid, flags & OPT_COALESCE_DISCOVERY) < 0)
                 goto fail;
 
         #ifdef WITH_NVCGO
-        if (nvcgo_init(&ctx->err) < 0)
+        if (nvcgo_init(&ctx->err, &ctx->nvcgo) < 0)
                 goto fail;
         #endif
 
@@ -443,6 +492,8 @@ nvc_init(struct nvc_context *ctx, const struct nvc_config *cfg, const char *opts
         free(ctx->cfg.ldcache);
         free(ctx->cfg.imex.chans);
         xclose(ctx->mnt_ns);
+        trace_close();
+        log_close();
         return (-1);
 }
 
@@ -456,12 +507,12 @@ nvc_shutdown(struct nvc_context *ctx)
 
         int rv = 0;
         #ifdef WITH_NVCGO
-        if (nvcgo_shutdown(&ctx->err) < 0) {
+        if (nvcgo_shutdown(&ctx->err, &ctx->nvcgo) < 0) {
                 log_warnf("error shutting down nvcgo rpc service: %s", ctx->err.msg);
                 rv = -1;
         }
         #endif
-        if (driver_shutdown(&ctx->err) < 0) {
+        if (driver_shutdown(&ctx->err, &ctx->driver) < 0) {
                 log_warnf("error shutting down driver rpc service: %s", ctx->err.msg);
                 rv = -1;
         }
@@ -476,15 +527,68 @@ nvc_shutdown(struct nvc_context *ctx)
         free(ctx->cfg.ldcache);
         free(ctx->cfg.imex.chans);
         xclose(ctx->mnt_ns);
+        xclose(ctx->ldconfig.fd);
 
         memset(&ctx->cfg, 0, sizeof(ctx->cfg));
+        memset(&ctx->ldconfig, 0, sizeof(ctx->ldconfig));
         ctx->mnt_ns = -1;
+        ctx->ldconfig.fd = -1;
+        mig_minors_free(&ctx->mig_minors);
+        path_resolve_flush();
 
+        trace_close();
         log_close();
         ctx->initialized = false;
         return (rv);
 }
 
+int
+nvc_driver_serve(struct nvc_context *ctx, const struct nvc_config *cfg, const char *path)
+{
+        char *dir = NULL;
+        int rv = -1;
+
+        if (ctx == NULL)
+                return (-1);
+        if (ctx->initialized) {
+                error_setx(&ctx->err, "library context already initialized");
+                return (-1);
+        }
+        if (cfg == NULL)
+                cfg = &(struct nvc_config){NULL, NULL, (uid_t)-1, (gid_t)-1, {0}};
+        if (path == NULL)
+                path = NV_DRIVER_SOCKET;
+        if (validate_args(ctx, !str_empty(path) && path[0] == '/') < 0)
+                return (-1);
+
+        log_open(secure_getenv("NVC_DEBUG_FILE"));
+        trace_open(secure_getenv("NVC_TRACE_FILE"));
+        log_infof("starting shared driver rpc service (version=%s, build=%s)", NVC_VERSION, BUILD_REVISION);
+
+        memset(&ctx->cfg, 0, sizeof(ctx->cfg));
+        if (copy_config(&ctx->err, ctx, cfg) < 0)
+                goto fail;
+        if ((dir = xstrdup(&ctx->err, path)) == NULL)
+                goto fail;
+        if (mkdir(dirname(dir), 0700) < 0 && errno != EEXIST) {
+                error_set(&ctx->err, "mkdir failed: %s", dir);
+                goto fail;
+        }
+        if (driver_serve(&ctx->err, ctx->cfg.root, ctx->cfg.uid, ctx->cfg.gid, path) < 0)
+                goto fail;
+        rv = 0;
+
+ fail:
+        free(dir);
+        free(ctx->cfg.root);
+        free(ctx->cfg.ldcache);
+        free(ctx->cfg.imex.chans);
+        memset(&ctx->cfg, 0, sizeof(ctx->cfg));
+        trace_close();
+        log_close();
+        return (rv);
+}
+
 const char *
 nvc_error(struct nvc_context *ctx)
 {
@@ -2,6 +2,7 @@
  * Copyright (c) 2017-2018, NVIDIA CORPORATION. All rights reserved.
  */
 
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include <inttypes.h>
@@ -17,12 +18,15 @@
 #include "common.h"
 #include "error.h"
 #include "options.h"
+#include "trace.h"
 #include "utils.h"
 #include "xfuncs.h"
 
 static char *find_namespace_path(struct error *, const struct nvc_container *, const char *);
 static int  find_compat_library_paths(struct error *, struct nvc_container *);
 static int  lookup_owner(struct error *, struct nvc_container *);
+static int  device_tmpfs_private(struct error *, const struct nvc_container *);
+static int  check_device_nodes(struct error *, struct nvc_container *);
 static int  copy_config(struct error *, struct nvc_container *, const struct nvc_container_config *);
 static int  validate_cuda_compat_mode_flags(struct error *, int32_t *);
 
@@ -117,6 +121,84 @@ lookup_owner(struct error *err, struct nvc_container *cnt)
         return (0);
 }
 
+/*
+ * device_tmpfs_private returns 1 if the container /dev is a tmpfs mounted by and for the container alone,
+ * that is a whole tmpfs instance which is neither propagated to nor received from another mount namespace.
+ */
+static int
+device_tmpfs_private(struct error *err, const struct nvc_container *cnt)
+{
+        const char *prefix;
+        char path[PATH_MAX];
+        char *buf = NULL;
+        char *line, *root, *mount, *opt, *fstype;
+        size_t len;
+        FILE *fs;
+        int rv = 0;
+
+        prefix = (cnt->flags & OPT_STANDALONE) ? cnt->cfg.rootfs : "";
+        if (xsnprintf(err, path, sizeof(path), "%s"PROC_MOUNTS_PATH(PROC_PID), prefix, (int32_t)cnt->cfg.pid) < 0)
+                return (-1);
+        if ((fs = xfopen(err, path, "r")) == NULL)
+                return (-1);
+
+        /* The last mount on /dev is the one on top, which is where device nodes would be created. */
+        while (getline(&buf, &len, fs) >= 0) {
+                line = buf;
+                for (int i = 0; i < 4; ++i)
+                        root = strsep(&line, " ");
+                mount = strsep(&line, " ");
+                strsep(&line, " ");
+                if (root == NULL || mount == NULL || line == NULL || !str_equal(mount, "/dev"))
+                        continue;
+                rv = 1;
+                while ((opt = strsep(&line, " ")) != NULL && !str_equal(opt, "-")) {
+                        if (str_has_prefix(opt, "shared:") || str_has_prefix(opt, "master:"))
+                                rv = 0;
+                }
+                fstype = strsep(&line, " ");
+                if (fstype == NULL || !str_equal(fstype, "tmpfs") || !str_equal(root, "/"))
+                        rv = 0;
+        }
+        free(buf);
+        fclose(fs);
+        return (rv);
+}
+
+/*
+ * Device nodes are only created in the container (see the mknod-devices option) if they can't be seen from outside
+ * of it or outlive it, and if they can be opened once created. The container /dev must thus be a private tmpfs,
+ * and the container must run in our user namespace: nodes on filesystems mounted from another user namespace can be
+ * created but not opened. Otherwise, the option is dropped and device nodes are bind mounted.
+ */
+static int
+check_device_nodes(struct error *err, struct nvc_container *cnt)
+{
+        const char *prefix;
+        char path[PATH_MAX];
+        struct stat s1, s2;
+        int rv;
+
+        if (!(cnt->flags & OPT_MKNOD_DEVICES))
+                return (0);
+
+        prefix = (cnt->flags & OPT_STANDALONE) ? cnt->cfg.rootfs : "";
+        if (xsnprintf(err, path, sizeof(path), "%s"PROC_NS_PATH(PROC_PID), prefix, (int32_t)cnt->cfg.pid, "user") < 0)
+                return (-1);
+        if (stat(path, &s1) < 0 || stat(PROC_SELF "/ns/user", &s2) < 0 || s1.st_dev != s2.st_dev || s1.st_ino != s2.st_ino) {
+                log_warn("container has its own user namespace, device nodes will be bind mounted");
+                cnt->flags &= ~OPT_MKNOD_DEVICES;
+                return (0);
+        }
+        if ((rv = device_tmpfs_private(err, cnt)) < 0)
+                return (-1);
+        if (rv == 0) {
+                log_warn("container /dev is not a private tmpfs, device nodes will be bind mounted");
+                cnt->flags &= ~OPT_MKNOD_DEVICES;
+        }
+        return (0);
+}
+
 static int
 copy_config(struct error *err, struct nvc_container *cnt, const struct nvc_container_config *cfg)
 {
@@ -223,6 +305,7 @@ nvc_container_new(struct nvc_context *ctx, const struct nvc_container_config *cf
 {
         struct nvc_container *cnt;
         int32_t flags;
+        trace_func();
 
         if (validate_context(ctx) < 0)
                 return (NULL);
@@ -257,10 +340,14 @@ nvc_container_new(struct nvc_context *ctx, const struct nvc_container_config *cf
         }
         if ((cnt->mnt_ns = find_namespace_path(&ctx->err, cnt, "mnt")) == NULL)
                 goto fail;
+        if (check_device_nodes(&ctx->err, cnt) < 0)
+                goto fail;
         if (!(flags & OPT_NO_CGROUPS)) {
-                if ((cnt->dev_cg_version = get_device_cgroup_version(&ctx->err, cnt)) < 0)
+                if ((cnt->dev_cg_version = get_device_cgroup_version(&ctx->err, ctx, cnt)) < 0)
+                        goto fail;
+                if ((cnt->dev_cg = find_device_cgroup_path(&ctx->err, ctx, cnt)) == NULL)
                         goto fail;
-                if ((cnt->dev_cg = find_device_cgroup_path(&ctx->err, cnt)) == NULL)
+                if ((cnt->dev_cg_rules = xcalloc(&ctx->err, 1, sizeof(*cnt->dev_cg_rules))) == NULL)
                         goto fail;
         }
 
@@ -297,6 +384,9 @@ nvc_container_free(struct nvc_container *cnt)
         free(cnt->cfg.ldconfig);
         free(cnt->mnt_ns);
         free(cnt->dev_cg);
+        if (cnt->dev_cg_rules != NULL)
+                free(cnt->dev_cg_rules->devs);
+        free(cnt->dev_cg_rules);
         array_free(cnt->libs, cnt->nlibs);
         free(cnt->cuda_compat_dir);
         free(cnt);
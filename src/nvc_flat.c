@@ -0,0 +1,514 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/param.h>
+#include <sys/types.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvc_internal.h"
+
+#include "error.h"
+#include "utils.h"
+#include "xfuncs.h"
+
+/*
+ * A flat buffer holds a whole info structure in a single contiguous allocation, with every reference expressed as an
+ * offset from the start of the buffer (0 standing for NULL). It never needs to be fixed up: importing it builds the
+ * public structure (and its pointer arrays) in one allocation whose strings point directly into the buffer.
+ *
+ *   flat_header | flat_driver_info or flat_device_info | arrays and strings...
+ */
+
+#define FLAT_MAGIC   0x4e564346 /* "NVCF" in native byte order */
+#define FLAT_VERSION 1
+#define FLAT_ALIGN   8
+#define FLAT_CHUNK   4096
+
+enum {
+        FLAT_DRIVER_INFO = 1,
+        FLAT_DEVICE_INFO = 2,
+};
+
+struct flat_header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t kind;
+        uint64_t size;
+};
+
+struct flat_array {
+        uint64_t offset;
+        uint64_t count;
+};
+
+struct flat_device_node {
+        uint64_t path;
+        uint64_t id;
+};
+
+struct flat_driver_info {
+        uint64_t nvrm_version;
+        uint64_t cuda_version;
+        struct flat_array bins;
+        struct flat_array libs;
+        struct flat_array libs32;
+        struct flat_array ipcs;
+        struct flat_array devs;
+        struct flat_array firmwares;
+};
+
+struct flat_mig_device {
+        uint64_t uuid;
+        uint32_t gi;
+        uint32_t ci;
+        uint64_t gi_caps_path;
+        uint64_t ci_caps_path;
+};
+
+struct flat_device {
+        uint64_t model;
+        uint64_t uuid;
+        uint64_t busid;
+        uint64_t arch;
+        uint64_t brand;
+        struct flat_device_node node;
+        uint64_t mig_capable;
+        uint64_t mig_caps_path;
+        struct flat_array mig_devices;
+};
+
+struct flat_device_info {
+        struct flat_array gpus;
+};
+
+/* Bump allocator over a single block. Offsets stay valid when the block grows, pointers must be recomputed. */
+struct arena {
+        char *base;
+        size_t size;
+        size_t used;
+        bool fixed;
+};
+
+#define arena_at(a, off, type) ((type *)(void *)((a)->base + (off)))
+
+static int arena_alloc(struct error *, struct arena *, size_t, size_t, uint64_t *);
+static int flat_string(struct error *, struct arena *, const char *, uint64_t *);
+static int flat_strings(struct error *, struct arena *, char * const [], size_t, struct flat_array *);
+static int flat_export(struct error *, struct arena *, uint16_t, size_t, uint64_t *);
+static int flat_check(struct error *, const void *, size_t, uint16_t, size_t);
+static int flat_range(struct error *, size_t, const struct flat_array *, size_t);
+static int flat_get_string(struct error *, const char *, size_t, uint64_t, char **);
+static int flat_get_strings(struct error *, struct arena *, const char *, size_t, const struct flat_array *, char ***);
+
+static int
+arena_alloc(struct error *err, struct arena *a, size_t count, size_t size, uint64_t *off)
+{
+        size_t start, end, n;
+        char *ptr;
+
+        start = (a->used + FLAT_ALIGN - 1) & ~(size_t)(FLAT_ALIGN - 1);
+        if (size != 0 && count > (SIZE_MAX - start) / size) {
+                error_setx(err, "flat buffer too large");
+                return (-1);
+        }
+        end = start + count * size;
+        if (end > a->size) {
+                if (a->fixed) {
+                        error_setx(err, "flat buffer overflow");
+                        return (-1);
+                }
+                n = MAX(end, a->size * 2);
+                n = (n + FLAT_CHUNK - 1) & ~(size_t)(FLAT_CHUNK - 1);
+                if ((ptr = xreallocarray(err, a->base, n, 1)) == NULL)
+                        return (-1);
+                memset(ptr + a->size, 0, n - a->size);
+                a->base = ptr;
+                a->size = n;
+        }
+        a->used = end;
+        *off = start;
+        return (0);
+}
+
+static int
+flat_string(struct error *err, struct arena *a, const char *str, uint64_t *off)
+{
+        size_t len;
+
+        *off = 0;
+        if (str == NULL)
+                return (0);
+        len = strlen(str) + 1;
+        if (arena_alloc(err, a, len, 1, off) < 0)
+                return (-1);
+        memcpy(arena_at(a, *off, char), str, len);
+        return (0);
+}
+
+static int
+flat_strings(struct error *err, struct arena *a, char * const strs[], size_t size, struct flat_array *arr)
+{
+        uint64_t off, str;
+
+        *arr = (struct flat_array){0, size};
+        if (size == 0)
+                return (0);
+        if (arena_alloc(err, a, size, sizeof(uint64_t), &off) < 0)
+                return (-1);
+        for (size_t i = 0; i < size; ++i) {
+                if (flat_string(err, a, strs[i], &str) < 0)
+                        return (-1);
+                arena_at(a, off, uint64_t)[i] = str;
+        }
+        arr->offset = off;
+        return (0);
+}
+
+static int
+flat_export(struct error *err, struct arena *a, uint16_t kind, size_t size, uint64_t *body)
+{
+        uint64_t off;
+
+        *a = (struct arena){NULL, 0, 0, false};
+        if (arena_alloc(err, a, 1, sizeof(struct flat_header), &off) < 0)
+                return (-1);
+        *arena_at(a, off, struct flat_header) = (struct flat_header){FLAT_MAGIC, FLAT_VERSION, kind, 0};
+        return (arena_alloc(err, a, 1, size, body));
+}
+
+static int
+flat_check(struct error *err, const void *buf, size_t size, uint16_t kind, size_t body)
+{
+        const struct flat_header *hdr = buf;
+
+        if (buf == NULL || (uintptr_t)buf % FLAT_ALIGN != 0 || size < sizeof(*hdr) + body) {
+                error_setx(err, "invalid flat buffer");
+                return (-1);
+        }
+        if (hdr->magic != FLAT_MAGIC || hdr->version != FLAT_VERSION || hdr->kind != kind || hdr->size != size) {
+                error_setx(err, "unsupported flat buffer");
+                return (-1);
+        }
+        return (0);
+}
+
+static int
+flat_range(struct error *err, size_t size, const struct flat_array *arr, size_t elem)
+{
+        if (arr->count == 0)
+                return (0);
+        if (arr->offset % FLAT_ALIGN != 0 || arr->offset < sizeof(struct flat_header) || arr->offset > size ||
+            arr->count > (size - arr->offset) / elem) {
+                error_setx(err, "invalid flat buffer");
+                return (-1);
+        }
+        return (0);
+}
+
+static int
+flat_get_string(struct error *err, const char *buf, size_t size, uint64_t off, char **str)
+{
+        *str = NULL;
+        if (off == 0)
+                return (0);
+        if (off < sizeof(struct flat_header) || off >= size || memchr(buf + off, '\0', size - off) == NULL) {
+                error_setx(err, "invalid flat buffer");
+                return (-1);
+        }
+        *str = (char *)buf + off;
+        return (0);
+}
+
+static int
+flat_get_strings(struct error *err, struct arena *a, const char *buf, size_t size, const struct flat_array *arr, char ***strs)
+{
+        const uint64_t *offs = (const uint64_t *)(const void *)(buf + arr->offset);
+        uint64_t off;
+
+        *strs = NULL;
+        if (arr->count == 0)
+                return (0);
+        if (arena_alloc(err, a, arr->count, sizeof(char *), &off) < 0)
+                return (-1);
+        *strs = arena_at(a, off, char *);
+        for (size_t i = 0; i < arr->count; ++i) {
+                if (flat_get_string(err, buf, size, offs[i], &(*strs)[i]) < 0)
+                        return (-1);
+        }
+        return (0);
+}
+
+int
+nvc_driver_info_export(struct nvc_context *ctx, const struct nvc_driver_info *info, void **buf, size_t *size)
+{
+        struct arena a;
+        struct flat_driver_info flat = {0};
+        uint64_t body, off, str;
+
+        if (validate_context(ctx) < 0)
+                return (-1);
+        if (validate_args(ctx, info != NULL && buf != NULL && size != NULL) < 0)
+                return (-1);
+
+        if (flat_export(&ctx->err, &a, FLAT_DRIVER_INFO, sizeof(flat), &body) < 0)
+                goto fail;
+        if (flat_string(&ctx->err, &a, info->nvrm_version, &flat.nvrm_version) < 0 ||
+            flat_string(&ctx->err, &a, info->cuda_version, &flat.cuda_version) < 0 ||
+            flat_strings(&ctx->err, &a, info->bins, info->nbins, &flat.bins) < 0 ||
+            flat_strings(&ctx->err, &a, info->libs, info->nlibs, &flat.libs) < 0 ||
+            flat_strings(&ctx->err, &a, info->libs32, info->nlibs32, &flat.libs32) < 0 ||
+            flat_strings(&ctx->err, &a, info->ipcs, info->nipcs, &flat.ipcs) < 0 ||
+            flat_strings(&ctx->err, &a, info->firmwares, info->nfirmwares, &flat.firmwares) < 0)
+                goto fail;
+
+        flat.devs = (struct flat_array){0, info->ndevs};
+        if (info->ndevs > 0 && arena_alloc(&ctx->err, &a, info->ndevs, sizeof(struct flat_device_node), &flat.devs.offset) < 0)
+                goto fail;
+        for (size_t i = 0; i < info->ndevs; ++i) {
+                if (flat_string(&ctx->err, &a, info->devs[i].path, &str) < 0)
+                        goto fail;
+                off = flat.devs.offset + i * sizeof(struct flat_device_node);
+                *arena_at(&a, off, struct flat_device_node) = (struct flat_device_node){str, (uint64_t)info->devs[i].id};
+        }
+
+        *arena_at(&a, body, struct flat_driver_info) = flat;
+        arena_at(&a, 0, struct flat_header)->size = a.used;
+        *buf = a.base;
+        *size = a.used;
+        return (0);
+
+ fail:
+        free(a.base);
+        return (-1);
+}
+
+struct nvc_driver_info *
+nvc_driver_info_import(struct nvc_context *ctx, const void *buf, size_t size)
+{
+        struct driver_info_block *blk = NULL;
+        const struct flat_driver_info *flat;
+        const struct flat_device_node *nodes;
+        struct nvc_driver_info *info;
+        struct arena a;
+        uint64_t off;
+        size_t n;
+
+        if (validate_context(ctx) < 0)
+                return (NULL);
+        if (flat_check(&ctx->err, buf, size, FLAT_DRIVER_INFO, sizeof(*flat)) < 0)
+                return (NULL);
+        flat = (const struct flat_driver_info *)(const void *)((const char *)buf + sizeof(struct flat_header));
+
+        if (flat_range(&ctx->err, size, &flat->bins, sizeof(uint64_t)) < 0 ||
+            flat_range(&ctx->err, size, &flat->libs, sizeof(uint64_t)) < 0 ||
+            flat_range(&ctx->err, size, &flat->libs32, sizeof(uint64_t)) < 0 ||
+            flat_range(&ctx->err, size, &flat->ipcs, sizeof(uint64_t)) < 0 ||
+            flat_range(&ctx->err, size, &flat->firmwares, sizeof(uint64_t)) < 0 ||
+            flat_range(&ctx->err, size, &flat->devs, sizeof(struct flat_device_node)) < 0)
+                return (NULL);
+
+        // The counts are bounded by the buffer size, so the total cannot overflow.
+        n = flat->bins.count + flat->libs.count + flat->libs32.count + flat->ipcs.count + flat->firmwares.count;
+        a = (struct arena){NULL, 0, 0, true};
+        a.size = sizeof(*blk) + FLAT_ALIGN * 6 + n * sizeof(char *) + flat->devs.count * sizeof(struct nvc_device_node);
+        if ((a.base = xcalloc(&ctx->err, 1, a.size)) == NULL)
+                return (NULL);
+        if (arena_alloc(&ctx->err, &a, 1, sizeof(*blk), &off) < 0)
+                goto fail;
+        blk = arena_at(&a, off, struct driver_info_block);
+        blk->flat = true;
+        info = &blk->info;
+
+        if (flat_get_string(&ctx->err, buf, size, flat->nvrm_version, &info->nvrm_version) < 0 ||
+            flat_get_string(&ctx->err, buf, size, flat->cuda_version, &info->cuda_version) < 0 ||
+            flat_get_strings(&ctx->err, &a, buf, size, &flat->bins, &info->bins) < 0 ||
+            flat_get_strings(&ctx->err, &a, buf, size, &flat->libs, &info->libs) < 0 ||
+            flat_get_strings(&ctx->err, &a, buf, size, &flat->libs32, &info->libs32) < 0 ||
+            flat_get_strings(&ctx->err, &a, buf, size, &flat->ipcs, &info->ipcs) < 0 ||
+            flat_get_strings(&ctx->err, &a, buf, size, &flat->firmwares, &info->firmwares) < 0)
+                goto fail;
+        info->nbins = flat->bins.count;
+        info->nlibs = flat->libs.count;
+        info->nlibs32 = flat->libs32.count;
+        info->nipcs = flat->ipcs.count;
+        info->nfirmwares = flat->firmwares.count;
+
+        if (flat->devs.count > 0) {
+                if (arena_alloc(&ctx->err, &a, flat->devs.count, sizeof(*info->devs), &off) < 0)
+                        goto fail;
+                info->devs = arena_at(&a, off, struct nvc_device_node);
+                info->ndevs = flat->devs.count;
+                nodes = (const struct flat_device_node *)(const void *)((const char *)buf + flat->devs.offset);
+                for (size_t i = 0; i < info->ndevs; ++i) {
+                        if (flat_get_string(&ctx->err, buf, size, nodes[i].path, &info->devs[i].path) < 0)
+                                goto fail;
+                        info->devs[i].id = (dev_t)nodes[i].id;
+                }
+        }
+        return (info);
+
+ fail:
+        free(a.base);
+        return (NULL);
+}
+
+int
+nvc_device_info_export(struct nvc_context *ctx, const struct nvc_device_info *info, void **buf, size_t *size)
+{
+        struct arena a;
+        struct flat_device_info flat = {0};
+        struct flat_device gpu;
+        struct flat_mig_device mig;
+        const struct nvc_device *dev;
+        const struct nvc_mig_device *mdev;
+        uint64_t body;
+
+        if (validate_context(ctx) < 0)
+                return (-1);
+        if (validate_args(ctx, info != NULL && buf != NULL && size != NULL) < 0)
+                return (-1);
+
+        if (flat_export(&ctx->err, &a, FLAT_DEVICE_INFO, sizeof(flat), &body) < 0)
+                goto fail;
+        flat.gpus = (struct flat_array){0, info->ngpus};
+        if (info->ngpus > 0 && arena_alloc(&ctx->err, &a, info->ngpus, sizeof(gpu), &flat.gpus.offset) < 0)
+                goto fail;
+
+        for (size_t i = 0; i < info->ngpus; ++i) {
+                dev = &info->gpus[i];
+                gpu = (struct flat_device){0};
+                if (flat_string(&ctx->err, &a, dev->model, &gpu.model) < 0 ||
+                    flat_string(&ctx->err, &a, dev->uuid, &gpu.uuid) < 0 ||
+                    flat_string(&ctx->err, &a, dev->busid, &gpu.busid) < 0 ||
+                    flat_string(&ctx->err, &a, dev->arch, &gpu.arch) < 0 ||
+                    flat_string(&ctx->err, &a, dev->brand, &gpu.brand) < 0 ||
+                    flat_string(&ctx->err, &a, dev->node.path, &gpu.node.path) < 0 ||
+                    flat_string(&ctx->err, &a, dev->mig_caps_path, &gpu.mig_caps_path) < 0)
+                        goto fail;
+                gpu.node.id = (uint64_t)dev->node.id;
+                gpu.mig_capable = dev->mig_capable;
+
+                gpu.mig_devices = (struct flat_array){0, dev->mig_devices.ndevices};
+                if (dev->mig_devices.ndevices > 0 &&
+                    arena_alloc(&ctx->err, &a, dev->mig_devices.ndevices, sizeof(mig), &gpu.mig_devices.offset) < 0)
+                        goto fail;
+                for (size_t j = 0; j < dev->mig_devices.ndevices; ++j) {
+                        mdev = &dev->mig_devices.devices[j];
+                        mig = (struct flat_mig_device){0, mdev->gi, mdev->ci, 0, 0};
+                        if (flat_string(&ctx->err, &a, mdev->uuid, &mig.uuid) < 0 ||
+                            flat_string(&ctx->err, &a, mdev->gi_caps_path, &mig.gi_caps_path) < 0 ||
+                            flat_string(&ctx->err, &a, mdev->ci_caps_path, &mig.ci_caps_path) < 0)
+                                goto fail;
+                        arena_at(&a, gpu.mig_devices.offset, struct flat_mig_device)[j] = mig;
+                }
+                arena_at(&a, flat.gpus.offset, struct flat_device)[i] = gpu;
+        }
+
+        *arena_at(&a, body, struct flat_device_info) = flat;
+        arena_at(&a, 0, struct flat_header)->size = a.used;
+        *buf = a.base;
+        *size = a.used;
+        return (0);
+
+ fail:
+        free(a.base);
+        return (-1);
+}
+
+struct nvc_device_info *
+nvc_device_info_import(struct nvc_context *ctx, const void *buf, size_t size)
+{
+        struct device_info_block *blk = NULL;
+        const struct flat_device_info *flat;
+        const struct flat_device *gpus;
+        const struct flat_mig_device *migs;
+        struct nvc_device_info *info;
+        struct nvc_device *dev;
+        struct nvc_mig_device *mdev;
+        struct arena a;
+        uint64_t off;
+        size_t n = 0;
+
+        if (validate_context(ctx) < 0)
+                return (NULL);
+        if (flat_check(&ctx->err, buf, size, FLAT_DEVICE_INFO, sizeof(*flat)) < 0)
+                return (NULL);
+        flat = (const struct flat_device_info *)(const void *)((const char *)buf + sizeof(struct flat_header));
+        if (flat_range(&ctx->err, size, &flat->gpus, sizeof(*gpus)) < 0)
+                return (NULL);
+        gpus = (const struct flat_device *)(const void *)((const char *)buf + flat->gpus.offset);
+        for (size_t i = 0; i < flat->gpus.count; ++i) {
+                if (flat_range(&ctx->err, size, &gpus[i].mig_devices, sizeof(*migs)) < 0)
+                        return (NULL);
+                n += gpus[i].mig_devices.count;
+        }
+
+        a = (struct arena){NULL, 0, 0, true};
+        a.size = sizeof(*blk) + FLAT_ALIGN * (2 + flat->gpus.count) + flat->gpus.count * sizeof(*dev) + n * sizeof(*mdev);
+        if ((a.base = xcalloc(&ctx->err, 1, a.size)) == NULL)
+                return (NULL);
+        if (arena_alloc(&ctx->err, &a, 1, sizeof(*blk), &off) < 0)
+                goto fail;
+        blk = arena_at(&a, off, struct device_info_block);
+        blk->flat = true;
+        info = &blk->info;
+
+        if (flat->gpus.count > 0) {
+                if (arena_alloc(&ctx->err, &a, flat->gpus.count, sizeof(*dev), &off) < 0)
+                        goto fail;
+                info->gpus = arena_at(&a, off, struct nvc_device);
+                info->ngpus = flat->gpus.count;
+        }
+        for (size_t i = 0; i < info->ngpus; ++i) {
+                dev = &info->gpus[i];
+                if (flat_get_string(&ctx->err, buf, size, gpus[i].model, &dev->model) < 0 ||
+                    flat_get_string(&ctx->err, buf, size, gpus[i].uuid, &dev->uuid) < 0 ||
+                    flat_get_string(&ctx->err, buf, size, gpus[i].busid, &dev->busid) < 0 ||
+                    flat_get_string(&ctx->err, buf, size, gpus[i].arch, &dev->arch) < 0 ||
+                    flat_get_string(&ctx->err, buf, size, gpus[i].brand, &dev->brand) < 0 ||
+                    flat_get_string(&ctx->err, buf, size, gpus[i].node.path, &dev->node.path) < 0 ||
+                    flat_get_string(&ctx->err, buf, size, gpus[i].mig_caps_path, &dev->mig_caps_path) < 0)
+                        goto fail;
+                dev->node.id = (dev_t)gpus[i].node.id;
+                dev->mig_capable = gpus[i].mig_capable != 0;
+
+                if (gpus[i].mig_devices.count == 0)
+                        continue;
+                if (arena_alloc(&ctx->err, &a, gpus[i].mig_devices.count, sizeof(*mdev), &off) < 0)
+                        goto fail;
+                dev->mig_devices.devices = arena_at(&a, off, struct nvc_mig_device);
+                dev->mig_devices.ndevices = gpus[i].mig_devices.count;
+                migs = (const struct flat_mig_device *)(const void *)((const char *)buf + gpus[i].mig_devices.offset);
+                for (size_t j = 0; j < dev->mig_devices.ndevices; ++j) {
+                        mdev = &dev->mig_devices.devices[j];
+                        mdev->parent = dev;
+                        mdev->gi = migs[j].gi;
+                        mdev->ci = migs[j].ci;
+                        if (flat_get_string(&ctx->err, buf, size, migs[j].uuid, &mdev->uuid) < 0 ||
+                            flat_get_string(&ctx->err, buf, size, migs[j].gi_caps_path, &mdev->gi_caps_path) < 0 ||
+                            flat_get_string(&ctx->err, buf, size, migs[j].ci_caps_path, &mdev->ci_caps_path) < 0)
+                                goto fail;
+                }
+        }
+        return (info);
+
+ fail:
+        free(a.base);
+        return (NULL);
+}
@@ -17,8 +17,10 @@
 #include "driver.h"
 #include "elftool.h"
 #include "error.h"
+#include "info_cache.h"
 #include "ldcache.h"
 #include "options.h"
+#include "trace.h"
 #include "utils.h"
 #include "xfuncs.h"
 
@@ -33,18 +35,24 @@
                   nitems(graphics_libs_glvnd) + \
                   nitems(graphics_libs_compat))
 
+/* Container options selecting which driver components are looked up. */
+#define OPT_DRIVER_COMPONENTS (OPT_UTILITY_BINS|OPT_COMPUTE_BINS|OPT_UTILITY_LIBS|OPT_COMPUTE_LIBS| \
+                               OPT_NGX_LIBS|OPT_VIDEO_LIBS|OPT_GRAPHICS_LIBS|OPT_COMPAT32)
+
 static int select_libraries(struct error *, void *, const char *, const char *, const char *);
 static int select_wsl_libraries(struct error *, void *, const char *, const char *, const char *);
-static int find_library_paths(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, const char *, const char * const [], size_t);
+static int find_library_paths(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, const char *, const char * const [], size_t, bool);
 static int find_binary_paths(struct error *, struct dxcore_context*, struct nvc_driver_info *, const char *, const char * const [], size_t);
 static int find_path(struct error *, const char *, const char *, const char *, char **);
-static int lookup_paths(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, int32_t, const char *);
-static int lookup_libraries(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, int32_t, const char *);
-static int lookup_binaries(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, int32_t);
+static int lookup_paths(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, int32_t, int32_t, const char *);
+static int lookup_cached_paths(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, int32_t, int32_t, const char *);
+static int lookup_libraries(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, int32_t, int32_t, const char *);
+static int lookup_binaries(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, int32_t, int32_t);
 static int lookup_firmwares(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, int32_t);
 static int lookup_devices(struct error *, struct dxcore_context *, struct nvc_driver_info *, const char *, int32_t);
-static int lookup_ipcs(struct error *, struct nvc_driver_info *, const char *, int32_t);
-static int fill_mig_device_info(struct nvc_context *, bool mig_enabled, struct driver_device *, struct nvc_device *);
+static int lookup_ipcs(struct error *, struct nvc_driver_info *, const char *, int32_t, int32_t);
+static struct nvc_driver_info *driver_info_new(struct nvc_context *, const char *, int32_t);
+static int fill_mig_device_info(struct nvc_context *, struct driver_device_info *, struct nvc_device *);
 static void clear_mig_device_info(struct nvc_mig_device_info *);
 
 /*
@@ -208,7 +216,7 @@ select_wsl_libraries(struct error *err, void *ptr, const char *root, const char
 
 static int
 find_library_paths(struct error *err, struct dxcore_context *dxcore, struct nvc_driver_info *info,
-                   const char *root, const char *ldcache, const char * const libs[], size_t size)
+                   const char *root, const char *ldcache, const char * const libs[], size_t size, bool compat32)
 {
         char path[PATH_MAX];
         struct ldcache ld;
@@ -226,16 +234,14 @@ find_library_paths(struct error *err, struct dxcore_context *dxcore, struct nvc_
         info->libs = array_new(err, size);
         if (info->libs == NULL)
                 goto fail;
-        if (ldcache_resolve(&ld, LIB_ARCH, root, libs,
-            info->libs, info->nlibs, select_libraries_fn, info) < 0)
-                goto fail;
-
-        info->nlibs32 = size;
-        info->libs32 = array_new(err, size);
-        if (info->libs32 == NULL)
-                goto fail;
-        if (ldcache_resolve(&ld, LIB32_ARCH, root, libs,
-            info->libs32, info->nlibs32, select_libraries_fn, info) < 0)
+        if (compat32) {
+                info->nlibs32 = size;
+                info->libs32 = array_new(err, size);
+                if (info->libs32 == NULL)
+                        goto fail;
+        }
+        if (ldcache_resolve(&ld, (uint32_t[2]){LIB_ARCH, LIB32_ARCH}, (char **[2]){info->libs, info->libs32}, compat32 ? 2 : 1,
+            root, libs, size, select_libraries_fn, info) < 0)
                 goto fail;
         rv = 0;
 
@@ -364,14 +370,16 @@ find_path(struct error *err, const char *tag, const char *root, const char *targ
 }
 
 static int
-lookup_paths(struct error *err, struct dxcore_context *dxcore, struct nvc_driver_info *info, const char *root, int32_t flags, const char *ldcache)
+lookup_paths(struct error *err, struct dxcore_context *dxcore, struct nvc_driver_info *info, const char *root, int32_t flags, int32_t components, const char *ldcache)
 {
-        if (lookup_libraries(err, dxcore, info, root, flags, ldcache) < 0) {
+        trace_func();
+
+        if (lookup_libraries(err, dxcore, info, root, flags, components, ldcache) < 0) {
                 log_err("error looking up libraries");
                 return (-1);
         }
 
-        if (lookup_binaries(err, dxcore, info, root, flags) < 0) {
+        if (lookup_binaries(err, dxcore, info, root, flags, components) < 0) {
                 log_err("error looking up binaries");
                 return (-1);
         }
@@ -386,26 +394,61 @@ lookup_paths(struct error *err, struct dxcore_context *dxcore, struct nvc_driver
         return (0);
 }
 
+// lookup_cached_paths wraps lookup_paths with the on-disk driver cache. The cache is purely an
+// optimization: any error loading or storing it is logged and the regular lookup is used instead.
+static int
+lookup_cached_paths(struct error *err, struct dxcore_context *dxcore, struct nvc_driver_info *info, const char *root, int32_t flags, int32_t components, const char *ldcache)
+{
+        int rv;
+
+        if ((flags & OPT_NO_CACHE) || dxcore->initialized)
+                return (lookup_paths(err, dxcore, info, root, flags, components, ldcache));
+
+        if ((rv = info_cache_load(err, info, root, ldcache, flags, components)) == INFO_CACHE_HIT)
+                return (0);
+        if (rv == INFO_CACHE_ERROR) {
+                log_warnf("failed to load driver cache: %s", err->msg);
+                error_reset(err);
+        }
+
+        if (lookup_paths(err, dxcore, info, root, flags, components, ldcache) < 0)
+                return (-1);
+
+        if (info_cache_store(err, info, root, ldcache, flags, components) < 0) {
+                log_warnf("failed to store driver cache: %s", err->msg);
+                error_reset(err);
+        }
+        return (0);
+}
+
 static int
-lookup_libraries(struct error *err, struct dxcore_context *dxcore, struct nvc_driver_info *info, const char *root, int32_t flags, const char *ldcache)
+lookup_libraries(struct error *err, struct dxcore_context *dxcore, struct nvc_driver_info *info, const char *root, int32_t flags, int32_t components, const char *ldcache)
 {
         const char *libs[MAX_LIBS];
         const char **ptr = libs;
 
-        ptr = array_append(ptr, utility_libs, nitems(utility_libs));
-        ptr = array_append(ptr, compute_libs, nitems(compute_libs));
-        ptr = array_append(ptr, ngx_libs, nitems(ngx_libs));
-        ptr = array_append(ptr, video_libs, nitems(video_libs));
-        ptr = array_append(ptr, graphics_libs, nitems(graphics_libs));
-        if (flags & OPT_NO_GLVND)
-                ptr = array_append(ptr, graphics_libs_compat, nitems(graphics_libs_compat));
-        else
-                ptr = array_append(ptr, graphics_libs_glvnd, nitems(graphics_libs_glvnd));
+        if (components & OPT_UTILITY_LIBS)
+                ptr = array_append(ptr, utility_libs, nitems(utility_libs));
+        if (components & OPT_COMPUTE_LIBS)
+                ptr = array_append(ptr, compute_libs, nitems(compute_libs));
+        if (components & OPT_NGX_LIBS)
+                ptr = array_append(ptr, ngx_libs, nitems(ngx_libs));
+        if (components & OPT_VIDEO_LIBS)
+                ptr = array_append(ptr, video_libs, nitems(video_libs));
+        if (components & OPT_GRAPHICS_LIBS) {
+                ptr = array_append(ptr, graphics_libs, nitems(graphics_libs));
+                if (flags & OPT_NO_GLVND)
+                        ptr = array_append(ptr, graphics_libs_compat, nitems(graphics_libs_compat));
+                else
+                        ptr = array_append(ptr, graphics_libs_glvnd, nitems(graphics_libs_glvnd));
+        }
 
         if (dxcore->initialized)
                 ptr = array_append(ptr, dxcore_libs, nitems(dxcore_libs));
 
-        if (find_library_paths(err, dxcore, info, root, ldcache, libs, (size_t)(ptr - libs)) < 0)
+        if (ptr == libs)
+                return (0);
+        if (find_library_paths(err, dxcore, info, root, ldcache, libs, (size_t)(ptr - libs), components & OPT_COMPAT32) < 0)
                 return (-1);
 
         for (size_t i = 0; info->libs != NULL && i < info->nlibs; ++i) {
@@ -422,15 +465,18 @@ lookup_libraries(struct error *err, struct dxcore_context *dxcore, struct nvc_dr
 }
 
 static int
-lookup_binaries(struct error *err, struct dxcore_context* dxcore, struct nvc_driver_info *info, const char *root, int32_t flags)
+lookup_binaries(struct error *err, struct dxcore_context* dxcore, struct nvc_driver_info *info, const char *root, int32_t flags, int32_t components)
 {
         const char *bins[MAX_BINS];
         const char **ptr = bins;
 
-        ptr = array_append(ptr, utility_bins, nitems(utility_bins));
-        if (!(flags & OPT_NO_MPS))
+        if (components & OPT_UTILITY_BINS)
+                ptr = array_append(ptr, utility_bins, nitems(utility_bins));
+        if ((components & OPT_COMPUTE_BINS) && !(flags & OPT_NO_MPS))
                 ptr = array_append(ptr, compute_bins, nitems(compute_bins));
 
+        if (ptr == bins)
+                return (0);
         if (find_binary_paths(err, dxcore, info, root, bins, (size_t)(ptr - bins)) < 0)
                 return (-1);
 
@@ -574,7 +620,7 @@ lookup_devices(struct error *err, struct dxcore_context *dxcore, struct nvc_driv
 }
 
 static int
-lookup_ipcs(struct error *err, struct nvc_driver_info *info, const char *root, int32_t flags)
+lookup_ipcs(struct error *err, struct nvc_driver_info *info, const char *root, int32_t flags, int32_t components)
 {
         char **ptr;
         const char *mps;
@@ -584,15 +630,15 @@ lookup_ipcs(struct error *err, struct nvc_driver_info *info, const char *root, i
         if (info->ipcs == NULL)
                 return (-1);
 
-        if (!(flags & OPT_NO_PERSISTENCED)) {
+        if (!(flags & OPT_NO_PERSISTENCED) && (components & OPT_UTILITY_LIBS)) {
                 if (find_path(err, "ipc", root, NV_PERSISTENCED_SOCKET, ptr++) < 0)
                         return (-1);
         }
-        if (!(flags & OPT_NO_FABRICMANAGER)) {
+        if (!(flags & OPT_NO_FABRICMANAGER) && (components & OPT_UTILITY_LIBS)) {
                 if (find_path(err, "ipc", root, NV_FABRICMANAGER_SOCKET, ptr++) < 0)
                         return (-1);
         }
-        if (!(flags & OPT_NO_MPS)) {
+        if (!(flags & OPT_NO_MPS) && (components & OPT_COMPUTE_LIBS)) {
                 if ((mps = secure_getenv("CUDA_MPS_PIPE_DIRECTORY")) == NULL)
                         mps = NV_MPS_PIPE_DIR;
                 if (find_path(err, "ipc", root, mps, ptr++) < 0)
@@ -603,57 +649,43 @@ lookup_ipcs(struct error *err, struct nvc_driver_info *info, const char *root, i
 }
 
 static int
-fill_mig_device_info(struct nvc_context *ctx, bool mig_enabled, struct driver_device *drv_device, struct nvc_device *device)
+fill_mig_device_info(struct nvc_context *ctx, struct driver_device_info *drv_device, struct nvc_device *device)
 {
         // Initialize local variables.
         struct nvc_mig_device_info *info = &device->mig_devices;
-        struct driver_device *mig_device;
-        unsigned int count = 0;
+        struct driver_mig_device_info *mig_device;
 
         // Clear out the 'gpu_instance_info' struct embedded in the device.
         memset(info, 0, sizeof(*info));
 
         // If MIG is not enabled, we have nothing more to do, so exit.
-        if (!mig_enabled)
+        if (!drv_device->mig_enabled)
             return 0;
 
-        // Otherwise, get the max count of MIG devices for the given device
-        // from the driver.
-        if (driver_get_device_max_mig_device_count(&ctx->err, drv_device, &count) < 0)
-                goto fail;
-
-        // Allocate space in 'devices' to hold all of the MIG devices.
-        if ((info->devices = xcalloc(&ctx->err, count, sizeof(struct nvc_mig_device))) == NULL)
+        // Allocate space in 'devices' to hold all of the MIG devices
+        // reported by the driver.
+        if ((info->devices = xcalloc(&ctx->err, drv_device->nmig_devices, sizeof(struct nvc_mig_device))) == NULL)
                 goto fail;
 
         // Populate 'mig_device_info' with information about the MIG devices
         // pulled from the driver.
-        for (unsigned int i = 0; i < count; ++i) {
-                // Get a reference to the MIG device at this index.
-                if (driver_get_device_mig_device(&ctx->err, drv_device, i, &mig_device) < 0)
-                        goto fail;
+        for (size_t i = 0; i < drv_device->nmig_devices; ++i) {
+                mig_device = &drv_device->mig_devices[i];
 
-               // If no MIG device exists at this index, then we are done. Due
-               // to races, there may (temporarily) be more devices further on
-               // in the list, but we won't detect them.
-               if (mig_device == NULL)
-                        break;
-
-                // Get the ID of the GPU Instance for this MIG device from the driver.
-                if (driver_get_device_gpu_instance_id(&ctx->err, mig_device, &info->devices[i].gi) < 0)
-                        goto fail;
-
-                // Get the ID of the Compute Instance for this MIG device from the driver.
-                if (driver_get_device_compute_instance_id(&ctx->err, mig_device, &info->devices[i].ci) < 0)
-                        goto fail;
+                // Set the IDs of the GPU Instance and Compute Instance for this MIG device.
+                info->devices[i].gi = mig_device->gi;
+                info->devices[i].ci = mig_device->ci;
 
                 // Set a reference back to the device associated with the
                 // current MIG device.
                 info->devices[i].parent = device;
 
-                // Populate the UUID of the MIG device.
-                if (driver_get_device_uuid(&ctx->err, mig_device, &info->devices[i].uuid) < 0)
-                        goto fail;
+                // Take over the UUID of the MIG device.
+                info->devices[i].uuid = mig_device->uuid;
+                mig_device->uuid = NULL;
+
+                // If we made it to here, update the total count of MIG devices by 1
+                info->ndevices++;
 
                 // Build a path to the MIG caps inside '/proc' associated
                 // with GPU Instance of the MIG device and set it inside
@@ -666,9 +698,6 @@ fill_mig_device_info(struct nvc_context *ctx, bool mig_enabled, struct driver_de
                 // inside 'info->devices[i]'.
                 if (xasprintf(&ctx->err, &info->devices[i].ci_caps_path, NV_COMP_INST_CAPS_PATH, minor(device->node.id), info->devices[i].gi, info->devices[i].ci) < 0)
                         goto fail;
-
-                // If we made it to here, update the total count of MIG devices by 1
-                info->ndevices++;
         }
 
         return (0);
@@ -703,30 +732,22 @@ clear_mig_device_info(struct nvc_mig_device_info *info)
 }
 
 static int
-init_nvc_device(struct nvc_context *ctx, unsigned int index, struct nvc_device *gpu)
+init_nvc_device(struct nvc_context *ctx, unsigned int index, struct driver_device_info *dev, struct nvc_device *gpu)
 {
-        struct driver_device *dev;
         struct error *err = &ctx->err;
-        bool mig_enabled;
-        unsigned int minor;
 
-        if (driver_get_device(err, index, &dev) < 0)
-                goto fail;
-        if (driver_get_device_model(err, dev, &gpu->model) < 0)
-                goto fail;
-        if (driver_get_device_uuid(err, dev, &gpu->uuid) < 0)
-                goto fail;
-        if (driver_get_device_busid(err, dev, &gpu->busid) < 0)
-                goto fail;
-        if (driver_get_device_arch(err, dev, &gpu->arch) < 0)
-                goto fail;
-        if (driver_get_device_brand(err, dev, &gpu->brand) < 0)
-                goto fail;
+        // Take over the attributes gathered by the driver.
+        gpu->model = dev->model;
+        gpu->uuid = dev->uuid;
+        gpu->busid = dev->busid;
+        gpu->arch = dev->arch;
+        gpu->brand = dev->brand;
+        dev->model = dev->uuid = dev->busid = dev->arch = dev->brand = NULL;
+
         if (ctx->dxcore.initialized)
         {
                 // No Device associated to a WSL GPU. Everything uses /dev/dxg
                 gpu->node.path = NULL;
-                minor = 0;
 
                 // No MIG support for WSL
                 gpu->mig_capable = 0;
@@ -738,19 +759,14 @@ init_nvc_device(struct nvc_context *ctx, unsigned int index, struct nvc_device *
         }
         else
         {
-                if (driver_get_device_minor(err, dev, &minor) < 0)
-                        goto fail;
-                if (xasprintf(err, &gpu->mig_caps_path, NV_GPU_CAPS_PATH, minor) < 0)
+                if (xasprintf(err, &gpu->mig_caps_path, NV_GPU_CAPS_PATH, dev->minor) < 0)
                         goto fail;
-                if (xasprintf(err, &gpu->node.path, NV_DEVICE_PATH, minor) < 0)
+                if (xasprintf(err, &gpu->node.path, NV_DEVICE_PATH, dev->minor) < 0)
                         goto fail;
-                if (driver_get_device_mig_capable(err, dev, &gpu->mig_capable) < 0)
-                        goto fail;
-                if (driver_get_device_mig_enabled(err, dev, &mig_enabled) < 0)
-                        goto fail;
-                gpu->node.id = makedev(NV_DEVICE_MAJOR, minor);
+                gpu->mig_capable = dev->mig_capable;
+                gpu->node.id = makedev(NV_DEVICE_MAJOR, dev->minor);
 
-                if (fill_mig_device_info(ctx, mig_enabled, dev, gpu) < 0)
+                if (fill_mig_device_info(ctx, dev, gpu) < 0)
                     goto fail;
 
                 log_infof("listing device %s (%s at %s)", gpu->node.path, gpu->uuid, gpu->busid);
@@ -793,32 +809,30 @@ match_library_flags(const char *lib, int32_t flags)
         return (false);
 }
 
-struct nvc_driver_info *
-nvc_driver_info_new(struct nvc_context *ctx, const char *opts)
+static struct nvc_driver_info *
+driver_info_new(struct nvc_context *ctx, const char *opts, int32_t components)
 {
         struct nvc_driver_info *info;
         int32_t flags;
 
-        if (validate_context(ctx) < 0)
-                return (NULL);
         if (opts == NULL)
                 opts = default_driver_opts;
         if ((flags = options_parse(&ctx->err, opts, driver_opts, nitems(driver_opts))) < 0)
                 return (NULL);
 
         log_infof("requesting driver information with '%s'", opts);
-        if ((info = xcalloc(&ctx->err, 1, sizeof(*info))) == NULL)
+        if ((info = xcalloc(&ctx->err, 1, sizeof(struct driver_info_block))) == NULL)
                 return (NULL);
 
-        if (driver_get_rm_version(&ctx->err, &info->nvrm_version) < 0)
+        if (driver_get_rm_version(&ctx->err, ctx->driver, &info->nvrm_version) < 0)
                 goto fail;
-        if (driver_get_cuda_version(&ctx->err, &info->cuda_version) < 0)
+        if (driver_get_cuda_version(&ctx->err, ctx->driver, &info->cuda_version) < 0)
                 goto fail;
-        if (lookup_paths(&ctx->err, &ctx->dxcore, info, ctx->cfg.root, flags, ctx->cfg.ldcache) < 0)
+        if (lookup_cached_paths(&ctx->err, &ctx->dxcore, info, ctx->cfg.root, flags, components, ctx->cfg.ldcache) < 0)
                 goto fail;
         if (lookup_devices(&ctx->err, &ctx->dxcore, info, ctx->cfg.root, flags) < 0)
                 goto fail;
-        if (lookup_ipcs(&ctx->err, info, ctx->cfg.root, flags) < 0)
+        if (lookup_ipcs(&ctx->err, info, ctx->cfg.root, flags, components) < 0)
                 goto fail;
         return (info);
 
@@ -827,11 +841,35 @@ nvc_driver_info_new(struct nvc_context *ctx, const char *opts)
         return (NULL);
 }
 
+struct nvc_driver_info *
+nvc_driver_info_new(struct nvc_context *ctx, const char *opts)
+{
+        if (validate_context(ctx) < 0)
+                return (NULL);
+        return (driver_info_new(ctx, opts, OPT_DRIVER_COMPONENTS));
+}
+
+// nvc_driver_info_new_for only looks up the driver components that nvc_driver_mount would mount in
+// the given container, skipping the libraries and binaries excluded by its capabilities.
+struct nvc_driver_info *
+nvc_driver_info_new_for(struct nvc_context *ctx, const struct nvc_container *cnt, const char *opts)
+{
+        if (validate_context(ctx) < 0)
+                return (NULL);
+        if (validate_args(ctx, cnt != NULL) < 0)
+                return (NULL);
+        return (driver_info_new(ctx, opts, cnt->flags & OPT_DRIVER_COMPONENTS));
+}
+
 void
 nvc_driver_info_free(struct nvc_driver_info *info)
 {
         if (info == NULL)
                 return;
+        if (((struct driver_info_block *)info)->flat) {
+                free(info);
+                return;
+        }
         free(info->nvrm_version);
         free(info->cuda_version);
         array_free(info->bins, info->nbins);
@@ -848,7 +886,8 @@ nvc_device_info_new(struct nvc_context *ctx, const char *opts)
 {
         struct nvc_device_info *info;
         struct nvc_device *gpu;
-        unsigned int n;
+        struct driver_device_info *devs = NULL;
+        size_t n = 0;
         int rv = -1;
 
         /*int32_t flags;*/
@@ -863,10 +902,11 @@ nvc_device_info_new(struct nvc_context *ctx, const char *opts)
         */
 
         log_infof("requesting device information with '%s'", opts);
-        if ((info = xcalloc(&ctx->err, 1, sizeof(*info))) == NULL)
+        if ((info = xcalloc(&ctx->err, 1, sizeof(struct device_info_block))) == NULL)
                 return (NULL);
 
-        if (driver_get_device_count(&ctx->err, &n) < 0)
+        // Gather the whole device tree from the driver in a single call.
+        if (driver_get_device_info(&ctx->err, ctx->driver, !ctx->dxcore.initialized, &devs, &n) < 0)
             goto fail;
 
         info->ngpus = n;
@@ -875,13 +915,15 @@ nvc_device_info_new(struct nvc_context *ctx, const char *opts)
                 goto fail;
 
         for (unsigned int i = 0; i < n; ++i, ++gpu) {
-                rv = init_nvc_device(ctx, i, gpu);
+                rv = init_nvc_device(ctx, i, &devs[i], gpu);
                 if (rv < 0) goto fail;
         }
 
+        driver_device_info_free(devs, n);
         return (info);
 
  fail:
+        driver_device_info_free(devs, n);
         nvc_device_info_free(info);
         return (NULL);
 }
@@ -891,6 +933,10 @@ nvc_device_info_free(struct nvc_device_info *info)
 {
         if (info == NULL)
                 return;
+        if (((struct device_info_block *)info)->flat) {
+                free(info);
+                return;
+        }
         for (size_t i = 0; info->gpus != NULL && i < info->ngpus; ++i) {
                 free(info->gpus[i].model);
                 free(info->gpus[i].uuid);
@@ -6,6 +6,7 @@
 #define HEADER_NVC_INTERNAL_H
 
 #include <sys/capability.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 
 #include <paths.h>
@@ -20,6 +21,7 @@
 #include "driver.h"
 #include "error.h"
 #include "ldcache.h"
+#include "mig_minors.h"
 #include "utils.h"
 #include "dxcore.h"
 
@@ -41,6 +43,7 @@
 #define NV_CAPS_IMEX_DEVICE_PATH NV_CAPS_IMEX_DEVICE_DIR "/channel%d"
 #define NV_PERSISTENCED_SOCKET   _PATH_VARRUN "nvidia-persistenced/socket"
 #define NV_FABRICMANAGER_SOCKET  _PATH_VARRUN "nvidia-fabricmanager/socket"
+#define NV_DRIVER_SOCKET         _PATH_VARRUN "nvidia-container/driver.sock"
 #define NV_MPS_PIPE_DIR          _PATH_TMP "nvidia-mps"
 #define NV_PROC_DRIVER           "/proc/driver/nvidia"
 #define NV_CAPS_PROC_DRIVER      "/proc/driver/nvidia-caps"
@@ -65,6 +68,8 @@
 
 #define MSFT_DXG_DEVICE_PATH     _PATH_DEV "dxg"
 
+struct nvcgo;
+
 struct nvc_context {
         bool initialized;
         struct error err;
@@ -72,6 +77,34 @@ struct nvc_context {
         int mnt_ns;
         bool no_pivot;
         struct dxcore_context dxcore;
+        struct driver *driver;
+        struct nvcgo *nvcgo;
+        struct mig_minors mig_minors;
+        struct {
+                int fd;
+                struct stat st;
+                bool used;
+        } ldconfig;
+};
+
+struct device_cgroup {
+        dev_t *devs;
+        size_t ndevs;
+        size_t size;
+};
+
+/*
+ * Info structures are allocated within these blocks so that those imported from a flat buffer (see nvc_flat.c),
+ * which live in a single allocation, can be told apart when they are freed.
+ */
+struct driver_info_block {
+        struct nvc_driver_info info;
+        bool flat;
+};
+
+struct device_info_block {
+        struct nvc_device_info info;
+        bool flat;
 };
 
 struct nvc_container {
@@ -82,6 +115,7 @@ struct nvc_container {
         char *mnt_ns;
         int dev_cg_version;
         char *dev_cg;
+        struct device_cgroup *dev_cg_rules;
         char **libs;
         size_t nlibs;
         char *cuda_compat_dir;
@@ -98,12 +132,12 @@ enum {
 };
 
 static const cap_value_t pcaps[] = {
-        CAP_CHOWN,           /* kmods */
+        CAP_CHOWN,           /* kmods, mknod-devices */
         CAP_DAC_OVERRIDE,    /* rhel userns, cgroups */
         CAP_DAC_READ_SEARCH, /* userns */
         CAP_FOWNER,          /* kmods */
         CAP_KILL,            /* privsep */
-        CAP_MKNOD,           /* kmods */
+        CAP_MKNOD,           /* kmods, mknod-devices */
         CAP_NET_ADMIN,       /* bpf_prog_query */
         CAP_SETGID,          /* privsep, userns */
         CAP_SETPCAP,         /* bounds, userns */
@@ -126,7 +160,8 @@ static const cap_value_t ecaps[][nitems(pcaps) + 1] = {
         [NVC_INFO]       = {CAP_KILL, -1},
 
         [NVC_MOUNT]      = {CAP_KILL, CAP_NET_ADMIN, CAP_SETUID, CAP_SETGID, CAP_SYS_CHROOT,
-                            CAP_SYS_ADMIN, CAP_DAC_READ_SEARCH, CAP_SYS_PTRACE, CAP_DAC_OVERRIDE, -1},
+                            CAP_SYS_ADMIN, CAP_DAC_READ_SEARCH, CAP_SYS_PTRACE, CAP_DAC_OVERRIDE,
+                            CAP_CHOWN, CAP_MKNOD, -1},
 
         [NVC_LDCACHE]    = {CAP_KILL, CAP_SETUID, CAP_SETGID, CAP_SYS_CHROOT,
                             CAP_SYS_ADMIN, CAP_DAC_READ_SEARCH, CAP_SYS_PTRACE, CAP_SETPCAP, -1},
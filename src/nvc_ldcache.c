@@ -2,6 +2,9 @@
  * Copyright (c) 2017-2018, NVIDIA CORPORATION. All rights reserved.
  */
 
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
 #include <linux/securebits.h>
 #include <linux/types.h>
 
@@ -14,26 +17,89 @@
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/wait.h>
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <paths.h>
 #include <sched.h>
+#include <stddef.h>
 #ifdef WITH_SECCOMP
 #include <seccomp.h>
 #endif /* WITH_SECCOMP */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "nvc_internal.h"
 
+#include "elftool.h"
 #include "error.h"
+#include "info_cache.h"
+#include "ldcache.h"
 #include "options.h"
+#include "trace.h"
 #include "utils.h"
 #include "xfuncs.h"
 
+#define LDCONFIG_CACHE "/etc/ld.so.cache"
+
+#define RECORD_DIR      NVC_CACHE_DIR "/ldcache"
+#define RECORD_MAGIC    "nvc-ldcache 2"
+#define RECORD_MAX_SIZE (16 * 1024 * 1024)
+#define RECORD_DIR_SIZE (128 * 1024 * 1024)
+
+/* The precompiled syscall filter only stands in for the libseccomp rules, builds without seccomp don't filter. */
+#ifdef WITH_SECCOMP
+# if defined(__x86_64__)
+#  define FILTER_AUDIT_ARCH AUDIT_ARCH_X86_64
+# elif defined(__aarch64__)
+#  define FILTER_AUDIT_ARCH AUDIT_ARCH_AARCH64
+# elif defined(__powerpc64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define FILTER_AUDIT_ARCH AUDIT_ARCH_PPC64LE
+# endif
+#endif /* WITH_SECCOMP */
+
+#ifndef __X32_SYSCALL_BIT
+# define __X32_SYSCALL_BIT 0x40000000
+#endif
+
+/*
+ * Records of the ldcache store hold the inputs of an update (a description of the library directories built from
+ * their listing and file attributes only, and the original container cache) followed by its outcome (the soname
+ * links to create and the resulting cache). They are named after a hash of the inputs, which are compared in full
+ * on lookup, so that containers started from the same image can reuse the outcome without inspecting any library.
+ * Only results computed by update_ldcache are recorded: the output of ldconfig depends on the whole container
+ * filesystem and is produced by a binary which might come from the container.
+ */
+struct record_header {
+        char magic[sizeof(RECORD_MAGIC)];
+        uint32_t key_size;
+        uint32_t cache_size;
+        uint32_t links_size;
+        uint32_t result_size;
+};
+
+/* Outcome of lookup_record, a miss is not an error. */
+enum {
+        RECORD_ERROR = -1,
+        RECORD_MISS  = 0,
+        RECORD_HIT   = 1,
+};
+
+struct library {
+        const char *dir;
+        char *name;
+        char *soname;
+        int32_t flags;
+        bool is_link;
+};
+
 static inline bool secure_mode(void);
 static pid_t create_process(struct error *, int);
 static int   change_rootfs(struct error *, const char *, bool, bool, uid_t, gid_t, bool *);
@@ -41,8 +107,34 @@ static int   adjust_capabilities(struct error *, uid_t, bool);
 static int   adjust_privileges(struct error *, uid_t, gid_t, bool);
 static int   limit_resources(struct error *);
 static int   limit_syscalls(struct error *);
+#ifdef FILTER_AUDIT_ARCH
+static int   load_syscall_filter(void);
+#endif /* FILTER_AUDIT_ARCH */
+#ifdef WITH_SECCOMP
+static int   load_seccomp_rules(struct error *);
+#endif /* WITH_SECCOMP */
 static ssize_t   sendfile_nointr(int, int, off_t *, size_t);
-static int       open_as_memfd(struct error *, const char *);
+static int       open_as_memfd(struct error *, int);
+static int       open_host_ldconfig(struct nvc_context *, const char *, bool *);
+static bool  is_library_name(const char *);
+static int   library_rank(bool, const char *, const char *);
+static int   add_library(struct error *, struct library **, size_t *, const char *, const char *);
+static int   scan_libraries(struct error *, const char *, struct library **, size_t *);
+static int   link_library(struct error *, const char *, const char *, const char *);
+static bool  has_library(const struct library *, size_t, const char *, int32_t);
+static uint64_t record_hash(const void *, size_t, const void *, size_t);
+static int   library_filter(const struct dirent *);
+static int   describe_libraries(struct error *, const char * const [], size_t, char **, size_t *);
+static int   apply_links(struct error *, const char *, size_t);
+static int   lookup_record(struct error *, int, const char *, size_t, const void *, size_t);
+static int   send_record(struct error *, int, const char *, size_t, const void *, size_t, const char *, size_t);
+static int   open_record_store(struct error *);
+static int   receive_record(struct error *, int, char **, size_t *);
+static int   store_record(struct error *, int, const char *, size_t);
+static int   compare_records(const void *, const void *);
+static int   prune_records(struct error *, int, const char *);
+static int   update_ldcache(struct error *, const char * const [], size_t, int, int);
+static int   reap_process(struct error *, pid_t, const char *);
 int memfd_create(const char *, unsigned int);
 
 
@@ -261,85 +353,240 @@ limit_resources(struct error *err)
         return (-1);
 }
 
+/*
+ * Syscalls allowed in the ldconfig sandbox, any other fails with EPERM. Both the precompiled filter and the libseccomp
+ * rules are generated from this list. SYSCALL_OPT marks the syscalls which don't exist on every architecture,
+ * their number is -1 where they don't (see below) and they are left out.
+ */
+#define SANDBOX_SYSCALLS(SYSCALL, SYSCALL_OPT) \
+        SYSCALL_OPT(access)                    \
+        SYSCALL_OPT(arch_prctl)                \
+        SYSCALL(brk)                           \
+        SYSCALL(chdir)                         \
+        SYSCALL_OPT(chmod)                     \
+        SYSCALL(clock_gettime)                 \
+        SYSCALL(close)                         \
+        SYSCALL(execve)                        \
+        SYSCALL_OPT(execveat)                  \
+        SYSCALL(exit)                          \
+        SYSCALL(exit_group)                    \
+        SYSCALL(fcntl)                         \
+        SYSCALL(fdatasync)                     \
+        SYSCALL(fstat)                         \
+        SYSCALL(fsync)                         \
+        SYSCALL(ftruncate)                     \
+        SYSCALL(getcwd)                        \
+        SYSCALL_OPT(getdents)                  \
+        SYSCALL(getdents64)                    \
+        SYSCALL(getegid)                       \
+        SYSCALL(geteuid)                       \
+        SYSCALL(getgid)                        \
+        SYSCALL_OPT(getpgrp)                   \
+        SYSCALL(getpid)                        \
+        SYSCALL(gettid)                        \
+        SYSCALL(gettimeofday)                  \
+        SYSCALL(getuid)                        \
+        SYSCALL_OPT(_llseek)                   \
+        SYSCALL(lseek)                         \
+        SYSCALL_OPT(lstat)                     \
+        SYSCALL_OPT(memfd_create)              \
+        SYSCALL_OPT(mkdir)                     \
+        SYSCALL(mmap)                          \
+        SYSCALL(mprotect)                      \
+        SYSCALL(mremap)                        \
+        SYSCALL(munmap)                        \
+        SYSCALL_OPT(newfstatat)                \
+        SYSCALL_OPT(open)                      \
+        SYSCALL(openat)                        \
+        SYSCALL(pread64)                       \
+        SYSCALL(read)                          \
+        SYSCALL_OPT(readlink)                  \
+        SYSCALL(readv)                         \
+        SYSCALL_OPT(rename)                    \
+        SYSCALL(rt_sigaction)                  \
+        SYSCALL(rt_sigprocmask)                \
+        SYSCALL(rt_sigreturn)                  \
+        SYSCALL(sendfile)                      \
+        SYSCALL_OPT(stat)                      \
+        SYSCALL_OPT(symlink)                   \
+        SYSCALL(tgkill)                        \
+        SYSCALL_OPT(time)                      \
+        SYSCALL(uname)                         \
+        SYSCALL_OPT(unlink)                    \
+        SYSCALL(write)                         \
+        SYSCALL(writev)                        \
+        SANDBOX_SYSCALLS_ARCH(SYSCALL)
+
+#if defined(__aarch64__)
+#define SANDBOX_SYSCALLS_ARCH(SYSCALL) \
+        SYSCALL(mkdirat)               \
+        SYSCALL(unlinkat)              \
+        SYSCALL(readlinkat)            \
+        SYSCALL(faccessat)             \
+        SYSCALL(symlinkat)             \
+        SYSCALL(fchmodat)              \
+        SYSCALL(renameat)
+#else
+#define SANDBOX_SYSCALLS_ARCH(SYSCALL)
+#endif
+
+#define SYSCALL_NR(name)     SYS_##name
+#define SYSCALL_OPT_NR(name) NR_OPT_##name
+
+#ifdef SYS_access
+# define NR_OPT_access SYS_access
+#else
+# define NR_OPT_access -1
+#endif
+#ifdef SYS_arch_prctl
+# define NR_OPT_arch_prctl SYS_arch_prctl
+#else
+# define NR_OPT_arch_prctl -1
+#endif
+#ifdef SYS_chmod
+# define NR_OPT_chmod SYS_chmod
+#else
+# define NR_OPT_chmod -1
+#endif
+#ifdef SYS_execveat
+# define NR_OPT_execveat SYS_execveat
+#else
+# define NR_OPT_execveat -1
+#endif
+#ifdef SYS_getdents
+# define NR_OPT_getdents SYS_getdents
+#else
+# define NR_OPT_getdents -1
+#endif
+#ifdef SYS_getpgrp
+# define NR_OPT_getpgrp SYS_getpgrp
+#else
+# define NR_OPT_getpgrp -1
+#endif
+#ifdef SYS__llseek
+# define NR_OPT__llseek SYS__llseek
+#else
+# define NR_OPT__llseek -1
+#endif
+#ifdef SYS_lstat
+# define NR_OPT_lstat SYS_lstat
+#else
+# define NR_OPT_lstat -1
+#endif
+#ifdef SYS_memfd_create
+# define NR_OPT_memfd_create SYS_memfd_create
+#else
+# define NR_OPT_memfd_create -1
+#endif
+#ifdef SYS_mkdir
+# define NR_OPT_mkdir SYS_mkdir
+#else
+# define NR_OPT_mkdir -1
+#endif
+#ifdef SYS_newfstatat
+# define NR_OPT_newfstatat SYS_newfstatat
+#else
+# define NR_OPT_newfstatat -1
+#endif
+#ifdef SYS_open
+# define NR_OPT_open SYS_open
+#else
+# define NR_OPT_open -1
+#endif
+#ifdef SYS_readlink
+# define NR_OPT_readlink SYS_readlink
+#else
+# define NR_OPT_readlink -1
+#endif
+#ifdef SYS_rename
+# define NR_OPT_rename SYS_rename
+#else
+# define NR_OPT_rename -1
+#endif
+#ifdef SYS_stat
+# define NR_OPT_stat SYS_stat
+#else
+# define NR_OPT_stat -1
+#endif
+#ifdef SYS_symlink
+# define NR_OPT_symlink SYS_symlink
+#else
+# define NR_OPT_symlink -1
+#endif
+#ifdef SYS_time
+# define NR_OPT_time SYS_time
+#else
+# define NR_OPT_time -1
+#endif
+#ifdef SYS_unlink
+# define NR_OPT_unlink SYS_unlink
+#else
+# define NR_OPT_unlink -1
+#endif
+
+#ifdef FILTER_AUDIT_ARCH
+/* A syscall missing from the architecture (nr < 0) jumps over its allow statement either way. */
+#define ALLOW_SYSCALL(nr) \
+        BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, (uint32_t)(nr), ((nr) < 0), 1), \
+        BPF_STMT(BPF_RET|BPF_K, SECCOMP_RET_ALLOW),
+#define ALLOW_SYSCALL_NAME(name)     ALLOW_SYSCALL(SYSCALL_NR(name))
+#define ALLOW_SYSCALL_OPT_NAME(name) ALLOW_SYSCALL(SYSCALL_OPT_NR(name))
+
+/*
+ * Precompiled equivalent of the libseccomp rules below for the architecture we are built for.
+ * The program is fixed at compile time from the syscall numbers of the target, which saves generating and
+ * loading it through libseccomp every time ldconfig runs.
+ */
+static const struct sock_filter syscall_filter[] = {
+        BPF_STMT(BPF_LD|BPF_W|BPF_ABS, offsetof(struct seccomp_data, arch)),
+        BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, FILTER_AUDIT_ARCH, 1, 0),
+        BPF_STMT(BPF_RET|BPF_K, SECCOMP_RET_KILL),
+        BPF_STMT(BPF_LD|BPF_W|BPF_ABS, offsetof(struct seccomp_data, nr)),
+#if defined(__x86_64__)
+        BPF_JUMP(BPF_JMP|BPF_JGE|BPF_K, __X32_SYSCALL_BIT, 0, 1),
+        BPF_STMT(BPF_RET|BPF_K, SECCOMP_RET_KILL),
+#endif
+        SANDBOX_SYSCALLS(ALLOW_SYSCALL_NAME, ALLOW_SYSCALL_OPT_NAME)
+        BPF_STMT(BPF_RET|BPF_K, SECCOMP_RET_ERRNO|(EPERM & SECCOMP_RET_DATA)),
+};
+
+#undef ALLOW_SYSCALL_OPT_NAME
+#undef ALLOW_SYSCALL_NAME
+#undef ALLOW_SYSCALL
+
+static int
+load_syscall_filter(void)
+{
+        struct sock_fprog prog = {
+                .len = (unsigned short)nitems(syscall_filter),
+                .filter = (struct sock_filter *)syscall_filter,
+        };
+
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0)
+                return (-1);
+        return (prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog, 0, 0));
+}
+#endif /* FILTER_AUDIT_ARCH */
+
 #ifdef WITH_SECCOMP
+#define SYSCALL_ENTRY(name)     SYSCALL_NR(name),
+#define SYSCALL_OPT_ENTRY(name) SYSCALL_OPT_NR(name),
+
 static int
-limit_syscalls(struct error *err)
+load_seccomp_rules(struct error *err)
 {
         scmp_filter_ctx ctx;
-        int syscalls[] = {
-                SCMP_SYS(access),
-                SCMP_SYS(arch_prctl),
-                SCMP_SYS(brk),
-                SCMP_SYS(chdir),
-                SCMP_SYS(chmod),
-                SCMP_SYS(clock_gettime),
-                SCMP_SYS(close),
-                SCMP_SYS(execve),
-                SCMP_SYS(execveat),
-                SCMP_SYS(exit),
-                SCMP_SYS(exit_group),
-                SCMP_SYS(fcntl),
-                SCMP_SYS(fdatasync),
-                SCMP_SYS(fstat),
-                SCMP_SYS(fsync),
-                SCMP_SYS(ftruncate),
-                SCMP_SYS(getcwd),
-                SCMP_SYS(getdents),
-                SCMP_SYS(getdents64),
-                SCMP_SYS(getegid),
-                SCMP_SYS(geteuid),
-                SCMP_SYS(getgid),
-                SCMP_SYS(getpgrp),
-                SCMP_SYS(getpid),
-                SCMP_SYS(gettid),
-                SCMP_SYS(gettimeofday),
-                SCMP_SYS(getuid),
-                SCMP_SYS(_llseek),
-                SCMP_SYS(lseek),
-                SCMP_SYS(lstat),
-#ifdef SYS_memfd_create
-                SCMP_SYS(memfd_create),
-#endif
-                SCMP_SYS(mkdir),
-                SCMP_SYS(mmap),
-                SCMP_SYS(mprotect),
-                SCMP_SYS(mremap),
-                SCMP_SYS(munmap),
-                SCMP_SYS(newfstatat),
-                SCMP_SYS(open),
-                SCMP_SYS(openat),
-                SCMP_SYS(pread64),
-                SCMP_SYS(read),
-                SCMP_SYS(readlink),
-                SCMP_SYS(readv),
-                SCMP_SYS(rename),
-                SCMP_SYS(rt_sigaction),
-                SCMP_SYS(rt_sigprocmask),
-                SCMP_SYS(rt_sigreturn),
-                SCMP_SYS(sendfile),
-                SCMP_SYS(stat),
-                SCMP_SYS(symlink),
-                SCMP_SYS(tgkill),
-                SCMP_SYS(time),
-                SCMP_SYS(uname),
-                SCMP_SYS(unlink),
-                SCMP_SYS(write),
-                SCMP_SYS(writev),
-#if defined(__aarch64__)
-                SCMP_SYS(mkdirat),
-                SCMP_SYS(unlinkat),
-                SCMP_SYS(readlinkat),
-                SCMP_SYS(faccessat),
-                SCMP_SYS(symlinkat),
-                SCMP_SYS(fchmodat),
-                SCMP_SYS(renameat),
-#endif
+        const int syscalls[] = {
+                SANDBOX_SYSCALLS(SYSCALL_ENTRY, SYSCALL_OPT_ENTRY)
         };
         int rv = -1;
 
+        /* Rules are given the native syscall numbers, which is the only architecture of the filter. */
         if ((ctx = seccomp_init(SCMP_ACT_ERRNO(EPERM))) == NULL)
                 goto fail;
         for (size_t i = 0; i < nitems(syscalls); ++i) {
+                if (syscalls[i] < 0)
+                        continue;
                 if (seccomp_rule_add(ctx, SCMP_ACT_ALLOW, syscalls[i], 0) < 0)
                         goto fail;
         }
@@ -353,18 +600,30 @@ limit_syscalls(struct error *err)
         seccomp_release(ctx);
         return (rv);
 }
-#else
+
+#undef SYSCALL_OPT_ENTRY
+#undef SYSCALL_ENTRY
+#endif /* WITH_SECCOMP */
+
 static int
 limit_syscalls(struct error *err)
 {
+#ifdef FILTER_AUDIT_ARCH
+        if (load_syscall_filter() == 0)
+                return (0);
+        log_warnf("could not load precompiled syscall filter: %s", strerror(errno));
+#endif /* FILTER_AUDIT_ARCH */
+#ifdef WITH_SECCOMP
+        return (load_seccomp_rules(err));
+#else
         if (secure_mode()) {
                 error_setx(err, "running in secure mode with seccomp disabled");
                 return (-1);
         }
         log_warn("seccomp is disabled, all syscalls are allowed");
         return (0);
-}
 #endif /* WITH_SECCOMP */
+}
 
 /* memfd_create(2) flags -- copied from <linux/memfd.h>. */
 #ifndef MFD_CLOEXEC
@@ -412,36 +671,34 @@ sendfile_nointr(int out_fd, int in_fd, off_t *offset, size_t count)
 }
 
 static int
-open_as_memfd(struct error *err, const char *path)
+open_as_memfd(struct error *err, int fd)
 {
-        int fd, memfd, ret;
+        int memfd;
         ssize_t bytes_sent = 0;
         struct stat st = {0};
         off_t offset = 0;
 
-        if ((fd = xopen(err, path, O_RDONLY)) < 0)
-                return (-1);
-
         log_info("creating a virtual copy of the ldconfig binary");
-        memfd = memfd_create(path, MFD_ALLOW_SEALING | MFD_CLOEXEC);
+        memfd = memfd_create("ldconfig", MFD_ALLOW_SEALING | MFD_CLOEXEC);
         if (memfd == -1) {
-                error_set(err, "error creating memfd for path: %s", path);
+                error_set(err, "error creating memfd for ldconfig");
                 return (-1);
         }
 
-        ret = fstat(fd, &st);
-        if (ret == -1) {
-                error_set(err, "error running fstat for path: %s", path);
+        if (fstat(fd, &st) == -1) {
+                error_set(err, "error running fstat for ldconfig");
                 goto fail;
         }
 
         while (bytes_sent < st.st_size) {
                 ssize_t sent;
-                sent = sendfile_nointr(memfd, fd, &offset, st.st_size - bytes_sent);
+                sent = sendfile_nointr(memfd, fd, &offset, (size_t)(st.st_size - bytes_sent));
                 if (sent == -1) {
                         error_set(err, "failed to copy ldconfig binary to virtual copy");
                         goto fail;
                 }
+                if (sent == 0)
+                        break;
                 bytes_sent += sent;
         }
 
@@ -449,24 +706,791 @@ open_as_memfd(struct error *err, const char *path)
                 error_set(err, "failed to seal virtual copy of the ldconfig binary");
                 goto fail;
         }
-
-        close(fd);
         return memfd;
 fail:
-        close(fd);
         close(memfd);
         return (-1);
 }
 
+/*
+ * Open the host ldconfig binary for execution.
+ * The sealed copy made for a context is kept and reused by subsequent invocations as long as the binary is unchanged.
+ * The first invocation of a context only opens the binary and leaves the copy to the ldconfig process (see sealed),
+ * which makes it before limiting its resources, so that one-shot invocations don't keep a copy around.
+ * The returned descriptor must not be closed if it is the one held by the context.
+ */
+static int
+open_host_ldconfig(struct nvc_context *ctx, const char *path, bool *sealed)
+{
+        struct stat s;
+        int fd, memfd;
+
+        *sealed = false;
+        if ((fd = xopen(&ctx->err, path, O_RDONLY|O_CLOEXEC)) < 0)
+                return (-1);
+        if (fstat(fd, &s) < 0) {
+                error_set(&ctx->err, "stat failed: %s", path);
+                close(fd);
+                return (-1);
+        }
+        if (ctx->ldconfig.fd >= 0) {
+                if (s.st_dev == ctx->ldconfig.st.st_dev && s.st_ino == ctx->ldconfig.st.st_ino &&
+                    s.st_size == ctx->ldconfig.st.st_size &&
+                    s.st_mtim.tv_sec == ctx->ldconfig.st.st_mtim.tv_sec && s.st_mtim.tv_nsec == ctx->ldconfig.st.st_mtim.tv_nsec &&
+                    s.st_ctim.tv_sec == ctx->ldconfig.st.st_ctim.tv_sec && s.st_ctim.tv_nsec == ctx->ldconfig.st.st_ctim.tv_nsec) {
+                        log_info("reusing the virtual copy of the ldconfig binary");
+                        close(fd);
+                        *sealed = true;
+                        return (ctx->ldconfig.fd);
+                }
+                xclose(ctx->ldconfig.fd);
+                ctx->ldconfig.fd = -1;
+        }
+        if (!ctx->ldconfig.used) {
+                ctx->ldconfig.used = true;
+                return (fd);
+        }
+
+        if ((memfd = open_as_memfd(&ctx->err, fd)) < 0) {
+                log_warnf("failed to create virtual copy of the ldconfig binary: %s", ctx->err.msg);
+                error_reset(&ctx->err);
+                return (fd);
+        }
+        close(fd);
+        ctx->ldconfig.fd = memfd;
+        ctx->ldconfig.st = s;
+        *sealed = true;
+        return (memfd);
+}
+
+static bool
+is_library_name(const char *name)
+{
+        return (str_has_prefix(name, "lib") && strstr(name, ".so") != NULL);
+}
+
+/*
+ * Rank the candidates for a given soname within a directory the way ldconfig does: a regular file named after the
+ * soname can't be relinked and always wins, then regular files win over existing links.
+ */
+static int
+library_rank(bool is_link, const char *name, const char *soname)
+{
+        if (is_link)
+                return (0);
+        return (str_equal(name, soname) ? 2 : 1);
+}
+
+static int
+add_library(struct error *err, struct library **libs, size_t *size, const char *dir, const char *name)
+{
+        char path[PATH_MAX];
+        struct elftool elf;
+        struct library *lib = NULL;
+        struct stat s;
+        const char *soname;
+        uint16_t machine;
+        uint32_t eflags;
+        int32_t flags;
+        bool is64, is_link;
+        int rv = -1;
+
+        if (path_join(err, path, dir, name) < 0)
+                return (-1);
+        if (xlstat(err, path, &s) < 0)
+                return (-1);
+        if (!S_ISREG(s.st_mode) && !S_ISLNK(s.st_mode))
+                return (0);
+        is_link = S_ISLNK(s.st_mode);
+
+        elftool_init(&elf, err);
+        if (elftool_open(&elf, path) < 0) {
+                /* Linker scripts and dangling links are skipped by ldconfig as well. */
+                error_reset(err);
+                return (0);
+        }
+        if ((soname = elftool_soname(&elf)) == NULL)
+                soname = name;
+        elftool_machine(&elf, &machine, &is64, &eflags);
+
+        /* Only consider links named after their soname, development links (e.g. libfoo.so) are not cached. */
+        if ((flags = ldcache_elf_flags(machine, is64, eflags)) == LD_UNKNOWN || (is_link && !str_equal(name, soname))) {
+                rv = 0;
+                goto fail;
+        }
+
+        for (size_t i = 0; i < *size; ++i) {
+                if ((*libs)[i].dir == dir && (*libs)[i].flags == flags && str_equal((*libs)[i].soname, soname)) {
+                        lib = &(*libs)[i];
+                        break;
+                }
+        }
+        if (lib != NULL) {
+                /* Within a directory the most recent version wins. */
+                if (library_rank(is_link, name, soname) < library_rank(lib->is_link, lib->name, lib->soname) ||
+                    (library_rank(is_link, name, soname) == library_rank(lib->is_link, lib->name, lib->soname) &&
+                    ldcache_libcmp(name, lib->name) <= 0)) {
+                        rv = 0;
+                        goto fail;
+                }
+                free(lib->name);
+                if ((lib->name = xstrdup(err, name)) == NULL)
+                        goto fail;
+                lib->is_link = is_link;
+                rv = 0;
+                goto fail;
+        }
+
+        if (*size % 16 == 0) {
+                if ((lib = xreallocarray(err, *libs, *size + 16, sizeof(**libs))) == NULL)
+                        goto fail;
+                *libs = lib;
+        }
+        lib = &(*libs)[*size];
+        *lib = (struct library){dir, xstrdup(err, name), xstrdup(err, soname), flags, is_link};
+        ++*size;
+        if (lib->name == NULL || lib->soname == NULL)
+                goto fail;
+        rv = 0;
+
+ fail:
+        elftool_close(&elf);
+        return (rv);
+}
+
+static int
+scan_libraries(struct error *err, const char *dir, struct library **libs, size_t *size)
+{
+        DIR *d;
+        struct dirent *ent;
+        int rv = -1;
+
+        if ((d = opendir(dir)) == NULL) {
+                if (errno == ENOENT)
+                        return (0);
+                error_set(err, "open failed: %s", dir);
+                return (-1);
+        }
+        for (;;) {
+                errno = 0;
+                if ((ent = readdir(d)) == NULL) {
+                        if (errno != 0) {
+                                error_set(err, "read failed: %s", dir);
+                                goto fail;
+                        }
+                        break;
+                }
+                if (!is_library_name(ent->d_name))
+                        continue;
+                if (add_library(err, libs, size, dir, ent->d_name) < 0)
+                        goto fail;
+        }
+        rv = 0;
+
+ fail:
+        closedir(d);
+        return (rv);
+}
+
+static int
+link_library(struct error *err, const char *dir, const char *name, const char *soname)
+{
+        char path[PATH_MAX];
+        char tmp[PATH_MAX];
+        char target[PATH_MAX];
+        ssize_t n;
+
+        if (path_join(err, path, dir, soname) < 0)
+                return (-1);
+        if ((n = readlink(path, target, sizeof(target) - 1)) >= 0) {
+                target[n] = '\0';
+                if (str_equal(target, name))
+                        return (0);
+        } else if (errno != ENOENT) {
+                error_set(err, "readlink failed: %s", path);
+                return (-1);
+        }
+
+        if (xsnprintf(err, tmp, sizeof(tmp), "%s~", path) < 0)
+                return (-1);
+        unlink(tmp);
+        if (symlink(name, tmp) < 0 || rename(tmp, path) < 0) {
+                error_set(err, "symlink creation failed: %s", path);
+                unlink(tmp);
+                return (-1);
+        }
+        log_infof("linking %s to %s", path, name);
+        return (0);
+}
+
+static bool
+has_library(const struct library *libs, size_t size, const char *soname, int32_t flags)
+{
+        for (size_t i = 0; i < size; ++i) {
+                if (libs[i].flags == flags && str_equal(libs[i].soname, soname))
+                        return (true);
+        }
+        return (false);
+}
+
+static uint64_t
+record_hash(const void *entries, size_t entries_size, const void *cache, size_t cache_size)
+{
+        const unsigned char *ptr;
+        uint64_t h = 0xcbf29ce484222325ull;
+
+        /* FNV-1a, collisions only cause a lookup to miss since the inputs are compared in full. */
+        for (ptr = entries; ptr < (const unsigned char *)entries + entries_size; ++ptr)
+                h = (h ^ *ptr) * 0x100000001b3ull;
+        for (ptr = cache; ptr < (const unsigned char *)cache + cache_size; ++ptr)
+                h = (h ^ *ptr) * 0x100000001b3ull;
+        return (h);
+}
+
+static int
+library_filter(const struct dirent *ent)
+{
+        return (is_library_name(ent->d_name));
+}
+
+/*
+ * Describe the libraries scan_libraries would look at in dirs from their attributes alone, without opening them.
+ * Entries are listed in a stable order, symlinks along with their target and the attributes of the file it resolves to.
+ */
+static int
+describe_libraries(struct error *err, const char * const dirs[], size_t ndirs, char **buf, size_t *len)
+{
+        char path[PATH_MAX];
+        char target[PATH_MAX];
+        struct dirent **ents;
+        struct stat s;
+        FILE *fs;
+        ssize_t n;
+        int nents;
+        int rv = -1;
+
+        if ((fs = open_memstream(buf, len)) == NULL) {
+                error_set(err, "memory allocation failed");
+                return (-1);
+        }
+        for (size_t i = 0; i < ndirs; ++i) {
+                if (dirs[i] == NULL)
+                        continue;
+                fprintf(fs, "%s\n", dirs[i]);
+                if ((nents = scandir(dirs[i], &ents, library_filter, alphasort)) < 0) {
+                        if (errno == ENOENT)
+                                continue;
+                        error_set(err, "open failed: %s", dirs[i]);
+                        goto fail;
+                }
+                for (int j = 0; j < nents; ++j) {
+                        if (path_join(NULL, path, dirs[i], ents[j]->d_name) == 0 && lstat(path, &s) == 0 &&
+                            (S_ISREG(s.st_mode) || S_ISLNK(s.st_mode))) {
+                                fprintf(fs, "%s %o %ju %jd %jd.%09ld", ents[j]->d_name, s.st_mode, (uintmax_t)s.st_ino,
+                                    (intmax_t)s.st_size, (intmax_t)s.st_mtim.tv_sec, s.st_mtim.tv_nsec);
+                                if (S_ISLNK(s.st_mode) && (n = readlink(path, target, sizeof(target) - 1)) >= 0) {
+                                        target[n] = '\0';
+                                        fprintf(fs, " -> %s", target);
+                                        if (stat(path, &s) == 0)
+                                                fprintf(fs, " %ju %jd %jd.%09ld", (uintmax_t)s.st_ino, (intmax_t)s.st_size,
+                                                    (intmax_t)s.st_mtim.tv_sec, s.st_mtim.tv_nsec);
+                                }
+                                fprintf(fs, "\n");
+                        }
+                        free(ents[j]);
+                }
+                free(ents);
+        }
+        rv = 0;
+
+ fail:
+        if (fclose(fs) != 0 || *len > UINT32_MAX) {
+                error_set(err, "memory allocation failed");
+                rv = -1;
+        }
+        if (rv < 0) {
+                free(*buf);
+                *buf = NULL;
+                *len = 0;
+        }
+        return (rv);
+}
+
+/* Create the soname links of a record, given as consecutive directory, name and soname strings. */
+static int
+apply_links(struct error *err, const char *links, size_t size)
+{
+        const char *dir, *name, *soname;
+        const char *end = links + size;
+
+        while (links < end) {
+                dir = links;
+                name = dir + strnlen(dir, (size_t)(end - dir)) + 1;
+                soname = (name < end) ? name + strnlen(name, (size_t)(end - name)) + 1 : end;
+                if (soname >= end || soname + strnlen(soname, (size_t)(end - soname)) >= end) {
+                        error_setx(err, "invalid cache record");
+                        return (-1);
+                }
+                if (link_library(err, dir, name, soname) < 0)
+                        return (-1);
+                links = soname + strlen(soname) + 1;
+        }
+        return (0);
+}
+
+/*
+ * Look for a record matching the given inputs and apply its outcome, returns RECORD_HIT if one was found.
+ */
+static int
+lookup_record(struct error *err, int dir, const char *key, size_t key_size, const void *cache, size_t cache_size)
+{
+        char name[32];
+        struct record_header hdr;
+        struct stat s, sdir;
+        const char *data = MAP_FAILED;
+        const char *links;
+        int fd;
+        int rv = RECORD_ERROR;
+
+        snprintf(name, sizeof(name), "%016"PRIx64, record_hash(key, key_size, cache, cache_size));
+        if ((fd = openat(dir, name, O_RDONLY|O_NOFOLLOW|O_CLOEXEC)) < 0) {
+                if (errno == ENOENT)
+                        return (RECORD_MISS);
+                error_set(err, "open failed: %s/%s", RECORD_DIR, name);
+                return (RECORD_ERROR);
+        }
+        if (fstat(fd, &s) < 0 || fstat(dir, &sdir) < 0) {
+                error_set(err, "stat failed: %s/%s", RECORD_DIR, name);
+                goto fail;
+        }
+        if (!S_ISREG(s.st_mode) || s.st_uid != sdir.st_uid || (s.st_mode & (S_IWGRP|S_IWOTH))) {
+                error_setx(err, "insecure cache file: %s/%s", RECORD_DIR, name);
+                goto fail;
+        }
+        if ((size_t)s.st_size < sizeof(hdr) + key_size + cache_size) {
+                rv = RECORD_MISS;
+                goto fail;
+        }
+        if ((data = mmap(NULL, (size_t)s.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+                error_set(err, "file mapping failed: %s/%s", RECORD_DIR, name);
+                goto fail;
+        }
+        memcpy(&hdr, data, sizeof(hdr));
+        if (memcmp(hdr.magic, RECORD_MAGIC, sizeof(hdr.magic)) || hdr.key_size != key_size || hdr.cache_size != cache_size ||
+            (size_t)s.st_size - sizeof(hdr) - key_size - cache_size != (uint64_t)hdr.links_size + hdr.result_size ||
+            memcmp(data + sizeof(hdr), key, key_size) || memcmp(data + sizeof(hdr) + key_size, cache, cache_size)) {
+                rv = RECORD_MISS;
+                goto fail;
+        }
+        links = data + sizeof(hdr) + key_size + cache_size;
+        if (apply_links(err, links, hdr.links_size) < 0)
+                goto fail;
+        if (ldcache_install(err, LDCONFIG_CACHE, links + hdr.links_size, hdr.result_size) < 0)
+                goto fail;
+        log_infof("installed %s from %s/%s", LDCONFIG_CACHE, RECORD_DIR, name);
+        rv = RECORD_HIT;
+
+ fail:
+        if (data != MAP_FAILED)
+                munmap((void *)data, (size_t)s.st_size);
+        close(fd);
+        return (rv);
+}
+
+static int
+send_record(struct error *err, int fd, const char *key, size_t key_size, const void *cache, size_t cache_size,
+    const char *links, size_t links_size)
+{
+        struct record_header hdr = {RECORD_MAGIC, (uint32_t)key_size, (uint32_t)cache_size, (uint32_t)links_size, 0};
+        struct iovec iov[5];
+        void *result;
+        size_t size;
+        ssize_t n;
+        int rv = -1;
+
+        if ((result = file_map(err, LDCONFIG_CACHE, &size)) == NULL)
+                return (-1);
+        if (sizeof(hdr) + key_size + cache_size + links_size + size > RECORD_MAX_SIZE) {
+                file_unmap(NULL, LDCONFIG_CACHE, result, size);
+                return (0);
+        }
+        hdr.result_size = (uint32_t)size;
+
+        iov[0] = (struct iovec){&hdr, sizeof(hdr)};
+        iov[1] = (struct iovec){(void *)key, key_size};
+        iov[2] = (struct iovec){(void *)cache, cache_size};
+        iov[3] = (struct iovec){(void *)links, links_size};
+        iov[4] = (struct iovec){result, size};
+        for (int i = 0; i < (int)nitems(iov);) {
+                if ((n = writev(fd, iov + i, (int)nitems(iov) - i)) < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        error_set(err, "write failed");
+                        goto fail;
+                }
+                for (; i < (int)nitems(iov) && (size_t)n >= iov[i].iov_len; ++i)
+                        n -= (ssize_t)iov[i].iov_len;
+                if (i < (int)nitems(iov)) {
+                        iov[i].iov_base = (char *)iov[i].iov_base + n;
+                        iov[i].iov_len -= (size_t)n;
+                }
+        }
+        rv = 0;
+
+ fail:
+        file_unmap(NULL, LDCONFIG_CACHE, result, size);
+        return (rv);
+}
+
+static int
+open_record_store(struct error *err)
+{
+        struct stat s;
+        int fd;
+
+        /* Records are only written by us but looked up by the unprivileged helper through this descriptor. */
+        if ((mkdir(NVC_CACHE_DIR, 0700) < 0 && errno != EEXIST) || (mkdir(RECORD_DIR, 0711) < 0 && errno != EEXIST)) {
+                error_set(err, "mkdir failed: %s", RECORD_DIR);
+                return (-1);
+        }
+        if ((fd = xopen(err, RECORD_DIR, O_PATH|O_DIRECTORY|O_NOFOLLOW|O_CLOEXEC)) < 0)
+                return (-1);
+        if (fstat(fd, &s) < 0 || s.st_uid != geteuid() || (s.st_mode & (S_IWGRP|S_IWOTH))) {
+                error_setx(err, "insecure cache directory: %s", RECORD_DIR);
+                close(fd);
+                return (-1);
+        }
+        return (fd);
+}
+
+static int
+receive_record(struct error *err, int fd, char **buf, size_t *len)
+{
+        size_t cap = 0;
+        ssize_t n;
+        char *ptr;
+
+        *buf = NULL;
+        *len = 0;
+        for (;;) {
+                if (*len == cap) {
+                        if (cap >= RECORD_MAX_SIZE) {
+                                error_setx(err, "cache record too large");
+                                goto fail;
+                        }
+                        cap = cap ? cap * 2 : 256 * 1024;
+                        if ((ptr = xreallocarray(err, *buf, cap, sizeof(**buf))) == NULL)
+                                goto fail;
+                        *buf = ptr;
+                }
+                if ((n = read(fd, *buf + *len, cap - *len)) < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        error_set(err, "read failed");
+                        goto fail;
+                }
+                if (n == 0)
+                        break;
+                *len += (size_t)n;
+        }
+        return (0);
+
+ fail:
+        free(*buf);
+        *buf = NULL;
+        *len = 0;
+        return (-1);
+}
+
+static int
+store_record(struct error *err, int dir, const char *buf, size_t len)
+{
+        char name[32], tmp[64];
+        struct record_header hdr;
+        const char *cache;
+        ssize_t n;
+        int fd;
+
+        if (len < sizeof(hdr))
+                goto invalid;
+        memcpy(&hdr, buf, sizeof(hdr));
+        if (memcmp(hdr.magic, RECORD_MAGIC, sizeof(hdr.magic)) ||
+            (uint64_t)hdr.key_size + hdr.cache_size + hdr.links_size + hdr.result_size != len - sizeof(hdr))
+                goto invalid;
+        cache = buf + sizeof(hdr) + hdr.key_size;
+
+        snprintf(name, sizeof(name), "%016"PRIx64, record_hash(buf + sizeof(hdr), hdr.key_size, cache, hdr.cache_size));
+        snprintf(tmp, sizeof(tmp), "%s.%"PRId32, name, (int32_t)getpid());
+        if ((fd = openat(dir, tmp, O_WRONLY|O_CREAT|O_EXCL|O_NOFOLLOW|O_CLOEXEC, 0644)) < 0) {
+                error_set(err, "open failed: %s/%s", RECORD_DIR, tmp);
+                return (-1);
+        }
+        for (size_t off = 0; off < len; off += (size_t)n) {
+                if ((n = write(fd, buf + off, len - off)) < 0) {
+                        if (errno == EINTR) {
+                                n = 0;
+                                continue;
+                        }
+                        error_set(err, "write failed: %s/%s", RECORD_DIR, tmp);
+                        goto fail;
+                }
+        }
+        if (close(fd) < 0) {
+                fd = -1;
+                error_set(err, "write failed: %s/%s", RECORD_DIR, tmp);
+                goto fail;
+        }
+        fd = -1;
+        if (renameat(dir, tmp, dir, name) < 0) {
+                error_set(err, "rename failed: %s/%s", RECORD_DIR, tmp);
+                goto fail;
+        }
+        log_infof("recorded %s for future containers as %s/%s", LDCONFIG_CACHE, RECORD_DIR, name);
+        if (prune_records(err, dir, name) < 0)
+                log_warnf("could not prune %s: %s", RECORD_DIR, err->msg);
+        return (0);
+
+ fail:
+        xclose(fd);
+        unlinkat(dir, tmp, 0);
+        return (-1);
+
+ invalid:
+        error_setx(err, "invalid cache record");
+        return (-1);
+}
+
+struct record_entry {
+        char name[32];
+        off_t size;
+        struct timespec atime;
+};
+
+static int
+compare_records(const void *p1, const void *p2)
+{
+        const struct record_entry *r1 = p1, *r2 = p2;
+
+        if (r1->atime.tv_sec != r2->atime.tv_sec)
+                return ((r1->atime.tv_sec < r2->atime.tv_sec) ? -1 : 1);
+        if (r1->atime.tv_nsec != r2->atime.tv_nsec)
+                return ((r1->atime.tv_nsec < r2->atime.tv_nsec) ? -1 : 1);
+        return (0);
+}
+
+/*
+ * Bound the ldcache store to RECORD_DIR_SIZE by evicting the least recently used records other than keep.
+ * Records are read by the helper on every hit, their access time is therefore used as the last use (note that
+ * with relatime, it is only updated by the first hit after a record was written and then at most once a day).
+ */
+static int
+prune_records(struct error *err, int dir, const char *keep)
+{
+        struct record_entry *records = NULL, *ptr;
+        size_t nrecords = 0, size = 0;
+        struct dirent *ent;
+        struct stat s;
+        off_t total = 0;
+        DIR *dirp = NULL;
+        int fd;
+        int rv = -1;
+
+        if ((fd = openat(dir, ".", O_RDONLY|O_DIRECTORY|O_CLOEXEC)) < 0 || (dirp = fdopendir(fd)) == NULL) {
+                error_set(err, "open failed: %s", RECORD_DIR);
+                xclose(fd);
+                return (-1);
+        }
+        while ((errno = 0, ent = readdir(dirp)) != NULL) {
+                if (strlen(ent->d_name) != 16 || strspn(ent->d_name, "0123456789abcdef") != 16)
+                        continue;
+                if (fstatat(dir, ent->d_name, &s, AT_SYMLINK_NOFOLLOW) < 0) {
+                        if (errno == ENOENT)
+                                continue;
+                        error_set(err, "stat failed: %s/%s", RECORD_DIR, ent->d_name);
+                        goto fail;
+                }
+                if (!S_ISREG(s.st_mode))
+                        continue;
+                if (nrecords == size) {
+                        size = size ? size * 2 : 64;
+                        if ((ptr = xreallocarray(err, records, size, sizeof(*records))) == NULL)
+                                goto fail;
+                        records = ptr;
+                }
+                ptr = &records[nrecords++];
+                strcpy(ptr->name, ent->d_name);
+                ptr->size = s.st_size;
+                ptr->atime = s.st_atim;
+                total += s.st_size;
+        }
+        if (errno != 0) {
+                error_set(err, "read failed: %s", RECORD_DIR);
+                goto fail;
+        }
+        if (total > RECORD_DIR_SIZE) {
+                qsort(records, nrecords, sizeof(*records), compare_records);
+                for (size_t i = 0; i < nrecords && total > RECORD_DIR_SIZE; ++i) {
+                        if (str_equal(records[i].name, keep))
+                                continue;
+                        if (unlinkat(dir, records[i].name, 0) < 0 && errno != ENOENT) {
+                                error_set(err, "unlink failed: %s/%s", RECORD_DIR, records[i].name);
+                                goto fail;
+                        }
+                        log_infof("evicted %s/%s", RECORD_DIR, records[i].name);
+                        total -= records[i].size;
+                }
+        }
+        rv = 0;
+
+ fail:
+        free(records);
+        closedir(dirp);
+        return (rv);
+}
+
+/*
+ * update_ldcache does what running ldconfig on the library directories would do, without rescanning every directory
+ * of ld.so.conf: soname links are created for the libraries found in dirs and the corresponding entries are merged
+ * in the existing cache. When several directories provide the same soname, the first one listed takes precedence.
+ * It is expected to run in the same sandbox as ldconfig, any failure should be followed by running ldconfig instead.
+ * If store is a valid descriptor, the outcome is looked up in the ldcache store before any library gets inspected,
+ * and recorded through out on a miss.
+ */
+static int
+update_ldcache(struct error *err, const char * const dirs[], size_t ndirs, int store, int out)
+{
+        struct ldcache ld;
+        struct library *libs = NULL;
+        struct ldcache_entry *entries = NULL;
+        char **paths = NULL;
+        char *key = NULL;
+        char *links = NULL;
+        FILE *fs = NULL;
+        size_t nlibs = 0;
+        size_t n = 0;
+        size_t keylen = 0;
+        size_t linkslen = 0;
+        int hit = RECORD_MISS;
+        int rv = -1;
+
+        ldcache_init(&ld, err, LDCONFIG_CACHE);
+        if (ldcache_open(&ld) < 0)
+                return (-1);
+        if (store >= 0) {
+                if (describe_libraries(err, dirs, ndirs, &key, &keylen) < 0 ||
+                    (hit = lookup_record(err, store, key, keylen, ld.addr, ld.size)) == RECORD_ERROR) {
+                        log_warnf("could not look up the ldcache store: %s", err->msg);
+                        error_reset(err);
+                        store = -1;
+                        hit = RECORD_MISS;
+                }
+        }
+        if (hit == RECORD_HIT)
+                goto done;
+
+        for (size_t i = 0; i < ndirs; ++i) {
+                if (dirs[i] != NULL && scan_libraries(err, dirs[i], &libs, &nlibs) < 0)
+                        goto fail;
+        }
+        if ((entries = xcalloc(err, nlibs + 1, sizeof(*entries))) == NULL)
+                goto fail;
+        if ((paths = array_new(err, nlibs + 1)) == NULL)
+                goto fail;
+        if (store >= 0 && (fs = open_memstream(&links, &linkslen)) == NULL) {
+                error_set(err, "memory allocation failed");
+                goto fail;
+        }
+        for (size_t i = 0; i < nlibs; ++i) {
+                if (!libs[i].is_link && !str_equal(libs[i].name, libs[i].soname)) {
+                        if (link_library(err, libs[i].dir, libs[i].name, libs[i].soname) < 0)
+                                goto fail;
+                        if (fs != NULL) {
+                                fwrite(libs[i].dir, strlen(libs[i].dir) + 1, 1, fs);
+                                fwrite(libs[i].name, strlen(libs[i].name) + 1, 1, fs);
+                                fwrite(libs[i].soname, strlen(libs[i].soname) + 1, 1, fs);
+                        }
+                }
+                if (has_library(libs, i, libs[i].soname, libs[i].flags))
+                        continue;
+                if (xasprintf(err, &paths[n], "%s/%s", libs[i].dir, libs[i].soname) < 0)
+                        goto fail;
+                entries[n] = (struct ldcache_entry){libs[i].flags, libs[i].soname, paths[n]};
+                ++n;
+        }
+        if (fs != NULL) {
+                if (fclose(fs) != 0) {
+                        fs = NULL;
+                        error_set(err, "memory allocation failed");
+                        goto fail;
+                }
+                fs = NULL;
+        }
+
+        if (ldcache_merge(&ld, entries, n) < 0)
+                goto fail;
+        log_infof("merged %zu libraries into %s", n, LDCONFIG_CACHE);
+        if (store >= 0 && send_record(err, out, key, keylen, ld.addr, ld.size, links, linkslen) < 0) {
+                log_warnf("could not record %s: %s", LDCONFIG_CACHE, err->msg);
+                error_reset(err);
+        }
+
+ done:
+        rv = 0;
+
+ fail:
+        if (ldcache_close(&ld) < 0)
+                rv = -1;
+        if (fs != NULL)
+                fclose(fs);
+        free(links);
+        free(key);
+        for (size_t i = 0; i < nlibs; ++i) {
+                free(libs[i].name);
+                free(libs[i].soname);
+        }
+        free(libs);
+        free(entries);
+        array_free(paths, nlibs + 1);
+        return (rv);
+}
+
+static int
+reap_process(struct error *err, pid_t child, const char *path)
+{
+        int status;
+
+        if (waitpid(child, &status, 0) < 0) {
+                error_set(err, "process reaping failed");
+                return (-1);
+        }
+        if (WIFSIGNALED(status)) {
+                error_setx(err, "process %s terminated with signal %d", path, WTERMSIG(status));
+                return (-1);
+        }
+        if (WIFEXITED(status) && (status = WEXITSTATUS(status)) != 0) {
+                error_setx(err, "process %s failed with error code: %d", path, status);
+                return (-1);
+        }
+        return (0);
+}
+
 int
 nvc_ldcache_update(struct nvc_context *ctx, const struct nvc_container *cnt)
 {
         char **argv;
         pid_t child;
-        int status;
         bool drop_groups = true;
         bool host_ldconfig = false;
+        bool sealed = false;
         int fd = -1;
+        int store = -1;
+        int pipefd[2] = {-1, -1};
+        int tracepipe[2] = {-1, -1};
+        pid_t pid;
+        char *record = NULL;
+        size_t len = 0;
+        int rv;
+        trace_func();
 
         if (validate_context(ctx) < 0)
                 return (-1);
@@ -485,6 +1509,7 @@ nvc_ldcache_update(struct nvc_context *ctx, const struct nvc_container *cnt)
          */
         char *argv_default[] = {cnt->cfg.ldconfig, "-f", "/etc/ld.so.conf", "-C", "/etc/ld.so.cache", cnt->cfg.libs_dir, cnt->cfg.libs32_dir, NULL};
         char *argv_with_compat_dir[] = {cnt->cfg.ldconfig, "-f", "/etc/ld.so.conf", "-C", "/etc/ld.so.cache", cnt->cuda_compat_dir, cnt->cfg.libs_dir, cnt->cfg.libs32_dir, NULL};
+        const char *dirs[] = {NULL, cnt->cfg.libs_dir, cnt->cfg.libs32_dir};
         if ((cnt->flags & OPT_CUDA_COMPAT_MODE_LDCONFIG) && (cnt->cuda_compat_dir != NULL)) {
                 /*
                  * We include the cuda_compat_dir directory on the ldconfig
@@ -495,6 +1520,7 @@ nvc_ldcache_update(struct nvc_context *ctx, const struct nvc_container *cnt)
                  */
                 log_info("prefering CUDA Forward Compatibility dir when running ldconfig");
                 argv = argv_with_compat_dir;
+                dirs[0] = cnt->cuda_compat_dir;
         } else {
                 argv = argv_default;
         }
@@ -505,23 +1531,47 @@ nvc_ldcache_update(struct nvc_context *ctx, const struct nvc_container *cnt)
                  * Force proc to be remounted since we're creating a PID namespace and fexecve depends on it.
                  */
                 ++argv[0];
-                if ((fd = open_as_memfd(&ctx->err, argv[0])) < 0) {
-                        log_warn("failed to create virtual copy of the ldconfig binary");
-                        if ((fd = xopen(&ctx->err, argv[0], O_RDONLY|O_CLOEXEC)) < 0)
-                                return (-1);
-                }
+                if ((fd = open_host_ldconfig(ctx, argv[0], &sealed)) < 0)
+                        return (-1);
                 host_ldconfig = true;
                 log_infof("executing %s from host at %s", argv[0], cnt->cfg.rootfs);
         } else {
                 log_infof("executing %s at %s", argv[0], cnt->cfg.rootfs);
         }
 
+        if (cnt->flags & OPT_LDCACHE_STORE) {
+                if ((store = open_record_store(&ctx->err)) < 0 || pipe2(pipefd, O_CLOEXEC) < 0) {
+                        log_warnf("could not open the ldcache store: %s", (store < 0) ? ctx->err.msg : strerror(errno));
+                        error_reset(&ctx->err);
+                        xclose(store);
+                        store = -1;
+                }
+        }
+
+        /* The child lives in its own PID namespace, its trace track is identified by the PID we see it with. */
+        if (trace_active() && pipe2(tracepipe, O_CLOEXEC) < 0)
+                tracepipe[0] = tracepipe[1] = -1;
+
         if ((child = create_process(&ctx->err, CLONE_NEWPID|CLONE_NEWIPC)) < 0) {
-                xclose(fd);
+                if (fd != ctx->ldconfig.fd)
+                        xclose(fd);
+                xclose(store);
+                xclose(pipefd[0]);
+                xclose(pipefd[1]);
+                xclose(tracepipe[0]);
+                xclose(tracepipe[1]);
                 return (-1);
         }
         if (child == 0) {
+                struct trace_span span;
+
                 prctl(PR_SET_NAME, (unsigned long)"nvc:[ldconfig]", 0, 0, 0);
+                xclose(tracepipe[1]);
+                if (tracepipe[0] >= 0 && read(tracepipe[0], &pid, sizeof(pid)) == sizeof(pid))
+                        trace_set_pid(pid);
+                xclose(tracepipe[0]);
+                trace_process_name("nvc:[ldconfig]");
+                span = trace_begin("ldconfig setup");
 
                 if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
                         goto fail;
@@ -529,13 +1579,31 @@ nvc_ldcache_update(struct nvc_context *ctx, const struct nvc_container *cnt)
                         goto fail;
                 if (change_rootfs(&ctx->err, cnt->cfg.rootfs, ctx->no_pivot, host_ldconfig, cnt->uid, cnt->gid, &drop_groups) < 0)
                         goto fail;
+                /* The copy can exceed the file size limit, it has to be made before limit_resources. */
+                if (fd >= 0 && !sealed) {
+                        int memfd;
+
+                        if ((memfd = open_as_memfd(&ctx->err, fd)) < 0) {
+                                log_warnf("failed to create virtual copy of the ldconfig binary: %s", ctx->err.msg);
+                                error_reset(&ctx->err);
+                        } else {
+                                fd = memfd;
+                        }
+                }
                 if (limit_resources(&ctx->err) < 0)
                         goto fail;
                 if (adjust_privileges(&ctx->err, cnt->uid, cnt->gid, drop_groups) < 0)
                         goto fail;
+                trace_end(&span);
                 if (limit_syscalls(&ctx->err) < 0)
                         goto fail;
 
+                xclose(pipefd[0]);
+                if (update_ldcache(&ctx->err, dirs, nitems(dirs), store, pipefd[1]) == 0)
+                        _exit(EXIT_SUCCESS);
+                log_warnf("could not update %s in place, running %s instead: %s", LDCONFIG_CACHE, argv[0], ctx->err.msg);
+                error_reset(&ctx->err);
+
                 if (fd < 0)
                         execve(argv[0], argv, (char * const []){NULL});
                 else
@@ -546,18 +1614,30 @@ nvc_ldcache_update(struct nvc_context *ctx, const struct nvc_container *cnt)
                 (ctx->err.code == ENOENT) ? _exit(EXIT_SUCCESS) : _exit(EXIT_FAILURE);
         }
 
-        xclose(fd);
-        if (waitpid(child, &status, 0) < 0) {
-                error_set(&ctx->err, "process reaping failed");
-                return (-1);
+        if (tracepipe[1] >= 0) {
+                pid = child;
+                if (write(tracepipe[1], &pid, sizeof(pid)) < 0)
+                        log_warnf("could not send the trace identifier to %s: %s", argv[0], strerror(errno));
         }
-        if (WIFSIGNALED(status)) {
-                error_setx(&ctx->err, "process %s terminated with signal %d", argv[0], WTERMSIG(status));
-                return (-1);
+        xclose(tracepipe[0]);
+        xclose(tracepipe[1]);
+        if (fd != ctx->ldconfig.fd)
+                xclose(fd);
+        if (store >= 0) {
+                /* The record (if any) has to be drained before reaping since it can exceed the pipe capacity. */
+                xclose(pipefd[1]);
+                if (receive_record(&ctx->err, pipefd[0], &record, &len) < 0) {
+                        log_warnf("could not receive the ldcache record: %s", ctx->err.msg);
+                        error_reset(&ctx->err);
+                }
+                xclose(pipefd[0]);
         }
-        if (WIFEXITED(status) && (status = WEXITSTATUS(status)) != 0) {
-                error_setx(&ctx->err, "process %s failed with error code: %d", argv[0], status);
-                return (-1);
+        if ((rv = reap_process(&ctx->err, child, argv[0])) == 0 && len > 0 &&
+            store_record(&ctx->err, store, record, len) < 0) {
+                log_warnf("could not store the ldcache record: %s", ctx->err.msg);
+                error_reset(&ctx->err);
         }
-        return (0);
+        free(record);
+        xclose(store);
+        return (rv);
 }
@@ -4,12 +4,18 @@
 
 #include <sys/sysmacros.h>
 #include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/vfs.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
 #undef basename /* Use the GNU version of basename. */
 #include <limits.h>
+#include <linux/magic.h>
 #include <nvidia-modprobe-utils.h>
 #include <stdio.h>
 #include <string.h>
@@ -18,51 +24,158 @@
 
 #include "nvc_internal.h"
 
+#include "bundle.h"
 #include "cgroup.h"
 #include "error.h"
+#include "mount_plan.h"
 #include "options.h"
+#include "trace.h"
 #include "utils.h"
 #include "xfuncs.h"
 
-static char **mount_files(struct error *, const char *, const struct nvc_container *, const char *, char *[], size_t);
-static char **mount_driverstore_files(struct error *, const char *, const struct nvc_container *, const char *, const char *[], size_t);
+#if defined(SYS_open_tree) && defined(SYS_move_mount) && defined(SYS_mount_setattr)
+# define HAVE_MOUNT_API 1
+# ifndef MOUNT_ATTR_SIZE_VER0
+struct mount_attr {
+        uint64_t attr_set;
+        uint64_t attr_clr;
+        uint64_t propagation;
+        uint64_t userns_fd;
+};
+#  define MOUNT_ATTR_SIZE_VER0    32
+#  define MOUNT_ATTR_RDONLY       0x00000001
+#  define MOUNT_ATTR_NOSUID       0x00000002
+#  define MOUNT_ATTR_NODEV        0x00000004
+#  define MOUNT_ATTR_NOEXEC       0x00000008
+#  define OPEN_TREE_CLONE         1
+#  define OPEN_TREE_CLOEXEC       O_CLOEXEC
+#  define MOVE_MOUNT_F_EMPTY_PATH 0x00000004
+#  define MOVE_MOUNT_T_EMPTY_PATH 0x00000040
+# endif /* MOUNT_ATTR_SIZE_VER0 */
+#endif /* defined(SYS_open_tree) && defined(SYS_move_mount) && defined(SYS_mount_setattr) */
+
+/*
+ * A plan_undo entry records how to revert an action of a plan: path is unmounted and removed, unless the action
+ * shadowed an entry of the image (only the mount is reverted) or replaced one of its symlinks (target is restored).
+ */
+struct plan_undo {
+        char *path;
+        char *target;
+        bool shadow;
+};
+
+static int  bind_mount(struct error *, const char *, const char *, unsigned long);
 static char *mount_directory(struct error *, const char *, const struct nvc_container *, const char *);
-static char *mount_firmware(struct error *, const char *, const struct nvc_container *, const char *);
 static char *mount_in_root(struct error *err, const char *src, const char *rootfs, const char *path, uid_t uid, uid_t gid, unsigned long mountflags);
 static char *mount_with_flags(struct error *, const char *, const char *,  uid_t, uid_t, unsigned long);
 static char *mount_device(struct error *, const char *, const struct nvc_container *, const struct nvc_device_node *);
-static char *mount_ipc(struct error *, const char *, const struct nvc_container *, const char *);
-static char *mount_procfs(struct error *, const char *, const struct nvc_container *);
-static char *mount_procfs_gpu(struct error *, const char *, const struct nvc_container *, const char *);
+static int  create_device(struct error *, const struct nvc_container *, const char *, const struct stat *);
 static char *mount_procfs_mig(struct error *, const char *, const struct nvc_container *, const char *);
-static char *mount_app_profile(struct error *, const struct nvc_container *);
 static int  update_app_profile(struct error *, const struct nvc_container *, dev_t);
 static void unmount(const char *);
-static int  symlink_library(struct error *, const char *, const char *, const char *, uid_t, gid_t);
-static int  symlink_libraries(struct error *, const struct nvc_container *, const char * const [], size_t);
-static int  device_mount_dxcore(struct nvc_context *, const struct nvc_container *);
-static int  device_mount_native(struct nvc_context *, const struct nvc_container *, const struct nvc_device *);
 static int  cap_device_mount(struct nvc_context *, const struct nvc_container *, const char *);
-static int  setup_mig_minor_cgroups(struct error *, const struct nvc_container *, int, const struct nvc_device_node *);
+static int  setup_mig_minor_cgroups(struct nvc_context *, const struct nvc_container *, int, const struct nvc_device_node *);
+static size_t device_cgroup_begin(const struct nvc_container *);
+static int  device_cgroup_add(struct error *, const struct nvc_container *, dev_t);
+static int  compare_devs(const void *, const void *);
+static int  device_cgroup_apply(struct error *, const struct nvc_context *, const struct nvc_container *);
+static int  device_cgroup_end(struct error *, const struct nvc_context *, const struct nvc_container *, size_t, bool);
+static int  plan_bind(struct error *, struct mount_plan *, const char *, const char *, unsigned long, dev_t, int);
+static int  plan_mkdir(struct error *, struct mount_plan *, const char *, mode_t);
+static int  plan_device_node(struct error *, struct mount_plan *, const struct nvc_container *, const char *, const char *, dev_t);
+static int  plan_library_symlink(struct error *, struct mount_plan *, const char *, const char *);
+static int  plan_library_symlinks(struct error *, struct mount_plan *, const struct nvc_container *, const char *, char * const [], size_t);
+static int  plan_files(struct error *, struct mount_plan *, const struct nvc_container *, const char *, const char *, const char *, char * const [], size_t);
+static int  plan_procfs(struct error *, struct mount_plan *, const char *);
+static int  plan_app_profile(struct error *, struct mount_plan *);
+static int  plan_driver(struct error *, const struct nvc_context *, const struct nvc_container *, const struct nvc_driver_info *, const char *, struct mount_plan *);
+static int  plan_device(struct error *, const struct nvc_context *, const struct nvc_container *, const struct nvc_device *, struct mount_plan *);
+static char *exec_bind(struct error *, const struct nvc_container *, const struct plan_action *);
+static char *exec_mknod(struct error *, const struct nvc_container *, const struct plan_action *, size_t *);
+static char *exec_tmpfs(struct error *, const struct nvc_container *, const struct plan_action *);
+static int  exec_copy(struct error *, const struct nvc_container *, const struct plan_action *);
+static int  exec_mkdir(struct error *, const struct nvc_container *, const struct plan_action *);
+static int  replace_symlink(struct error *, const struct nvc_container *, const char *, const char *);
+static int  exec_symlink(struct error *, const struct nvc_container *, const struct plan_action *, struct plan_undo *);
+static void plan_undo(const struct nvc_container *, const struct plan_undo *);
+static int  plan_execute(struct nvc_context *, const struct nvc_container *, const struct mount_plan *);
+
+#ifdef HAVE_MOUNT_API
+static int mount_api_broken;
+#endif /* HAVE_MOUNT_API */
 
-static char *
-mount_directory(struct error *err, const char *root, const struct nvc_container *cnt, const char *dir)
+/*
+ * bind_mount bind mounts src at dst with the given mount flags.
+ * When the kernel supports it, the flags are applied to a detached copy of src before it gets attached, so that
+ * dst is never exposed with the flags of src. Otherwise, fall back to a bind mount followed by a remount.
+ */
+static int
+bind_mount(struct error *err, const char *src, const char *dst, unsigned long mountflags)
 {
-        char src[PATH_MAX];
-        if (path_join(err, src, root, dir) < 0)
-                return (NULL);
-        return mount_in_root(err, src, cnt->cfg.rootfs, dir, cnt->uid, cnt->gid, MS_NOSUID|MS_NOEXEC);
+#ifdef HAVE_MOUNT_API
+        struct mount_attr attr = {0};
+        int tree = -1;
+        int fd = -1;
+        int rv = -1;
+
+        if (__atomic_load_n(&mount_api_broken, __ATOMIC_RELAXED))
+                goto legacy;
+
+        attr.attr_set = ((mountflags & MS_RDONLY) ? MOUNT_ATTR_RDONLY : 0) |
+                        ((mountflags & MS_NOSUID) ? MOUNT_ATTR_NOSUID : 0) |
+                        ((mountflags & MS_NODEV) ? MOUNT_ATTR_NODEV : 0) |
+                        ((mountflags & MS_NOEXEC) ? MOUNT_ATTR_NOEXEC : 0);
+        attr.attr_clr = (MOUNT_ATTR_RDONLY|MOUNT_ATTR_NOSUID|MOUNT_ATTR_NODEV|MOUNT_ATTR_NOEXEC) & ~attr.attr_set;
+
+        if ((tree = (int)syscall(SYS_open_tree, AT_FDCWD, src, OPEN_TREE_CLONE|OPEN_TREE_CLOEXEC)) < 0) {
+                if (errno == ENOSYS || errno == EPERM)
+                        goto unsupported;
+                error_set(err, "mount operation failed: %s", src);
+                goto fail;
+        }
+        if (syscall(SYS_mount_setattr, tree, "", AT_EMPTY_PATH, &attr, MOUNT_ATTR_SIZE_VER0) < 0) {
+                if (errno == ENOSYS)
+                        goto unsupported;
+                error_set(err, "mount operation failed: %s", src);
+                goto fail;
+        }
+        if ((fd = open(dst, O_PATH|O_NOFOLLOW|O_CLOEXEC)) < 0) {
+                error_set(err, "open failed: %s", dst);
+                goto fail;
+        }
+        if (syscall(SYS_move_mount, tree, "", fd, "", MOVE_MOUNT_F_EMPTY_PATH|MOVE_MOUNT_T_EMPTY_PATH) < 0) {
+                error_set(err, "mount operation failed: %s", src);
+                goto fail;
+        }
+        rv = 0;
+
+ fail:
+        xclose(fd);
+        xclose(tree);
+        return (rv);
+
+ unsupported:
+        log_info("mount api unavailable, falling back to remounts");
+        __atomic_store_n(&mount_api_broken, true, __ATOMIC_RELAXED);
+        xclose(tree);
+ legacy:
+#endif /* HAVE_MOUNT_API */
+        if (xmount(err, src, dst, NULL, MS_BIND, NULL) < 0)
+                return (-1);
+        if (xmount(err, NULL, dst, NULL, MS_BIND|MS_REMOUNT | mountflags, NULL) < 0)
+                return (-1);
+        return (0);
 }
 
-// mount_firmware mounts the specified firmware file. The path specified is the container path and is resolved
-// on the host before mounting.
 static char *
-mount_firmware(struct error *err, const char *root, const struct nvc_container *cnt, const char *container_path)
+mount_directory(struct error *err, const char *root, const struct nvc_container *cnt, const char *dir)
 {
         char src[PATH_MAX];
-        if (path_resolve_full(err, src, root, container_path) < 0)
+        trace_func();
+
+        if (path_join(err, src, root, dir) < 0)
                 return (NULL);
-        return mount_in_root(err, src, cnt->cfg.rootfs, container_path, cnt->uid, cnt->gid, MS_RDONLY|MS_NODEV|MS_NOSUID);
+        return mount_in_root(err, src, cnt->cfg.rootfs, dir, cnt->uid, cnt->gid, MS_NOSUID|MS_NOEXEC);
 }
 
 // mount_in_root bind mounts the specified src to the specified location in a root.
@@ -87,122 +200,14 @@ mount_with_flags(struct error *err, const char *src, const char *dst, uid_t uid,
                 goto fail;
 
         log_infof("mounting %s at %s with flags 0x%lx", src, dst, mountflags);
-        if (xmount(err, src, dst, NULL, MS_BIND, NULL) < 0)
-                goto fail;
-        if (xmount(err, NULL, dst, NULL, MS_BIND|MS_REMOUNT | mountflags, NULL) < 0)
+        if (bind_mount(err, src, dst, mountflags) < 0)
                 goto fail;
         if ((mnt = xstrdup(err, dst)) == NULL)
                 goto fail;
         return (mnt);
 
  fail:
-        unmount(mnt);
-        return (NULL);
-}
-
-static char **
-mount_files(struct error *err, const char *root, const struct nvc_container *cnt, const char *dir, char *paths[], size_t size)
-{
-        char src[PATH_MAX];
-        char dst[PATH_MAX];
-        mode_t mode;
-        char *src_end, *dst_end, *file;
-        char **mnt, **ptr;
-
-        if (path_new(err, src, root) < 0)
-                return (NULL);
-        if (path_resolve_full(err, dst, cnt->cfg.rootfs, dir) < 0)
-                return (NULL);
-        if (file_create(err, dst, NULL, cnt->uid, cnt->gid, MODE_DIR(0755)) < 0)
-                return (NULL);
-        if (path_new(err, dst, dir) < 0)
-                return (NULL);
-        src_end = src + strlen(src);
-        dst_end = dst + strlen(dst);
-
-        mnt = ptr = array_new(err, size + 1); /* NULL terminated. */
-        if (mnt == NULL)
-                return (NULL);
-
-        for (size_t i = 0; i < size; ++i) {
-                file = basename(paths[i]);
-                if (!match_binary_flags(file, cnt->flags) && !match_library_flags(file, cnt->flags))
-                        continue;
-                if (path_append(err, src, paths[i]) < 0)
-                        goto fail;
-                if (file_mode_nofollow(err, src, &mode) < 0)
-                        goto fail;
-                // If we encounter resolved directories or symlinks here, we raise an error.
-                if (S_ISDIR(mode) || S_ISLNK(mode)) {
-                        error_setx(err, "unexpected source file mode %o for %s", mode, paths[i]);
-                        goto fail;
-                }
-                if (path_append(err, dst, file) < 0)
-                        goto fail;
-                if ((*ptr++ = mount_in_root(err, src, cnt->cfg.rootfs, dst, cnt->uid, cnt->gid, MS_RDONLY|MS_NODEV|MS_NOSUID)) == NULL)
-                        goto fail;
-                *src_end = '\0';
-                *dst_end = '\0';
-        }
-        return (mnt);
-
- fail:
-        for (size_t i = 0; i < size; ++i)
-                unmount(mnt[i]);
-        array_free(mnt, size);
-        return (NULL);
-}
-
-static char **
-mount_driverstore_files(struct error *err, const char *root, const struct nvc_container *cnt, const char *driverStore, const char *files[], size_t size)
-{
-        char src[PATH_MAX];
-        char dst[PATH_MAX];
-        char *src_end, *dst_end, *file;
-        char **mnt, **ptr;
-
-        if (path_join(err, src, root, driverStore) < 0)
-                return (NULL);
-        if (path_resolve_full(err, dst, cnt->cfg.rootfs, driverStore) < 0)
-                return (NULL);
-        if (file_create(err, dst, NULL, cnt->uid, cnt->gid, MODE_DIR(0755)) < 0)
-                return (NULL);
-
-        src_end = src + strlen(src);
-        dst_end = dst + strlen(dst);
-
-        mnt = ptr = array_new(err, size + 1); /* NULL terminated. */
-        if (mnt == NULL)
-                return (NULL);
-
-        for (size_t i = 0; i < size; ++i) {
-                file = basename(files[i]);
-
-                if (path_append(err, src, files[i]) < 0)
-                        goto fail;
-                if (path_append(err, dst, file) < 0)
-                        goto fail;
-                if (file_create(err, dst, NULL, cnt->uid, cnt->gid, MODE_REG(0555)) < 0)
-                        goto fail;
-
-                log_infof("mounting %s at %s", src, dst);
-
-                if (xmount(err, src, dst, NULL, MS_BIND, NULL) < 0)
-                        goto fail;
-                if (xmount(err, NULL, dst, NULL, MS_BIND|MS_REMOUNT|MS_RDONLY|MS_NODEV|MS_NOSUID, NULL) < 0)
-                        goto fail;
-                if ((*ptr++ = xstrdup(err, dst)) == NULL)
-                        goto fail;
-                *src_end = '\0';
-                *dst_end = '\0';
-        }
-
-        return (mnt);
-
- fail:
-        for (size_t i = 0; i < size; ++i)
-                unmount(mnt[i]);
-        array_free(mnt, size);
+        unmount(dst);
         return (NULL);
 }
 
@@ -214,6 +219,8 @@ mount_device(struct error *err, const char *root, const struct nvc_container *cn
         char dst[PATH_MAX];
         mode_t mode;
         char *mnt;
+        int rv;
+        trace_func();
 
         if (path_join(err, src, root, dev->path) < 0)
                 return (NULL);
@@ -225,15 +232,22 @@ mount_device(struct error *err, const char *root, const struct nvc_container *cn
                 error_setx(err, "invalid device node: %s", src);
                 return (NULL);
         }
+        if (cnt->flags & OPT_MKNOD_DEVICES) {
+                if ((rv = create_device(err, cnt, dst, &s)) < 0)
+                        return (NULL);
+                if (rv == 0) {
+                        if ((mnt = xstrdup(err, dst)) == NULL)
+                                unmount(dst);
+                        return (mnt);
+                }
+        }
         if (file_mode(err, src, &mode) < 0)
                 return (NULL);
         if (file_create(err, dst, NULL, cnt->uid, cnt->gid, mode) < 0)
                 return (NULL);
 
         log_infof("mounting %s at %s", src, dst);
-        if (xmount(err, src, dst, NULL, MS_BIND, NULL) < 0)
-                goto fail;
-        if (xmount(err, NULL, dst, NULL, MS_BIND|MS_REMOUNT | MS_RDONLY|MS_NOSUID|MS_NOEXEC, NULL) < 0)
+        if (bind_mount(err, src, dst, MS_RDONLY|MS_NOSUID|MS_NOEXEC) < 0)
                 goto fail;
         if ((mnt = xstrdup(err, dst)) == NULL)
                 goto fail;
@@ -244,61 +258,65 @@ mount_device(struct error *err, const char *root, const struct nvc_container *cn
         return (NULL);
 }
 
-static char *
-mount_ipc(struct error *err, const char *root, const struct nvc_container *cnt, const char *ipc)
+/*
+ * create_device creates the device node dst with the type, mode and owner of the host node s.
+ * It returns 1 if the node can't be created there and has to be bind mounted instead, that is if dst already exists,
+ * it doesn't belong to the container /dev tmpfs checked by nvc_container_new (see check_device_nodes), the filesystem
+ * doesn't allow device nodes or we aren't permitted to create them (e.g. no CAP_MKNOD).
+ */
+static int
+create_device(struct error *err, const struct nvc_container *cnt, const char *dst, const struct stat *s)
 {
-        char src[PATH_MAX];
-        char dst[PATH_MAX];
-        mode_t mode;
-        char *mnt;
-
-        if (path_join(err, src, root, ipc) < 0)
-                return (NULL);
-        if (path_resolve_full(err, dst, cnt->cfg.rootfs, ipc) < 0)
-                return (NULL);
-        if (file_mode(err, src, &mode) < 0)
-                return (NULL);
-        if (file_create(err, dst, NULL, cnt->uid, cnt->gid, mode) < 0)
-                return (NULL);
+        char devfs[PATH_MAX];
+        struct statfs fs;
+        struct stat sdir, sdev;
+        char *tmp, *dir;
+        int rv = -1;
 
-        log_infof("mounting %s at %s", src, dst);
-        if (xmount(err, src, dst, NULL, MS_BIND, NULL) < 0)
+        if ((tmp = xstrdup(err, dst)) == NULL)
+                return (-1);
+        dir = dirname(tmp);
+        if (path_resolve_full(err, devfs, cnt->cfg.rootfs, "/dev") < 0)
                 goto fail;
-        if (xmount(err, NULL, dst, NULL, MS_BIND|MS_REMOUNT | MS_NODEV|MS_NOSUID|MS_NOEXEC, NULL) < 0)
+        if (file_create(err, dir, NULL, cnt->uid, cnt->gid, MODE_DIR(0755)) < 0)
                 goto fail;
-        if ((mnt = xstrdup(err, dst)) == NULL)
+        if (statfs(dir, &fs) < 0) {
+                error_set(err, "statfs failed: %s", dir);
                 goto fail;
-        return (mnt);
-
- fail:
-        unmount(dst);
-        return (NULL);
-}
-
-static char *
-mount_app_profile(struct error *err, const struct nvc_container *cnt)
-{
-        char path[PATH_MAX];
-        char *mnt;
-
-        if (path_resolve_full(err, path, cnt->cfg.rootfs, NV_APP_PROFILE_DIR) < 0)
-                return (NULL);
-        if (file_create(err, path, NULL, cnt->uid, cnt->gid, MODE_DIR(0555)) < 0)
-                return (NULL);
-
-        log_infof("mounting tmpfs at %s", path);
-        if (xmount(err, "tmpfs", path, "tmpfs", 0, "mode=0555") < 0)
+        }
+        if (xstat(err, dir, &sdir) < 0 || xstat(err, devfs, &sdev) < 0)
                 goto fail;
-        /* XXX Some kernels require MS_BIND in order to remount within a userns */
-        if (xmount(err, NULL, path, NULL, MS_BIND|MS_REMOUNT | MS_NODEV|MS_NOSUID|MS_NOEXEC, NULL) < 0)
+        if (fs.f_type != TMPFS_MAGIC || sdir.st_dev != sdev.st_dev) {
+                log_infof("%s is not on the container /dev tmpfs; falling back to bind mount for %s", dir, dst);
+                rv = 1;
                 goto fail;
-        if ((mnt = xstrdup(err, path)) == NULL)
+        }
+        if (fs.f_flags & ST_NODEV) {
+                log_infof("%s is mounted nodev; falling back to bind mount for %s", dir, dst);
+                rv = 1;
                 goto fail;
-        return (mnt);
+        }
+
+        log_infof("creating device node %s (%u:%u)", dst, major(s->st_rdev), minor(s->st_rdev));
+        if (mknod(dst, s->st_mode & (S_IFMT|07777), s->st_rdev) < 0) {
+                if (errno != EPERM && errno != EACCES && errno != EEXIST && errno != EROFS) {
+                        error_set(err, "device node creation failed: %s", dst);
+                        goto fail;
+                }
+                log_infof("could not create device node %s: %s; falling back to bind mount", dst, strerror(errno));
+                rv = 1;
+                goto fail;
+        }
+        if (lchown(dst, s->st_uid, s->st_gid) < 0 || chmod(dst, s->st_mode & 07777) < 0) {
+                error_set(err, "device node creation failed: %s", dst);
+                unlink(dst);
+                goto fail;
+        }
+        rv = 0;
 
  fail:
-        unmount(path);
-        return (NULL);
+        free(tmp);
+        return (rv);
 }
 
 static int
@@ -310,6 +328,7 @@ update_app_profile(struct error *err, const struct nvc_container *cnt, dev_t id)
         uintmax_t n;
         uint64_t dev;
         int rv = -1;
+        trace_func();
 
 #define profile quote_str({\
         "profiles": [{"name": "_container_", "settings": ["EGLVisibleDGPUDevices", 0x%lx]}],\
@@ -345,117 +364,6 @@ update_app_profile(struct error *err, const struct nvc_container *cnt, dev_t id)
         return (rv);
 }
 
-static char *
-mount_procfs(struct error *err, const char *root, const struct nvc_container *cnt)
-{
-        char src[PATH_MAX];
-        char dst[PATH_MAX];
-        char *src_end, *dst_end, *mnt, *param;
-        mode_t mode;
-        char *buf = NULL;
-        const char *files[] = {
-                "params",
-                "version",
-                "registry",
-        };
-
-        if (path_join(err, src, root, NV_PROC_DRIVER) < 0)
-                return (NULL);
-        if (path_resolve_full(err, dst, cnt->cfg.rootfs, NV_PROC_DRIVER) < 0)
-                return (NULL);
-        src_end = src + strlen(src);
-        dst_end = dst + strlen(dst);
-
-        log_infof("mounting tmpfs at %s", dst);
-        if (xmount(err, "tmpfs", dst, "tmpfs", 0, "mode=0555") < 0)
-                return (NULL);
-
-        for (size_t i = 0; i < nitems(files); ++i) {
-                if (path_append(err, src, files[i]) < 0)
-                        goto fail;
-                if (path_append(err, dst, files[i]) < 0)
-                        goto fail;
-                if (file_mode(err, src, &mode) < 0) {
-                        if (err->code == ENOENT) {
-                                log_warnf("%s not found; skipping", src);
-                                // We reset the strings to ensure that the paths are
-                                // not concatenated if one of the files is not found.
-                                *src_end = '\0';
-                                *dst_end = '\0';
-                                continue;
-                        }
-                        goto fail;
-                }
-                if (file_read_text(err, src, &buf) < 0)
-                        goto fail;
-                /* Prevent NVRM from adjusting the device nodes. */
-                if (i == 0 && (param = strstr(buf, "ModifyDeviceFiles: 1")) != NULL)
-                        param[19] = '0';
-                if (file_create(err, dst, buf, cnt->uid, cnt->gid, mode) < 0)
-                        goto fail;
-                *src_end = '\0';
-                *dst_end = '\0';
-                free(buf);
-                buf = NULL;
-        }
-        /* XXX Some kernels require MS_BIND in order to remount within a userns */
-        if (xmount(err, NULL, dst, NULL, MS_BIND|MS_REMOUNT | MS_NODEV|MS_NOSUID|MS_NOEXEC, NULL) < 0)
-                goto fail;
-        if ((mnt = xstrdup(err, dst)) == NULL)
-                goto fail;
-        return (mnt);
-
- fail:
-        *dst_end = '\0';
-        unmount(dst);
-        free(buf);
-        return (NULL);
-}
-
-static char *
-mount_procfs_gpu(struct error *err, const char *root, const struct nvc_container *cnt, const char *busid)
-{
-        char src[PATH_MAX];
-        char dst[PATH_MAX] = {0};
-        char *gpu = NULL;
-        char *mnt = NULL;
-        mode_t mode;
-
-        for (int off = 0;; off += 4) {
-                /* XXX Check if the driver procfs uses 32-bit or 16-bit PCI domain */
-                if (xasprintf(err, &gpu, "%s/gpus/%s", NV_PROC_DRIVER, busid + off) < 0)
-                        return (NULL);
-                if (path_join(err, src, root, gpu) < 0)
-                        goto fail;
-                if (path_resolve_full(err, dst, cnt->cfg.rootfs, gpu) < 0)
-                        goto fail;
-                if (file_mode(err, src, &mode) == 0)
-                        break;
-                if (err->code != ENOENT || off != 0)
-                        goto fail;
-                *dst = '\0';
-                free(gpu);
-                gpu = NULL;
-        }
-        if (file_create(err, dst, NULL, cnt->uid, cnt->gid, mode) < 0)
-                goto fail;
-
-        log_infof("mounting %s at %s", src, dst);
-        if (xmount(err, src, dst, NULL, MS_BIND, NULL) < 0)
-                goto fail;
-        if (xmount(err, NULL, dst, NULL, MS_BIND|MS_REMOUNT | MS_RDONLY|MS_NODEV|MS_NOSUID|MS_NOEXEC, NULL) < 0)
-                goto fail;
-        if ((mnt = xstrdup(err, dst)) == NULL)
-                goto fail;
-        free(gpu);
-        return (mnt);
-
- fail:
-        free(gpu);
-        unmount(dst);
-        return (NULL);
-}
-
 static char *
 mount_procfs_mig(struct error *err, const char *root, const struct nvc_container *cnt, const char *caps_path)
 {
@@ -464,6 +372,7 @@ mount_procfs_mig(struct error *err, const char *root, const struct nvc_container
         char dst[PATH_MAX] = {0};
         char *mnt = NULL;
         mode_t mode;
+        trace_func();
 
         // Set the source path to "<root>/<caps_path>" where 'root' holds the
         // path to root on the host file system, and 'path' holds the path
@@ -486,12 +395,8 @@ mount_procfs_mig(struct error *err, const char *root, const struct nvc_container
 
         log_infof("mounting %s at %s", src, dst);
 
-        // Bind mount the source path over the destination path.
-        if (xmount(err, src, dst, NULL, MS_BIND, NULL) < 0)
-                goto fail;
-
-        // Remount the destination path to update its mountflags.
-        if (xmount(err, NULL, dst, NULL, MS_BIND|MS_REMOUNT | MS_RDONLY|MS_NODEV|MS_NOSUID|MS_NOEXEC, NULL) < 0)
+        // Bind mount the source path over the destination path with the desired mountflags.
+        if (bind_mount(err, src, dst, MS_RDONLY|MS_NODEV|MS_NOSUID|MS_NOEXEC) < 0)
                 goto fail;
 
         // Copy the destination path out to a newly allocated string and return it.
@@ -506,124 +411,734 @@ mount_procfs_mig(struct error *err, const char *root, const struct nvc_container
         return (NULL);
 }
 
-static void
-unmount(const char *path)
-{
-        if (path == NULL || str_empty(path))
-                return;
-        umount2(path, MNT_DETACH);
-        file_remove(NULL, path);
+static void
+unmount(const char *path)
+{
+        if (path == NULL || str_empty(path))
+                return;
+        umount2(path, MNT_DETACH);
+        file_remove(NULL, path);
+}
+
+/*
+ * Device cgroup rules are staged in the container and applied as a single set, either at the end of
+ * each mount operation or, with the defer-cgroups option, when nvc_device_cgroup_commit is called.
+ */
+static size_t
+device_cgroup_begin(const struct nvc_container *cnt)
+{
+        if (cnt->dev_cg_rules == NULL)
+                return (0);
+        return (cnt->dev_cg_rules->ndevs);
+}
+
+static int
+device_cgroup_add(struct error *err, const struct nvc_container *cnt, dev_t id)
+{
+        struct device_cgroup *rules = cnt->dev_cg_rules;
+        dev_t *devs;
+        size_t size;
+
+        /* Duplicates are only removed when the rules get applied (see device_cgroup_apply). */
+        if (rules->ndevs == rules->size) {
+                size = (rules->size > 0) ? rules->size * 2 : 16;
+                if ((devs = xreallocarray(err, rules->devs, size, sizeof(*devs))) == NULL)
+                        return (-1);
+                rules->devs = devs;
+                rules->size = size;
+        }
+        rules->devs[rules->ndevs++] = id;
+        return (0);
+}
+
+static int
+compare_devs(const void *p1, const void *p2)
+{
+        dev_t d1 = *(const dev_t *)p1;
+        dev_t d2 = *(const dev_t *)p2;
+
+        return ((d1 > d2) - (d1 < d2));
+}
+
+/*
+ * device_cgroup_apply sets up the device cgroup with the staged rules, sorted and deduplicated in a copy
+ * so that the staged rules can still be rolled back to a mark if this fails.
+ */
+static int
+device_cgroup_apply(struct error *err, const struct nvc_context *ctx, const struct nvc_container *cnt)
+{
+        const struct device_cgroup *rules = cnt->dev_cg_rules;
+        dev_t *devs;
+        size_t ndevs = 0;
+        int rv;
+
+        if (rules->ndevs == 0)
+                return (setup_device_cgroup(err, ctx, cnt, NULL, 0));
+        if ((devs = xcalloc(err, rules->ndevs, sizeof(*devs))) == NULL)
+                return (-1);
+        memcpy(devs, rules->devs, rules->ndevs * sizeof(*devs));
+        qsort(devs, rules->ndevs, sizeof(*devs), compare_devs);
+        for (size_t i = 0; i < rules->ndevs; ++i) {
+                if (ndevs == 0 || devs[ndevs - 1] != devs[i])
+                        devs[ndevs++] = devs[i];
+        }
+        rv = setup_device_cgroup(err, ctx, cnt, devs, ndevs);
+        free(devs);
+        return (rv);
+}
+
+static int
+device_cgroup_end(struct error *err, const struct nvc_context *ctx, const struct nvc_container *cnt, size_t mark, bool commit)
+{
+        struct device_cgroup *rules = cnt->dev_cg_rules;
+
+        if (rules == NULL)
+                return (0);
+        if (!commit) {
+                /* Drop the rules staged since the matching device_cgroup_begin. */
+                rules->ndevs = mark;
+                return (0);
+        }
+        if (cnt->flags & OPT_DEFER_CGROUPS)
+                return (0);
+        if (device_cgroup_apply(err, ctx, cnt) < 0) {
+                rules->ndevs = mark;
+                return (-1);
+        }
+        rules->ndevs = 0;
+        return (0);
+}
+
+/*
+ * Container injections are compiled into a mount plan (see mount_plan.h) before being executed as a unit.
+ * The compilation decides what goes into the container from the driver information and the container flags,
+ * the execution performs the side effects and rolls all of them back if one of them fails.
+ */
+
+static int
+plan_bind(struct error *err, struct mount_plan *plan, const char *src, const char *dst, unsigned long flags, dev_t dev, int opts)
+{
+        struct plan_action *a;
+
+        if ((a = plan_add(err, plan, PLAN_BIND, src, dst)) == NULL)
+                return (-1);
+        a->flags = flags;
+        a->dev = dev;
+        a->opts = opts;
+        return (0);
+}
+
+static int
+plan_mkdir(struct error *err, struct mount_plan *plan, const char *dst, mode_t mode)
+{
+        struct plan_action *a;
+
+        if ((a = plan_add(err, plan, PLAN_MKDIR, NULL, dst)) == NULL)
+                return (-1);
+        a->mode = mode;
+        return (0);
+}
+
+/* Device nodes are either bind mounted or, with the mknod-devices option, created in the container. */
+static int
+plan_device_node(struct error *err, struct mount_plan *plan, const struct nvc_container *cnt, const char *src, const char *dst, dev_t dev)
+{
+        struct plan_action *a;
+
+        if ((a = plan_add(err, plan, (cnt->flags & OPT_MKNOD_DEVICES) ? PLAN_MKNOD : PLAN_BIND, src, dst)) == NULL)
+                return (-1);
+        a->flags = MS_RDONLY|MS_NOSUID|MS_NOEXEC;
+        a->dev = dev;
+        return (0);
+}
+
+static int
+plan_library_symlink(struct error *err, struct mount_plan *plan, const char *dir, const char *lib)
+{
+        char path[PATH_MAX];
+        const char *target, *linkname;
+
+        if (str_has_prefix(lib, "libcuda.so")) {
+                /* XXX Many applications wrongly assume that libcuda.so exists (e.g. with dlopen). */
+                target = SONAME_LIBCUDA;
+                linkname = "libcuda.so";
+        } else if (str_has_prefix(lib, "libGLX_nvidia.so")) {
+                /* XXX GLVND requires this symlink for indirect GLX support. */
+                target = lib;
+                linkname = "libGLX_indirect.so.0";
+        } else if (str_has_prefix(lib, "libnvidia-opticalflow.so")) {
+                /* XXX Fix missing symlink for libnvidia-opticalflow.so. */
+                target = "libnvidia-opticalflow.so.1";
+                linkname = "libnvidia-opticalflow.so";
+        } else
+                return (0);
+
+        if (path_join(err, path, dir, linkname) < 0)
+                return (-1);
+        return (plan_add(err, plan, PLAN_SYMLINK, target, path) == NULL ? -1 : 0);
+}
+
+/*
+ * plan_files adds the driver files matching the container flags to dir, either bind mounted from root or,
+ * if subdir is given, linked to the driver bundle mounted at NV_BUNDLE_DIR.
+ */
+static int
+plan_files(struct error *err, struct mount_plan *plan, const struct nvc_container *cnt, const char *root,
+    const char *subdir, const char *dir, char * const paths[], size_t size)
+{
+        char src[PATH_MAX];
+        char dst[PATH_MAX];
+        struct plan_action *a;
+        const char *file;
+
+        if (paths == NULL || size == 0)
+                return (0);
+        if (plan_mkdir(err, plan, dir, MODE_DIR(0755)) < 0)
+                return (-1);
+
+        for (size_t i = 0; i < size; ++i) {
+                file = basename(paths[i]);
+                if (!match_binary_flags(file, cnt->flags) && !match_library_flags(file, cnt->flags))
+                        continue;
+                if (path_join(err, dst, dir, file) < 0)
+                        return (-1);
+                if (subdir != NULL) {
+                        if (path_join(err, src, NV_BUNDLE_DIR, subdir) < 0 || path_append(err, src, file) < 0)
+                                return (-1);
+                        /* Like a bind mount would, the driver file takes precedence over the one of the image. */
+                        if ((a = plan_add(err, plan, PLAN_SYMLINK, src, dst)) == NULL)
+                                return (-1);
+                        a->opts = PLAN_OPT_REPLACE;
+                } else {
+                        if (path_join(err, src, root, paths[i]) < 0)
+                                return (-1);
+                        if (plan_bind(err, plan, src, dst, MS_RDONLY|MS_NODEV|MS_NOSUID, 0, PLAN_OPT_REGULAR) < 0)
+                                return (-1);
+                }
+        }
+        return (0);
+}
+
+static int
+plan_library_symlinks(struct error *err, struct mount_plan *plan, const struct nvc_container *cnt,
+    const char *dir, char * const paths[], size_t size)
+{
+        const char *file;
+
+        for (size_t i = 0; paths != NULL && i < size; ++i) {
+                file = basename(paths[i]);
+                if (!match_binary_flags(file, cnt->flags) && !match_library_flags(file, cnt->flags))
+                        continue;
+                if (plan_library_symlink(err, plan, dir, file) < 0)
+                        return (-1);
+        }
+        return (0);
+}
+
+static int
+plan_procfs(struct error *err, struct mount_plan *plan, const char *root)
+{
+        char src[PATH_MAX];
+        char dst[PATH_MAX];
+        struct plan_action *a;
+        const char *files[] = {
+                "params",
+                "version",
+                "registry",
+        };
+
+        if ((a = plan_add(err, plan, PLAN_TMPFS, NULL, NV_PROC_DRIVER)) == NULL)
+                return (-1);
+        a->flags = MS_NODEV|MS_NOSUID|MS_NOEXEC;
+
+        for (size_t i = 0; i < nitems(files); ++i) {
+                if (path_join(err, src, root, NV_PROC_DRIVER) < 0 || path_append(err, src, files[i]) < 0)
+                        return (-1);
+                if (path_join(err, dst, NV_PROC_DRIVER, files[i]) < 0)
+                        return (-1);
+                if ((a = plan_add(err, plan, PLAN_COPY, src, dst)) == NULL)
+                        return (-1);
+                a->opts = PLAN_OPT_OPTIONAL | (i == 0 ? PLAN_OPT_PARAMS : 0);
+        }
+        return (0);
+}
+
+static int
+plan_app_profile(struct error *err, struct mount_plan *plan)
+{
+        struct plan_action *a;
+
+        if (plan_mkdir(err, plan, NV_APP_PROFILE_DIR, MODE_DIR(0555)) < 0)
+                return (-1);
+        if ((a = plan_add(err, plan, PLAN_TMPFS, NULL, NV_APP_PROFILE_DIR)) == NULL)
+                return (-1);
+        a->flags = MS_NODEV|MS_NOSUID|MS_NOEXEC;
+        return (0);
+}
+
+static int
+plan_driver(struct error *err, const struct nvc_context *ctx, const struct nvc_container *cnt,
+    const struct nvc_driver_info *info, const char *bundle, struct mount_plan *plan)
+{
+        char src[PATH_MAX];
+        struct plan_action *a;
+        const char *root = ctx->cfg.root;
+        trace_func();
+
+        /* Procfs mount */
+        if (ctx->dxcore.initialized)
+                log_warn("skipping procfs mount on WSL");
+        else if (plan_procfs(err, plan, root) < 0)
+                return (-1);
+
+        /* Application profile mount */
+        if (cnt->flags & OPT_GRAPHICS_LIBS) {
+                if (ctx->dxcore.initialized)
+                        log_warn("skipping app profile mount on WSL");
+                else if (plan_app_profile(err, plan) < 0)
+                        return (-1);
+        }
+
+        /* Host binary and library mounts */
+        if (bundle != NULL) {
+                if (plan_bind(err, plan, bundle, NV_BUNDLE_DIR, MS_RDONLY|MS_NODEV|MS_NOSUID, 0, 0) < 0)
+                        return (-1);
+        }
+        if (plan_files(err, plan, cnt, root, bundle ? NV_BUNDLE_BINS_SUBDIR : NULL, cnt->cfg.bins_dir, info->bins, info->nbins) < 0)
+                return (-1);
+        if (plan_files(err, plan, cnt, root, bundle ? NV_BUNDLE_LIBS_SUBDIR : NULL, cnt->cfg.libs_dir, info->libs, info->nlibs) < 0)
+                return (-1);
+        if (cnt->flags & OPT_COMPAT32) {
+                if (plan_files(err, plan, cnt, root, bundle ? NV_BUNDLE_LIBS32_SUBDIR : NULL, cnt->cfg.libs32_dir, info->libs32, info->nlibs32) < 0)
+                        return (-1);
+        }
+        if (plan_library_symlinks(err, plan, cnt, cnt->cfg.bins_dir, info->bins, info->nbins) < 0)
+                return (-1);
+        if (plan_library_symlinks(err, plan, cnt, cnt->cfg.libs_dir, info->libs, info->nlibs) < 0)
+                return (-1);
+        if ((cnt->flags & OPT_COMPAT32) &&
+            plan_library_symlinks(err, plan, cnt, cnt->cfg.libs32_dir, info->libs32, info->nlibs32) < 0)
+                return (-1);
+
+        /* Container library mounts */
+        if (cnt->flags & OPT_CUDA_COMPAT_MODE_MOUNT) {
+                if (plan_files(err, plan, cnt, cnt->cfg.rootfs, NULL, cnt->cfg.libs_dir, cnt->libs, cnt->nlibs) < 0)
+                        return (-1);
+        }
+
+        /* Firmware mounts, the paths specified are container paths and are resolved on the host. */
+        for (size_t i = 0; i < info->nfirmwares; ++i) {
+                if (path_resolve_full(err, src, root, info->firmwares[i]) < 0) {
+                        log_errf("error mounting firmware path %s", info->firmwares[i]);
+                        return (-1);
+                }
+                if (plan_bind(err, plan, src, info->firmwares[i], MS_RDONLY|MS_NODEV|MS_NOSUID, 0, 0) < 0)
+                        return (-1);
+        }
+
+        /* IPC mounts */
+        for (size_t i = 0; i < info->nipcs; ++i) {
+                /* XXX Only utility libraries require persistenced or fabricmanager IPC, everything else is compute only. */
+                if (str_has_suffix(NV_PERSISTENCED_SOCKET, info->ipcs[i]) || str_has_suffix(NV_FABRICMANAGER_SOCKET, info->ipcs[i])) {
+                        if (!(cnt->flags & OPT_UTILITY_LIBS))
+                                continue;
+                } else if (!(cnt->flags & OPT_COMPUTE_LIBS))
+                        continue;
+                if (path_join(err, src, root, info->ipcs[i]) < 0)
+                        return (-1);
+                if (plan_bind(err, plan, src, info->ipcs[i], MS_NODEV|MS_NOSUID|MS_NOEXEC, 0, 0) < 0)
+                        return (-1);
+        }
+
+        /* Device mounts */
+        for (size_t i = 0; i < info->ndevs; ++i) {
+                /* On WSL2 we only mount the /dev/dxg device and as such these checks are not applicable. */
+                if (!ctx->dxcore.initialized) {
+                        /* XXX Only compute libraries require specific devices (e.g. UVM). */
+                        if (!(cnt->flags & OPT_COMPUTE_LIBS) && major(info->devs[i].id) != NV_DEVICE_MAJOR)
+                                continue;
+                        /* XXX Only display capability requires the modeset device. */
+                        if (!(cnt->flags & OPT_DISPLAY) && minor(info->devs[i].id) == NV_MODESET_DEVICE_MINOR)
+                                continue;
+                }
+                if (!(cnt->flags & OPT_NO_DEVBIND)) {
+                        if (path_join(err, src, root, info->devs[i].path) < 0)
+                                return (-1);
+                        if (plan_device_node(err, plan, cnt, src, info->devs[i].path, info->devs[i].id) < 0)
+                                return (-1);
+                }
+                if (!(cnt->flags & OPT_NO_CGROUPS)) {
+                        if ((a = plan_add(err, plan, PLAN_CGROUP, NULL, NULL)) == NULL)
+                                return (-1);
+                        a->dev = info->devs[i].id;
+                }
+        }
+        return (0);
+}
+
+static int
+plan_device(struct error *err, const struct nvc_context *ctx, const struct nvc_container *cnt,
+    const struct nvc_device *dev, struct mount_plan *plan)
+{
+        char src[PATH_MAX];
+        char gpu[PATH_MAX];
+        struct plan_action *a;
+        const struct dxcore_adapter *adapter;
+        mode_t mode;
+        trace_func();
+
+        /*
+         * Under dxcore, devices are not directly visible and everything goes through /dev/dxg, we only need to
+         * mount the driver store. Adapter 0 is used for all the devices since all the NVIDIA adapters should share
+         * the same drivers on a system. If this assumption is changed we will need to query the LUID for each
+         * nvc_device and find the matching driver store.
+         */
+        if (ctx->dxcore.initialized) {
+                adapter = &ctx->dxcore.adapterList[0];
+                if (plan_mkdir(err, plan, adapter->pDriverStorePath, MODE_DIR(0755)) < 0)
+                        return (-1);
+                for (size_t i = 0; i < (size_t)adapter->driverStoreComponentCount; ++i) {
+                        if (path_join(err, src, ctx->cfg.root, adapter->pDriverStorePath) < 0 ||
+                            path_append(err, src, adapter->pDriverStoreComponents[i]) < 0)
+                                return (-1);
+                        if (path_join(err, gpu, adapter->pDriverStorePath, basename(adapter->pDriverStoreComponents[i])) < 0)
+                                return (-1);
+                        if (plan_bind(err, plan, src, gpu, MS_RDONLY|MS_NODEV|MS_NOSUID, 0, 0) < 0)
+                                return (-1);
+                }
+                return (0);
+        }
+
+        if (!(cnt->flags & OPT_NO_DEVBIND)) {
+                if (path_join(err, src, ctx->cfg.root, dev->node.path) < 0)
+                        return (-1);
+                if (plan_device_node(err, plan, cnt, src, dev->node.path, dev->node.id) < 0)
+                        return (-1);
+        }
+        for (size_t off = 0;; off += 4) {
+                /* XXX Check if the driver procfs uses 32-bit or 16-bit PCI domain */
+                if (xsnprintf(err, gpu, sizeof(gpu), "%s/gpus/%s", NV_PROC_DRIVER, dev->busid + off) < 0)
+                        return (-1);
+                if (path_join(err, src, ctx->cfg.root, gpu) < 0)
+                        return (-1);
+                if (file_mode(err, src, &mode) == 0)
+                        break;
+                if (err->code != ENOENT || off != 0)
+                        return (-1);
+        }
+        if (plan_bind(err, plan, src, gpu, MS_RDONLY|MS_NODEV|MS_NOSUID|MS_NOEXEC, 0, 0) < 0)
+                return (-1);
+        if (cnt->flags & OPT_GRAPHICS_LIBS) {
+                if ((a = plan_add(err, plan, PLAN_PROFILE, NULL, NULL)) == NULL)
+                        return (-1);
+                a->dev = dev->node.id;
+        }
+        if (!(cnt->flags & OPT_NO_CGROUPS)) {
+                if ((a = plan_add(err, plan, PLAN_CGROUP, NULL, NULL)) == NULL)
+                        return (-1);
+                a->dev = dev->node.id;
+        }
+        return (0);
+}
+
+static char *
+exec_bind(struct error *err, const struct nvc_container *cnt, const struct plan_action *a)
+{
+        struct stat s;
+        mode_t mode;
+
+        if (a->dev != 0) {
+                if (xstat(err, a->src, &s) < 0)
+                        return (NULL);
+                if (s.st_rdev != a->dev) {
+                        error_setx(err, "invalid device node: %s", a->src);
+                        return (NULL);
+                }
+        }
+        if (a->opts & PLAN_OPT_REGULAR) {
+                if (file_mode_nofollow(err, a->src, &mode) < 0)
+                        return (NULL);
+                // If we encounter resolved directories or symlinks here, we raise an error.
+                if (S_ISDIR(mode) || S_ISLNK(mode)) {
+                        error_setx(err, "unexpected source file mode %o for %s", mode, a->src);
+                        return (NULL);
+                }
+        }
+        return (mount_in_root(err, a->src, cnt->cfg.rootfs, a->dst, cnt->uid, cnt->gid, a->flags));
+}
+
+/*
+ * exec_mknod creates the device node of the action, or bind mounts it if the node can't be created.
+ * Nodes actually created are counted in nnodes.
+ */
+static char *
+exec_mknod(struct error *err, const struct nvc_container *cnt, const struct plan_action *a, size_t *nnodes)
+{
+        char path[PATH_MAX];
+        struct stat s;
+        char *mnt;
+        int rv;
+
+        if (xstat(err, a->src, &s) < 0)
+                return (NULL);
+        if (s.st_rdev != a->dev) {
+                error_setx(err, "invalid device node: %s", a->src);
+                return (NULL);
+        }
+        if (path_resolve_full(err, path, cnt->cfg.rootfs, a->dst) < 0)
+                return (NULL);
+        if ((rv = create_device(err, cnt, path, &s)) < 0)
+                return (NULL);
+        if (rv > 0)
+                return (mount_with_flags(err, a->src, path, cnt->uid, cnt->gid, a->flags));
+        if ((mnt = xstrdup(err, path)) == NULL) {
+                unmount(path);
+                return (NULL);
+        }
+        ++*nnodes;
+        return (mnt);
+}
+
+static char *
+exec_tmpfs(struct error *err, const struct nvc_container *cnt, const struct plan_action *a)
+{
+        char path[PATH_MAX];
+        char *mnt;
+
+        if (path_resolve_full(err, path, cnt->cfg.rootfs, a->dst) < 0)
+                return (NULL);
+
+        log_infof("mounting tmpfs at %s", path);
+        if (xmount(err, "tmpfs", path, "tmpfs", 0, "mode=0555") < 0)
+                return (NULL);
+        /* XXX Some kernels require MS_BIND in order to remount within a userns */
+        if (xmount(err, NULL, path, NULL, MS_BIND|MS_REMOUNT | a->flags, NULL) < 0)
+                goto fail;
+        if ((mnt = xstrdup(err, path)) == NULL)
+                goto fail;
+        return (mnt);
+
+ fail:
+        unmount(path);
+        return (NULL);
 }
 
 static int
-symlink_library(struct error *err, const char *src, const char *target, const char *linkname, uid_t uid, gid_t gid)
+exec_copy(struct error *err, const struct nvc_container *cnt, const struct plan_action *a)
 {
         char path[PATH_MAX];
-        char *tmp;
+        char *buf = NULL;
+        char *param;
+        mode_t mode;
         int rv = -1;
 
-        if ((tmp = xstrdup(err, src)) == NULL)
+        if (file_mode(err, a->src, &mode) < 0) {
+                if (err->code == ENOENT && (a->opts & PLAN_OPT_OPTIONAL)) {
+                        log_warnf("%s not found; skipping", a->src);
+                        error_reset(err);
+                        return (0);
+                }
                 return (-1);
-        if (path_join(err, path, dirname(tmp), linkname) < 0)
-                goto fail;
-
-        log_infof("creating symlink %s -> %s", path, target);
-        if (file_create(err, path, target, uid, gid, MODE_LNK(0777)) < 0)
+        }
+        if (path_resolve_full(err, path, cnt->cfg.rootfs, a->dst) < 0)
+                return (-1);
+        if (file_read_text(err, a->src, &buf) < 0)
+                return (-1);
+        if ((a->opts & PLAN_OPT_PARAMS) && (param = strstr(buf, "ModifyDeviceFiles: 1")) != NULL)
+                param[19] = '0';
+        if (file_create(err, path, buf, cnt->uid, cnt->gid, mode) < 0)
                 goto fail;
         rv = 0;
 
  fail:
-        free(tmp);
+        free(buf);
         return (rv);
 }
 
 static int
-symlink_libraries(struct error *err, const struct nvc_container *cnt, const char * const paths[], size_t size)
+exec_mkdir(struct error *err, const struct nvc_container *cnt, const struct plan_action *a)
 {
-        char *lib;
+        char path[PATH_MAX];
 
-        for (size_t i = 0; i < size; ++i) {
-                lib = basename(paths[i]);
-                if (str_has_prefix(lib, "libcuda.so")) {
-                        /* XXX Many applications wrongly assume that libcuda.so exists (e.g. with dlopen). */
-                        if (symlink_library(err, paths[i], SONAME_LIBCUDA, "libcuda.so", cnt->uid, cnt->gid) < 0)
-                                return (-1);
-                } else if (str_has_prefix(lib, "libGLX_nvidia.so")) {
-                        /* XXX GLVND requires this symlink for indirect GLX support. */
-                        if (symlink_library(err, paths[i], lib, "libGLX_indirect.so.0", cnt->uid, cnt->gid) < 0)
-                                return (-1);
-                } else if (str_has_prefix(lib, "libnvidia-opticalflow.so")) {
-                        /* XXX Fix missing symlink for libnvidia-opticalflow.so. */
-                        if (symlink_library(err, paths[i], "libnvidia-opticalflow.so.1", "libnvidia-opticalflow.so", cnt->uid, cnt->gid) < 0)
-                                return (-1);
-                }
-        }
-        return (0);
+        if (path_resolve_full(err, path, cnt->cfg.rootfs, a->dst) < 0)
+                return (-1);
+        return (file_create(err, path, NULL, cnt->uid, cnt->gid, a->mode));
 }
 
+/* The symlink is created aside and renamed over path, so that path never goes missing. */
 static int
-device_mount_dxcore(struct nvc_context *ctx, const struct nvc_container *cnt)
+replace_symlink(struct error *err, const struct nvc_container *cnt, const char *path, const char *target)
 {
-        char **drvstore_mnt = NULL;
-        size_t drvstore_size = 0;
-
-        // under dxcore we want to mount the driver store key libraries.
-        // Devices are not directly visible under dxcore everything is done via /dev/dxg
-        // so we only need to mount the per-gpu driver driverStore there are no other per gpu
-        // device mounting that needs to be done
-        //
-        // Note that we are using adapter 0 for all the devices. This is because all
-        // the NVIDIA adapters should share the same drivers on a system. If this
-        // assumption is changed we will need to query the LUID for each nvc_device
-        // and find the matching driver store.
-        drvstore_size = (size_t)ctx->dxcore.adapterList[0].driverStoreComponentCount;
-        if ((drvstore_mnt = mount_driverstore_files(&ctx->err,
-                                                    ctx->cfg.root,
-                                                    cnt,
-                                                    ctx->dxcore.adapterList[0].pDriverStorePath,
-                                                    ctx->dxcore.adapterList[0].pDriverStoreComponents,
-                                                    drvstore_size)) == NULL)
-        {
-                log_errf("failed to mount DriverStore components %s", ctx->dxcore.adapterList[0].pDriverStorePath);
+        char tmp[PATH_MAX];
+
+        if (xsnprintf(err, tmp, sizeof(tmp), "%s.%ld", path, (long)getpid()) < 0)
+                return (-1);
+        unlink(tmp);
+        if (file_create(err, tmp, target, cnt->uid, cnt->gid, MODE_LNK(0777)) < 0)
+                return (-1);
+        if (rename(tmp, path) < 0) {
+                error_set(err, "rename failed: %s", tmp);
+                unlink(tmp);
                 return (-1);
         }
-
-        return 0;
+        return (0);
 }
 
+/*
+ * Symlinks are created in the resolved parent directory, an existing symlink at dst is not followed.
+ * Unless the action says otherwise, an existing entry at dst is left untouched and never removed on rollback.
+ * With PLAN_OPT_REPLACE, an existing symlink is replaced and its target kept for rollback, while any other entry
+ * of the image (e.g. a library file) is shadowed with a bind mount of src instead, leaving the image as it was.
+ */
 static int
-device_mount_native(struct nvc_context *ctx, const struct nvc_container *cnt, const struct nvc_device *dev)
+exec_symlink(struct error *err, const struct nvc_container *cnt, const struct plan_action *a, struct plan_undo *undo)
 {
-        char *dev_mnt = NULL;
-        char *proc_mnt = NULL;
+        char path[PATH_MAX];
+        char src[PATH_MAX];
+        char target[PATH_MAX];
+        struct stat s;
+        char *dir;
+        ssize_t n;
+        bool existed;
         int rv = -1;
 
-        if (!(cnt->flags & OPT_NO_DEVBIND)) {
-                if ((dev_mnt = mount_device(&ctx->err, ctx->cfg.root, cnt, &dev->node)) == NULL)
-                        goto fail;
-        }
-        if ((proc_mnt = mount_procfs_gpu(&ctx->err, ctx->cfg.root, cnt, dev->busid)) == NULL)
+        if ((dir = xstrdup(err, a->dst)) == NULL)
+                return (-1);
+        if (path_resolve_full(err, path, cnt->cfg.rootfs, dirname(dir)) < 0)
                 goto fail;
-        if (cnt->flags & OPT_GRAPHICS_LIBS) {
-                if (update_app_profile(&ctx->err, cnt, dev->node.id) < 0)
+        if (path_append(err, path, basename(a->dst)) < 0)
+                goto fail;
+        existed = (lstat(path, &s) == 0);
+
+        if ((a->opts & PLAN_OPT_REPLACE) && existed && !S_ISLNK(s.st_mode)) {
+                if (path_resolve_full(err, src, cnt->cfg.rootfs, a->src) < 0)
                         goto fail;
-        }
-        if (!(cnt->flags & OPT_NO_CGROUPS)) {
-                if (setup_device_cgroup(&ctx->err, cnt, dev->node.id) < 0)
+                log_infof("mounting %s over %s", src, path);
+                if (bind_mount(err, src, path, MS_RDONLY|MS_NODEV|MS_NOSUID) < 0)
+                        goto fail;
+                if ((undo->path = xstrdup(err, path)) == NULL) {
+                        umount2(path, MNT_DETACH);
                         goto fail;
+                }
+                undo->shadow = true;
+                rv = 0;
+                goto fail;
         }
 
+        log_infof("creating symlink %s -> %s", path, a->src);
+        if ((a->opts & PLAN_OPT_REPLACE) && existed) {
+                if ((n = readlink(path, target, sizeof(target) - 1)) < 0) {
+                        error_set(err, "readlink failed: %s", path);
+                        goto fail;
+                }
+                target[n] = '\0';
+                if ((undo->target = xstrdup(err, target)) == NULL)
+                        goto fail;
+                if (replace_symlink(err, cnt, path, a->src) < 0)
+                        goto fail;
+        } else if (file_create(err, path, a->src, cnt->uid, cnt->gid, MODE_LNK(0777)) < 0) {
+                goto fail;
+        }
+        if ((undo->path = xstrdup(err, (existed && undo->target == NULL) ? "" : path)) == NULL)
+                goto fail;
         rv = 0;
 
  fail:
         if (rv < 0) {
-                unmount(proc_mnt);
-                unmount(dev_mnt);
+                free(undo->target);
+                undo->target = NULL;
         }
+        free(dir);
+        return (rv);
+}
 
-        free(proc_mnt);
-        free(dev_mnt);
+static void
+plan_undo(const struct nvc_container *cnt, const struct plan_undo *undo)
+{
+        if (undo->path == NULL)
+                return;
+        if (undo->target != NULL)
+                replace_symlink(NULL, cnt, undo->path, undo->target);
+        else if (undo->shadow)
+                umount2(undo->path, MNT_DETACH);
+        else
+                unmount(undo->path);
+}
+
+/*
+ * plan_execute applies a plan within the container mount namespace. Everything mounted or linked by the plan is undone
+ * if an action fails, and the device cgroup rules of the plan are applied as a single set at the end.
+ */
+static int
+plan_execute(struct nvc_context *ctx, const struct nvc_container *cnt, const struct mount_plan *plan)
+{
+        const struct plan_action *a;
+        struct plan_undo *undo;
+        size_t nundo = 0;
+        size_t ndevs = 0, nnodes = 0;
+        size_t cg_mark;
+        int rv = -1;
+        trace_func();
+
+        if ((undo = xcalloc(&ctx->err, plan->nactions, sizeof(*undo))) == NULL)
+                return (-1);
+        cg_mark = device_cgroup_begin(cnt);
+
+        for (size_t i = 0; i < plan->nactions; ++i) {
+                a = &plan->actions[i];
+                switch (a->op) {
+                case PLAN_MKDIR:
+                        if (exec_mkdir(&ctx->err, cnt, a) < 0)
+                                goto fail;
+                        break;
+                case PLAN_BIND:
+                        if ((undo[nundo++].path = exec_bind(&ctx->err, cnt, a)) == NULL)
+                                goto fail;
+                        break;
+                case PLAN_MKNOD:
+                        ++ndevs;
+                        if ((undo[nundo++].path = exec_mknod(&ctx->err, cnt, a, &nnodes)) == NULL)
+                                goto fail;
+                        break;
+                case PLAN_TMPFS:
+                        if ((undo[nundo++].path = exec_tmpfs(&ctx->err, cnt, a)) == NULL)
+                                goto fail;
+                        break;
+                case PLAN_COPY:
+                        if (exec_copy(&ctx->err, cnt, a) < 0)
+                                goto fail;
+                        break;
+                case PLAN_SYMLINK:
+                        if (exec_symlink(&ctx->err, cnt, a, &undo[nundo++]) < 0)
+                                goto fail;
+                        break;
+                case PLAN_PROFILE:
+                        if (update_app_profile(&ctx->err, cnt, a->dev) < 0)
+                                goto fail;
+                        break;
+                case PLAN_CGROUP:
+                        if (device_cgroup_add(&ctx->err, cnt, a->dev) < 0)
+                                goto fail;
+                        break;
+                }
+        }
+        if (device_cgroup_end(&ctx->err, ctx, cnt, cg_mark, true) < 0)
+                goto fail;
+        if (ndevs > 0)
+                log_infof("created %zu of %zu device nodes, bind mounted the others", nnodes, ndevs);
+        rv = 0;
 
+ fail:
+        if (rv < 0) {
+                device_cgroup_end(NULL, ctx, cnt, cg_mark, false);
+                while (nundo > 0)
+                        plan_undo(cnt, &undo[--nundo]);
+        }
+        for (size_t i = 0; i < plan->nactions; ++i) {
+                free(undo[i].path);
+                free(undo[i].target);
+        }
+        free(undo);
         return (rv);
 }
 
@@ -642,7 +1157,7 @@ cap_device_mount(struct nvc_context *ctx, const struct nvc_container *cnt, const
                        goto fail;
         }
         if (!(cnt->flags & OPT_NO_CGROUPS))
-                if (setup_device_cgroup(&ctx->err, cnt, node.id) < 0)
+                if (device_cgroup_add(&ctx->err, cnt, node.id) < 0)
                         goto fail;
 
         rv = 0;
@@ -659,178 +1174,133 @@ cap_device_mount(struct nvc_context *ctx, const struct nvc_container *cnt, const
 }
 
 static int
-setup_mig_minor_cgroups(struct error *err, const struct nvc_container *cnt, int mig_major, const struct nvc_device_node *node)
+setup_mig_minor_cgroups(struct nvc_context *ctx, const struct nvc_container *cnt, int mig_major, const struct nvc_device_node *node)
 {
-        unsigned int gpu_minor = 0;
-        unsigned int mig_minor = 0;
-        char line[PATH_MAX];
-        char dummy[PATH_MAX];
-        FILE *fp;
-        int rv = -1;
+        const struct mig_minor *entries;
+        size_t n;
 
-        if ((fp = fopen(NV_CAPS_MIG_MINORS_PATH, "r")) == NULL) {
-            error_set(err, "unable to open file for reading: %s", NV_CAPS_MIG_MINORS_PATH);
-            goto fail;
+        if (mig_minors_load(&ctx->err, &ctx->mig_minors) < 0)
+                return (-1);
+        if (ctx->mig_minors.missing) {
+                error_setx(&ctx->err, "unable to open file for reading: %s", NV_CAPS_MIG_MINORS_PATH);
+                return (-1);
         }
-
-        line[PATH_MAX - 1] = '\0';
-        while (fgets(line, PATH_MAX - 1, fp)) {
-                if (sscanf(line, "gpu%u%s %u", &gpu_minor, dummy, &mig_minor) != 3)
-                        continue;
-                if (gpu_minor != minor(node->id))
-                        continue;
-                if (setup_device_cgroup(err, cnt, makedev((unsigned int)mig_major, mig_minor)) < 0)
-                        goto fail;
+        n = mig_minors_for_gpu(&ctx->mig_minors, minor(node->id), &entries);
+        for (size_t i = 0; i < n; ++i) {
+                if (device_cgroup_add(&ctx->err, cnt, makedev((unsigned int)mig_major, entries[i].minor)) < 0)
+                        return (-1);
         }
-
-        rv = 0;
-
-fail:
-        fclose(fp);
-        return (rv);
+        return (0);
 }
 
 int
 nvc_driver_mount(struct nvc_context *ctx, const struct nvc_container *cnt, const struct nvc_driver_info *info)
 {
-        const char **mnt, **ptr, **tmp;
-        size_t nmnt;
+        char bundle[PATH_MAX];
+        struct mount_plan plan = {NULL, 0, 0};
+        bool use_bundle;
+        int lock = -1;
         int rv = -1;
+        trace_func();
 
         if (validate_context(ctx) < 0)
                 return (-1);
         if (validate_args(ctx, cnt != NULL && info != NULL) < 0)
                 return (-1);
 
-        if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
+        /*
+         * The driver bundle is staged on the host before entering the container namespace,
+         * and is kept locked until it is mounted so that it can't be removed in the meantime.
+         */
+        use_bundle = (cnt->flags & OPT_DRIVER_BUNDLE) && !ctx->dxcore.initialized;
+        if (use_bundle && (lock = bundle_stage(&ctx->err, ctx->cfg.root, info, cnt->flags, bundle)) < 0)
                 return (-1);
-
-        nmnt = 2 + info->nbins + info->nlibs + cnt->nlibs + info->nlibs32 + info->nipcs + info->ndevs + info->nfirmwares;
-        mnt = ptr = (const char **)array_new(&ctx->err, nmnt);
-        if (mnt == NULL)
-                goto fail;
-
-        /* Procfs mount */
-        if (ctx->dxcore.initialized)
-                log_warn("skipping procfs mount on WSL");
-        else if ((*ptr++ = mount_procfs(&ctx->err, ctx->cfg.root, cnt)) == NULL)
+        if (plan_driver(&ctx->err, ctx, cnt, info, use_bundle ? bundle : NULL, &plan) < 0)
                 goto fail;
 
-        /* Application profile mount */
-        if (cnt->flags & OPT_GRAPHICS_LIBS) {
-                if (ctx->dxcore.initialized)
-                        log_warn("skipping app profile mount on WSL");
-                else if ((*ptr++ = mount_app_profile(&ctx->err, cnt)) == NULL)
-                        goto fail;
-        }
-
-        /* Host binary and library mounts */
-        if (info->bins != NULL && info->nbins > 0) {
-                if ((tmp = (const char **)mount_files(&ctx->err, ctx->cfg.root, cnt, cnt->cfg.bins_dir, info->bins, info->nbins)) == NULL)
-                        goto fail;
-                ptr = array_append(ptr, tmp, array_size(tmp));
-                free(tmp);
-        }
-        if (info->libs != NULL && info->nlibs > 0) {
-                if ((tmp = (const char **)mount_files(&ctx->err, ctx->cfg.root, cnt, cnt->cfg.libs_dir, info->libs, info->nlibs)) == NULL)
-                        goto fail;
-                ptr = array_append(ptr, tmp, array_size(tmp));
-                free(tmp);
-        }
-        if ((cnt->flags & OPT_COMPAT32) && info->libs32 != NULL && info->nlibs32 > 0) {
-                if ((tmp = (const char **)mount_files(&ctx->err, ctx->cfg.root, cnt, cnt->cfg.libs32_dir, info->libs32, info->nlibs32)) == NULL)
-                        goto fail;
-                ptr = array_append(ptr, tmp, array_size(tmp));
-                free(tmp);
-        }
-        if (symlink_libraries(&ctx->err, cnt, mnt, (size_t)(ptr - mnt)) < 0)
+        if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
                 goto fail;
+        if (plan_execute(ctx, cnt, &plan) < 0)
+                assert_func(ns_enter_at(NULL, ctx->mnt_ns, CLONE_NEWNS));
+        else rv = ns_enter_at(&ctx->err, ctx->mnt_ns, CLONE_NEWNS);
 
-        /* Container library mounts */
-        if ((cnt->flags & OPT_CUDA_COMPAT_MODE_MOUNT) && cnt->libs != NULL && cnt->nlibs > 0) {
-                if ((tmp = (const char **)mount_files(&ctx->err, cnt->cfg.rootfs, cnt, cnt->cfg.libs_dir, cnt->libs, cnt->nlibs)) == NULL) {
-                        goto fail;
-                }
-                ptr = array_append(ptr, tmp, array_size(tmp));
-                free(tmp);
-        }
+ fail:
+        xclose(lock);
+        plan_free(&plan);
+        return (rv);
+}
 
-        /* Firmware mounts */
-        for (size_t i = 0; i < info->nfirmwares; ++i) {
-                if ((*ptr++ = mount_firmware(&ctx->err, ctx->cfg.root, cnt, info->firmwares[i])) == NULL) {
-                        log_errf("error mounting firmware path %s", info->firmwares[i]);
-                        goto fail;
-                }
-        }
+int
+nvc_driver_mount_plan(struct nvc_context *ctx, const struct nvc_container *cnt, const struct nvc_driver_info *info, char **json)
+{
+        char bundle[PATH_MAX];
+        struct mount_plan plan = {NULL, 0, 0};
+        bool use_bundle;
+        int rv = -1;
+        trace_func();
 
-        /* IPC mounts */
-        for (size_t i = 0; i < info->nipcs; ++i) {
-                /* XXX Only utility libraries require persistenced or fabricmanager IPC, everything else is compute only. */
-                if (str_has_suffix(NV_PERSISTENCED_SOCKET, info->ipcs[i]) || str_has_suffix(NV_FABRICMANAGER_SOCKET, info->ipcs[i])) {
-                        if (!(cnt->flags & OPT_UTILITY_LIBS))
-                                continue;
-                } else if (!(cnt->flags & OPT_COMPUTE_LIBS))
-                        continue;
-                if ((*ptr++ = mount_ipc(&ctx->err, ctx->cfg.root, cnt, info->ipcs[i])) == NULL)
-                        goto fail;
-        }
+        if (validate_context(ctx) < 0)
+                return (-1);
+        if (validate_args(ctx, cnt != NULL && info != NULL && json != NULL) < 0)
+                return (-1);
 
-        /* Device mounts */
-        for (size_t i = 0; i < info->ndevs; ++i) {
-                /* On WSL2 we only mount the /dev/dxg device and as such these checks are not applicable. */
-                if (!ctx->dxcore.initialized) {
-                        /* XXX Only compute libraries require specific devices (e.g. UVM). */
-                        if (!(cnt->flags & OPT_COMPUTE_LIBS) && major(info->devs[i].id) != NV_DEVICE_MAJOR)
-                                continue;
-                        /* XXX Only display capability requires the modeset device. */
-                        if (!(cnt->flags & OPT_DISPLAY) && minor(info->devs[i].id) == NV_MODESET_DEVICE_MINOR)
-                                continue;
-                }
-                if (!(cnt->flags & OPT_NO_DEVBIND)) {
-                        if ((*ptr++ = mount_device(&ctx->err, ctx->cfg.root, cnt, &info->devs[i])) == NULL)
-                                goto fail;
-                }
-                if (!(cnt->flags & OPT_NO_CGROUPS)) {
-                        if (setup_device_cgroup(&ctx->err, cnt, info->devs[i].id) < 0)
-                                goto fail;
-                }
-        }
-        rv = 0;
+        /* Nothing gets staged, the plan only refers to where the driver bundle would be. */
+        use_bundle = (cnt->flags & OPT_DRIVER_BUNDLE) && !ctx->dxcore.initialized;
+        if (use_bundle && bundle_path(&ctx->err, info, cnt->flags, bundle) < 0)
+                return (-1);
+        if (plan_driver(&ctx->err, ctx, cnt, info, use_bundle ? bundle : NULL, &plan) < 0)
+                goto fail;
+        rv = plan_to_json(&ctx->err, &plan, json);
 
  fail:
-        if (rv < 0) {
-                for (size_t i = 0; mnt != NULL && i < nmnt; ++i)
-                        unmount(mnt[i]);
-                assert_func(ns_enter_at(NULL, ctx->mnt_ns, CLONE_NEWNS));
-        } else {
-                rv = ns_enter_at(&ctx->err, ctx->mnt_ns, CLONE_NEWNS);
-        }
-
-        array_free((char **)mnt, nmnt);
+        plan_free(&plan);
         return (rv);
 }
 
 int
 nvc_device_mount(struct nvc_context *ctx, const struct nvc_container *cnt, const struct nvc_device *dev)
 {
+        struct mount_plan plan = {NULL, 0, 0};
         int rv = -1;
+        trace_func();
 
         if (validate_context(ctx) < 0)
                 return (-1);
         if (validate_args(ctx, cnt != NULL && dev != NULL) < 0)
                 return (-1);
 
-        if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
-                return (-1);
-
-        if (ctx->dxcore.initialized)
-                rv = device_mount_dxcore(ctx, cnt);
-        else rv = device_mount_native(ctx, cnt, dev);
+        if (plan_device(&ctx->err, ctx, cnt, dev, &plan) < 0)
+                goto fail;
 
-        if (rv < 0)
+        if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
+                goto fail;
+        if (plan_execute(ctx, cnt, &plan) < 0)
                 assert_func(ns_enter_at(NULL, ctx->mnt_ns, CLONE_NEWNS));
         else rv = ns_enter_at(&ctx->err, ctx->mnt_ns, CLONE_NEWNS);
 
+ fail:
+        plan_free(&plan);
+        return (rv);
+}
+
+int
+nvc_device_mount_plan(struct nvc_context *ctx, const struct nvc_container *cnt, const struct nvc_device *dev, char **json)
+{
+        struct mount_plan plan = {NULL, 0, 0};
+        int rv = -1;
+        trace_func();
+
+        if (validate_context(ctx) < 0)
+                return (-1);
+        if (validate_args(ctx, cnt != NULL && dev != NULL && json != NULL) < 0)
+                return (-1);
+
+        if (plan_device(&ctx->err, ctx, cnt, dev, &plan) < 0)
+                goto fail;
+        rv = plan_to_json(&ctx->err, &plan, json);
+
+ fail:
+        plan_free(&plan);
         return (rv);
 }
 
@@ -841,7 +1311,9 @@ nvc_mig_device_access_caps_mount(struct nvc_context *ctx, const struct nvc_conta
         char access[PATH_MAX];
         char *proc_mnt_gi = NULL;
         char *proc_mnt_ci = NULL;
+        size_t cg_mark;
         int rv = -1;
+        trace_func();
 
         // Validate incoming arguments.
         if (validate_context(ctx) < 0)
@@ -853,6 +1325,9 @@ nvc_mig_device_access_caps_mount(struct nvc_context *ctx, const struct nvc_conta
         if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
                 return (-1);
 
+        // Start staging device cgroup rules for this operation.
+        cg_mark = device_cgroup_begin(cnt);
+
         // Construct the path to the 'access' file in '/proc' for the GPU Instance.
         if (path_join(&ctx->err, access, dev->gi_caps_path, NV_MIG_ACCESS_FILE) < 0)
                 goto fail;
@@ -883,13 +1358,19 @@ nvc_mig_device_access_caps_mount(struct nvc_context *ctx, const struct nvc_conta
                 goto fail;
         }
 
+        // Apply the device cgroup rules staged for both capabilities at once.
+        if (device_cgroup_end(&ctx->err, ctx, cnt, cg_mark, true) < 0)
+                goto fail;
+
         // Set the return value to indicate success.
         rv = 0;
 
  fail:
         if (rv < 0) {
-                // If we failed above for any reason, unmount the 'access' file
-                // we mounted and exit the mount namespace.
+                // If we failed above for any reason, drop the staged device
+                // cgroup rules, unmount the 'access' file we mounted and exit
+                // the mount namespace.
+                device_cgroup_end(NULL, ctx, cnt, cg_mark, false);
                 unmount(proc_mnt_gi);
                 unmount(proc_mnt_ci);
                 assert_func(ns_enter_at(NULL, ctx->mnt_ns, CLONE_NEWNS));
@@ -913,7 +1394,9 @@ nvc_mig_config_global_caps_mount(struct nvc_context *ctx, const struct nvc_conta
         char *dev_mnt = NULL;
         char *proc_mnt = NULL;
         struct nvc_device_node node = {0};
+        size_t cg_mark;
         int rv = -1;
+        trace_func();
 
         // Validate incoming arguments.
         if (validate_context(ctx) < 0)
@@ -925,6 +1408,9 @@ nvc_mig_config_global_caps_mount(struct nvc_context *ctx, const struct nvc_conta
         if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
                 return (-1);
 
+        // Start staging device cgroup rules for this operation.
+        cg_mark = device_cgroup_begin(cnt);
+
         // Mount the entire 'nvidia-capabilities' folder from '/proc' into the container.
         if ((proc_mnt = mount_procfs_mig(&ctx->err, ctx->cfg.root, cnt, NV_PROC_DRIVER_CAPS)) == NULL)
                 goto fail;
@@ -942,17 +1428,23 @@ nvc_mig_config_global_caps_mount(struct nvc_context *ctx, const struct nvc_conta
                         goto fail;
 
                 if (!(cnt->flags & OPT_NO_CGROUPS))
-                        if (setup_device_cgroup(&ctx->err, cnt, node.id) < 0)
+                        if (device_cgroup_add(&ctx->err, cnt, node.id) < 0)
                                 goto fail;
         }
 
+        // Apply the staged device cgroup rules.
+        if (device_cgroup_end(&ctx->err, ctx, cnt, cg_mark, true) < 0)
+                goto fail;
+
         // Set the return value to indicate success.
         rv = 0;
 
  fail:
         if (rv < 0) {
-                // If we failed above for any reason, unmount the 'access' file
-                // we mounted and exit the mount namespace.
+                // If we failed above for any reason, drop the staged device
+                // cgroup rules, unmount the 'access' file we mounted and exit
+                // the mount namespace.
+                device_cgroup_end(NULL, ctx, cnt, cg_mark, false);
                 unmount(proc_mnt);
                 assert_func(ns_enter_at(NULL, ctx->mnt_ns, CLONE_NEWNS));
         } else {
@@ -975,7 +1467,9 @@ nvc_mig_monitor_global_caps_mount(struct nvc_context *ctx, const struct nvc_cont
         char *dev_mnt = NULL;
         char *proc_mnt = NULL;
         struct nvc_device_node node = {0};
+        size_t cg_mark;
         int rv = -1;
+        trace_func();
 
         // Validate incoming arguments.
         if (validate_context(ctx) < 0)
@@ -987,6 +1481,9 @@ nvc_mig_monitor_global_caps_mount(struct nvc_context *ctx, const struct nvc_cont
         if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
                 return (-1);
 
+        // Start staging device cgroup rules for this operation.
+        cg_mark = device_cgroup_begin(cnt);
+
         // Mount the entire 'nvidia-capabilities' folder from '/proc' into the container.
         if ((proc_mnt = mount_procfs_mig(&ctx->err, ctx->cfg.root, cnt, NV_PROC_DRIVER_CAPS)) == NULL)
                 goto fail;
@@ -1004,17 +1501,23 @@ nvc_mig_monitor_global_caps_mount(struct nvc_context *ctx, const struct nvc_cont
                         goto fail;
 
                 if (!(cnt->flags & OPT_NO_CGROUPS))
-                        if (setup_device_cgroup(&ctx->err, cnt, node.id) < 0)
+                        if (device_cgroup_add(&ctx->err, cnt, node.id) < 0)
                                 goto fail;
         }
 
+        // Apply the staged device cgroup rules.
+        if (device_cgroup_end(&ctx->err, ctx, cnt, cg_mark, true) < 0)
+                goto fail;
+
         // Set the return value to indicate success.
         rv = 0;
 
  fail:
         if (rv < 0) {
-                // If we failed above for any reason, unmount the 'access' file
-                // we mounted and exit the mount namespace.
+                // If we failed above for any reason, drop the staged device
+                // cgroup rules, unmount the 'access' file we mounted and exit
+                // the mount namespace.
+                device_cgroup_end(NULL, ctx, cnt, cg_mark, false);
                 unmount(proc_mnt);
                 assert_func(ns_enter_at(NULL, ctx->mnt_ns, CLONE_NEWNS));
         } else {
@@ -1034,7 +1537,9 @@ nvc_device_mig_caps_mount(struct nvc_context *ctx, const struct nvc_container *c
 {
         // Initialize local variables.
         int nvcaps_major = -1;
+        size_t cg_mark;
         int rv = -1;
+        trace_func();
 
         // Validate incoming arguments.
         if (validate_context(ctx) < 0)
@@ -1046,19 +1551,27 @@ nvc_device_mig_caps_mount(struct nvc_context *ctx, const struct nvc_container *c
         if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
                 return (-1);
 
+        // Start staging device cgroup rules for this operation.
+        cg_mark = device_cgroup_begin(cnt);
+
         // Check if NV_CAPS_MODULE_NAME exists as a major device, and if so,
         // mount in the appropriate /dev based capabilities as devices.
         if ((nvcaps_major = nvidia_get_chardev_major(NV_CAPS_MODULE_NAME)) != -1) {
                 if (!(cnt->flags & OPT_NO_CGROUPS))
-                        if (setup_mig_minor_cgroups(&ctx->err, cnt, nvcaps_major, &dev->node) < 0)
+                        if (setup_mig_minor_cgroups(ctx, cnt, nvcaps_major, &dev->node) < 0)
                                 goto fail;
         }
 
+        // Apply the device cgroup rules staged for all MIG minors at once.
+        if (device_cgroup_end(&ctx->err, ctx, cnt, cg_mark, true) < 0)
+                goto fail;
+
         // Set the return value to indicate success.
         rv = 0;
 
  fail:
         if (rv < 0) {
+                device_cgroup_end(NULL, ctx, cnt, cg_mark, false);
                 assert_func(ns_enter_at(NULL, ctx->mnt_ns, CLONE_NEWNS));
         } else {
                 rv = ns_enter_at(&ctx->err, ctx->mnt_ns, CLONE_NEWNS);
@@ -1074,7 +1587,9 @@ nvc_imex_channel_mount(struct nvc_context *ctx, const struct nvc_container *cnt,
         char path[PATH_MAX];
         struct nvc_device_node node;
         char *mnt = NULL;
+        size_t cg_mark;
         int rv = -1;
+        trace_func();
 
         // Validate incoming arguments.
         if (validate_context(ctx) < 0)
@@ -1086,6 +1601,9 @@ nvc_imex_channel_mount(struct nvc_context *ctx, const struct nvc_container *cnt,
         if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
                 return (-1);
 
+        // Start staging device cgroup rules for this operation.
+        cg_mark = device_cgroup_begin(cnt);
+
         // Construct a device node for the channel.
         if (xsnprintf(&ctx->err, path, sizeof(path), NV_CAPS_IMEX_DEVICE_PATH, chan->id) < 0)
             goto fail;
@@ -1098,15 +1616,18 @@ nvc_imex_channel_mount(struct nvc_context *ctx, const struct nvc_container *cnt,
                         goto fail;
         }
         if (!(cnt->flags & OPT_NO_CGROUPS)) {
-                if (setup_device_cgroup(&ctx->err, cnt, node.id) < 0)
+                if (device_cgroup_add(&ctx->err, cnt, node.id) < 0)
                         goto fail;
         }
+        if (device_cgroup_end(&ctx->err, ctx, cnt, cg_mark, true) < 0)
+                goto fail;
 
         // Set the return value to indicate success.
         rv = 0;
 
  fail:
         if (rv < 0) {
+                device_cgroup_end(NULL, ctx, cnt, cg_mark, false);
                 unmount(mnt);
                 assert_func(ns_enter_at(NULL, ctx->mnt_ns, CLONE_NEWNS));
         } else {
@@ -1116,3 +1637,34 @@ nvc_imex_channel_mount(struct nvc_context *ctx, const struct nvc_container *cnt,
 
         return (rv);
 }
+
+int
+nvc_device_cgroup_commit(struct nvc_context *ctx, const struct nvc_container *cnt)
+{
+        int rv = -1;
+        trace_func();
+
+        if (validate_context(ctx) < 0)
+                return (-1);
+        if (validate_args(ctx, cnt != NULL) < 0)
+                return (-1);
+
+        if ((cnt->flags & OPT_NO_CGROUPS) || cnt->dev_cg_rules == NULL || cnt->dev_cg_rules->ndevs == 0)
+                return (0);
+
+        if (ns_enter(&ctx->err, cnt->mnt_ns, CLONE_NEWNS) < 0)
+                return (-1);
+
+        log_infof("committing %zu device cgroup rules", cnt->dev_cg_rules->ndevs);
+        if (device_cgroup_apply(&ctx->err, ctx, cnt) < 0)
+                goto fail;
+        cnt->dev_cg_rules->ndevs = 0;
+        rv = 0;
+
+ fail:
+        if (rv < 0)
+                assert_func(ns_enter_at(NULL, ctx->mnt_ns, CLONE_NEWNS));
+        else
+                rv = ns_enter_at(&ctx->err, ctx->mnt_ns, CLONE_NEWNS);
+        return (rv);
+}
@@ -143,6 +143,46 @@ union driver_get_device_compute_instance_id_res switch (int errcode) {
                 string errmsg<>;
 };
 
+struct driver_mig_device_attrs {
+        string uuid<>;
+        unsigned int gi;
+        unsigned int ci;
+};
+
+struct driver_device_attrs {
+        string model<>;
+        string uuid<>;
+        string busid<>;
+        string brand<>;
+        driver_device_arch arch;
+        unsigned int minor;
+        bool mig_capable;
+        bool mig_enabled;
+        driver_mig_device_attrs mig_devices<>;
+};
+
+union driver_get_device_info_res switch (int errcode) {
+        case 0:
+                driver_device_attrs devices<>;
+        default:
+                string errmsg<>;
+};
+
+union driver_attach_res switch (int errcode) {
+        case 0:
+                void;
+        default:
+                string errmsg<>;
+};
+
+struct driver_snapshot {
+        string key<>;
+        unsigned hyper timestamp;
+        string rm_version<>;
+        driver_cuda_version cuda_version;
+        driver_device_attrs devices<>;
+};
+
 program DRIVER_PROGRAM {
         version DRIVER_VERSION {
                 driver_init_res DRIVER_INIT(ptr_t) = 1;
@@ -162,6 +202,8 @@ program DRIVER_PROGRAM {
                 driver_get_device_mig_device_res DRIVER_GET_DEVICE_MIG_DEVICE(ptr_t, ptr_t, unsigned int) = 15;
                 driver_get_device_gpu_instance_id_res DRIVER_GET_DEVICE_GPU_INSTANCE_ID(ptr_t, ptr_t) = 16;
                 driver_get_device_compute_instance_id_res DRIVER_GET_DEVICE_COMPUTE_INSTANCE_ID(ptr_t, ptr_t) = 17;
+                driver_get_device_info_res DRIVER_GET_DEVICE_INFO(ptr_t, bool) = 18;
+                driver_attach_res DRIVER_ATTACH(ptr_t, string, string, unsigned int, unsigned int) = 19;
         } = 1;
 } = 1;
 
@@ -194,6 +236,8 @@ union nvcgo_find_device_cgroup_path_res switch (int errcode) {
                 string errmsg<>;
 };
 
+typedef unsigned hyper nvcgo_device_ids<>;
+
 union nvcgo_setup_device_cgroup_res switch (int errcode) {
         case 0:
                 void;
@@ -207,7 +251,7 @@ program NVCGO_PROGRAM {
                 nvcgo_shutdown_res NVCGO_SHUTDOWN(ptr_t) = 2;
                 nvcgo_get_device_cgroup_version_res NVCGO_GET_DEVICE_CGROUP_VERSION(ptr_t, string, int) = 3;
                 nvcgo_find_device_cgroup_path_res NVCGO_FIND_DEVICE_CGROUP_PATH(ptr_t, int, string, int, int) = 4;
-                nvcgo_setup_device_cgroup_res NVCGO_SETUP_DEVICE_CGROUP(ptr_t, int, string, u_long) = 5;
+                nvcgo_setup_device_cgroup_res NVCGO_SETUP_DEVICE_CGROUP(ptr_t, int, string, nvcgo_device_ids, bool) = 5;
         } = 1;
 } = 2;
 #endif
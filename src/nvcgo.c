@@ -17,6 +17,7 @@
 #include <sys/types.h>
 
 #include <inttypes.h>
+#include <stdlib.h>
 
 #pragma GCC diagnostic push
 #include "nvc_rpc.h"
@@ -32,11 +33,10 @@
 
 void nvcgo_program_1(struct svc_req *, register SVCXPRT *);
 
-static struct nvcgo_ext {
+struct nvcgo_ext {
         struct nvcgo;
-        bool initialized;
         void *dl_handle;
-} global_nvcgo_context;
+};
 
 int
 nvcgo_program_1_freeresult(maybe_unused SVCXPRT *svc, xdrproc_t xdr_result, caddr_t res)
@@ -45,18 +45,12 @@ nvcgo_program_1_freeresult(maybe_unused SVCXPRT *svc, xdrproc_t xdr_result, cadd
         return (1);
 }
 
-struct nvcgo *
-nvcgo_get_context(void)
-{
-        return (struct nvcgo *)&global_nvcgo_context;
-}
-
 int
-nvcgo_init(struct error *err)
+nvcgo_init(struct error *err, struct nvcgo **nvcgo)
 {
         int ret;
         struct rpc_prog rpc_prog = {0};
-        struct nvcgo_ext *ctx = (struct nvcgo_ext *)nvcgo_get_context();
+        struct nvcgo_ext *ctx;
         struct nvcgo_init_res res = {0};
         struct error rpcerr = {0};
 
@@ -67,7 +61,9 @@ nvcgo_init(struct error *err)
                 .dispatch = nvcgo_program_1,
         };
 
-        memset(ctx, 0, sizeof(*ctx));
+        *nvcgo = NULL;
+        if ((ctx = xcalloc(err, 1, sizeof(*ctx))) == NULL)
+                return (-1);
         if (rpc_init(err, &ctx->rpc, &rpc_prog) < 0)
                 goto fail;
 
@@ -76,11 +72,12 @@ nvcgo_init(struct error *err)
         if (ret < 0)
                 goto fail;
 
-        ctx->initialized = true;
+        *nvcgo = (struct nvcgo *)ctx;
         return (0);
 
  fail:
         rpc_shutdown(&rpcerr, &ctx->rpc, true);
+        free(ctx);
         return (-1);
 }
 
@@ -131,13 +128,13 @@ nvcgo_init_1_svc(ptr_t ctxptr, nvcgo_init_res *res, maybe_unused struct svc_req
 }
 
 int
-nvcgo_shutdown(struct error *err)
+nvcgo_shutdown(struct error *err, struct nvcgo **nvcgo)
 {
         int ret;
-        struct nvcgo_ext *ctx = (struct nvcgo_ext *)nvcgo_get_context();
+        struct nvcgo_ext *ctx = (struct nvcgo_ext *)*nvcgo;
         struct nvcgo_shutdown_res res = {0};
 
-        if (ctx->initialized == false)
+        if (ctx == NULL)
                 return (0);
 
         ret = call_rpc(err, &ctx->rpc, &res, nvcgo_shutdown_1);
@@ -145,7 +142,8 @@ nvcgo_shutdown(struct error *err)
         if (rpc_shutdown(err, &ctx->rpc, (ret < 0)) < 0)
                 return (-1);
 
-        ctx->initialized = false;
+        free(ctx);
+        *nvcgo = NULL;
         return (0);
 }
 
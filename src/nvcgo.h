@@ -34,8 +34,7 @@ struct nvcgo {
         struct libnvcgo api;
 };
 
-int nvcgo_init(struct error *);
-int nvcgo_shutdown(struct error *);
-struct nvcgo *nvcgo_get_context(void);
+int nvcgo_init(struct error *, struct nvcgo **);
+int nvcgo_shutdown(struct error *, struct nvcgo **);
 
 #endif /* HEADER_NVCGO_H */
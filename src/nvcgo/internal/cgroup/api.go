@@ -34,19 +34,41 @@ type Interface interface {
 	AddDeviceRules(cgroupPath string, devices []DeviceRule) error
 }
 
-func New(version int) (Interface, error) {
+// Option is a functional option for New
+type Option func(*options)
+
+type options struct {
+	useDeviceMap bool
+}
+
+// WithDeviceMap selects (on cgroupv2) a device filter that looks devices up
+// in an eBPF map instead of matching them with one instruction block each.
+func WithDeviceMap(useDeviceMap bool) Option {
+	return func(o *options) {
+		o.useDeviceMap = useDeviceMap
+	}
+}
+
+func New(version int, opts ...Option) (Interface, error) {
+	o := &options{}
+	for _, opt := range opts {
+		opt(o)
+	}
+
 	switch version {
 	case 1:
 		return &cgroupv1{}, nil
 	case 2:
-		return &cgroupv2{}, nil
+		return &cgroupv2{useDeviceMap: o.useDeviceMap}, nil
 	default:
 		return nil, fmt.Errorf("invalid version")
 	}
 }
 
 type cgroupv1 struct{}
-type cgroupv2 struct{}
+type cgroupv2 struct {
+	useDeviceMap bool
+}
 
 var _ Interface = (*cgroupv1)(nil)
 var _ Interface = (*cgroupv2)(nil)
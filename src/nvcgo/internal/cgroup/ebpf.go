@@ -295,3 +295,230 @@ func AttachCgroupDeviceFilter(prog *ebpf.Program, dirFd int) error {
 	}
 	return nil
 }
+
+const (
+	// DeviceMapProgramName is the name given to device filter programs that
+	// look devices up in a map rather than matching them one by one.
+	DeviceMapProgramName = "nvc_device_map"
+	// DeviceMapName is the name of the map backing these programs.
+	DeviceMapName = "nvc_devices"
+	// DeviceMapMaxEntries is the maximum number of devices a map can hold.
+	DeviceMapMaxEntries = 4096
+)
+
+// deviceMapKey mirrors the (type, major, minor) triple of struct bpf_cgroup_dev_ctx
+// used as a key in the device map. The value is the mask of allowed accesses.
+type deviceMapKey struct {
+	Type  uint32
+	Major uint32
+	Minor uint32
+}
+
+// NewDeviceMap creates an empty map suitable for use with PrependDeviceMapFilter.
+func NewDeviceMap() (*ebpf.Map, error) {
+	return ebpf.NewMap(&ebpf.MapSpec{
+		Name:       DeviceMapName,
+		Type:       ebpf.Hash,
+		KeySize:    uint32(unsafe.Sizeof(deviceMapKey{})),
+		ValueSize:  uint32(unsafe.Sizeof(uint32(0))),
+		MaxEntries: DeviceMapMaxEntries,
+	})
+}
+
+// FindDeviceMap returns the device map referenced by a device filter program
+// generated with PrependDeviceMapFilter, or nil if prog is not such a program.
+func FindDeviceMap(prog *ebpf.Program) (*ebpf.Map, error) {
+	info, err := prog.Info()
+	if err != nil {
+		return nil, fmt.Errorf("unable to get Info() of the device filter program: %w", err)
+	}
+	if info.Name != DeviceMapProgramName {
+		return nil, nil
+	}
+	ids, _ := info.MapIDs()
+	if len(ids) != 1 {
+		return nil, fmt.Errorf("unexpected number of maps referenced by the device filter program: %d", len(ids))
+	}
+	m, err := ebpf.NewMapFromID(ids[0])
+	if err != nil {
+		return nil, fmt.Errorf("cannot fetch map from id: %w", err)
+	}
+	return m, nil
+}
+
+// UpdateDeviceMap grants the devices in a set of device rules through a device map.
+// Only rules allowing access to a specific device can be expressed as map entries.
+func UpdateDeviceMap(m *ebpf.Map, devices []specs.LinuxDeviceCgroup) error {
+	for _, dev := range devices {
+		if !dev.Allow {
+			return fmt.Errorf("deny rules are not supported by the device map filter")
+		}
+		if dev.Major == nil || dev.Minor == nil || *dev.Major < 0 || *dev.Minor < 0 {
+			return fmt.Errorf("wildcard devices are not supported by the device map filter")
+		}
+		if *dev.Major > math.MaxUint32 || *dev.Minor > math.MaxUint32 {
+			return fmt.Errorf("invalid device %d:%d", *dev.Major, *dev.Minor)
+		}
+
+		key := deviceMapKey{
+			Major: uint32(*dev.Major),
+			Minor: uint32(*dev.Minor),
+		}
+		switch dev.Type {
+		case string('c'):
+			key.Type = unix.BPF_DEVCG_DEV_CHAR
+		case string('b'):
+			key.Type = unix.BPF_DEVCG_DEV_BLOCK
+		default:
+			return fmt.Errorf("invalid DeviceType %q", dev.Type)
+		}
+
+		access := uint32(0)
+		for _, r := range dev.Access {
+			switch r {
+			case 'r':
+				access |= unix.BPF_DEVCG_ACC_READ
+			case 'w':
+				access |= unix.BPF_DEVCG_ACC_WRITE
+			case 'm':
+				access |= unix.BPF_DEVCG_ACC_MKNOD
+			default:
+				return fmt.Errorf("unknown device access %v", r)
+			}
+		}
+
+		// Merge with any access already granted for this device.
+		var prev uint32
+		if err := m.Lookup(&key, &prev); err == nil {
+			access |= prev
+		} else if !errors.Is(err, ebpf.ErrKeyNotExist) {
+			return fmt.Errorf("unable to lookup device %d:%d in the device map: %w", key.Major, key.Minor, err)
+		}
+		if err := m.Put(&key, &access); err != nil {
+			return fmt.Errorf("unable to add device %d:%d to the device map: %w", key.Major, key.Minor, err)
+		}
+	}
+	return nil
+}
+
+// PrependDeviceMapFilter prepends a fixed set of instructions to an existing device
+// filtering ebpf program, allowing any access granted by the device map 'm' and
+// falling through to the original instructions otherwise.
+func PrependDeviceMapFilter(m *ebpf.Map, origInsts asm.Instructions) (asm.Instructions, error) {
+	fallthroughSym := fmt.Sprintf("%s-fallthrough", uuid.New().String())
+
+	insts := asm.Instructions{
+		// R6 <- ctx (preserved across the helper call for the original program)
+		asm.Mov.Reg(asm.R6, asm.R1),
+		// R2 <- type (lower 16 bit of u32 access_type at R1[0])
+		asm.LoadMem(asm.R2, asm.R1, 0, asm.Half),
+		// R7 <- access (upper 16 bit of u32 access_type at R1[0])
+		asm.LoadMem(asm.R7, asm.R1, 0, asm.Word),
+		asm.RSh.Imm32(asm.R7, 16),
+		// R3 <- major (u32 major at R1[4])
+		asm.LoadMem(asm.R3, asm.R1, 4, asm.Word),
+		// R4 <- minor (u32 minor at R1[8])
+		asm.LoadMem(asm.R4, asm.R1, 8, asm.Word),
+		// key <- {type, major, minor} on the stack
+		asm.StoreMem(asm.RFP, -12, asm.R2, asm.Word),
+		asm.StoreMem(asm.RFP, -8, asm.R3, asm.Word),
+		asm.StoreMem(asm.RFP, -4, asm.R4, asm.Word),
+		// R0 <- bpf_map_lookup_elem(map, &key)
+		asm.LoadMapPtr(asm.R1, m.FD()),
+		asm.Mov.Reg(asm.R2, asm.RFP),
+		asm.Add.Imm(asm.R2, -12),
+		asm.FnMapLookupElem.Call(),
+		// if (R0 == NULL) goto fallthrough
+		asm.JEq.Imm(asm.R0, 0, fallthroughSym),
+		// if (*R0 & R7 != R7) goto fallthrough
+		asm.LoadMem(asm.R2, asm.R0, 0, asm.Word),
+		asm.And.Reg32(asm.R2, asm.R7),
+		asm.JNE.Reg(asm.R2, asm.R7, fallthroughSym),
+	}
+	tail := deviceMapFilterTail()
+	tail[2] = tail[2].Sym(fallthroughSym)
+	insts = append(insts, tail...)
+
+	return append(insts, origInsts...), nil
+}
+
+// deviceMapFilterTail returns the last instructions prepended by PrependDeviceMapFilter,
+// from the return of an allowed access to the fallthrough to the original instructions.
+func deviceMapFilterTail() asm.Instructions {
+	return asm.Instructions{
+		// R0 <- 1
+		asm.Mov.Imm32(asm.R0, 1),
+		asm.Return(),
+		// R1 <- ctx
+		asm.Mov.Reg(asm.R1, asm.R6),
+		// R0 <- 0 (the lookup left NULL or a map value pointer in it, which
+		// the original instructions could otherwise return as is)
+		asm.Mov.Imm(asm.R0, 0),
+	}
+}
+
+// StripDeviceMapFilter returns the original instructions of a device filtering ebpf
+// program generated with PrependDeviceMapFilter, i.e. without the device map lookup.
+func StripDeviceMapFilter(insts asm.Instructions) (asm.Instructions, error) {
+	tail := deviceMapFilterTail()
+	for i := 0; i+len(tail) <= len(insts); i++ {
+		match := true
+		for j, ins := range tail {
+			got := insts[i+j]
+			if got.OpCode != ins.OpCode || got.Dst != ins.Dst || got.Src != ins.Src ||
+				got.Offset != ins.Offset || got.Constant != ins.Constant {
+				match = false
+				break
+			}
+		}
+		if match {
+			return insts[i+len(tail):], nil
+		}
+	}
+	return nil, fmt.Errorf("unable to find the end of the device map filter")
+}
+
+// DeviceMapRules returns the device rules granted through a device map.
+func DeviceMapRules(m *ebpf.Map) ([]specs.LinuxDeviceCgroup, error) {
+	var rules []specs.LinuxDeviceCgroup
+	var key deviceMapKey
+	var access uint32
+
+	iter := m.Iterate()
+	for iter.Next(&key, &access) {
+		var typ string
+		switch key.Type {
+		case unix.BPF_DEVCG_DEV_CHAR:
+			typ = string('c')
+		case unix.BPF_DEVCG_DEV_BLOCK:
+			typ = string('b')
+		default:
+			return nil, fmt.Errorf("invalid device type %d in the device map", key.Type)
+		}
+
+		var acc string
+		if access&unix.BPF_DEVCG_ACC_READ != 0 {
+			acc += "r"
+		}
+		if access&unix.BPF_DEVCG_ACC_WRITE != 0 {
+			acc += "w"
+		}
+		if access&unix.BPF_DEVCG_ACC_MKNOD != 0 {
+			acc += "m"
+		}
+
+		major := int64(key.Major)
+		minor := int64(key.Minor)
+		rules = append(rules, specs.LinuxDeviceCgroup{
+			Allow:  true,
+			Type:   typ,
+			Major:  &major,
+			Minor:  &minor,
+			Access: acc,
+		})
+	}
+	if err := iter.Err(); err != nil {
+		return nil, fmt.Errorf("unable to iterate over the device map: %w", err)
+	}
+	return rules, nil
+}
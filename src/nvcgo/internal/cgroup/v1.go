@@ -104,9 +104,18 @@ func (c *cgroupv1) GetDeviceCGroupRootPath(procRootPath string, prefix string, p
 
 // AddDeviceRules adds a set of device rules for the device cgroup at cgroupPath
 func (c *cgroupv1) AddDeviceRules(cgroupPath string, rules []DeviceRule) error {
+	// Keep the allow/deny files open across rules so that a batch of rules
+	// costs a single open per file rather than one per rule.
+	files := make(map[string]*os.File)
+	defer func() {
+		for _, file := range files {
+			file.Close()
+		}
+	}()
+
 	// Loop through all rules in the set of device rules and add that rule to the device.
 	for _, rule := range rules {
-		err := c.addDeviceRule(cgroupPath, &rule)
+		err := c.addDeviceRule(cgroupPath, files, &rule)
 		if err != nil {
 			return err
 		}
@@ -115,7 +124,7 @@ func (c *cgroupv1) AddDeviceRules(cgroupPath string, rules []DeviceRule) error {
 	return nil
 }
 
-func (c *cgroupv1) addDeviceRule(cgroupPath string, rule *DeviceRule) error {
+func (c *cgroupv1) addDeviceRule(cgroupPath string, files map[string]*os.File, rule *DeviceRule) error {
 	// Check the major/minor numbers of the device in the device rule.
 	if rule.Major == nil {
 		return fmt.Errorf("no major set in device rule")
@@ -125,21 +134,26 @@ func (c *cgroupv1) addDeviceRule(cgroupPath string, rule *DeviceRule) error {
 		return fmt.Errorf("no minor set in device rule")
 	}
 
-	// Open the appropriate allow/deny file.
+	// Open the appropriate allow/deny file (if not already open).
 	var path string
 	if rule.Allow {
 		path = filepath.Join(cgroupPath, "devices.allow")
 	} else {
 		path = filepath.Join(cgroupPath, "devices.deny")
 	}
-	file, err := os.OpenFile(path, os.O_APPEND|os.O_WRONLY, 0600)
-	if err != nil {
-		return err
+	file, ok := files[path]
+	if !ok {
+		var err error
+		file, err = os.OpenFile(path, os.O_APPEND|os.O_WRONLY, 0600)
+		if err != nil {
+			return err
+		}
+		files[path] = file
 	}
-	defer file.Close()
 
-	// Write the device rule into the file.
-	_, err = file.WriteString(fmt.Sprintf("%s %d:%d %s", rule.Type, *rule.Major, *rule.Minor, rule.Access))
+	// Write the device rule into the file. The kernel parses a single rule
+	// per write, so each rule still needs its own write call.
+	_, err := file.WriteString(fmt.Sprintf("%s %d:%d %s", rule.Type, *rule.Major, *rule.Minor, rule.Access))
 	if err != nil {
 		return err
 	}
@@ -108,6 +108,11 @@ func (c *cgroupv2) GetDeviceCGroupRootPath(procRootPath string, prefix string, p
 
 // AddDeviceRules adds a set of device rules for the device cgroup at cgroupPath
 func (c *cgroupv2) AddDeviceRules(cgroupPath string, rules []DeviceRule) error {
+	// Nothing to do if there are no rules (avoids regenerating the programs).
+	if len(rules) == 0 {
+		return nil
+	}
+
 	// Open the cgroup path.
 	dirFD, err := unix.Open(cgroupPath, unix.O_DIRECTORY|unix.O_RDONLY, 0600)
 	if err != nil {
@@ -121,6 +126,11 @@ func (c *cgroupv2) AddDeviceRules(cgroupPath string, rules []DeviceRule) error {
 		return fmt.Errorf("unable to find any existing device filters attached to the cgroup: %v", err)
 	}
 
+	// In device map mode, grant the devices through map updates instead.
+	if c.useDeviceMap {
+		return c.addDeviceMapRules(dirFD, oldProgs, rules)
+	}
+
 	// Generate a new set of eBPF programs by prepending instructions for the
 	// new devices to the instructions of each existing program.
 	// If no existing programs found, create a new program with just our device filter.
@@ -146,7 +156,15 @@ func (c *cgroupv2) AddDeviceRules(cgroupPath string, rules []DeviceRule) error {
 			return fmt.Errorf("unable to get the instructions of the original device filters program: %v", err)
 		}
 
-		newProg, err := generateNewProgram(rules, oldInsts)
+		// A map-backed program (from an earlier call in device map mode) can't
+		// be extended as is, its instructions reference its map. Rebuild it out
+		// of the devices in its map and the instructions it was generated from.
+		oldRules, oldInsts, err := stripDeviceMapProgram(oldProg, oldInsts)
+		if err != nil {
+			return fmt.Errorf("unable to convert the original device map program: %v", err)
+		}
+
+		newProg, err := generateNewProgram(append(oldRules, rules...), oldInsts)
 		if err != nil {
 			return fmt.Errorf("unable to generate new device filter program from existing programs: %v", err)
 		}
@@ -154,26 +172,137 @@ func (c *cgroupv2) AddDeviceRules(cgroupPath string, rules []DeviceRule) error {
 		newProgs = append(newProgs, newProg)
 	}
 
-	// Increase `ulimit -l` limit to avoid BPF_PROG_LOAD error below.
-	// This limit is not inherited into the container.
+	return replaceDeviceFilters(dirFD, oldProgs, newProgs)
+}
+
+// addDeviceMapRules adds a set of device rules through the maps backing the
+// device filter programs attached to the cgroup at dirFD. Only programs that
+// are not map-backed yet (or no program at all) cause a program to be loaded,
+// so adding devices to a cgroup that was set up before is just map updates.
+func (c *cgroupv2) addDeviceMapRules(dirFD int, oldProgs []*ebpf.Program, rules []DeviceRule) error {
+	// Increase `ulimit -l` limit to avoid BPF_MAP_CREATE / BPF_PROG_LOAD errors below.
+	increaseMemlockLimit()
+
+	// Find the maps of the programs we attached previously (if any).
+	var devMaps []*ebpf.Map
+	var foreignProgs []*ebpf.Program
+	defer func() {
+		for _, m := range devMaps {
+			m.Close()
+		}
+	}()
+	for _, oldProg := range oldProgs {
+		m, err := FindDeviceMap(oldProg)
+		if err != nil {
+			return fmt.Errorf("unable to find the device map of an existing device filters program: %v", err)
+		}
+		if m == nil {
+			foreignProgs = append(foreignProgs, oldProg)
+			continue
+		}
+		devMaps = append(devMaps, m)
+	}
+	if len(devMaps) == 0 {
+		m, err := NewDeviceMap()
+		if err != nil {
+			return fmt.Errorf("unable to create device map: %v", err)
+		}
+		devMaps = append(devMaps, m)
+	}
+
+	// Every attached program has to allow a device, so grant it in all the maps.
+	for _, m := range devMaps {
+		if err := UpdateDeviceMap(m, rules); err != nil {
+			return fmt.Errorf("unable to update device map: %v", err)
+		}
+	}
+
+	// Nothing else to do if all the attached programs are already map-backed.
+	if len(oldProgs) > 0 && len(foreignProgs) == 0 {
+		return nil
+	}
+
+	// Otherwise, generate map-backed programs out of the remaining ones.
+	var newProgs []*ebpf.Program
+	if len(oldProgs) == 0 {
+		oldInsts := asm.Instructions{asm.Return()}
+
+		newProg, err := generateNewMapProgram(devMaps[0], oldInsts)
+		if err != nil {
+			return fmt.Errorf("unable to generate new device map program with no existing programs: %v", err)
+		}
+
+		newProgs = append(newProgs, newProg)
+	}
+	for _, oldProg := range foreignProgs {
+		oldInfo, err := oldProg.Info()
+		if err != nil {
+			return fmt.Errorf("unable to get Info() of the original device filters program: %v", err)
+		}
+
+		oldInsts, err := oldInfo.Instructions()
+		if err != nil {
+			return fmt.Errorf("unable to get the instructions of the original device filters program: %v", err)
+		}
+
+		newProg, err := generateNewMapProgram(devMaps[0], oldInsts)
+		if err != nil {
+			return fmt.Errorf("unable to generate new device map program from existing programs: %v", err)
+		}
+
+		newProgs = append(newProgs, newProg)
+	}
+
+	return replaceDeviceFilters(dirFD, foreignProgs, newProgs)
+}
+
+// stripDeviceMapProgram returns the device rules granted through the map of a
+// map-backed program along with its instructions stripped of the map lookup.
+// Instructions of other programs are returned as is.
+func stripDeviceMapProgram(prog *ebpf.Program, insts asm.Instructions) ([]DeviceRule, asm.Instructions, error) {
+	m, err := FindDeviceMap(prog)
+	if err != nil || m == nil {
+		return nil, insts, err
+	}
+	defer m.Close()
+
+	rules, err := DeviceMapRules(m)
+	if err != nil {
+		return nil, nil, err
+	}
+	insts, err = StripDeviceMapFilter(insts)
+	if err != nil {
+		return nil, nil, err
+	}
+	return rules, insts, nil
+}
+
+// increaseMemlockLimit raises `ulimit -l` to avoid BPF_PROG_LOAD errors.
+// This limit is not inherited into the container.
+func increaseMemlockLimit() {
 	memlockLimit := &unix.Rlimit{
 		Cur: unix.RLIM_INFINITY,
 		Max: unix.RLIM_INFINITY,
 	}
 	_ = unix.Setrlimit(unix.RLIMIT_MEMLOCK, memlockLimit)
+}
+
+// replaceDeviceFilters replaces a set of existing eBPF programs with new ones.
+func replaceDeviceFilters(dirFD int, oldProgs []*ebpf.Program, newProgs []*ebpf.Program) error {
+	// Increase `ulimit -l` limit to avoid BPF_PROG_LOAD error below.
+	increaseMemlockLimit()
 
-	// Replace the set of existing eBPF programs with the new ones.
 	// We don't have to worry about atomically replacing each program (i.e. by
 	// using BPF_F_REPLACE) because we know that the code here is always run
 	// strictly *before* a container begins executing.
 	for _, oldProg := range oldProgs {
-		err = DetachCgroupDeviceFilter(oldProg, dirFD)
+		err := DetachCgroupDeviceFilter(oldProg, dirFD)
 		if err != nil {
 			return fmt.Errorf("unable to detach original device filters program: %v", err)
 		}
 	}
 	for _, newProg := range newProgs {
-		err = AttachCgroupDeviceFilter(newProg, dirFD)
+		err := AttachCgroupDeviceFilter(newProg, dirFD)
 		if err != nil {
 			return fmt.Errorf("unable to attach new device filters program: %v", err)
 		}
@@ -202,3 +331,26 @@ func generateNewProgram(rules []DeviceRule, oldInsts asm.Instructions) (*ebpf.Pr
 
 	return newProg, nil
 }
+
+func generateNewMapProgram(m *ebpf.Map, oldInsts asm.Instructions) (*ebpf.Program, error) {
+	// Prepend the device map lookup to the original set of instructions.
+	newInsts, err := PrependDeviceMapFilter(m, oldInsts)
+	if err != nil {
+		return nil, fmt.Errorf("unable to prepend the device map filter to the original device filters program: %v", err)
+	}
+
+	// Generate new eBPF program for the merged device filter instructions.
+	// The program is named so that it can be recognized (and its map reused) later on.
+	spec := &ebpf.ProgramSpec{
+		Name:         DeviceMapProgramName,
+		Type:         ebpf.CGroupDevice,
+		Instructions: newInsts,
+		License:      BpfProgramLicense,
+	}
+	newProg, err := ebpf.NewProgram(spec)
+	if err != nil {
+		return nil, fmt.Errorf("unable to create new device map program: %v", err)
+	}
+
+	return newProg, nil
+}
@@ -91,8 +91,8 @@ func GetDeviceCGroupRootPath(version C.int, procRootPath *C.char, cgroupRootPref
 }
 
 //export AddDeviceRules
-func AddDeviceRules(version C.int, cgroupPath *C.char, crules []CDeviceRule, rerr **C.char) C.int {
-	api, err := cgroup.New(int(version))
+func AddDeviceRules(version C.int, cgroupPath *C.char, crules []CDeviceRule, useDeviceMap C.bool, rerr **C.char) C.int {
+	api, err := cgroup.New(int(version), cgroup.WithDeviceMap(bool(useDeviceMap)))
 	if err != nil {
 		*rerr = C.CString(fmt.Sprintf("unable to create cgroupv%v interface: %v", version, err))
 		return -1
@@ -18,11 +18,13 @@ struct option {
 enum {
         OPT_LOAD_KMODS              = 1 << 0,
         OPT_NO_CREATE_IMEX_CHANNELS = 1 << 1,
+        OPT_COALESCE_DISCOVERY      = 1 << 2,
 };
 
 static const struct option library_opts[] = {
         {"load-kmods", OPT_LOAD_KMODS},
-        {"no-create-imex-channels", OPT_NO_CREATE_IMEX_CHANNELS}
+        {"no-create-imex-channels", OPT_NO_CREATE_IMEX_CHANNELS},
+        {"coalesce-discovery", OPT_COALESCE_DISCOVERY},
 };
 
 static const char * const default_library_opts = "";
@@ -36,6 +38,7 @@ enum {
         OPT_NO_PERSISTENCED  = 1 << 4,
         OPT_NO_FABRICMANAGER = 1 << 5,
         OPT_NO_GSP_FIRMWARE  = 1 << 6,
+        OPT_NO_CACHE         = 1 << 7,
 };
 
 static const struct option driver_opts[] = {
@@ -46,6 +49,7 @@ static const struct option driver_opts[] = {
         {"no-persistenced", OPT_NO_PERSISTENCED},
         {"no-fabricmanager", OPT_NO_FABRICMANAGER},
         {"no-gsp-firmware", OPT_NO_GSP_FIRMWARE},
+        {"no-cache", OPT_NO_CACHE},
 };
 
 static const char * const default_driver_opts = "";
@@ -78,6 +82,11 @@ enum {
         OPT_CUDA_COMPAT_MODE_DISABLED = 1 << 14,
         OPT_CUDA_COMPAT_MODE_LDCONFIG = 1 << 15,
         OPT_CUDA_COMPAT_MODE_MOUNT    = 1 << 16,
+        OPT_DEFER_CGROUPS             = 1 << 17,
+        OPT_CGROUP_DEVICE_MAP         = 1 << 18,
+        OPT_DRIVER_BUNDLE             = 1 << 19,
+        OPT_LDCACHE_STORE             = 1 << 20,
+        OPT_MKNOD_DEVICES             = 1 << 21,
 };
 
 static const struct option container_opts[] = {
@@ -95,6 +104,11 @@ static const struct option container_opts[] = {
         {"cuda-compat-mode=disabled", OPT_CUDA_COMPAT_MODE_DISABLED},
         {"cuda-compat-mode=mount", OPT_CUDA_COMPAT_MODE_MOUNT},
         {"cuda-compat-mode=ldconfig", OPT_CUDA_COMPAT_MODE_LDCONFIG},
+        {"defer-cgroups", OPT_DEFER_CGROUPS},
+        {"cgroup-device-map", OPT_CGROUP_DEVICE_MAP},
+        {"driver-bundle", OPT_DRIVER_BUNDLE},
+        {"ldcache-store", OPT_LDCACHE_STORE},
+        {"mknod-devices", OPT_MKNOD_DEVICES},
 };
 
 static const char * const default_container_opts = "standalone no-cgroups no-devbind utility";
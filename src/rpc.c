@@ -16,12 +16,16 @@
 
 #include <sys/prctl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 
+#include <errno.h>
 #include <inttypes.h>
 #include <poll.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,10 +40,44 @@
 #include "error.h"
 #include "utils.h"
 #include "rpc.h"
+#include "trace.h"
 #include "xfuncs.h"
 
 #define REAP_TIMEOUT_MS 10
 
+static struct rpc_prog traced_prog;
+
+/*
+ * SIGPIPE is ignored while RPCs are in flight so that a dead service fails the call instead of killing us.
+ * The disposition is process-wide, it is therefore only restored once the last concurrent caller is done.
+ */
+static pthread_mutex_t sigpipe_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int sigpipe_users;
+static struct sigaction sigpipe_action;
+
+static void
+traced_dispatch(struct svc_req *req, SVCXPRT *xprt)
+{
+        char name[64];
+
+        snprintf(name, sizeof(name), "%s rpc %lu", traced_prog.name, (unsigned long)req->rq_proc);
+        trace_scope(name);
+        traced_prog.dispatch(req, xprt);
+}
+
+static bool
+register_service(struct rpc *rpc)
+{
+        void (*dispatch)(struct svc_req *, SVCXPRT *) = rpc->prog.dispatch;
+
+        /* Services only serve one program per process, the dispatch wrapper can therefore use a global. */
+        if (trace_active()) {
+                traced_prog = rpc->prog;
+                dispatch = traced_dispatch;
+        }
+        return (svc_register(rpc->svc, rpc->prog.id, rpc->prog.version, dispatch, 0));
+}
+
 static int
 setup_client(struct error *err, struct rpc *rpc)
 {
@@ -48,6 +86,7 @@ setup_client(struct error *err, struct rpc *rpc)
         struct timeval timeout = {10, 0};
 
         xclose(rpc->fd[SOCK_SVC]);
+        rpc->fd[SOCK_SVC] = -1;
 
         addrlen = sizeof(addr);
         if (getpeername(rpc->fd[SOCK_CLT], (struct sockaddr *)&addr, &addrlen) < 0) {
@@ -71,8 +110,10 @@ setup_service(struct error *err, struct rpc *rpc, pid_t ppid)
         log_infof("starting %s rpc service", rpc->prog.name);
         snprintf(procname, 16, "nvc:[%s]", rpc->prog.name);
         prctl(PR_SET_NAME, (unsigned long)procname, 0, 0, 0);
+        trace_process_name(procname);
 
         xclose(rpc->fd[SOCK_CLT]);
+        rpc->fd[SOCK_CLT] = -1;
 
         /*
          * Set PDEATHSIG in case our parent terminates unexpectedly.
@@ -86,7 +127,7 @@ setup_service(struct error *err, struct rpc *rpc, pid_t ppid)
                 kill(getpid(), SIGTERM);
 
         if ((rpc->svc = svcunixfd_create(rpc->fd[SOCK_SVC], 0, 0)) == NULL ||
-            !svc_register(rpc->svc, rpc->prog.id, rpc->prog.version, rpc->prog.dispatch, 0)) {
+            !register_service(rpc)) {
                 error_setx(err, "%s rpc service registration failed", rpc->prog.name);
                 goto fail;
         }
@@ -170,6 +211,127 @@ rpc_init(struct error *err, struct rpc *rpc, struct rpc_prog *prog)
         return (-1);
 }
 
+/*
+ * rpc_connect attaches to a service already listening on a unix socket (see rpc_listen) instead of
+ * spawning a private one. Such a service is not owned by the caller and is never reaped by rpc_shutdown.
+ */
+int
+rpc_connect(struct error *err, struct rpc *rpc, struct rpc_prog *prog, const char *path)
+{
+        struct sockaddr_un addr = {.sun_family = AF_UNIX};
+        struct timeval timeout = {10, 0};
+        struct stat s;
+
+        if (rpc->initialized)
+                return (0);
+
+        *rpc = (struct rpc){false, {-1, -1}, -1, NULL, NULL, *prog};
+
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+                error_setx(err, "%s rpc socket path too long: %s", rpc->prog.name, path);
+                return (-1);
+        }
+        strcpy(addr.sun_path, path);
+
+        /* Only trust a socket created by a privileged service or by ourselves, which nobody else can write to. */
+        if (lstat(path, &s) < 0) {
+                error_set(err, "%s rpc socket stat failed: %s", rpc->prog.name, path);
+                return (-1);
+        }
+        if (!S_ISSOCK(s.st_mode) || (s.st_uid != 0 && s.st_uid != geteuid()) || (s.st_mode & (S_IWGRP|S_IWOTH))) {
+                error_setx(err, "%s rpc socket is insecure: %s", rpc->prog.name, path);
+                return (-1);
+        }
+
+        if ((rpc->fd[SOCK_CLT] = socket(PF_LOCAL, SOCK_STREAM|SOCK_CLOEXEC, 0)) < 0 ||
+            connect(rpc->fd[SOCK_CLT], (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+                error_set(err, "%s rpc connection failed: %s", rpc->prog.name, path);
+                goto fail;
+        }
+        if ((rpc->clt = clntunix_create(&addr, rpc->prog.id, rpc->prog.version, &rpc->fd[SOCK_CLT], 0, 0)) == NULL) {
+                error_setx(err, "%s rpc %s", rpc->prog.name, clnt_spcreateerror("client creation failed"));
+                goto fail;
+        }
+        clnt_control(rpc->clt, CLSET_TIMEOUT, (char *)&timeout);
+
+        rpc->initialized = true;
+        return (0);
+
+ fail:
+        xclose(rpc->fd[SOCK_CLT]);
+        rpc->fd[SOCK_CLT] = -1;
+        return (-1);
+}
+
+/*
+ * socket_in_use returns whether a service is accepting connections on the unix socket at path.
+ */
+static bool
+socket_in_use(const char *path)
+{
+        struct sockaddr_un addr = {.sun_family = AF_UNIX};
+        int fd;
+        bool rv;
+
+        strcpy(addr.sun_path, path);
+        if ((fd = socket(PF_LOCAL, SOCK_STREAM|SOCK_CLOEXEC, 0)) < 0)
+                return (false);
+        rv = (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 || errno != ECONNREFUSED);
+        close(fd);
+        return (rv);
+}
+
+/*
+ * rpc_listen registers the service on a unix socket bound to path, only accessible by the current user.
+ * A socket left behind by a service that is gone is replaced, one that is still in use is not.
+ * The caller is responsible for running the service loop and for removing the socket when it is done.
+ */
+int
+rpc_listen(struct error *err, struct rpc *rpc, struct rpc_prog *prog, const char *path)
+{
+        struct stat s;
+        mode_t mask;
+
+        *rpc = (struct rpc){false, {-1, -1}, -1, NULL, NULL, *prog};
+
+        if (strlen(path) >= sizeof(((struct sockaddr_un *)NULL)->sun_path)) {
+                error_setx(err, "%s rpc socket path too long: %s", rpc->prog.name, path);
+                return (-1);
+        }
+        if (lstat(path, &s) == 0) {
+                if (!S_ISSOCK(s.st_mode)) {
+                        error_setx(err, "%s rpc socket path exists: %s", rpc->prog.name, path);
+                        return (-1);
+                }
+                if (socket_in_use(path)) {
+                        error_setx(err, "%s rpc service already listening on %s", rpc->prog.name, path);
+                        return (-1);
+                }
+                if (unlink(path) < 0 && errno != ENOENT) {
+                        error_set(err, "%s rpc socket removal failed: %s", rpc->prog.name, path);
+                        return (-1);
+                }
+        }
+
+        mask = umask(0177);
+        rpc->svc = svcunix_create(RPC_ANYSOCK, 0, 0, (char *)path);
+        umask(mask);
+        if (rpc->svc == NULL) {
+                error_setx(err, "%s rpc service creation failed: %s", rpc->prog.name, path);
+                return (-1);
+        }
+        if (!register_service(rpc)) {
+                error_setx(err, "%s rpc service registration failed", rpc->prog.name);
+                svc_destroy(rpc->svc);
+                rpc->svc = NULL;
+                return (-1);
+        }
+
+        log_infof("listening for %s rpc requests on %s", rpc->prog.name, path);
+        rpc->initialized = true;
+        return (0);
+}
+
 int
 rpc_shutdown(struct error *err, struct rpc *rpc, bool force)
 {
@@ -185,3 +347,23 @@ rpc_shutdown(struct error *err, struct rpc *rpc, bool force)
         *rpc = (struct rpc){false, {-1, -1}, -1, NULL, NULL, {0}};
         return (0);
 }
+
+void
+rpc_sigpipe_ignore(void)
+{
+        struct sigaction sa = {.sa_handler = SIG_IGN};
+
+        pthread_mutex_lock(&sigpipe_mutex);
+        if (sigpipe_users++ == 0)
+                sigaction(SIGPIPE, &sa, &sigpipe_action);
+        pthread_mutex_unlock(&sigpipe_mutex);
+}
+
+void
+rpc_sigpipe_restore(void)
+{
+        pthread_mutex_lock(&sigpipe_mutex);
+        if (--sigpipe_users == 0)
+                sigaction(SIGPIPE, &sigpipe_action, NULL);
+        pthread_mutex_unlock(&sigpipe_mutex);
+}
@@ -34,6 +34,7 @@ SVCXPRT *svcunixfd_create(int, u_int, u_int);
 
 #include "error.h"
 #include "dxcore.h"
+#include "trace.h"
 
 #define SOCK_CLT 0
 #define SOCK_SVC 1
@@ -55,20 +56,34 @@ struct rpc {
 };
 
 int rpc_init(struct error *, struct rpc *, struct rpc_prog *);
+int rpc_connect(struct error *, struct rpc *, struct rpc_prog *, const char *);
+int rpc_listen(struct error *, struct rpc *, struct rpc_prog *, const char *);
 int rpc_shutdown(struct error *, struct rpc *, bool force);
+void rpc_sigpipe_ignore(void);
+void rpc_sigpipe_restore(void);
 
-#define call_rpc(err, ctx, res, func, ...) __extension__ ({                                            \
+/*
+ * call_rpc_stat is call_rpc also returning the status of the call itself in stat, which tells RPC failures apart
+ * from the errors returned by the service (both end up in err->code).
+ */
+#define call_rpc_stat(err, ctx, stat, res, func, ...) __extension__ ({                                 \
         enum clnt_stat r_;                                                                             \
-        struct sigaction osa_, sa_ = {.sa_handler = SIG_IGN};                                          \
+        struct trace_span t_;                                                                          \
                                                                                                        \
         static_assert(sizeof(ptr_t) >= sizeof(intptr_t), "incompatible types");                        \
-        sigaction(SIGPIPE, &sa_, &osa_);                                                               \
+        rpc_sigpipe_ignore();                                                                          \
+        t_ = trace_begin(#func);                                                                       \
         if ((r_ = func((ptr_t)ctx, ##__VA_ARGS__, res, (ctx)->clt)) != RPC_SUCCESS)                    \
                 error_set_rpc(err, r_, "%s rpc error", (ctx)->prog.name);                               \
         else if ((res)->errcode != 0)                                                                  \
                 error_from_xdr(err, res);                                                              \
-        sigaction(SIGPIPE, &osa_, NULL);                                                               \
+        trace_end(&t_);                                                                                \
+        rpc_sigpipe_restore();                                                                         \
+        *(stat) = r_;                                                                                  \
         (r_ == RPC_SUCCESS && (res)->errcode == 0) ? 0 : -1;                                           \
 })
 
+#define call_rpc(err, ctx, res, func, ...) \
+        call_rpc_stat(err, ctx, &(enum clnt_stat){RPC_SUCCESS}, res, func, ##__VA_ARGS__)
+
 #endif /* HEADER_RPC_H */
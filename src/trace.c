@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define TRACE_MAX_EVENT 512
+
+static uint64_t trace_now(void);
+static int32_t trace_pid(void);
+static void trace_write(const char *, size_t);
+
+/* The trace file is shared by all the library contexts of the process, it is closed along with the last one. */
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int tracefd = -1;
+static unsigned int tracerefs;
+/* Track of the process when getpid doesn't identify it (i.e. within a PID namespace), see trace_set_pid. */
+static pid_t tracepid;
+
+static uint64_t
+trace_now(void)
+{
+        struct timespec ts;
+
+        /* The monotonic clock is shared by all processes, which keeps the tracks of the RPC services aligned. */
+        if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+                return (0);
+        return ((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec);
+}
+
+static int32_t
+trace_pid(void)
+{
+        return ((int32_t)((tracepid > 0) ? tracepid : getpid()));
+}
+
+static void
+trace_write(const char *buf, size_t len)
+{
+        ssize_t n;
+
+        /*
+         * Events are appended with a single write so that processes sharing the file (e.g. forked RPC services)
+         * never interleave partial records. A short or failed write only loses this event.
+         */
+        do {
+                n = write(tracefd, buf, len);
+        } while (n < 0 && errno == EINTR);
+}
+
+bool
+trace_active(void)
+{
+        return (tracefd >= 0);
+}
+
+void
+trace_open(const char *path)
+{
+        struct stat s;
+
+        pthread_mutex_lock(&trace_mutex);
+        if (trace_active()) {
+                ++tracerefs;
+                goto out;
+        }
+        if (path == NULL || *path == '\0')
+                goto out;
+        if ((tracefd = open(path, O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0600)) < 0) {
+                log_warnf("could not open trace file %s: %s", path, strerror(errno));
+                goto out;
+        }
+        tracerefs = 1;
+
+        /*
+         * The JSON array format tolerates a missing closing bracket and a trailing comma,
+         * which lets several invocations append to the same file.
+         */
+        if (fstat(tracefd, &s) == 0 && s.st_size == 0)
+                trace_write("[\n", 2);
+        trace_process_name(program_invocation_short_name);
+
+ out:
+        pthread_mutex_unlock(&trace_mutex);
+}
+
+void
+trace_close(void)
+{
+        pthread_mutex_lock(&trace_mutex);
+        if (trace_active() && --tracerefs == 0) {
+                close(tracefd);
+                tracefd = -1;
+        }
+        pthread_mutex_unlock(&trace_mutex);
+}
+
+void
+trace_set_pid(pid_t pid)
+{
+        tracepid = pid;
+}
+
+void
+trace_process_name(const char *name)
+{
+        char buf[TRACE_MAX_EVENT];
+        int n;
+
+        if (!trace_active())
+                return;
+        n = snprintf(buf, sizeof(buf), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%"PRId32",\"args\":{\"name\":\"%s\"}},\n",
+            trace_pid(), name);
+        if (n > 0 && (size_t)n < sizeof(buf))
+                trace_write(buf, (size_t)n);
+}
+
+struct trace_span
+trace_begin(const char *name)
+{
+        if (!trace_active())
+                return ((struct trace_span){NULL, 0});
+        return ((struct trace_span){name, trace_now()});
+}
+
+void
+trace_end(struct trace_span *span)
+{
+        char buf[TRACE_MAX_EVENT];
+        uint64_t end;
+        int n;
+
+        if (span->name == NULL || !trace_active())
+                return;
+
+        end = trace_now();
+        n = snprintf(buf, sizeof(buf),
+            "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%"PRIu64".%03"PRIu64",\"dur\":%"PRIu64".%03"PRIu64",\"pid\":%"PRId32",\"tid\":%ld},\n",
+            span->name, span->start / 1000, span->start % 1000, (end - span->start) / 1000, (end - span->start) % 1000,
+            trace_pid(), (long)syscall(SYS_gettid));
+        if (n > 0 && (size_t)n < sizeof(buf))
+                trace_write(buf, (size_t)n);
+        span->name = NULL;
+}
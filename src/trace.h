@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HEADER_TRACE_H
+#define HEADER_TRACE_H
+
+#include <sys/types.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+/*
+ * Spans are written in the Chrome trace event format to the file given by NVC_TRACE_FILE, and can be loaded as is
+ * in chrome://tracing or Perfetto. Every process (including the RPC services) shows up as its own track, and every
+ * thread as a row within it. Span names are emitted verbatim and must not require JSON escaping.
+ */
+
+struct trace_span {
+        const char *name;
+        uint64_t start;
+};
+
+bool trace_active(void);
+void trace_open(const char *);
+void trace_close(void);
+void trace_set_pid(pid_t);
+void trace_process_name(const char *);
+struct trace_span trace_begin(const char *);
+void trace_end(struct trace_span *);
+
+/* trace_scope records a span covering the remainder of the enclosing block. */
+#define trace_scope(name) \
+        maybe_unused struct trace_span trace_scope_ __attribute__((cleanup(trace_end))) = trace_begin(name)
+#define trace_func() trace_scope(__func__)
+
+#endif /* HEADER_TRACE_H */
@@ -20,6 +20,7 @@
 #include <libgen.h>
 #undef basename /* Use the GNU version of basename. */
 #include <limits.h>
+#include <pthread.h>
 #include <pwd.h>
 #include <sched.h>
 #include <stdio.h>
@@ -28,6 +29,10 @@
 #include <time.h>
 #include <unistd.h>
 
+#ifdef SYS_openat2
+# include <linux/openat2.h>
+#endif /* SYS_openat2 */
+
 #include "common.h"
 #include "utils.h"
 #include "xfuncs.h"
@@ -43,9 +48,41 @@ static int set_fsugid(uid_t, gid_t);
 static int make_ancestors(char *, mode_t);
 static int do_file_remove(const char *, const struct stat *, int, struct FTW *);
 static int open_next(struct error *, int, const char *);
+static int path_walk(struct error *, char *, const char *, const char *);
+static bool path_has_dotdot(const char *);
+static void path_root_release(void *);
+static void path_root_key_create(void);
+static struct path_root *path_root_get(const char *);
+static int path_lookup(struct error *, char *, const char *, const char *);
 static int do_path_resolve(struct error *, bool, char *, const char *, const char *);
+static int setns_thread(int, int);
 
+/*
+ * Root directories resolved against are held open, per thread since a thread can switch mount namespaces
+ * (see setns_thread). Entries are keyed by path and identity and invalidated whenever the namespace changes.
+ */
+struct path_root {
+        char *path;
+        char *real;
+        int fd;
+        dev_t dev;
+        ino_t ino;
+        unsigned int gen;
+};
+
+static pthread_once_t path_root_once = PTHREAD_ONCE_INIT;
+static pthread_key_t path_root_key;
+static __thread struct path_root path_roots[4];
+static __thread unsigned int path_root_next;
+static __thread unsigned int ns_generation;
+static int openat2_broken;
+
+/*
+ * The log file is shared by all the library contexts of the process, it is closed along with the last one.
+ */
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
 static FILE *logfile;
+static unsigned int logrefs;
 
 bool
 log_active(void)
@@ -56,44 +93,54 @@ log_active(void)
 void
 log_open(const char *path)
 {
-        if (path == NULL || log_active())
-                return;
-        logfile = fopen(path, "ae");
-        assert(logfile != NULL);
+        pthread_mutex_lock(&log_mutex);
         if (log_active()) {
-                setbuf(logfile, NULL);
-                fprintf(logfile, "\n-- WARNING, the following logs are for debugging purposes only --\n\n");
+                ++logrefs;
+        } else if (path != NULL) {
+                logfile = fopen(path, "ae");
+                assert(logfile != NULL);
+                if (log_active()) {
+                        logrefs = 1;
+                        setbuf(logfile, NULL);
+                        fprintf(logfile, "\n-- WARNING, the following logs are for debugging purposes only --\n\n");
+                }
         }
+        pthread_mutex_unlock(&log_mutex);
 }
 
 void
 log_close(void)
 {
-        if (!log_active())
-                return;
-        fclose(logfile);
-        logfile = NULL;
+        pthread_mutex_lock(&log_mutex);
+        if (log_active() && --logrefs == 0) {
+                fclose(logfile);
+                logfile = NULL;
+        }
+        pthread_mutex_unlock(&log_mutex);
 }
 
 void
 log_write(char level, const char *file, unsigned long line, const char *fmt, ...)
 {
         struct timeval tv = {0};
-        struct tm *tm;
+        struct tm tm;
         char buf[16];
         va_list ap;
 
         if (!log_active())
                 return;
-        if (gettimeofday(&tv, NULL) < 0 || (tm = gmtime(&tv.tv_sec)) == NULL ||
-            strftime(buf, sizeof(buf), "%m%d %T", tm) == 0)
+        if (gettimeofday(&tv, NULL) < 0 || gmtime_r(&tv.tv_sec, &tm) == NULL ||
+            strftime(buf, sizeof(buf), "%m%d %T", &tm) == 0)
                 strcpy(buf, "0000 00:00:00");
 
+        /* Keep the lines of concurrent contexts whole. */
+        flockfile(logfile);
         fprintf(logfile, "%c%s.%06ld %ld %s:%lu] ", level, buf, tv.tv_usec, (long)syscall(SYS_gettid), basename(file), line);
         va_start(ap, fmt);
         vfprintf(logfile, fmt, ap);
         va_end(ap);
         fputc('\n', logfile);
+        funlockfile(logfile);
 }
 
 int
@@ -323,10 +370,25 @@ str_to_ugid(struct error *err, char *str, uid_t *uid, gid_t *gid)
         return (-1);
 }
 
+/*
+ * Joining a mount namespace requires a filesystem context (root, cwd, umask) which isn't shared with other threads,
+ * give the calling thread its own so that library contexts can be used concurrently. This is a no-op otherwise.
+ */
+static int
+setns_thread(int fd, int nstype)
+{
+        if (nstype == CLONE_NEWNS) {
+                if (unshare(CLONE_FS) < 0)
+                        return (-1);
+                ++ns_generation;
+        }
+        return (setns(fd, nstype));
+}
+
 int
 ns_enter_at(struct error *err, int fd, int nstype)
 {
-        if (setns(fd, nstype) < 0) {
+        if (setns_thread(fd, nstype) < 0) {
                 error_set(err, "namespace association failed");
                 return (-1);
         }
@@ -341,7 +403,7 @@ ns_enter(struct error *err, const char *path, int nstype)
 
         if ((fd = xopen(err, path, O_RDONLY)) < 0)
                 return (-1);
-        if (setns(fd, nstype) < 0) {
+        if (setns_thread(fd, nstype) < 0) {
                 error_set(err, "namespace association failed: %s", path);
                 goto fail;
         }
@@ -813,11 +875,10 @@ open_next(struct error *err, int dir, const char *path)
 }
 
 static int
-do_path_resolve(struct error *err, bool full, char *buf, const char *root, const char *path)
+path_walk(struct error *err, char *realpath, const char *root, const char *path)
 {
         int fd = -1;
         int rv = -1;
-        char realpath[PATH_MAX];
         char dbuf[2][PATH_MAX];
         char *link = dbuf[0];
         char *ptr = dbuf[1];
@@ -906,18 +967,226 @@ do_path_resolve(struct error *err, bool full, char *buf, const char *root, const
                 }
         }
 
-        if (!full) {
-                if (path_new(err, buf, realpath) < 0)
+        rv = 0;
+
+ fail:
+        xclose(fd);
+        return (rv);
+}
+
+static bool
+path_has_dotdot(const char *path)
+{
+        for (const char *p = path; (p = strstr(p, "..")) != NULL; p += 2) {
+                if ((p == path || p[-1] == '/') && (p[2] == '\0' || p[2] == '/'))
+                        return (true);
+        }
+        return (false);
+}
+
+static void
+path_root_release(void *arg)
+{
+        struct path_root *roots = arg;
+
+        for (size_t i = 0; i < nitems(path_roots); ++i) {
+                if (roots[i].path == NULL)
+                        continue;
+                close(roots[i].fd);
+                free(roots[i].path);
+                free(roots[i].real);
+                roots[i] = (struct path_root){NULL, NULL, -1, 0, 0, 0};
+        }
+}
+
+static void
+path_root_key_create(void)
+{
+        if (pthread_key_create(&path_root_key, path_root_release) != 0)
+                __atomic_store_n(&openat2_broken, true, __ATOMIC_RELAXED);
+}
+
+static struct path_root *
+path_root_get(const char *root)
+{
+        struct path_root *r;
+        struct stat s, fs;
+        char proc[32];
+        char real[PATH_MAX];
+        ssize_t n;
+        int fd;
+
+        if (fstatat(AT_FDCWD, root, &s, AT_SYMLINK_NOFOLLOW) < 0 || !S_ISDIR(s.st_mode))
+                return (NULL);
+        for (size_t i = 0; i < nitems(path_roots); ++i) {
+                r = &path_roots[i];
+                if (r->path != NULL && r->gen == ns_generation && r->dev == s.st_dev && r->ino == s.st_ino &&
+                    str_equal(r->path, root))
+                        return (r);
+        }
+
+        if ((fd = open(root, O_PATH|O_NOFOLLOW|O_DIRECTORY|O_CLOEXEC)) < 0)
+                return (NULL);
+        snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+        if (fstat(fd, &fs) < 0 || fs.st_dev != s.st_dev || fs.st_ino != s.st_ino ||
+            (n = readlink(proc, real, sizeof(real))) <= 0 || (size_t)n >= sizeof(real) || *real != '/')
+                goto fail;
+        real[n] = '\0';
+
+        pthread_once(&path_root_once, path_root_key_create);
+        if (__atomic_load_n(&openat2_broken, __ATOMIC_RELAXED))
+                goto fail;
+        pthread_setspecific(path_root_key, path_roots);
+
+        r = &path_roots[path_root_next++ % nitems(path_roots)];
+        if (r->path != NULL) {
+                close(r->fd);
+                free(r->path);
+                free(r->real);
+        }
+        *r = (struct path_root){strdup(root), strdup(real), fd, s.st_dev, s.st_ino, ns_generation};
+        if (r->path == NULL || r->real == NULL) {
+                free(r->path);
+                free(r->real);
+                *r = (struct path_root){NULL, NULL, -1, 0, 0, 0};
+                goto fail;
+        }
+        return (r);
+
+ fail:
+        close(fd);
+        return (NULL);
+}
+
+/* Outcome of path_lookup, a deferred lookup is not an error. */
+enum {
+        PATH_LOOKUP_ERROR = -1,
+        PATH_LOOKUP_DEFER = 0,
+        PATH_LOOKUP_DONE  = 1,
+};
+
+/*
+ * path_lookup resolves path within root in a single openat2(RESOLVE_BENEATH) call and returns PATH_LOOKUP_DEFER
+ * whenever the result could differ from the one of path_walk, in which case the caller falls back to the latter.
+ * Absolute symlinks and symlinks climbing above root are rejected by the kernel and deferred as well.
+ * Like path_walk, trailing components which don't exist are kept as is.
+ */
+static int
+path_lookup(maybe_unused struct error *err, maybe_unused char *realpath, maybe_unused const char *root, maybe_unused const char *path)
+{
+#ifdef SYS_openat2
+        struct open_how how = {
+                .flags = O_PATH|O_CLOEXEC,
+                .resolve = RESOLVE_BENEATH|RESOLVE_NO_MAGICLINKS,
+        };
+        struct path_root *r;
+        char buf[PATH_MAX];
+        char proc[32];
+        char resolved[PATH_MAX];
+        char *ptr, *file;
+        const char *suffix;
+        size_t len, split;
+        ssize_t n;
+        int fd = -1;
+        int rv = PATH_LOOKUP_DEFER;
+
+        if (__atomic_load_n(&openat2_broken, __ATOMIC_RELAXED))
+                return (PATH_LOOKUP_DEFER);
+        if ((len = strlen(path)) >= sizeof(buf) || path_has_dotdot(path))
+                return (PATH_LOOKUP_DEFER);
+        if ((r = path_root_get(root)) == NULL)
+                return (PATH_LOOKUP_DEFER);
+
+        /* Strip trailing components until what remains exists. */
+        memcpy(buf, path, len + 1);
+        for (split = len;;) {
+                if (buf[strspn(buf, "/")] == '\0')
+                        break;
+                if ((fd = (int)syscall(SYS_openat2, r->fd, buf + strspn(buf, "/"), &how, sizeof(how))) >= 0)
+                        break;
+                if (errno == ENOSYS || errno == EPERM || errno == EINVAL || errno == E2BIG) {
+                        __atomic_store_n(&openat2_broken, true, __ATOMIC_RELAXED);
+                        return (PATH_LOOKUP_DEFER);
+                }
+                if (errno != ENOENT)
+                        return (PATH_LOOKUP_DEFER);
+                while (split > 0 && buf[split - 1] == '/')
+                        --split;
+                while (split > 0 && buf[split - 1] != '/')
+                        --split;
+                buf[split] = '\0';
+        }
+
+        suffix = "";
+        if (fd >= 0) {
+                snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+                if ((n = readlink(proc, resolved, sizeof(resolved))) <= 0 || (size_t)n >= sizeof(resolved))
                         goto fail;
-        } else {
-                if (path_join(err, buf, root, realpath) < 0)
+                resolved[n] = '\0';
+                len = str_equal(r->real, "/") ? 0 : strlen(r->real);
+                if (strncmp(resolved, r->real, len) || (resolved[len] != '/' && resolved[len] != '\0'))
                         goto fail;
+                suffix = resolved + len;
         }
-        rv = 0;
+
+        /*
+         * The first missing component must not exist at all (a dangling symlink would be followed by path_walk),
+         * past it path_walk doesn't resolve anything and simply appends the components.
+         */
+        memcpy(buf, path + split, strlen(path + split) + 1);
+        for (ptr = buf; (file = strsep(&ptr, "/")) != NULL;) {
+                if (*file == '\0' || str_equal(file, "."))
+                        continue;
+                if (fstatat(fd >= 0 ? fd : r->fd, file, &(struct stat){0}, AT_SYMLINK_NOFOLLOW) == 0 || errno != ENOENT)
+                        goto fail;
+                break;
+        }
+        if (path_new(err, realpath, suffix) < 0) {
+                rv = PATH_LOOKUP_ERROR;
+                goto fail;
+        }
+        memcpy(buf, path + split, strlen(path + split) + 1);
+        for (ptr = buf; (file = strsep(&ptr, "/")) != NULL;) {
+                if (*file == '\0' || str_equal(file, "."))
+                        continue;
+                if (path_append(err, realpath, file) < 0) {
+                        rv = PATH_LOOKUP_ERROR;
+                        goto fail;
+                }
+        }
+        rv = PATH_LOOKUP_DONE;
 
  fail:
         xclose(fd);
         return (rv);
+#else
+        return (PATH_LOOKUP_DEFER);
+#endif /* SYS_openat2 */
+}
+
+static int
+do_path_resolve(struct error *err, bool full, char *buf, const char *root, const char *path)
+{
+        char realpath[PATH_MAX];
+        int rv;
+
+        *realpath = '\0';
+        assert(*root == '/');
+
+        if ((rv = path_lookup(err, realpath, root, path)) == PATH_LOOKUP_ERROR)
+                return (-1);
+        if (rv == PATH_LOOKUP_DEFER && path_walk(err, realpath, root, path) < 0)
+                return (-1);
+
+        if (!full)
+                return (path_new(err, buf, realpath));
+        return (path_join(err, buf, root, realpath));
+}
+
+void
+path_resolve_flush(void)
+{
+        path_root_release(path_roots);
 }
 
 int
@@ -83,6 +83,7 @@ int path_append(struct error *, char *, const char *);
 int path_join(struct error *, char *, const char *, const char *);
 int path_resolve(struct error *, char *, const char *, const char *);
 int path_resolve_full(struct error *, char *, const char *, const char *);
+void path_resolve_flush(void);
 
 int perm_drop_privileges(struct error *, uid_t, gid_t, bool);
 int perm_set_bounds(struct error *, const cap_value_t [], size_t);
@@ -21,6 +21,7 @@
 static inline void xclose(int);
 static inline int  xopen(struct error *, const char *, int);
 static inline void *xcalloc(struct error *, size_t, size_t);
+static inline void *xreallocarray(struct error *, void *, size_t, size_t);
 static inline int  xstat(struct error *, const char *, struct stat *);
 static inline int  xlstat(struct error *, const char *, struct stat *);
 static inline FILE *xfopen(struct error *, const char *, const char *);
@@ -65,6 +66,16 @@ xcalloc(struct error *err, size_t nmemb, size_t size)
         return (p);
 }
 
+static inline void *
+xreallocarray(struct error *err, void *ptr, size_t nmemb, size_t size)
+{
+        void *p;
+
+        if ((p = reallocarray(ptr, nmemb, size)) == NULL)
+                error_set(err, "memory allocation failed");
+        return (p);
+}
+
 static inline int
 xstat(struct error *err, const char *path, struct stat *buf)
 {
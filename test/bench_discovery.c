@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ */
+
+/*
+ * Benchmark of the discovery path: nvc_init, nvc_driver_info_new and nvc_device_info_new are run in
+ * sequence for a number of iterations (each one with a fresh context) and the p50/p99 latency of every
+ * step is reported. Meant to be run against the stub NVML (see nvml_stub.c), syscall counts are gathered
+ * by running a single iteration under strace (see the bench target of the Makefile).
+ */
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nvc.h"
+
+enum { STEP_INIT, STEP_DRIVER, STEP_DEVICE, STEP_TOTAL, NSTEPS };
+
+static const char * const step_names[NSTEPS] = {
+        "nvc_init",
+        "nvc_driver_info_new",
+        "nvc_device_info_new",
+        "total",
+};
+
+static double now(void);
+static int compare_samples(const void *, const void *);
+static double percentile(double *, size_t, unsigned int);
+static void run(double [NSTEPS], const char *, size_t *);
+
+static double
+now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3);
+}
+
+static int
+compare_samples(const void *p1, const void *p2)
+{
+        double d1 = *(const double *)p1, d2 = *(const double *)p2;
+
+        return ((d1 > d2) - (d1 < d2));
+}
+
+static double
+percentile(double *samples, size_t n, unsigned int p)
+{
+        qsort(samples, n, sizeof(*samples), compare_samples);
+        return (samples[(n - 1) * p / 100]);
+}
+
+static void
+run(double samples[NSTEPS], const char *opts, size_t *ndevs)
+{
+        struct nvc_context *nvc;
+        struct nvc_config *cfg;
+        struct nvc_driver_info *drv;
+        struct nvc_device_info *dev;
+        double t0, t1, t2, t3;
+
+        if ((nvc = nvc_context_new()) == NULL || (cfg = nvc_config_new()) == NULL)
+                errx(EXIT_FAILURE, "memory allocation failed");
+
+        t0 = now();
+        if (nvc_init(nvc, cfg, opts) < 0)
+                errx(EXIT_FAILURE, "initialization error: %s", nvc_error(nvc));
+        t1 = now();
+        if ((drv = nvc_driver_info_new(nvc, NULL)) == NULL)
+                errx(EXIT_FAILURE, "detection error: %s", nvc_error(nvc));
+        t2 = now();
+        if ((dev = nvc_device_info_new(nvc, NULL)) == NULL)
+                errx(EXIT_FAILURE, "detection error: %s", nvc_error(nvc));
+        t3 = now();
+
+        samples[STEP_INIT] = t1 - t0;
+        samples[STEP_DRIVER] = t2 - t1;
+        samples[STEP_DEVICE] = t3 - t2;
+        samples[STEP_TOTAL] = t3 - t0;
+        *ndevs = dev->ngpus;
+
+        nvc_device_info_free(dev);
+        nvc_driver_info_free(drv);
+        nvc_shutdown(nvc);
+        nvc_config_free(cfg);
+        nvc_context_free(nvc);
+}
+
+int
+main(int argc, char *argv[])
+{
+        double *samples[NSTEPS];
+        double iter[NSTEPS];
+        const char *opts = "";
+        size_t n = 100;
+        size_t ndevs = 0;
+        int c;
+
+        while ((c = getopt(argc, argv, "n:o:")) != -1) {
+                switch (c) {
+                case 'n':
+                        if ((n = strtoul(optarg, NULL, 10)) == 0)
+                                errx(EXIT_FAILURE, "invalid iteration count: %s", optarg);
+                        break;
+                case 'o':
+                        opts = optarg;
+                        break;
+                default:
+                        fprintf(stderr, "usage: %s [-n iterations] [-o library options]\n", argv[0]);
+                        return (EXIT_FAILURE);
+                }
+        }
+
+        for (size_t i = 0; i < NSTEPS; ++i) {
+                if ((samples[i] = calloc(n, sizeof(*samples[i]))) == NULL)
+                        errx(EXIT_FAILURE, "memory allocation failed");
+        }
+        for (size_t i = 0; i < n; ++i) {
+                run(iter, opts, &ndevs);
+                for (size_t j = 0; j < NSTEPS; ++j)
+                        samples[j][i] = iter[j];
+        }
+
+        printf("iterations: %zu, devices: %zu\n", n, ndevs);
+        printf("%-24s %12s %12s\n", "step", "p50 (us)", "p99 (us)");
+        for (size_t i = 0; i < NSTEPS; ++i) {
+                printf("%-24s %12.0f %12.0f\n", step_names[i], percentile(samples[i], n, 50), percentile(samples[i], n, 99));
+                free(samples[i]);
+        }
+        return (EXIT_SUCCESS);
+}
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ */
+
+/*
+ * Benchmark of the ld.so.cache lookups of ldcache.c on synthetic glibc 2.2 format caches. For every cache size, it
+ * times ldcache_open (mapping and index build), a single ldcache_resolve pass over the native and 32-bit
+ * architectures, and the linear scan of the whole table once per architecture that ldcache_resolve replaced.
+ * The results of both lookups are checked to be identical and the p50/p99 latency of each is reported.
+ * The cache internals are needed to write the files, the benchmark is therefore built together with ldcache.c.
+ */
+
+#include "ldcache.c"
+
+#include <err.h>
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_ARCH   (LD_ELF_LIBC6|LD_X8664_LIB64)
+#define BENCH_ARCH32 (LD_ELF_LIBC6|LD_I386_LIB32)
+
+static const char * const bench_libs[] = {
+        "libnvidia-ml.so",
+        "libnvidia-cfg.so",
+        "libnvidia-nscq.so",
+        "libcuda.so",
+        "libcudadebugger.so",
+        "libnvidia-opencl.so",
+        "libnvidia-gpucomp.so",
+        "libnvidia-ptxjitcompiler.so",
+        "libnvidia-fatbinaryloader.so",
+        "libnvidia-allocator.so",
+        "libnvidia-compiler.so",
+        "libnvidia-pkcs11.so",
+        "libnvidia-nvvm.so",
+        "libnvidia-ngx.so",
+        "libvdpau_nvidia.so",
+        "libnvidia-encode.so",
+        "libnvidia-opticalflow.so",
+        "libnvcuvid.so",
+        "libnvidia-eglcore.so",
+        "libnvidia-glcore.so",
+        "libnvidia-tls.so",
+        "libnvidia-glsi.so",
+        "libnvidia-fbc.so",
+        "libnvidia-ifr.so",
+        "libnvidia-rtcore.so",
+        "libnvoptix.so",
+        "libGLX_nvidia.so",
+        "libEGL_nvidia.so",
+        "libGLESv2_nvidia.so",
+        "libGLESv1_CM_nvidia.so",
+        "libnvidia-glvkspirv.so",
+        "libnvidia-cbl.so",
+};
+
+static const size_t bench_sizes[] = {10000, 30000, 100000};
+
+static double now(void);
+static int compare_samples(const void *, const void *);
+static double percentile(double *, size_t, unsigned int);
+static void make_cache(const char *, size_t);
+static int select_first(struct error *, void *, const char *, const char *, const char *);
+static int legacy_resolve(struct ldcache *, uint32_t, const char *, const char * const [],
+    char *[], size_t, ldcache_select_fn, void *);
+static void free_paths(char *[], size_t);
+
+static double
+now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3);
+}
+
+static int
+compare_samples(const void *p1, const void *p2)
+{
+        double d1 = *(const double *)p1, d2 = *(const double *)p2;
+
+        return ((d1 > d2) - (d1 < d2));
+}
+
+static double
+percentile(double *samples, size_t n, unsigned int p)
+{
+        qsort(samples, n, sizeof(*samples), compare_samples);
+        return (samples[(n - 1) * p / 100]);
+}
+
+/*
+ * Write a cache of n entries: the driver libraries of bench_libs for both architectures, spread over the table,
+ * and filler libraries for the rest, half of them 32-bit.
+ */
+static void
+make_cache(const char *path, size_t n)
+{
+        struct header_libc6 *h;
+        char key[64], value[PATH_MAX];
+        size_t nlibs = nitems(bench_libs);
+        size_t stride = n / (2 * nlibs);
+        size_t strings = sizeof(*h) + n * sizeof(*h->libs);
+        size_t size = strings + n * (sizeof(key) + sizeof(value));
+        size_t off = strings;
+        FILE *fs;
+
+        if (n < 2 * nlibs)
+                errx(EXIT_FAILURE, "cache size too small: %zu", n);
+        if ((h = calloc(1, size)) == NULL)
+                errx(EXIT_FAILURE, "memory allocation failed");
+        memcpy(h->magic, MAGIC_LIBC6, MAGIC_LIBC6_LEN);
+        memcpy(h->version, MAGIC_VERSION, MAGIC_VERSION_LEN);
+        h->nlibs = (uint32_t)n;
+
+        for (size_t i = 0; i < n; ++i) {
+                bool lib32 = (i % 2 == 1);
+                const char *dir = lib32 ? "/usr/lib/i386-linux-gnu" : "/usr/lib/x86_64-linux-gnu";
+
+                if (i % stride == 0 && i / stride < 2 * nlibs) {
+                        lib32 = (i / stride >= nlibs);
+                        dir = lib32 ? "/usr/lib/i386-linux-gnu" : "/usr/lib/x86_64-linux-gnu";
+                        snprintf(key, sizeof(key), "%s.1", bench_libs[(i / stride) % nlibs]);
+                } else {
+                        snprintf(key, sizeof(key), "libfiller%zu.so.%zu", i / 2, i % 7);
+                }
+                snprintf(value, sizeof(value), "%s/%s", dir, key);
+
+                h->libs[i] = (struct entry_libc6){
+                        .flags = lib32 ? BENCH_ARCH32 : BENCH_ARCH,
+                        .key = (uint32_t)off,
+                        .value = (uint32_t)(off + strlen(key) + 1),
+                };
+                memcpy((char *)h + off, key, strlen(key) + 1);
+                off += strlen(key) + 1;
+                memcpy((char *)h + off, value, strlen(value) + 1);
+                off += strlen(value) + 1;
+        }
+
+        if ((fs = fopen(path, "w")) == NULL || fwrite(h, off, 1, fs) != 1 || fclose(fs) != 0)
+                err(EXIT_FAILURE, "could not write %s", path);
+        free(h);
+}
+
+static int
+select_first(maybe_unused struct error *err, maybe_unused void *ptr, maybe_unused const char *root,
+    const char *orig, maybe_unused const char *alt)
+{
+        return (orig == NULL);
+}
+
+/*
+ * The lookup ldcache_resolve replaced: a scan of the whole table, repeated for every architecture.
+ */
+static int
+legacy_resolve(struct ldcache *ctx, uint32_t arch, const char *root, const char * const libs[],
+    char *paths[], size_t size, ldcache_select_fn select, void *select_ctx)
+{
+        char path[PATH_MAX];
+        struct header_libc6 *h;
+        int override;
+
+        h = (struct header_libc6 *)ctx->ptr;
+        memset(paths, 0, size * sizeof(*paths));
+
+        for (uint32_t i = 0; i < h->nlibs; ++i) {
+                int32_t flags = h->libs[i].flags;
+                char *key = (char *)ctx->ptr + h->libs[i].key;
+                char *value = (char *)ctx->ptr + h->libs[i].value;
+
+                if (!(flags & LD_ELF) || (flags & LD_ARCH_MASK) != (int32_t)arch)
+                        continue;
+
+                for (size_t j = 0; j < size; ++j) {
+                        if (!str_has_prefix(key, libs[j]))
+                                continue;
+                        if (path_resolve(ctx->err, path, root, value) < 0)
+                                return (-1);
+                        if (paths[j] != NULL && str_equal(paths[j], path))
+                                continue;
+                        if ((override = select(ctx->err, select_ctx, root, paths[j], path)) < 0)
+                                return (-1);
+                        if (override) {
+                                free(paths[j]);
+                                paths[j] = xstrdup(ctx->err, path);
+                                if (paths[j] == NULL)
+                                        return (-1);
+                        }
+                        break;
+                }
+        }
+        return (0);
+}
+
+static void
+free_paths(char *paths[], size_t size)
+{
+        for (size_t i = 0; i < size; ++i) {
+                free(paths[i]);
+                paths[i] = NULL;
+        }
+}
+
+int
+main(int argc, char *argv[])
+{
+        struct error error = {0};
+        struct ldcache ld;
+        char path[] = "/tmp/bench-ldcache.XXXXXX";
+        const uint32_t archs[] = {LD_X8664_LIB64, LD_I386_LIB32};
+        char *paths[nitems(archs)][nitems(bench_libs)];
+        char *legacy[nitems(archs)][nitems(bench_libs)];
+        const size_t *sizes = bench_sizes;
+        size_t nsizes = nitems(bench_sizes);
+        size_t entries;
+        double *samples[3];
+        size_t n = 100;
+        int mismatches = 0;
+        int c, fd;
+
+        while ((c = getopt(argc, argv, "n:e:")) != -1) {
+                switch (c) {
+                case 'n':
+                        if ((n = strtoul(optarg, NULL, 10)) == 0)
+                                errx(EXIT_FAILURE, "invalid iteration count: %s", optarg);
+                        break;
+                case 'e':
+                        if ((entries = strtoul(optarg, NULL, 10)) == 0)
+                                errx(EXIT_FAILURE, "invalid cache size: %s", optarg);
+                        sizes = &entries;
+                        nsizes = 1;
+                        break;
+                default:
+                        fprintf(stderr, "usage: %s [-n iterations] [-e cache entries]\n", argv[0]);
+                        return (EXIT_FAILURE);
+                }
+        }
+
+        if ((fd = mkstemp(path)) < 0)
+                err(EXIT_FAILURE, "mkstemp failed");
+        close(fd);
+        for (size_t i = 0; i < nitems(samples); ++i) {
+                if ((samples[i] = calloc(n, sizeof(*samples[i]))) == NULL)
+                        errx(EXIT_FAILURE, "memory allocation failed");
+        }
+        memset(paths, 0, sizeof(paths));
+        memset(legacy, 0, sizeof(legacy));
+
+        printf("iterations: %zu, libraries: %zu, architectures: %zu\n", n, nitems(bench_libs), nitems(archs));
+        printf("%-10s %-10s %12s %12s %12s %12s %12s %12s\n", "entries", "results",
+            "open p50", "open p99", "resolve p50", "resolve p99", "scan p50", "scan p99");
+        for (size_t s = 0; s < nsizes; ++s) {
+                const char *status = "same";
+
+                make_cache(path, sizes[s]);
+                for (size_t j = 0; j < n; ++j) {
+                        double t0 = now();
+                        ldcache_init(&ld, &error, path);
+                        if (ldcache_open(&ld) < 0)
+                                errx(EXIT_FAILURE, "%s", error.msg);
+                        double t1 = now();
+                        if (ldcache_resolve(&ld, archs, (char **[]){paths[0], paths[1]}, nitems(archs), "/",
+                            bench_libs, nitems(bench_libs), select_first, NULL) < 0)
+                                errx(EXIT_FAILURE, "%s", error.msg);
+                        double t2 = now();
+                        for (size_t a = 0; a < nitems(archs); ++a) {
+                                if (legacy_resolve(&ld, archs[a], "/", bench_libs, legacy[a], nitems(bench_libs),
+                                    select_first, NULL) < 0)
+                                        errx(EXIT_FAILURE, "%s", error.msg);
+                        }
+                        double t3 = now();
+                        samples[0][j] = t1 - t0;
+                        samples[1][j] = t2 - t1;
+                        samples[2][j] = t3 - t2;
+
+                        for (size_t a = 0; a < nitems(archs); ++a) {
+                                for (size_t l = 0; l < nitems(bench_libs); ++l) {
+                                        if (paths[a][l] == NULL || legacy[a][l] == NULL || !str_equal(paths[a][l], legacy[a][l])) {
+                                                if (j == 0)
+                                                        warnx("%zu entries: %s: ldcache_resolve %s, scan %s", sizes[s], bench_libs[l],
+                                                            paths[a][l] ? paths[a][l] : "(none)", legacy[a][l] ? legacy[a][l] : "(none)");
+                                                status = "MISMATCH";
+                                        }
+                                }
+                                free_paths(paths[a], nitems(bench_libs));
+                                free_paths(legacy[a], nitems(bench_libs));
+                        }
+                        if (ldcache_close(&ld) < 0)
+                                errx(EXIT_FAILURE, "%s", error.msg);
+                }
+                if (str_equal(status, "MISMATCH"))
+                        ++mismatches;
+                printf("%-10zu %-10s %12.2f %12.2f %12.2f %12.2f %12.2f %12.2f\n", sizes[s], status,
+                    percentile(samples[0], n, 50), percentile(samples[0], n, 99),
+                    percentile(samples[1], n, 50), percentile(samples[1], n, 99),
+                    percentile(samples[2], n, 50), percentile(samples[2], n, 99));
+        }
+
+        unlink(path);
+        for (size_t i = 0; i < nitems(samples); ++i)
+                free(samples[i]);
+        error_reset(&error);
+        if (mismatches > 0)
+                warnx("ldcache_resolve and the table scan disagree on %d cache sizes", mismatches);
+        return (mismatches > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ */
+
+/*
+ * Benchmark of the two path resolvers of utils.c: path_lookup (a single openat2(RESOLVE_BENEATH) call) and path_walk
+ * (one readlinkat and openat per component). Both are run on the same paths of a scratch root, their results are
+ * checked to be identical whenever path_lookup doesn't defer to path_walk, and the p50/p99 latency of each is reported.
+ * Paths resolving outside of the root must be deferred by path_lookup and rejected by path_walk.
+ * The resolvers are internal, the benchmark is therefore built together with utils.c.
+ */
+
+#include "utils.c"
+
+#include <err.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <time.h>
+
+struct bench_case {
+        const char *name;
+        const char *path;
+        bool outside;
+};
+
+static const char * const bench_tree[][2] = {
+        {"usr/lib/x86_64-linux-gnu/libfoo.so.1", NULL},
+        {"usr/bin/nvidia-smi", NULL},
+        {"lib", "usr/lib"},
+        {"abs", "/usr/lib/x86_64-linux-gnu"},
+        {"usr/lib/up", "../../../../usr/bin"},
+        {"usr/lib/absup", "/../../usr/bin"},
+        {"dangling", "nonexistent"},
+};
+
+static const struct bench_case bench_cases[] = {
+        {"plain", "/usr/lib/x86_64-linux-gnu/libfoo.so.1", false},
+        {"relative symlink", "/lib/x86_64-linux-gnu/libfoo.so.1", false},
+        {"absolute symlink", "/abs/libfoo.so.1", false},
+        {"symlink above root", "/usr/lib/up/nvidia-smi", true},
+        {"absolute symlink above root", "/usr/lib/absup/nvidia-smi", true},
+        {"missing components", "/usr/lib/x86_64-linux-gnu/vdpau/libvdpau.so.1", false},
+        {"dangling symlink", "/dangling/file", false},
+        {"dot-dot", "/usr/lib/../bin/nvidia-smi", false},
+};
+
+static double now(void);
+static int compare_samples(const void *, const void *);
+static double percentile(double *, size_t, unsigned int);
+static void make_tree(const char *);
+static int remove_entry(const char *, const struct stat *, int, struct FTW *);
+
+static double
+now(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ((double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3);
+}
+
+static int
+compare_samples(const void *p1, const void *p2)
+{
+        double d1 = *(const double *)p1, d2 = *(const double *)p2;
+
+        return ((d1 > d2) - (d1 < d2));
+}
+
+static double
+percentile(double *samples, size_t n, unsigned int p)
+{
+        qsort(samples, n, sizeof(*samples), compare_samples);
+        return (samples[(n - 1) * p / 100]);
+}
+
+static void
+make_tree(const char *root)
+{
+        struct error err = {0};
+        char path[PATH_MAX];
+
+        for (size_t i = 0; i < nitems(bench_tree); ++i) {
+                if (path_join(&err, path, root, bench_tree[i][0]) < 0 ||
+                    file_create(&err, path, bench_tree[i][1], getuid(), getgid(), bench_tree[i][1] ? MODE_LNK(0777) : MODE_REG(0644)) < 0)
+                        errx(EXIT_FAILURE, "%s", err.msg);
+        }
+}
+
+static int
+remove_entry(const char *path, maybe_unused const struct stat *s, maybe_unused int flag, maybe_unused struct FTW *ftw)
+{
+        return (remove(path));
+}
+
+int
+main(int argc, char *argv[])
+{
+        struct error error = {0};
+        char root[] = "/tmp/bench-path-resolve.XXXXXX";
+        char lookup[PATH_MAX], walk[PATH_MAX];
+        double *samples[2];
+        size_t n = 10000;
+        int mismatches = 0;
+        int c, rv;
+
+        while ((c = getopt(argc, argv, "n:")) != -1) {
+                switch (c) {
+                case 'n':
+                        if ((n = strtoul(optarg, NULL, 10)) == 0)
+                                errx(EXIT_FAILURE, "invalid iteration count: %s", optarg);
+                        break;
+                default:
+                        fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+                        return (EXIT_FAILURE);
+                }
+        }
+
+        if (mkdtemp(root) == NULL)
+                err(EXIT_FAILURE, "mkdtemp failed");
+        make_tree(root);
+        for (size_t i = 0; i < nitems(samples); ++i) {
+                if ((samples[i] = calloc(n, sizeof(*samples[i]))) == NULL)
+                        errx(EXIT_FAILURE, "memory allocation failed");
+        }
+
+        printf("iterations: %zu\n", n);
+        printf("%-28s %-10s %12s %12s %12s %12s\n", "case", "lookup", "lookup p50", "lookup p99", "walk p50", "walk p99");
+        for (size_t i = 0; i < nitems(bench_cases); ++i) {
+                const struct bench_case *bc = &bench_cases[i];
+                const char *status;
+
+                if ((rv = path_lookup(&error, lookup, root, bc->path)) == PATH_LOOKUP_ERROR)
+                        errx(EXIT_FAILURE, "%s: %s", bc->name, error.msg);
+                if (bc->outside) {
+                        if (rv != PATH_LOOKUP_DEFER || path_walk(&error, walk, root, bc->path) == 0) {
+                                warnx("%s: resolved outside of the root", bc->name);
+                                ++mismatches;
+                        }
+                        error_reset(&error);
+                        printf("%-28s %s\n", bc->name, "rejected");
+                        continue;
+                }
+                if (path_walk(&error, walk, root, bc->path) < 0)
+                        errx(EXIT_FAILURE, "%s: %s", bc->name, error.msg);
+                if (rv == PATH_LOOKUP_DEFER)
+                        status = "fallback";
+                else if (str_equal(lookup, walk))
+                        status = "same";
+                else {
+                        status = "MISMATCH";
+                        warnx("%s: path_lookup %s, path_walk %s", bc->name, lookup, walk);
+                        ++mismatches;
+                }
+
+                for (size_t j = 0; j < n; ++j) {
+                        double t0 = now();
+                        path_lookup(&error, lookup, root, bc->path);
+                        double t1 = now();
+                        path_walk(&error, walk, root, bc->path);
+                        double t2 = now();
+                        samples[0][j] = t1 - t0;
+                        samples[1][j] = t2 - t1;
+                }
+                printf("%-28s %-10s %12.2f %12.2f %12.2f %12.2f\n", bc->name, status,
+                    percentile(samples[0], n, 50), percentile(samples[0], n, 99),
+                    percentile(samples[1], n, 50), percentile(samples[1], n, 99));
+        }
+
+        path_resolve_flush();
+        if (nftw(root, remove_entry, 16, FTW_DEPTH|FTW_PHYS) < 0)
+                warn("could not remove %s", root);
+        for (size_t i = 0; i < nitems(samples); ++i)
+                free(samples[i]);
+        if (mismatches > 0)
+                warnx("path_lookup and path_walk disagree on %d paths", mismatches);
+        return (mismatches > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stub NVML library simulating GPUs without any hardware, used to benchmark the discovery path.
+ * Load it through NVC_NVML_LIBRARY. The simulated topology and the latency of every call are read
+ * at initialization from the file given by NVML_STUB_CONFIG, as KEY=VALUE lines:
+ *
+ *     NVML_STUB_GPUS=8           number of GPUs (default 1)
+ *     NVML_STUB_MIG_DEVICES=7    MIG devices per GPU, 0 for GPUs without MIG support (default 0)
+ *     NVML_STUB_LATENCY_US=200   latency injected into every call in microseconds (default 0)
+ */
+
+#define NVML_NO_UNVERSIONED_FUNC_DEFS
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#pragma GCC visibility push(default)
+#include "nvml.h"
+#pragma GCC visibility pop
+
+#define MAX_GPUS        64
+#define MAX_MIG_DEVICES 7
+
+struct nvmlDevice_st {
+        unsigned int gpu;
+        unsigned int gi;
+        bool mig;
+};
+
+static struct {
+        pthread_mutex_t lock;
+        unsigned int refcount;
+        unsigned int ngpus;
+        unsigned int nmigs;
+        unsigned long latency;
+        struct nvmlDevice_st gpus[MAX_GPUS];
+        struct nvmlDevice_st migs[MAX_GPUS][MAX_MIG_DEVICES];
+} stub = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static int
+parse_config(const char *path)
+{
+        FILE *fs;
+        char *line = NULL;
+        size_t len = 0;
+        unsigned long val;
+        char key[64];
+        int rv = -1;
+
+        stub.ngpus = 1;
+        stub.nmigs = 0;
+        stub.latency = 0;
+        if (path == NULL || *path == '\0')
+                return (0);
+        if ((fs = fopen(path, "r")) == NULL)
+                return (-1);
+        while (getline(&line, &len, fs) >= 0) {
+                if (*line == '#' || *line == '\n')
+                        continue;
+                if (sscanf(line, " %63[A-Z_] = %lu", key, &val) != 2)
+                        goto fail;
+                if (!strcmp(key, "NVML_STUB_GPUS") && val > 0 && val <= MAX_GPUS)
+                        stub.ngpus = (unsigned int)val;
+                else if (!strcmp(key, "NVML_STUB_MIG_DEVICES") && val <= MAX_MIG_DEVICES)
+                        stub.nmigs = (unsigned int)val;
+                else if (!strcmp(key, "NVML_STUB_LATENCY_US"))
+                        stub.latency = val;
+                else
+                        goto fail;
+        }
+        rv = 0;
+
+ fail:
+        free(line);
+        fclose(fs);
+        return (rv);
+}
+
+static void
+delay(void)
+{
+        struct timespec ts = {
+                .tv_sec = (time_t)(stub.latency / 1000000),
+                .tv_nsec = (long)(stub.latency % 1000000) * 1000,
+        };
+
+        if (stub.latency == 0)
+                return;
+        while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+}
+
+static nvmlReturn_t
+check_device(nvmlDevice_t dev)
+{
+        delay();
+        if (stub.refcount == 0)
+                return (NVML_ERROR_UNINITIALIZED);
+        if (dev == NULL || dev->gpu >= stub.ngpus)
+                return (NVML_ERROR_INVALID_ARGUMENT);
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlInit_v2(void)
+{
+        nvmlReturn_t rv = NVML_SUCCESS;
+
+        pthread_mutex_lock(&stub.lock);
+        if (stub.refcount == 0) {
+                if (parse_config(getenv("NVML_STUB_CONFIG")) < 0) {
+                        rv = NVML_ERROR_UNKNOWN;
+                        goto fail;
+                }
+                for (unsigned int i = 0; i < stub.ngpus; ++i) {
+                        stub.gpus[i] = (struct nvmlDevice_st){i, 0, false};
+                        for (unsigned int j = 0; j < stub.nmigs; ++j)
+                                stub.migs[i][j] = (struct nvmlDevice_st){i, j + 1, true};
+                }
+        }
+        ++stub.refcount;
+
+ fail:
+        pthread_mutex_unlock(&stub.lock);
+        delay();
+        return (rv);
+}
+
+nvmlReturn_t
+nvmlShutdown(void)
+{
+        nvmlReturn_t rv = NVML_SUCCESS;
+
+        pthread_mutex_lock(&stub.lock);
+        if (stub.refcount == 0)
+                rv = NVML_ERROR_UNINITIALIZED;
+        else
+                --stub.refcount;
+        pthread_mutex_unlock(&stub.lock);
+        delay();
+        return (rv);
+}
+
+const char *
+nvmlErrorString(nvmlReturn_t result)
+{
+        switch (result) {
+        case NVML_SUCCESS:
+                return ("Success");
+        case NVML_ERROR_UNINITIALIZED:
+                return ("Uninitialized");
+        case NVML_ERROR_INVALID_ARGUMENT:
+                return ("Invalid Argument");
+        case NVML_ERROR_NOT_SUPPORTED:
+                return ("Not Supported");
+        case NVML_ERROR_INSUFFICIENT_SIZE:
+                return ("Insufficient Size");
+        case NVML_ERROR_NOT_FOUND:
+                return ("Not Found");
+        default:
+                return ("Unknown Error");
+        }
+}
+
+nvmlReturn_t
+nvmlSystemGetDriverVersion(char *version, unsigned int length)
+{
+        delay();
+        if (snprintf(version, length, "%s", "999.99.99") >= (int)length)
+                return (NVML_ERROR_INSUFFICIENT_SIZE);
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlSystemGetCudaDriverVersion(int *version)
+{
+        delay();
+        *version = 12040;
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetCount_v2(unsigned int *count)
+{
+        delay();
+        if (stub.refcount == 0)
+                return (NVML_ERROR_UNINITIALIZED);
+        *count = stub.ngpus;
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetHandleByIndex_v2(unsigned int index, nvmlDevice_t *dev)
+{
+        delay();
+        if (stub.refcount == 0)
+                return (NVML_ERROR_UNINITIALIZED);
+        if (index >= stub.ngpus)
+                return (NVML_ERROR_INVALID_ARGUMENT);
+        *dev = &stub.gpus[index];
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetName(nvmlDevice_t dev, char *name, unsigned int length)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        if (snprintf(name, length, "NVIDIA Stub GPU%s", dev->mig ? " MIG 1g.10gb" : "") >= (int)length)
+                return (NVML_ERROR_INSUFFICIENT_SIZE);
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetUUID(nvmlDevice_t dev, char *uuid, unsigned int length)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        if (snprintf(uuid, length, "%s-00000000-0000-0000-%04x-%012x",
+            dev->mig ? "MIG" : "GPU", dev->gi, dev->gpu) >= (int)length)
+                return (NVML_ERROR_INSUFFICIENT_SIZE);
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetPciInfo(nvmlDevice_t dev, nvmlPciInfo_t *pci)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        memset(pci, 0, sizeof(*pci));
+        pci->domain = 0;
+        pci->bus = dev->gpu + 1;
+        pci->device = 0;
+        pci->pciDeviceId = 0x20b010de;
+        snprintf(pci->busIdLegacy, sizeof(pci->busIdLegacy), NVML_DEVICE_PCI_BUS_ID_LEGACY_FMT, 0, pci->bus, 0);
+        snprintf(pci->busId, sizeof(pci->busId), NVML_DEVICE_PCI_BUS_ID_FMT, 0, pci->bus, 0);
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetPciInfo_v3(nvmlDevice_t dev, nvmlPciInfo_t *pci)
+{
+        return (nvmlDeviceGetPciInfo(dev, pci));
+}
+
+nvmlReturn_t
+nvmlDeviceGetCudaComputeCapability(nvmlDevice_t dev, int *major, int *minor)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        *major = 8;
+        *minor = 0;
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetBrand(nvmlDevice_t dev, nvmlBrandType_t *brand)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        *brand = NVML_BRAND_NVIDIA;
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetMinorNumber(nvmlDevice_t dev, unsigned int *minor)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        *minor = dev->gpu;
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetMigMode(nvmlDevice_t dev, unsigned int *current, unsigned int *pending)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        if (stub.nmigs == 0 || dev->mig)
+                return (NVML_ERROR_NOT_SUPPORTED);
+        *current = *pending = NVML_DEVICE_MIG_ENABLE;
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetMaxMigDeviceCount(nvmlDevice_t dev, unsigned int *count)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        if (stub.nmigs == 0 || dev->mig)
+                return (NVML_ERROR_NOT_SUPPORTED);
+        *count = stub.nmigs;
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetMigDeviceHandleByIndex(nvmlDevice_t dev, unsigned int index, nvmlDevice_t *mig)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        if (dev->mig)
+                return (NVML_ERROR_NOT_SUPPORTED);
+        if (index >= stub.nmigs)
+                return (NVML_ERROR_NOT_FOUND);
+        *mig = &stub.migs[dev->gpu][index];
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetGpuInstanceId(nvmlDevice_t dev, unsigned int *id)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        if (!dev->mig)
+                return (NVML_ERROR_NOT_SUPPORTED);
+        *id = dev->gi;
+        return (NVML_SUCCESS);
+}
+
+nvmlReturn_t
+nvmlDeviceGetComputeInstanceId(nvmlDevice_t dev, unsigned int *id)
+{
+        nvmlReturn_t rv;
+
+        if ((rv = check_device(dev)) != NVML_SUCCESS)
+                return (rv);
+        if (!dev->mig)
+                return (NVML_ERROR_NOT_SUPPORTED);
+        *id = 0;
+        return (NVML_SUCCESS);
+}
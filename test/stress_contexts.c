@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ */
+
+/*
+ * Stress test of concurrent library contexts: every thread repeatedly creates its own context and runs nvc_init,
+ * nvc_driver_info_new and nvc_device_info_new on it before tearing it down. Meant to be run against the stub NVML
+ * (see nvml_stub.c), the device information returned by every context is checked against the first one.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nvc.h"
+
+struct worker {
+        pthread_t tid;
+        unsigned int id;
+        size_t iterations;
+        size_t failures;
+};
+
+static void *run(void *);
+static bool check_devices(const struct nvc_device_info *);
+
+static const char *opts = "";
+static pthread_mutex_t reference_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t reference_ngpus = SIZE_MAX;
+static char **reference_uuids;
+
+static bool
+check_devices(const struct nvc_device_info *dev)
+{
+        bool ok = true;
+
+        pthread_mutex_lock(&reference_mutex);
+        if (reference_ngpus == SIZE_MAX) {
+                if ((reference_uuids = calloc(dev->ngpus, sizeof(*reference_uuids))) == NULL)
+                        errx(EXIT_FAILURE, "memory allocation failed");
+                for (size_t i = 0; i < dev->ngpus; ++i) {
+                        if ((reference_uuids[i] = strdup(dev->gpus[i].uuid)) == NULL)
+                                errx(EXIT_FAILURE, "memory allocation failed");
+                }
+                reference_ngpus = dev->ngpus;
+        } else if (dev->ngpus != reference_ngpus) {
+                ok = false;
+        } else {
+                for (size_t i = 0; i < dev->ngpus && ok; ++i)
+                        ok = (strcmp(dev->gpus[i].uuid, reference_uuids[i]) == 0);
+        }
+        pthread_mutex_unlock(&reference_mutex);
+        return (ok);
+}
+
+static void *
+run(void *arg)
+{
+        struct worker *w = arg;
+        struct nvc_context *nvc;
+        struct nvc_config *cfg;
+        struct nvc_driver_info *drv;
+        struct nvc_device_info *dev;
+        bool ok;
+
+        for (size_t i = 0; i < w->iterations; ++i) {
+                drv = NULL;
+                dev = NULL;
+                ok = false;
+                if ((nvc = nvc_context_new()) == NULL || (cfg = nvc_config_new()) == NULL)
+                        errx(EXIT_FAILURE, "memory allocation failed");
+
+                if (nvc_init(nvc, cfg, opts) < 0)
+                        warnx("thread %u, iteration %zu: initialization error: %s", w->id, i, nvc_error(nvc));
+                else if ((drv = nvc_driver_info_new(nvc, NULL)) == NULL)
+                        warnx("thread %u, iteration %zu: driver error: %s", w->id, i, nvc_error(nvc));
+                else if ((dev = nvc_device_info_new(nvc, NULL)) == NULL)
+                        warnx("thread %u, iteration %zu: device error: %s", w->id, i, nvc_error(nvc));
+                else if (!(ok = check_devices(dev)))
+                        warnx("thread %u, iteration %zu: device information mismatch", w->id, i);
+                if (!ok)
+                        ++w->failures;
+
+                nvc_device_info_free(dev);
+                nvc_driver_info_free(drv);
+                nvc_shutdown(nvc);
+                nvc_config_free(cfg);
+                nvc_context_free(nvc);
+        }
+        return (NULL);
+}
+
+int
+main(int argc, char *argv[])
+{
+        struct worker *workers;
+        size_t nthreads = 8;
+        size_t n = 20;
+        size_t failures = 0;
+        int c;
+
+        while ((c = getopt(argc, argv, "t:n:o:")) != -1) {
+                switch (c) {
+                case 't':
+                        if ((nthreads = strtoul(optarg, NULL, 10)) == 0)
+                                errx(EXIT_FAILURE, "invalid thread count: %s", optarg);
+                        break;
+                case 'n':
+                        if ((n = strtoul(optarg, NULL, 10)) == 0)
+                                errx(EXIT_FAILURE, "invalid iteration count: %s", optarg);
+                        break;
+                case 'o':
+                        opts = optarg;
+                        break;
+                default:
+                        fprintf(stderr, "usage: %s [-t threads] [-n iterations] [-o library options]\n", argv[0]);
+                        return (EXIT_FAILURE);
+                }
+        }
+
+        if ((workers = calloc(nthreads, sizeof(*workers))) == NULL)
+                errx(EXIT_FAILURE, "memory allocation failed");
+        for (size_t i = 0; i < nthreads; ++i) {
+                workers[i] = (struct worker){.id = (unsigned int)i, .iterations = n};
+                if ((errno = pthread_create(&workers[i].tid, NULL, run, &workers[i])) != 0)
+                        err(EXIT_FAILURE, "thread creation failed");
+        }
+        for (size_t i = 0; i < nthreads; ++i) {
+                pthread_join(workers[i].tid, NULL);
+                failures += workers[i].failures;
+        }
+
+        printf("threads: %zu, iterations: %zu, devices: %zu, failures: %zu\n", nthreads, n,
+            reference_ngpus == SIZE_MAX ? 0 : reference_ngpus, failures);
+        for (size_t i = 0; reference_ngpus != SIZE_MAX && i < reference_ngpus; ++i)
+                free(reference_uuids[i]);
+        free(reference_uuids);
+        free(workers);
+        return (failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+ */
+
+/*
+ * Tests of the JSON output of mount plans (plan_to_json), as printed by nvidia-container-cli configure --dry-run,
+ * for every operation and combination of mount flags and action options. The plan functions are internal,
+ * the test is therefore built together with mount_plan.c.
+ */
+
+#include "mount_plan.c"
+
+#include <sys/sysmacros.h>
+
+#include <err.h>
+#include <stdbool.h>
+
+struct test_action {
+        enum plan_op op;
+        const char *src;
+        const char *dst;
+        unsigned long flags;
+        mode_t mode;
+        unsigned int major;
+        unsigned int minor;
+        int opts;
+};
+
+struct test_case {
+        const char *name;
+        const struct test_action *actions;
+        size_t nactions;
+        const char *json;
+};
+
+#define TEST_CASE(name, json, ...) \
+        {name, (const struct test_action[]){__VA_ARGS__}, nitems(((const struct test_action[]){__VA_ARGS__})), json}
+
+static const struct test_case test_cases[] = {
+        {"empty plan", NULL, 0, "[]"},
+        TEST_CASE("mkdir",
+            "[{\"op\": \"mkdir\", \"dst\": \"/run/nvidia-persistenced\", \"mode\": \"0755\"}]",
+            {PLAN_MKDIR, NULL, "/run/nvidia-persistenced", 0, 040755, 0, 0, 0}),
+        TEST_CASE("bind without flags",
+            "[{\"op\": \"bind\", \"src\": \"/a\", \"dst\": \"/b\", \"flags\": []}]",
+            {PLAN_BIND, "/a", "/b", 0, 0, 0, 0, 0}),
+        TEST_CASE("bind with all flags",
+            "[{\"op\": \"bind\", \"src\": \"/usr/bin/nvidia-smi\", \"dst\": \"/usr/bin/nvidia-smi\", "
+            "\"flags\": [\"ro\", \"nosuid\", \"nodev\", \"noexec\"]}]",
+            {PLAN_BIND, "/usr/bin/nvidia-smi", "/usr/bin/nvidia-smi", MS_RDONLY|MS_NOSUID|MS_NODEV|MS_NOEXEC, 0, 0, 0, 0}),
+        TEST_CASE("optional bind of a device",
+            "[{\"op\": \"bind\", \"src\": \"/dev/nvidia-uvm\", \"dst\": \"/dev/nvidia-uvm\", \"flags\": [\"nosuid\", \"noexec\"], "
+            "\"device\": \"235:0\", \"optional\": true}]",
+            {PLAN_BIND, "/dev/nvidia-uvm", "/dev/nvidia-uvm", MS_NOSUID|MS_NOEXEC, 0, 235, 0, PLAN_OPT_OPTIONAL}),
+        TEST_CASE("mknod",
+            "[{\"op\": \"mknod\", \"src\": \"/dev/nvidia0\", \"dst\": \"/dev/nvidia0\", \"flags\": [\"ro\", \"nosuid\", \"noexec\"], "
+            "\"device\": \"195:0\"}]",
+            {PLAN_MKNOD, "/dev/nvidia0", "/dev/nvidia0", MS_RDONLY|MS_NOSUID|MS_NOEXEC, 0, 195, 0, 0}),
+        TEST_CASE("tmpfs",
+            "[{\"op\": \"tmpfs\", \"dst\": \"/proc/driver/nvidia\", \"flags\": [\"nosuid\", \"nodev\", \"noexec\"]}]",
+            {PLAN_TMPFS, NULL, "/proc/driver/nvidia", MS_NOSUID|MS_NODEV|MS_NOEXEC, 0, 0, 0, 0}),
+        TEST_CASE("copy with regular and params options (not printed)",
+            "[{\"op\": \"copy\", \"src\": \"/proc/driver/nvidia/params\", \"dst\": \"/proc/driver/nvidia/params\"}]",
+            {PLAN_COPY, "/proc/driver/nvidia/params", "/proc/driver/nvidia/params", 0, 0, 0, 0, PLAN_OPT_REGULAR|PLAN_OPT_PARAMS}),
+        TEST_CASE("symlink",
+            "[{\"op\": \"symlink\", \"src\": \"libcuda.so.1\", \"dst\": \"/usr/lib64/libcuda.so\"}]",
+            {PLAN_SYMLINK, "libcuda.so.1", "/usr/lib64/libcuda.so", 0, 0, 0, 0, 0}),
+        TEST_CASE("replacing symlink",
+            "[{\"op\": \"symlink\", \"src\": \"/usr/lib/nvidia/bundles/550.54/lib/libcuda.so.1\", \"dst\": \"/usr/lib64/libcuda.so.1\", "
+            "\"replace\": true}]",
+            {PLAN_SYMLINK, "/usr/lib/nvidia/bundles/550.54/lib/libcuda.so.1", "/usr/lib64/libcuda.so.1", 0, 0, 0, 0, PLAN_OPT_REPLACE}),
+        TEST_CASE("optional replacing symlink",
+            "[{\"op\": \"symlink\", \"src\": \"a\", \"dst\": \"/b\", \"optional\": true, \"replace\": true}]",
+            {PLAN_SYMLINK, "a", "/b", 0, 0, 0, 0, PLAN_OPT_OPTIONAL|PLAN_OPT_REPLACE}),
+        TEST_CASE("profile and cgroup always carry a device",
+            "[{\"op\": \"profile\", \"device\": \"0:0\"},\n {\"op\": \"cgroup\", \"device\": \"195:255\"}]",
+            {PLAN_PROFILE, NULL, NULL, 0, 0, 0, 0, 0},
+            {PLAN_CGROUP, NULL, NULL, 0, 0, 195, 255, 0}),
+        TEST_CASE("string escaping",
+            "[{\"op\": \"symlink\", \"src\": \"a\\\"b\\\\c\\u000ad\", \"dst\": \"/tab\\u0009\"}]",
+            {PLAN_SYMLINK, "a\"b\\c\nd", "/tab\t", 0, 0, 0, 0, 0}),
+        TEST_CASE("several actions",
+            "[{\"op\": \"tmpfs\", \"dst\": \"/proc/driver/nvidia\", \"flags\": []},\n"
+            " {\"op\": \"bind\", \"src\": \"/x\", \"dst\": \"/y\", \"flags\": [\"ro\"]},\n"
+            " {\"op\": \"cgroup\", \"device\": \"195:0\"}]",
+            {PLAN_TMPFS, NULL, "/proc/driver/nvidia", 0, 0, 0, 0, 0},
+            {PLAN_BIND, "/x", "/y", MS_RDONLY, 0, 0, 0, 0},
+            {PLAN_CGROUP, NULL, NULL, 0, 0, 195, 0, 0}),
+};
+
+static bool run(const struct test_case *);
+
+static bool
+run(const struct test_case *tc)
+{
+        struct error err = {0};
+        struct mount_plan plan = {0};
+        struct plan_action *a;
+        char *json = NULL;
+        bool ok = false;
+
+        for (size_t i = 0; i < tc->nactions; ++i) {
+                const struct test_action *ta = &tc->actions[i];
+
+                if ((a = plan_add(&err, &plan, ta->op, ta->src, ta->dst)) == NULL)
+                        goto fail;
+                a->flags = ta->flags;
+                a->mode = ta->mode;
+                a->dev = makedev(ta->major, ta->minor);
+                a->opts = ta->opts;
+        }
+        if (plan_to_json(&err, &plan, &json) < 0)
+                goto fail;
+        if (!(ok = str_equal(json, tc->json)))
+                warnx("%s: got\n%s\nexpected\n%s", tc->name, json, tc->json);
+
+ fail:
+        if (err.code != 0)
+                warnx("%s: %s", tc->name, err.msg);
+        free(json);
+        plan_free(&plan);
+        error_reset(&err);
+        return (ok);
+}
+
+int
+main(void)
+{
+        size_t failures = 0;
+
+        for (size_t i = 0; i < nitems(test_cases); ++i) {
+                bool ok = run(&test_cases[i]);
+                printf("%-56s %s\n", test_cases[i].name, ok ? "ok" : "FAIL");
+                if (!ok)
+                        ++failures;
+        }
+        printf("%zu tests, %zu failures\n", nitems(test_cases), failures);
+        return (failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}